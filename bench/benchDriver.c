@@ -0,0 +1,250 @@
+/*
+Filename: benchDriver.c
+Author: Benjamin Baird
+Date Created: October 19, 2026
+Last Updated: October 19, 2026
+Description: End-to-end benchmark. Times the offline build of a corpus
+             (throughput, CPU, peak RSS), the retriever's index load, and a
+             fixed query set (p50/p95/p99 latency), then appends the results
+             as one JSON object per line to a results file.
+             Usage: benchDriver -c corpus.txt -q queries.txt [-i indexer] [-w workdir]
+                                [-o results.jsonl] [-l label] [-r repeats]
+*/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+#ifndef WAIT_H_INCLUDED
+#define WAIT_H_INCLUDED
+#include <sys/wait.h>
+#endif
+
+#ifndef RESOURCE_H_INCLUDED
+#define RESOURCE_H_INCLUDED
+#include <sys/resource.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "../engine.h"
+#endif
+
+#ifndef QUERYLOG_H_INCLUDED
+#define QUERYLOG_H_INCLUDED
+#include "queryLog.h"
+#endif
+
+double now () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***
+    Compare function for qsort, ascending doubles
+***/
+int cmpDouble (const void *pa, const void *pb) {
+    double a = *(const double*)pa;
+    double b = *(const double*)pb;
+    return (a > b) - (a < b);
+}
+
+/***
+    @return : the p-th percentile of sorted values (nearest rank)
+***/
+double percentile (double sorted[], long count, double p) {
+    if (count == 0)
+        return 0;
+    long rank = (long)(p / 100.0 * count + 0.999999) - 1;
+    if (rank < 0)
+        rank = 0;
+    if (rank >= count)
+        rank = count - 1;
+    return sorted[rank];
+}
+
+/***
+    Runs the indexer on the corpus in the current directory
+    @return 0 : success, with the wall time, CPU time and peak RSS filled in
+    @return -1 : the indexer could not be run or failed
+***/
+int runIndexer (char *indexer, char *corpus, double *wall, double *cpu, long *peakKb) {
+    double start = now();
+    pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0)
+            dup2(devNull, STDOUT_FILENO);
+        execl(indexer, indexer, corpus, (char*)NULL);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0)
+        return -1;
+    *wall = now() - start;
+    *cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    *peakKb = usage.ru_maxrss;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+void usage (char *name) {
+    printf("Usage: %s -c corpus.txt -q queries.txt [-i indexer] [-w workdir]"
+           " [-o results.jsonl] [-l label] [-r repeats]\n", name);
+}
+
+int main (int argc, char *argv[]) {
+    char *corpus = NULL;
+    char *queryPath = NULL;
+    char *indexer = "../../indexer";
+    char *workdir = "bench/work";
+    char *output = "bench/results.jsonl";
+    char *label = "";
+    long repeats = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:q:i:w:o:l:r:")) != -1) {
+        switch (opt) {
+            case 'c': corpus = optarg; break;
+            case 'q': queryPath = optarg; break;
+            case 'i': indexer = optarg; break;
+            case 'w': workdir = optarg; break;
+            case 'o': output = optarg; break;
+            case 'l': label = optarg; break;
+            case 'r': repeats = atol(optarg); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (corpus == NULL || queryPath == NULL || repeats < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Paths are resolved before moving into the work directory
+    char *corpusAbs = realpath(corpus, NULL);
+    char *indexerAbs = realpath(indexer, NULL);
+    struct stat info;
+    if (corpusAbs == NULL || indexerAbs == NULL || stat(corpusAbs, &info) != 0) {
+        printf("Error: corpus %s or indexer %s not found\n", corpus, indexer);
+        return 1;
+    }
+    long queriesCount = 0;
+    char **queries = loadQueries(queryPath, &queriesCount);
+    if (queries == NULL) {
+        printf("Error loading %s\n", queryPath);
+        return 1;
+    }
+    FILE *out = fopen(output, "a");
+    if (out == NULL) {
+        printf("Error opening %s\n", output);
+        return 1;
+    }
+    mkdir(workdir, 0755);
+    if (chdir(workdir) != 0) {
+        printf("Error entering %s\n", workdir);
+        return 1;
+    }
+
+    // Offline build
+    double buildWall = 0;
+    double buildCpu = 0;
+    long buildPeakKb = 0;
+    if (runIndexer(indexerAbs, corpusAbs, &buildWall, &buildCpu, &buildPeakKb) != 0) {
+        printf("Error running %s\n", indexerAbs);
+        return 1;
+    }
+    double corpusMb = info.st_size / 1048576.0;
+    printf("build    : %.2f s wall, %.2f s cpu, %.3f MB/s, peak RSS %ld KB\n",
+           buildWall, buildCpu, corpusMb / buildWall, buildPeakKb);
+
+    // Retriever startup
+    Index index;
+    double start = now();
+    if (loadIndex(&index) != 0) {
+        printf("Error loading the index\n");
+        return 1;
+    }
+    double startup = now() - start;
+    struct rusage self;
+    getrusage(RUSAGE_SELF, &self);
+    printf("startup  : %.3f s, %ld docs, %ld terms, %ld postings, RSS %ld KB\n",
+           startup, index.numDocs, index.dictSize, index.postSize, self.ru_maxrss);
+
+    // Query set
+    long numRuns = queriesCount * repeats;
+    double *latency = malloc(sizeof(double)*(numRuns > 0 ? numRuns : 1));
+    double queryStart = now();
+    for (long r = 0; r < repeats; r++) {
+        for (long q = 0; q < queriesCount; q++) {
+            double t = now();
+            double **results = retrieveResults(queries[q], &index, NULL);
+            freeResults(results, index.numDocs);
+            latency[r*queriesCount + q] = (now() - t) * 1000.0;
+        }
+    }
+    double queryWall = now() - queryStart;
+    qsort(latency, numRuns, sizeof(double), cmpDouble);
+    double p50 = percentile(latency, numRuns, 50);
+    double p95 = percentile(latency, numRuns, 95);
+    double p99 = percentile(latency, numRuns, 99);
+    double maxMs = (numRuns > 0) ? latency[numRuns-1] : 0;
+    printf("queries  : %ld in %.2f s, %.1f qps, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           numRuns, queryWall, numRuns / queryWall, p50, p95, p99, maxMs);
+
+    fprintf(out, "{\"label\":\"%s\",\"time\":%ld,\"corpus\":\"%s\",\"corpus_bytes\":%lld,"
+            "\"docs\":%ld,\"terms\":%ld,\"postings\":%ld,"
+            "\"build_s\":%.4f,\"build_cpu_s\":%.4f,\"build_mb_per_s\":%.3f,\"build_peak_rss_kb\":%ld,"
+            "\"startup_s\":%.4f,\"retriever_rss_kb\":%ld,"
+            "\"queries\":%ld,\"qps\":%.2f,\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}\n",
+            label, (long)time(NULL), corpusAbs, (long long)info.st_size,
+            index.numDocs, index.dictSize, index.postSize,
+            buildWall, buildCpu, corpusMb / buildWall, buildPeakKb,
+            startup, self.ru_maxrss,
+            numRuns, numRuns / queryWall, p50, p95, p99, maxMs);
+    fclose(out);
+
+    for (long q = 0; q < queriesCount; q++)
+        free(queries[q]);
+    free(queries);
+    free(latency);
+    freeIndex(&index);
+    free(corpusAbs);
+    free(indexerAbs);
+    return 0;
+}
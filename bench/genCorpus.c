@@ -0,0 +1,184 @@
+/*
+Filename: genCorpus.c
+Author: Benjamin Baird
+Date Created: October 19, 2026
+Last Updated: October 19, 2026
+Description: Writes a reproducible synthetic $DOC/$TITLE/$BODY corpus, and
+             optionally a query set, with Zipfian term frequencies.
+             The same options and seed always give the same files.
+             Usage: genCorpus -o corpus.txt [-m megabytes] [-s seed] [-v vocabulary]
+                              [-z exponent] [-q queries.txt] [-n numQueries]
+*/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+// Words per body line
+#define LINE_WORDS 12
+
+/***
+    xorshift64* generator, used instead of rand() so corpora are identical
+    on every platform
+***/
+unsigned long long nextRandom (unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/***
+    @return : uniform double in [0, 1)
+***/
+double uniform (unsigned long long *state) {
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/***
+    Draws a term rank from the Zipf distribution's cumulative table
+    @return : rank in [0, vocabulary)
+***/
+long zipfRank (double cdf[], long vocabulary, unsigned long long *state) {
+    double u = uniform(state) * cdf[vocabulary-1];
+    long low = 0;
+    long high = vocabulary - 1;
+    while (low < high) {
+        long middle = (low + high) / 2;
+        if (cdf[middle] < u)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/***
+    Spells the word for a rank, lower ranks get shorter words
+***/
+void rankWord (long rank, char *word) {
+    static const char *consonants = "bcdfghjklmnprstvwz";
+    static const char *vowels = "aeiou";
+    int length = 0;
+    do {
+        word[length++] = consonants[rank % 18];
+        rank /= 18;
+        word[length++] = vowels[rank % 5];
+        rank /= 5;
+    } while (rank > 0);
+    word[length] = '\0';
+}
+
+int main (int argc, char *argv[]) {
+    char *corpusPath = NULL;
+    char *queryPath = NULL;
+    double megabytes = 10;
+    unsigned long long seed = 1;
+    long vocabulary = 200000;
+    double exponent = 1.0;
+    long numQueries = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:m:s:v:z:q:n:")) != -1) {
+        switch (opt) {
+            case 'o': corpusPath = optarg; break;
+            case 'm': megabytes = atof(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 'v': vocabulary = atol(optarg); break;
+            case 'z': exponent = atof(optarg); break;
+            case 'q': queryPath = optarg; break;
+            case 'n': numQueries = atol(optarg); break;
+            default:
+                printf("Usage: %s -o corpus.txt [-m megabytes] [-s seed] [-v vocabulary]"
+                       " [-z exponent] [-q queries.txt] [-n numQueries]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (corpusPath == NULL || vocabulary < 1 || megabytes <= 0) {
+        printf("Usage: %s -o corpus.txt [-m megabytes] [-s seed] [-v vocabulary]"
+               " [-z exponent] [-q queries.txt] [-n numQueries]\n", argv[0]);
+        return 1;
+    }
+
+    double *cdf = malloc(sizeof(double)*vocabulary);
+    double total = 0;
+    for (long r = 0; r < vocabulary; r++) {
+        total += 1.0 / pow((double)(r + 1), exponent);
+        cdf[r] = total;
+    }
+
+    FILE *fp = fopen(corpusPath, "w");
+    if (fp == NULL) {
+        printf("Error creating %s\n", corpusPath);
+        free(cdf);
+        return 1;
+    }
+    setvbuf(fp, NULL, _IOFBF, 1048576);
+
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    long long target = (long long)(megabytes * 1048576);
+    long long written = 0;
+    long numDocs = 0;
+    char word [64];
+    while (written < target) {
+        written += fprintf(fp, "$DOC G%09ld\n$TITLE\n", numDocs);
+        long titleWords = 3 + nextRandom(&state) % 6;
+        for (long w = 0; w < titleWords; w++) {
+            rankWord(zipfRank(cdf, vocabulary, &state), word);
+            written += fprintf(fp, (w + 1 < titleWords) ? "%s " : "%s\n", word);
+        }
+        written += fprintf(fp, "$BODY\n");
+        long bodyWords = 50 + nextRandom(&state) % 351;
+        for (long w = 0; w < bodyWords; w++) {
+            rankWord(zipfRank(cdf, vocabulary, &state), word);
+            int endLine = (w + 1) % LINE_WORDS == 0 || w + 1 == bodyWords;
+            written += fprintf(fp, endLine ? "%s\n" : "%s ", word);
+        }
+        numDocs++;
+    }
+    fclose(fp);
+    printf("Wrote %ld documents, %lld bytes to %s\n", numDocs, written, corpusPath);
+
+    // Queries of 1 to 4 terms drawn from the same distribution
+    if (queryPath != NULL) {
+        fp = fopen(queryPath, "w");
+        if (fp == NULL) {
+            printf("Error creating %s\n", queryPath);
+            free(cdf);
+            return 1;
+        }
+        for (long q = 0; q < numQueries; q++) {
+            long terms = 1 + nextRandom(&state) % 4;
+            for (long t = 0; t < terms; t++) {
+                rankWord(zipfRank(cdf, vocabulary, &state), word);
+                fprintf(fp, (t + 1 < terms) ? "%s " : "%s\n", word);
+            }
+        }
+        fclose(fp);
+        printf("Wrote %ld queries to %s\n", numQueries, queryPath);
+    }
+
+    free(cdf);
+    return 0;
+}
@@ -0,0 +1,409 @@
+/*
+Filename: microBench.c
+Author: Benjamin Baird
+Date Created: October 19, 2026
+Last Updated: October 19, 2026
+Description: Microbenchmarks of the primitives that dominate indexing and
+             retrieval: addTerm/searchTree/selfBalance (tree.c),
+             searchNodes/appendNode (list.c), searchIndex/tfidf (engine.c).
+             Each runs on sorted, random, Zipfian and long shared prefix keys
+             and reports ns/op, plus cycles, instructions, cache and branch
+             misses per op from perf_event_open when the kernel allows it.
+             Usage: microBench [-n keys] [-b benchmark]
+*/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef IOCTL_H_INCLUDED
+#define IOCTL_H_INCLUDED
+#include <sys/ioctl.h>
+#endif
+
+#ifndef SYSCALL_H_INCLUDED
+#define SYSCALL_H_INCLUDED
+#include <sys/syscall.h>
+#endif
+
+#ifndef PERF_EVENT_H_INCLUDED
+#define PERF_EVENT_H_INCLUDED
+#include <linux/perf_event.h>
+#endif
+
+#ifndef TREE_H_INCLUDED
+#define TREE_H_INCLUDED
+#include "../tree.h"
+#endif
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "../engine.h"
+#endif
+
+#define NUM_COUNTERS 4
+#define KEY_LENGTH 96
+
+/***
+    Hardware counters for one measurement, fds are -1 when unavailable
+***/
+typedef struct Counters {
+    int fds[NUM_COUNTERS];
+    long long values[NUM_COUNTERS];
+    double seconds;
+}Counters;
+
+const char *distNames [] = {"sorted", "random", "zipf", "prefix"};
+#define NUM_DISTS 4
+
+double now () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***
+    Opens one hardware counter for this thread, disabled until started
+    @return : file descriptor, -1 if the counter isn't available
+***/
+int openCounter (unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void startCounters (Counters *c) {
+    unsigned long long configs [NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                 PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        c->fds[i] = openCounter(configs[i]);
+        c->values[i] = -1;
+        if (c->fds[i] >= 0) {
+            ioctl(c->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    c->seconds = now();
+}
+
+void stopCounters (Counters *c) {
+    c->seconds = now() - c->seconds;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (c->fds[i] < 0)
+            continue;
+        ioctl(c->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(c->fds[i], &c->values[i], sizeof(long long)) != sizeof(long long))
+            c->values[i] = -1;
+        close(c->fds[i]);
+    }
+}
+
+/***
+    Prints a result row, counters divided by the number of operations
+***/
+void report (const char *name, const char *dist, long ops, Counters *c) {
+    printf("%-12s %-7s %10ld %10.1f", name, dist, ops, c->seconds * 1e9 / ops);
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (c->values[i] < 0)
+            printf(" %10s", "n/a");
+        else
+            printf(" %10.2f", (double)c->values[i] / ops);
+    }
+    printf("\n");
+}
+
+unsigned long long nextRandom (unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/***
+    Fills keys with n keys of a distribution. Sorted and random are n distinct
+    keys, zipf repeats keys by a Zipf(1) draw over n, prefix shares a long
+    prefix so every comparison walks most of the string.
+***/
+void generateKeys (int dist, long n, char keys[][KEY_LENGTH]) {
+    unsigned long long state = 42;
+    double *cdf = NULL;
+    if (dist == 2) {
+        cdf = malloc(sizeof(double)*n);
+        double total = 0;
+        for (long r = 0; r < n; r++) {
+            total += 1.0 / (r + 1);
+            cdf[r] = total;
+        }
+    }
+    for (long i = 0; i < n; i++) {
+        long id = i;
+        if (dist == 2) {
+            double u = (nextRandom(&state) >> 11) * (1.0 / 9007199254740992.0) * cdf[n-1];
+            long low = 0;
+            long high = n - 1;
+            while (low < high) {
+                long middle = (low + high) / 2;
+                if (cdf[middle] < u)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            id = low * 7919 % n;
+        }
+        if (dist == 3)
+            sprintf(keys[i], "internationalizationcomponentsubsystemconfigurationidentifier%09ld", id);
+        else
+            sprintf(keys[i], "k%09ld", id);
+    }
+    // Shuffle for random order
+    if (dist == 1) {
+        for (long i = n - 1; i > 0; i--) {
+            long j = nextRandom(&state) % (i + 1);
+            if (j == i)
+                continue;
+            char temp [KEY_LENGTH];
+            strcpy(temp, keys[i]);
+            strcpy(keys[i], keys[j]);
+            strcpy(keys[j], temp);
+        }
+    }
+    free(cdf);
+}
+
+/***
+    addTerm of every key, docIds change every 100 terms like a document
+***/
+TreeNode *benchAddTerm (int dist, long n, char keys[][KEY_LENGTH]) {
+    TreeNode *tree = NULL;
+    char docId [32];
+    Counters c;
+    startCounters(&c);
+    for (long i = 0; i < n; i++) {
+        sprintf(docId, "d%ld", i / 100);
+        if (tree == NULL)
+            tree = initTreeNode(keys[i], docId);
+        else
+            tree = addTerm(tree, keys[i], docId, NULL);
+    }
+    stopCounters(&c);
+    report("addTerm", distNames[dist], n, &c);
+    return tree;
+}
+
+/***
+    searchTree of every key in the tree built from them
+***/
+void benchSearchTree (int dist, long n, char keys[][KEY_LENGTH], TreeNode *tree) {
+    long found = 0;
+    Counters c;
+    startCounters(&c);
+    for (long i = 0; i < n; i++) {
+        if (searchTree(tree, keys[i]) != NULL)
+            found++;
+    }
+    stopCounters(&c);
+    if (found != n)
+        printf("Warning: searchTree found %ld of %ld\n", found, n);
+    report("searchTree", distNames[dist], n, &c);
+}
+
+/***
+    selfBalance of three node chains that need a rotation. The chains are
+    built before timing, only the selfBalance calls are timed
+***/
+void benchSelfBalance (int dist, long n, char keys[][KEY_LENGTH]) {
+    long ops = (n > 2) ? n - 2 : 0;
+    TreeNode *nodes = calloc(3 * (ops > 0 ? ops : 1), sizeof(TreeNode));
+    char **last = malloc(sizeof(char*) * (ops > 0 ? ops : 1));
+    if (nodes == NULL || last == NULL) {
+        printf("Warning: out of memory for selfBalance\n");
+        free(nodes);
+        free(last);
+        return;
+    }
+    for (long i = 0; i < ops; i++) {
+        // Right-right chain of the three keys in order, so a left rotation is due
+        char *chain [3] = {keys[i], keys[i+1], keys[i+2]};
+        for (int a = 0; a < 2; a++) {
+            for (int b = 0; b < 2 - a; b++) {
+                if (strcmp(chain[b], chain[b+1]) > 0) {
+                    char *temp = chain[b];
+                    chain[b] = chain[b+1];
+                    chain[b+1] = temp;
+                }
+            }
+        }
+        TreeNode *node = &nodes[3*i];
+        for (int k = 0; k < 3; k++) {
+            node[k].term = chain[k];
+            node[k].height = 3 - k;
+            node[k].right = (k < 2) ? &node[k+1] : NULL;
+        }
+        last[i] = chain[2];
+    }
+
+    long failed = 0;
+    Counters c;
+    startCounters(&c);
+    for (long i = 0; i < ops; i++) {
+        if (selfBalance(&nodes[3*i], last[i]) == NULL)
+            failed++;
+    }
+    stopCounters(&c);
+    if (failed > 0)
+        printf("Warning: selfBalance returned NULL %ld times\n", failed);
+    report("selfBalance", distNames[dist], ops > 0 ? ops : 1, &c);
+    free(nodes);
+    free(last);
+}
+
+/***
+    appendNode of listLength nodes, then searchNodes for each of them
+***/
+void benchList (int dist, long listLength, char keys[][KEY_LENGTH]) {
+    Node *list = initNode(keys[0]);
+    Counters c;
+    startCounters(&c);
+    for (long i = 1; i < listLength; i++) {
+        appendNode(list, initNode(keys[i]));
+    }
+    stopCounters(&c);
+    report("appendNode", distNames[dist], listLength - 1 > 0 ? listLength - 1 : 1, &c);
+
+    long found = 0;
+    startCounters(&c);
+    for (long i = 0; i < listLength; i++) {
+        if (searchNodes(list, keys[i]) != NULL)
+            found++;
+    }
+    stopCounters(&c);
+    report("searchNodes", distNames[dist], listLength, &c);
+    freeNodeList(list);
+}
+
+/***
+    searchIndex of every key in a dictionary built from the tree in order
+***/
+void benchSearchIndex (int dist, long n, char keys[][KEY_LENGTH], TreeNode *tree) {
+    long dictSize = countTreeNodes(tree);
+    DictIndex *dict = malloc(sizeof(DictIndex)*dictSize);
+    TreeIter iter;
+    initTreeIter(&iter, tree);
+    TreeNode *node;
+    long size = 0;
+    while ((node = nextTreeNode(&iter)) != NULL) {
+        dict[size].term = node->term;
+        dict[size].df = node->freq;
+        dict[size].postIndex = 0;
+        size++;
+    }
+
+    long found = 0;
+    Counters c;
+    startCounters(&c);
+    for (long i = 0; i < n; i++) {
+        if (searchIndex(dict, dictSize - 1, keys[i]) >= 0)
+            found++;
+    }
+    stopCounters(&c);
+    report("searchIndex", distNames[dist], n, &c);
+    free(dict);
+}
+
+/***
+    tfidf over varying tf and df
+***/
+void benchTfidf (long n) {
+    double sum = 0;
+    Counters c;
+    startCounters(&c);
+    for (long i = 0; i < n; i++) {
+        sum += tfidf((double)(1 + i % 17), 1000000, 1 + i % 9973);
+    }
+    stopCounters(&c);
+    report("tfidf", "-", n, &c);
+    if (sum < 0)
+        printf("%f\n", sum);
+}
+
+int main (int argc, char *argv[]) {
+    long n = 100000;
+    char *only = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+        switch (opt) {
+            case 'n': n = atol(optarg); break;
+            case 'b': only = optarg; break;
+            default:
+                printf("Usage: %s [-n keys] [-b benchmark]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (n < 3)
+        n = 3;
+
+    // Posting lists are far shorter than the dictionary
+    long listLength = (n < 10000) ? n : 10000;
+    char (*keys)[KEY_LENGTH] = malloc(sizeof(*keys)*n);
+    if (keys == NULL) {
+        printf("Error allocating %ld keys\n", n);
+        return 1;
+    }
+
+    printf("%-12s %-7s %10s %10s %10s %10s %10s %10s\n", "benchmark", "keys", "ops", "ns/op",
+           "cycles/op", "instr/op", "cmiss/op", "bmiss/op");
+    for (int dist = 0; dist < NUM_DISTS; dist++) {
+        generateKeys(dist, n, keys);
+        TreeNode *tree = NULL;
+        if (only == NULL || strcmp(only, "addTerm") == 0 || strcmp(only, "searchTree") == 0
+                || strcmp(only, "searchIndex") == 0)
+            tree = benchAddTerm(dist, n, keys);
+        if (only == NULL || strcmp(only, "searchTree") == 0)
+            benchSearchTree(dist, n, keys, tree);
+        if (only == NULL || strcmp(only, "searchIndex") == 0)
+            benchSearchIndex(dist, n, keys, tree);
+        if (only == NULL || strcmp(only, "selfBalance") == 0)
+            benchSelfBalance(dist, n, keys);
+        if (only == NULL || strcmp(only, "appendNode") == 0 || strcmp(only, "searchNodes") == 0)
+            benchList(dist, listLength, keys);
+        if (tree != NULL)
+            freeTree(tree);
+    }
+    if (only == NULL || strcmp(only, "tfidf") == 0)
+        benchTfidf(n * 10);
+
+    free(keys);
+    return 0;
+}
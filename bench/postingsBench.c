@@ -0,0 +1,223 @@
+/*
+Filename: postingsBench.c
+Author: Benjamin Baird
+Date Created: October 19, 2026
+Last Updated: October 19, 2026
+Description: Compares the postings/sec of the old array-of-structs scoring loop
+             against the structure-of-arrays kernels in postings.c, and of the
+             kernel of each scoring model (tf-idf, BM25, BM25F) against BM25
+             through a generic loop calling the model per posting.
+             Usage: postingsBench [numPostings] [numDocs] [rounds]
+*/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+#ifndef POSTINGS_H_INCLUDED
+#define POSTINGS_H_INCLUDED
+#include "../postings.h"
+#endif
+
+// The posting layout and loop used before PostColumns
+typedef struct LegacyPost {
+    long docno;
+    long tf;
+}LegacyPost;
+
+double tfidf (double tf, long totalDocs, long df) {
+    if (df == 0)
+        return 10000;
+    return ((double)tf * log2((double)totalDocs/(double)df));
+}
+
+/***
+    A scoring model called once per posting, as a generic loop would
+***/
+typedef double (*PostingScore) (double tf, long docno, OkapiTerm *term);
+
+double bm25Score (double tf, long docno, OkapiTerm *term) {
+    return term->weight * tf / (tf + term->base + term->slope * term->length[docno]);
+}
+
+// Read at run time, so the compiler can't inline the model into the loop
+PostingScore volatile genericModel = bm25Score;
+
+/***
+    BM25 through the generic loop, the model's call and branches per posting
+***/
+void scoreGeneric (PostColumns *pIndex, long start, long count, PostingScore score,
+                   OkapiTerm *term, double docMatrix[]) {
+    for (long k = start; k < start + count; k++)
+        docMatrix[pIndex->docno[k]] += score(pIndex->tf[k], pIndex->docno[k], term);
+}
+
+double now () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char *argv[]) {
+    long numPostings = (argc > 1) ? atol(argv[1]) : 10000000;
+    long numDocs = (argc > 2) ? atol(argv[2]) : 1000000;
+    long rounds = (argc > 3) ? atol(argv[3]) : 20;
+    long df = numPostings;
+
+    LegacyPost *legacy = malloc(sizeof(LegacyPost)*numPostings);
+    PostColumns columns = initPostColumns(numPostings);
+    double *docMatrix = calloc(numDocs, sizeof(double));
+    if (legacy == NULL || columns.docno == NULL || columns.tf == NULL || docMatrix == NULL) {
+        printf("Error allocating %ld postings\n", numPostings);
+        return 1;
+    }
+
+    // Ascending docnos with small Zipf-like tfs, as an inverted list would have
+    srand(42);
+    long docno = 0;
+    for (long i = 0; i < numPostings; i++) {
+        docno = (docno + 1 + rand() % 3) % numDocs;
+        long tf = 1 + (long)(1.0 / (rand() / (RAND_MAX + 1.0) + 0.05));
+        legacy[i].docno = docno;
+        legacy[i].tf = tf;
+        setPost(&columns, i, docno, tf);
+    }
+
+    double start = now();
+    for (long r = 0; r < rounds; r++) {
+        for (long k = 0; k < numPostings; k++) {
+            double tfidfResult = tfidf((double)legacy[k].tf, numDocs, df / 4);
+            docMatrix[legacy[k].docno] += tfidfResult * 0.5;
+        }
+    }
+    double legacyTime = now() - start;
+    double legacySum = 0;
+    for (long i = 0; i < numDocs; i++) {
+        legacySum += docMatrix[i];
+        docMatrix[i] = 0;
+    }
+
+    start = now();
+    for (long r = 0; r < rounds; r++) {
+        scorePostings(&columns, 0, numPostings, tfidf(1.0, numDocs, df / 4), 0.5, docMatrix);
+    }
+    double kernelTime = now() - start;
+    double kernelSum = 0;
+    for (long i = 0; i < numDocs; i++)
+        kernelSum += docMatrix[i];
+
+    // Document lengths around 250 terms, titles of 1 to 10 terms holding
+    // every 8th posting
+    uint32_t *length = malloc(sizeof(uint32_t)*numDocs);
+    uint32_t *titleLength = malloc(sizeof(uint32_t)*numDocs);
+    uint32_t *titleDocno = malloc(sizeof(uint32_t)*(numPostings/8 + 1));
+    uint32_t *titleTf = malloc(sizeof(uint32_t)*(numPostings/8 + 1));
+    if (length == NULL || titleLength == NULL || titleDocno == NULL || titleTf == NULL) {
+        printf("Error allocating %ld documents\n", numDocs);
+        return 1;
+    }
+    double totalLength = 0;
+    double totalTitle = 0;
+    for (long d = 0; d < numDocs; d++) {
+        length[d] = 50 + rand() % 400;
+        titleLength[d] = 1 + rand() % 10;
+        totalLength += length[d];
+        totalTitle += titleLength[d];
+    }
+    long titleCount = 0;
+    for (long i = 0; i < numPostings; i += 8) {
+        // The title postings must stay ascending, the docnos wrap around once
+        if (titleCount > 0 && columns.docno[i] <= titleDocno[titleCount-1])
+            break;
+        titleDocno[titleCount] = columns.docno[i];
+        titleTf[titleCount++] = 1;
+    }
+
+    double k1 = 1.2;
+    double b = 0.75;
+    OkapiTerm term;
+    memset(&term, 0, sizeof(term));
+    term.weight = log(1 + (numDocs - df / 4 + 0.5) / (df / 4 + 0.5)) * (k1 + 1);
+    term.k1 = k1;
+    term.base = k1 * (1 - b);
+    term.slope = k1 * b / (totalLength / numDocs);
+    term.length = length;
+
+    for (long i = 0; i < numDocs; i++)
+        docMatrix[i] = 0;
+    start = now();
+    for (long r = 0; r < rounds; r++)
+        scoreBM25(&columns, 0, numPostings, &term, docMatrix);
+    double bm25Time = now() - start;
+    double bm25Sum = 0;
+    for (long i = 0; i < numDocs; i++) {
+        bm25Sum += docMatrix[i];
+        docMatrix[i] = 0;
+    }
+
+    start = now();
+    for (long r = 0; r < rounds; r++)
+        scoreGeneric(&columns, 0, numPostings, genericModel, &term, docMatrix);
+    double genericTime = now() - start;
+    double genericSum = 0;
+    for (long i = 0; i < numDocs; i++) {
+        genericSum += docMatrix[i];
+        docMatrix[i] = 0;
+    }
+
+    // BM25F over the same lengths as bodies
+    term.base = 1 - b;
+    term.slope = b / (totalLength / numDocs);
+    term.titleBase = (1 - b) / 2.0;
+    term.titleSlope = b / (totalTitle / numDocs * 2.0);
+    term.titleLength = titleLength;
+    term.titleDocno = titleDocno;
+    term.titleTf = titleTf;
+    term.titleCount = titleCount;
+    start = now();
+    for (long r = 0; r < rounds; r++)
+        scoreBM25F(&columns, 0, numPostings, &term, docMatrix);
+    double bm25fTime = now() - start;
+
+    double total = (double)numPostings * rounds;
+    printf("postings: %ld  docs: %ld  rounds: %ld\n", numPostings, numDocs, rounds);
+    printf("legacy AoS loop : %8.1f Mpostings/sec\n", total / legacyTime / 1e6);
+    printf("SoA kernels     : %8.1f Mpostings/sec (%.2fx)\n", total / kernelTime / 1e6,
+           legacyTime / kernelTime);
+    printf("Scoring models, specialized kernels:\n");
+    printf("    tfidf       : %8.1f Mpostings/sec\n", total / kernelTime / 1e6);
+    printf("    bm25        : %8.1f Mpostings/sec\n", total / bm25Time / 1e6);
+    printf("    bm25f       : %8.1f Mpostings/sec (%ld title postings)\n", total / bm25fTime / 1e6,
+           titleCount);
+    printf("    bm25 generic: %8.1f Mpostings/sec, model called per posting (kernel/generic %.2fx)\n",
+           total / genericTime / 1e6, genericTime / bm25Time);
+    if (fabs(legacySum - kernelSum) > 1e-6 * fabs(legacySum))
+        printf("Warning: score mismatch %f vs %f\n", legacySum, kernelSum);
+    if (fabs(bm25Sum - genericSum) > 1e-6 * fabs(bm25Sum))
+        printf("Warning: bm25 score mismatch %f vs %f\n", bm25Sum, genericSum);
+
+    free(length);
+    free(titleLength);
+    free(titleDocno);
+    free(titleTf);
+    free(legacy);
+    freePostColumns(&columns);
+    free(docMatrix);
+    return 0;
+}
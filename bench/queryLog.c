@@ -0,0 +1,51 @@
+/*
+Filename: queryLog.c
+Author: Benjamin Baird
+Date Created: October 19, 2026
+Last Updated: October 19, 2026
+Description: Query logs for the benchmarks, shared by benchDriver and replay
+*/
+
+#ifndef QUERYLOG_H_INCLUDED
+#define QUERYLOG_H_INCLUDED
+#include "queryLog.h"
+#endif
+
+char **loadQueries (char *path, long *numQueries) {
+    *numQueries = 0;
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return NULL;
+    char **queries = NULL;
+    long cap = 0;
+    long count = 0;
+    char *line = NULL;
+    size_t size = 0;
+    int ok = 1;
+    while (ok && getline(&line, &size, fp) > 0) {
+        if (strspn(line, " \n") == strlen(line))
+            continue;
+        if (count == cap) {
+            cap = (cap == 0) ? 256 : cap * 2;
+            char **grown = realloc(queries, sizeof(char*)*cap);
+            if (grown == NULL) {
+                ok = 0;
+                break;
+            }
+            queries = grown;
+        }
+        queries[count] = strdup(line);
+        ok = queries[count] != NULL;
+        count += ok;
+    }
+    free(line);
+    fclose(fp);
+    if (!ok) {
+        for (long i = 0; i < count; i++)
+            free(queries[i]);
+        free(queries);
+        return NULL;
+    }
+    *numQueries = count;
+    return queries;
+}
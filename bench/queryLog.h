@@ -0,0 +1,27 @@
+/*
+Filename: queryLog.h
+Author: Benjamin Baird
+Description: Header file for queryLog.c, the query logs the benchmarks replay
+*/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+/***
+    Loads a query log, one query per line, skipping blank lines
+    @return : array of queries, numQueries is set to its length. NULL if
+              the file couldn't be read or out of memory
+***/
+char **loadQueries (char *path, long *numQueries);
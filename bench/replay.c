@@ -0,0 +1,198 @@
+/*
+Filename: replay.c
+Author: Benjamin Baird
+Date Created: October 19, 2026
+Last Updated: October 19, 2026
+Description: Query-log replay load generator. Loads the index in the current
+             (or given) directory once and issues queries from a log
+             open-loop at a target rate: query i is due at start + i/rate
+             whether or not earlier queries have finished. Response time is
+             measured from when a query was due, so time spent queued behind a
+             slow query is counted (coordinated omission corrected), and
+             service time from when it started. Both are kept in histograms.
+             Usage: replay -q queries.txt [-r qps] [-n count] [-d indexdir] [-o results.jsonl]
+*/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "../engine.h"
+#endif
+
+#ifndef HISTOGRAM_H_INCLUDED
+#define HISTOGRAM_H_INCLUDED
+#include "../histogram.h"
+#endif
+
+#ifndef QUERYLOG_H_INCLUDED
+#define QUERYLOG_H_INCLUDED
+#include "queryLog.h"
+#endif
+
+/***
+    @return : CLOCK_MONOTONIC in nanoseconds
+***/
+long long nowNs () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/***
+    Sleeps until a CLOCK_MONOTONIC time in nanoseconds
+***/
+void sleepUntil (long long ns) {
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+        ;
+}
+
+/***
+    Prints a histogram's percentiles in milliseconds
+***/
+void printHistogram (char *name, Histogram *hist) {
+    printf("%-10s mean %8.3f  p50 %8.3f  p90 %8.3f  p99 %8.3f  p99.9 %8.3f  max %8.3f ms\n",
+           name, histMean(hist) / 1e6, histPercentile(hist, 50) / 1e6, histPercentile(hist, 90) / 1e6,
+           histPercentile(hist, 99) / 1e6, histPercentile(hist, 99.9) / 1e6, hist->max / 1e6);
+}
+
+/***
+    Writes a histogram's percentiles in milliseconds as JSON members
+***/
+void jsonHistogram (FILE *fp, char *name, Histogram *hist) {
+    fprintf(fp, "\"%s_mean_ms\":%.4f,\"%s_p50_ms\":%.4f,\"%s_p90_ms\":%.4f,\"%s_p99_ms\":%.4f,"
+            "\"%s_p999_ms\":%.4f,\"%s_max_ms\":%.4f",
+            name, histMean(hist) / 1e6, name, histPercentile(hist, 50) / 1e6,
+            name, histPercentile(hist, 90) / 1e6, name, histPercentile(hist, 99) / 1e6,
+            name, histPercentile(hist, 99.9) / 1e6, name, hist->max / 1e6);
+}
+
+void usage (char *name) {
+    printf("Usage: %s -q queries.txt [-r qps] [-n count] [-d indexdir] [-o results.jsonl]\n", name);
+}
+
+int main (int argc, char *argv[]) {
+    char *queryPath = NULL;
+    char *indexDir = NULL;
+    char *output = NULL;
+    double rate = 100;
+    long count = -1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "q:r:n:d:o:")) != -1) {
+        switch (opt) {
+            case 'q': queryPath = optarg; break;
+            case 'r': rate = atof(optarg); break;
+            case 'n': count = atol(optarg); break;
+            case 'd': indexDir = optarg; break;
+            case 'o': output = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (queryPath == NULL || rate <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    long numQueries = 0;
+    char **queries = loadQueries(queryPath, &numQueries);
+    if (queries == NULL || numQueries == 0) {
+        printf("Error loading %s\n", queryPath);
+        return 1;
+    }
+    if (count < 0)
+        count = numQueries;
+    FILE *out = NULL;
+    if (output != NULL && (out = fopen(output, "a")) == NULL) {
+        printf("Error opening %s\n", output);
+        return 1;
+    }
+    if (indexDir != NULL && chdir(indexDir) != 0) {
+        printf("Error entering %s\n", indexDir);
+        return 1;
+    }
+
+    Index index;
+    long long loadStart = nowNs();
+    if (loadIndex(&index) != 0) {
+        printf("Error loading the index\n");
+        return 1;
+    }
+    printf("Loaded %ld docs, %ld terms in %.3f s\n", index.numDocs, index.dictSize,
+           (nowNs() - loadStart) / 1e9);
+
+    Histogram *response = malloc(sizeof(Histogram));
+    Histogram *service = malloc(sizeof(Histogram));
+    initHistogram(response);
+    initHistogram(service);
+
+    // Open loop: each query has a fixed due time, late queries are not skipped
+    double interval = 1e9 / rate;
+    long long start = nowNs();
+    long late = 0;
+    for (long i = 0; i < count; i++) {
+        long long due = start + (long long)(i * interval);
+        long long begin = nowNs();
+        if (begin < due) {
+            sleepUntil(due);
+            begin = nowNs();
+        } else if (begin - due > (long long)interval) {
+            late++;
+        }
+        double **results = retrieveResults(queries[i % numQueries], &index, NULL);
+        freeResults(results, index.numDocs);
+        long long end = nowNs();
+        recordValue(service, end - begin);
+        recordValue(response, end - due);
+    }
+    double elapsed = (nowNs() - start) / 1e9;
+
+    printf("%ld queries in %.2f s: target %.1f qps, achieved %.1f qps, %ld started over an interval late\n",
+           count, elapsed, rate, count / elapsed, late);
+    printHistogram("response", response);
+    printHistogram("service", service);
+
+    if (out != NULL) {
+        fprintf(out, "{\"time\":%ld,\"queries\":%ld,\"target_qps\":%.2f,\"achieved_qps\":%.2f,\"late\":%ld,",
+                (long)time(NULL), count, rate, count / elapsed, late);
+        jsonHistogram(out, "response", response);
+        fprintf(out, ",");
+        jsonHistogram(out, "service", service);
+        fprintf(out, "}\n");
+        fclose(out);
+    }
+
+    for (long q = 0; q < numQueries; q++)
+        free(queries[q]);
+    free(queries);
+    free(response);
+    free(service);
+    freeIndex(&index);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Generates (once) and benchmarks synthetic corpora of the given sizes in MB.
+# Run from the source directory after 'make all bench':
+#     bench/runBench.sh [label] [megabytes ...]
+# Results are appended to bench/results.jsonl
+
+LABEL=${1:-$(git rev-parse --short HEAD 2>/dev/null)}
+[ $# -gt 0 ] && shift
+SIZES=${*:-10}
+
+mkdir -p bench/data
+for MB in $SIZES; do
+    CORPUS=bench/data/corpus-${MB}mb.txt
+    QUERIES=bench/data/queries-${MB}mb.txt
+    if [ ! -f "$CORPUS" ] || [ ! -f "$QUERIES" ]; then
+        bench/genCorpus -o "$CORPUS" -m "$MB" -s 42 -q "$QUERIES" -n 1000 || exit 1
+    fi
+    echo "== $MB MB =="
+    bench/benchDriver -c "$CORPUS" -q "$QUERIES" -i ../../indexer -w bench/work \
+        -o bench/results.jsonl -l "$LABEL" || exit 1
+done
@@ -0,0 +1,599 @@
+/***
+    Filename: blockstore.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: The documents of a generation, compressed so the corpus
+                 files needn't be kept. The indexer reads each document
+                 from its $DOC to the next, as snippets.c finds them, and
+                 packs them in corpus order into blocks of about STORE_BLOCK
+                 bytes compressed by lzblock.c. A document is in one block,
+                 reading it decompresses that block alone. documents.bin is
+                 binary, in the byte order of the machine that wrote it:
+                    header: magic, numDocs, numBlocks, tableStart
+                    blocks: back to back
+                    at tableStart:
+                    blockStart: numBlocks + 1 int64
+                    blockSize: numBlocks uint32
+                    docBlock, docOffset, docLength: numDocs uint32 each
+                    docStart: numDocs int64
+***/
+
+#ifndef BLOCKSTORE_H_INCLUDED
+#define BLOCKSTORE_H_INCLUDED
+#include "blockstore.h"
+#endif
+
+#ifndef LZBLOCK_H_INCLUDED
+#define LZBLOCK_H_INCLUDED
+#include "lzblock.h"
+#endif
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#ifndef DOCPARSE_H_INCLUDED
+#define DOCPARSE_H_INCLUDED
+#include "docparse.h"
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#define STORE_MAGIC "BSTORE01"
+// Longest document kept, its offsets are 32 bits
+#define STORE_MAX_DOC (1L << 30)
+
+typedef struct StoreHeader {
+    char magic[8];
+    int64_t numDocs;
+    int64_t numBlocks;
+    int64_t tableStart;
+}StoreHeader;
+
+/***
+    A STORE_FILE being written, the block being filled is compressed once
+    it holds STORE_BLOCK bytes
+***/
+typedef struct StoreWriter {
+    FILE *fp;
+    char *path;
+    char *temp;
+    BlockStore out;         // offsets of the blocks written so far
+    long capBlocks;
+    char *block;            // documents of the block being filled
+    long size;
+    long cap;
+    char *packed;           // compressed block
+    long packedCap;
+    int64_t written;        // bytes of the file so far
+}StoreWriter;
+
+/***
+    A block read from a store, kept while its documents are read in turn
+***/
+typedef struct StoreBlock {
+    long block;             // -1 before the first
+    char *packed;
+    long packedCap;
+    char *text;
+    long textCap;
+}StoreBlock;
+
+/***
+    Everything writeBlockStore builds from the index files
+***/
+typedef struct StoreBuild {
+    DocPlaces places;
+    long firstDoc;          // documents before it are already stored
+    long doc;               // being read, -1 between indexed documents
+    StoreWriter writer;
+}StoreBuild;
+
+/***
+    Start writing a STORE_FILE beside the generation's old one
+    @return 0 : success
+    @return -1 : the file couldn't be created or out of memory
+***/
+static int openWriter (StoreWriter *writer, const char *dir, long numDocs) {
+    memset(writer, 0, sizeof(StoreWriter));
+    writer->out.fd = -1;
+    writer->path = generationPath(dir, STORE_FILE);
+    if (writer->path == NULL)
+        return -1;
+    writer->temp = malloc(sizeof(char)*((int)strlen(writer->path)+5));
+    if (writer->temp == NULL)
+        return -1;
+    sprintf(writer->temp, "%s.tmp", writer->path);
+    writer->out.numDocs = numDocs;
+    writer->out.docBlock = calloc(numDocs + 1, sizeof(uint32_t));
+    writer->out.docOffset = calloc(numDocs + 1, sizeof(uint32_t));
+    writer->out.docLength = calloc(numDocs + 1, sizeof(uint32_t));
+    writer->out.docStart = calloc(numDocs + 1, sizeof(int64_t));
+    writer->capBlocks = 64;
+    writer->out.blockStart = malloc(sizeof(int64_t)*(writer->capBlocks + 1));
+    writer->out.blockSize = malloc(sizeof(uint32_t)*writer->capBlocks);
+    if (writer->out.docBlock == NULL || writer->out.docOffset == NULL || writer->out.docLength == NULL
+            || writer->out.docStart == NULL || writer->out.blockStart == NULL || writer->out.blockSize == NULL)
+        return -1;
+    writer->fp = fopen(writer->temp, "wb");
+    if (writer->fp == NULL)
+        return -1;
+
+    // The header is written again with the counts at the end
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    if (fwrite(&header, sizeof(header), 1, writer->fp) != 1)
+        return -1;
+    writer->written = sizeof(header);
+    writer->out.blockStart[0] = writer->written;
+    return 0;
+}
+
+/***
+    Compress the block being filled and write it out
+    @return 0 : success
+    @return -1 : the file couldn't be written or out of memory
+***/
+static int flushBlock (StoreWriter *writer) {
+    if (writer->size == 0)
+        return 0;
+    if (writer->out.numBlocks == writer->capBlocks) {
+        long cap = writer->capBlocks*2;
+        int64_t *start = realloc(writer->out.blockStart, sizeof(int64_t)*(cap + 1));
+        if (start != NULL)
+            writer->out.blockStart = start;
+        uint32_t *size = realloc(writer->out.blockSize, sizeof(uint32_t)*cap);
+        if (size != NULL)
+            writer->out.blockSize = size;
+        if (start == NULL || size == NULL)
+            return -1;
+        writer->capBlocks = cap;
+    }
+    if (writer->packedCap < LZ_BOUND(writer->size)) {
+        char *grown = realloc(writer->packed, LZ_BOUND(writer->size));
+        if (grown == NULL)
+            return -1;
+        writer->packed = grown;
+        writer->packedCap = LZ_BOUND(writer->size);
+    }
+    long packed = lzCompress(writer->block, writer->size, writer->packed, writer->packedCap);
+    // A block that doesn't compress is stored as is, its sizes say which
+    char *data = (packed >= 0 && packed < writer->size) ? writer->packed : writer->block;
+    long length = (data == writer->packed) ? packed : writer->size;
+    if ((long)fwrite(data, 1, length, writer->fp) != length)
+        return -1;
+    long b = writer->out.numBlocks++;
+    writer->out.blockSize[b] = (uint32_t)writer->size;
+    writer->written += length;
+    writer->out.blockStart[b+1] = writer->written;
+    writer->size = 0;
+    return 0;
+}
+
+/***
+    Pack a document into the block being filled, which is written out once
+    it's full. start is where it is in its corpus file
+    @return 0 : success
+    @return -1 : the file couldn't be written, the document is too long or
+                 out of memory
+***/
+static int addDocument (StoreWriter *writer, long docno, const char *text, long length, int64_t start) {
+    if (length > STORE_MAX_DOC) {
+        printf("Error: document %ld is longer than %ld bytes\n", docno, STORE_MAX_DOC);
+        return -1;
+    }
+    if (writer->size + length > writer->cap) {
+        long cap = (writer->cap > 0) ? writer->cap : STORE_BLOCK;
+        while (cap < writer->size + length)
+            cap *= 2;
+        char *grown = realloc(writer->block, cap);
+        if (grown == NULL)
+            return -1;
+        writer->block = grown;
+        writer->cap = cap;
+    }
+    memcpy(writer->block + writer->size, text, length);
+    writer->out.docBlock[docno] = (uint32_t)writer->out.numBlocks;
+    writer->out.docOffset[docno] = (uint32_t)writer->size;
+    writer->out.docLength[docno] = (uint32_t)length;
+    writer->out.docStart[docno] = start;
+    writer->size += length;
+    return (writer->size >= STORE_BLOCK) ? flushBlock(writer) : 0;
+}
+
+/***
+    Write the last block, the tables and the header, and rename the file
+    over the old one. The file is removed if ok is 0 or it fails
+    @return 0 : success
+    @return -1 : failure
+***/
+static int closeWriter (StoreWriter *writer, int ok) {
+    ok = ok && flushBlock(writer) == 0;
+    BlockStore *out = &writer->out;
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.numDocs = out->numDocs;
+    header.numBlocks = out->numBlocks;
+    header.tableStart = writer->written;
+    if (writer->fp != NULL) {
+        ok = ok && (long)fwrite(out->blockStart, sizeof(int64_t), out->numBlocks + 1, writer->fp)
+                        == out->numBlocks + 1;
+        ok = ok && (long)fwrite(out->blockSize, sizeof(uint32_t), out->numBlocks, writer->fp)
+                        == out->numBlocks;
+        ok = ok && (long)fwrite(out->docBlock, sizeof(uint32_t), out->numDocs, writer->fp) == out->numDocs;
+        ok = ok && (long)fwrite(out->docOffset, sizeof(uint32_t), out->numDocs, writer->fp) == out->numDocs;
+        ok = ok && (long)fwrite(out->docLength, sizeof(uint32_t), out->numDocs, writer->fp) == out->numDocs;
+        ok = ok && (long)fwrite(out->docStart, sizeof(int64_t), out->numDocs, writer->fp) == out->numDocs;
+        ok = ok && fseek(writer->fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer->fp) == 1;
+        ok = (fclose(writer->fp) == 0) && ok;
+    }
+    if (writer->temp != NULL && (!ok || rename(writer->temp, writer->path) != 0)) {
+        remove(writer->temp);
+        ok = 0;
+    }
+    free(writer->path);
+    free(writer->temp);
+    free(writer->block);
+    free(writer->packed);
+    freeBlockStore(out);
+    memset(writer, 0, sizeof(StoreWriter));
+    writer->out.fd = -1;
+    return ok ? 0 : -1;
+}
+
+/***
+    Read a corpus file, storing the indexed documents in it. Documents are
+    found the way snippets.c finds them, so their offsets agree
+    @return 0 : success
+    @return -1 : the file couldn't be read, the store written or out of memory
+***/
+static int scanFile (StoreBuild *build, int fileid, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Error opening %s\n", path);
+        return -1;
+    }
+    // The bytes since the last $DOC, which is textStart bytes into the file
+    long cap = STORE_BLOCK;
+    char *text = malloc(cap);
+    long size = 0;
+    long textStart = 0;
+    char word [MAX_WORD+1];
+    int length = 0;
+    long wordStart = 0;
+    long lineNum = 0;
+    int metaTags = 0;
+    int ret = (text != NULL) ? 0 : -1;
+    int c = 0;
+    while (ret == 0 && c != EOF) {
+        c = fgetc(fp);
+        if (c != EOF) {
+            if (size == cap) {
+                char *grown = realloc(text, cap*2);
+                if (grown == NULL) {
+                    ret = -1;
+                    break;
+                }
+                text = grown;
+                cap *= 2;
+            }
+            text[size++] = (char)c;
+        }
+        if (c != ' ' && c != '\n' && c != EOF) {
+            if (length == 0)
+                wordStart = size - 1;
+            if (length < MAX_WORD)
+                word[length++] = (char)c;
+            continue;
+        }
+        word[length] = '\0';
+        if (strcmp(word, "$DOC") == 0) {
+            // The bytes before it are the end of the last document
+            if (build->doc >= 0)
+                ret = addDocument(&build->writer, build->doc, text, wordStart, textStart);
+            build->doc = -1;
+            memmove(text, text + wordStart, size - wordStart);
+            size -= wordStart;
+            textStart += wordStart;
+            metaTags = 1;
+        } else if (word[0] == '$') {
+            metaTags++;
+        } else if (metaTags == 1 && length > 0) {
+            // The docid, the document is stored if it's indexed
+            build->doc = findDocPlace(&build->places, fileid, lineNum);
+            if (build->doc < build->firstDoc)
+                build->doc = -1;
+        }
+        length = 0;
+        if (c == '\n')
+            lineNum++;
+    }
+    if (ret == 0 && build->doc >= 0)
+        ret = addDocument(&build->writer, build->doc, text, size, textStart);
+    build->doc = -1;
+    free(text);
+    fclose(fp);
+    return ret;
+}
+
+int writeBlockStore (const char *dir) {
+    StoreBuild build;
+    memset(&build, 0, sizeof(build));
+    build.doc = -1;
+    build.writer.out.fd = -1;
+    DocPlaces *places = &build.places;
+    int ret = readDocPlaces(dir, places);
+    if (ret != 0)
+        printf("Error reading the index files of %s\n", dir);
+    if (ret == 0 && openWriter(&build.writer, dir, places->numDocs) != 0) {
+        closeWriter(&build.writer, 0);
+        printf("Error creating %s of %s\n", STORE_FILE, dir);
+        ret = -1;
+    }
+
+    long long rawBytes = 0;
+    for (int f = 0; ret == 0 && f < places->numFiles; f++)
+        ret = scanFile(&build, f, places->files[f]);
+    if (ret == 0 && places->next < places->numDocs) {
+        printf("Error: %ld documents of %s weren't found in its files\n", places->numDocs - places->next, dir);
+        ret = -1;
+    }
+    for (long d = 0; ret == 0 && d < places->numDocs; d++)
+        rawBytes += build.writer.out.docLength[d];
+    long long storedBytes = build.writer.written;
+    if (build.writer.path != NULL && closeWriter(&build.writer, ret == 0) != 0) {
+        if (ret == 0)
+            printf("Error writing %s of %s\n", STORE_FILE, dir);
+        ret = -1;
+    }
+    if (ret == 0) {
+        printf("Stored %ld documents, %.1f MB compressed to %.1f MB\n", places->numDocs,
+               rawBytes/1048576.0, storedBytes/1048576.0);
+    }
+
+    freeDocPlaces(places);
+    return ret;
+}
+
+/***
+    Read and decompress a block of a store into cache, unless it's there
+    @return 0 : success
+    @return -1 : the block couldn't be read, or is corrupt
+***/
+static int readBlock (BlockStore *store, long block, StoreBlock *cache) {
+    if (cache->block == block)
+        return 0;
+    cache->block = -1;
+    long length = store->blockStart[block+1] - store->blockStart[block];
+    long size = store->blockSize[block];
+    if (cache->textCap < size + 1) {
+        char *grown = realloc(cache->text, size + 1);
+        if (grown == NULL)
+            return -1;
+        cache->text = grown;
+        cache->textCap = size + 1;
+    }
+    // A block that didn't compress is read as is
+    if (length == size) {
+        if (pread(store->fd, cache->text, size, store->blockStart[block]) != size)
+            return -1;
+        cache->block = block;
+        return 0;
+    }
+    if (cache->packedCap < length) {
+        char *grown = realloc(cache->packed, length);
+        if (grown == NULL)
+            return -1;
+        cache->packed = grown;
+        cache->packedCap = length;
+    }
+    if (pread(store->fd, cache->packed, length, store->blockStart[block]) != length
+            || lzDecompress(cache->packed, length, cache->text, size) != size)
+        return -1;
+    cache->block = block;
+    return 0;
+}
+
+char *storedDocument (BlockStore *store, long docno, long *length) {
+    if (docno < 0 || docno >= store->numDocs)
+        return NULL;
+    StoreBlock cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.block = -1;
+    char *text = NULL;
+    if (store->docLength[docno] == 0) {
+        *length = 0;
+        text = calloc(1, sizeof(char));
+    } else if (readBlock(store, store->docBlock[docno], &cache) == 0) {
+        *length = store->docLength[docno];
+        text = malloc(*length + 1);
+        if (text != NULL) {
+            memcpy(text, cache.text + store->docOffset[docno], *length);
+            text[*length] = '\0';
+        }
+    }
+    free(cache.packed);
+    free(cache.text);
+    return text;
+}
+
+/***
+    Copy the documents of a store into the one being written
+    @call newDocno : docno of each old document, -1 if it's dropped, NULL
+                     to keep every docno
+    @return 0 : success
+    @return -1 : a block couldn't be read or the new store written
+***/
+static int copyStored (StoreWriter *writer, BlockStore *old, const char *from, long newDocno[]) {
+    // The kept documents are copied in order, most from the block read last
+    StoreBlock cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.block = -1;
+    int ret = 0;
+    for (long d = 0; ret == 0 && d < old->numDocs; d++) {
+        long docno = (newDocno != NULL) ? newDocno[d] : d;
+        if (docno < 0)
+            continue;
+        if (readBlock(old, old->docBlock[d], &cache) != 0) {
+            printf("Error reading document %ld of %s\n", d, from);
+            ret = -1;
+            break;
+        }
+        ret = addDocument(writer, docno, cache.text + old->docOffset[d], old->docLength[d], old->docStart[d]);
+    }
+    free(cache.packed);
+    free(cache.text);
+    return ret;
+}
+
+int compactBlockStore (const char *from, const char *to, long oldDocs, long newDocno[], long numDocs) {
+    char *path = generationPath(from, STORE_FILE);
+    BlockStore old;
+    int ret = (path != NULL && loadBlockStore(&old, path, oldDocs) == 0) ? 0 : -1;
+    free(path);
+    if (ret != 0) {
+        printf("Error loading %s of %s\n", STORE_FILE, from);
+        return -1;
+    }
+
+    StoreWriter writer;
+    if (openWriter(&writer, to, numDocs) != 0)
+        ret = -1;
+    if (ret == 0)
+        ret = copyStored(&writer, &old, from, newDocno);
+    if (closeWriter(&writer, ret == 0) != 0) {
+        if (ret == 0)
+            printf("Error writing %s of %s\n", STORE_FILE, to);
+        ret = -1;
+    }
+    freeBlockStore(&old);
+    return ret;
+}
+
+int extendBlockStore (const char *from, const char *to, long oldDocs, int fileid) {
+    char *path = generationPath(from, STORE_FILE);
+    if (path != NULL && access(path, F_OK) != 0) {
+        free(path);
+        return 0;
+    }
+    BlockStore old;
+    int ret = (path != NULL && loadBlockStore(&old, path, oldDocs) == 0) ? 0 : -1;
+    free(path);
+    if (ret != 0) {
+        printf("Error loading %s of %s\n", STORE_FILE, from);
+        return -1;
+    }
+
+    StoreBuild build;
+    memset(&build, 0, sizeof(build));
+    build.firstDoc = oldDocs;
+    build.doc = -1;
+    build.writer.out.fd = -1;
+    DocPlaces *places = &build.places;
+    if (readDocPlaces(to, places) != 0 || fileid < 0 || fileid >= places->numFiles) {
+        printf("Error reading the index files of %s\n", to);
+        ret = -1;
+    }
+    if (ret == 0 && openWriter(&build.writer, to, places->numDocs) != 0)
+        ret = -1;
+    if (ret == 0)
+        ret = copyStored(&build.writer, &old, from, NULL);
+
+    // The new documents are all in one file, after those of the other files
+    while (ret == 0 && places->next < places->numDocs && places->fileid[places->order[places->next]] < fileid)
+        places->next++;
+    if (ret == 0)
+        ret = scanFile(&build, fileid, places->files[fileid]);
+    for (long d = oldDocs; ret == 0 && d < places->numDocs; d++) {
+        if (build.writer.out.docLength[d] == 0) {
+            printf("Error: document %ld of %s wasn't found in %s\n", d, to, places->files[fileid]);
+            ret = -1;
+        }
+    }
+    if (build.writer.path != NULL && closeWriter(&build.writer, ret == 0) != 0) {
+        if (ret == 0)
+            printf("Error writing %s of %s\n", STORE_FILE, to);
+        ret = -1;
+    }
+    freeDocPlaces(places);
+    freeBlockStore(&old);
+    return ret;
+}
+
+int loadBlockStore (BlockStore *store, const char *path, long numDocs) {
+    memset(store, 0, sizeof(BlockStore));
+    store->fd = open(path, O_RDONLY);
+    if (store->fd < 0)
+        return -1;
+
+    StoreHeader header;
+    int ok = pread(store->fd, &header, sizeof(header), 0) == sizeof(header)
+             && memcmp(header.magic, STORE_MAGIC, sizeof(header.magic)) == 0
+             && header.numDocs == numDocs && header.numBlocks >= 0 && header.numBlocks <= UINT32_MAX
+             && header.tableStart >= (int64_t)sizeof(header);
+    long numBlocks = ok ? header.numBlocks : 0;
+    store->numDocs = numDocs;
+    store->numBlocks = numBlocks;
+    store->blockStart = malloc(sizeof(int64_t)*(numBlocks + 1));
+    store->blockSize = malloc(sizeof(uint32_t)*(numBlocks + 1));
+    store->docBlock = malloc(sizeof(uint32_t)*(numDocs + 1));
+    store->docOffset = malloc(sizeof(uint32_t)*(numDocs + 1));
+    store->docLength = malloc(sizeof(uint32_t)*(numDocs + 1));
+    store->docStart = malloc(sizeof(int64_t)*(numDocs + 1));
+    ok = ok && store->blockStart != NULL && store->blockSize != NULL && store->docBlock != NULL
+         && store->docOffset != NULL && store->docLength != NULL && store->docStart != NULL;
+
+    // The tables follow the blocks
+    FILE *fp = ok ? fopen(path, "rb") : NULL;
+    ok = ok && fp != NULL && fseek(fp, header.tableStart, SEEK_SET) == 0;
+    ok = ok && (long)fread(store->blockStart, sizeof(int64_t), numBlocks + 1, fp) == numBlocks + 1;
+    ok = ok && (long)fread(store->blockSize, sizeof(uint32_t), numBlocks, fp) == numBlocks;
+    ok = ok && (long)fread(store->docBlock, sizeof(uint32_t), numDocs, fp) == numDocs;
+    ok = ok && (long)fread(store->docOffset, sizeof(uint32_t), numDocs, fp) == numDocs;
+    ok = ok && (long)fread(store->docLength, sizeof(uint32_t), numDocs, fp) == numDocs;
+    ok = ok && (long)fread(store->docStart, sizeof(int64_t), numDocs, fp) == numDocs;
+    if (fp != NULL)
+        fclose(fp);
+
+    // The offsets are trusted when documents are read, check them once here
+    ok = ok && store->blockStart[0] == (int64_t)sizeof(header)
+         && store->blockStart[numBlocks] == header.tableStart;
+    for (long b = 0; ok && b < numBlocks; b++) {
+        long length = store->blockStart[b+1] - store->blockStart[b];
+        ok = length > 0 && length <= store->blockSize[b];
+    }
+    for (long d = 0; ok && d < numDocs; d++) {
+        ok = (store->docLength[d] == 0 && store->docOffset[d] == 0)
+             || (store->docBlock[d] < numBlocks
+                 && (uint64_t)store->docOffset[d] + store->docLength[d] <= store->blockSize[store->docBlock[d]]);
+    }
+    if (!ok) {
+        freeBlockStore(store);
+        return -1;
+    }
+    return 0;
+}
+
+void freeBlockStore (BlockStore *store) {
+    if (store->fd >= 0)
+        close(store->fd);
+    free(store->blockStart);
+    free(store->blockSize);
+    free(store->docBlock);
+    free(store->docOffset);
+    free(store->docLength);
+    free(store->docStart);
+    memset(store, 0, sizeof(BlockStore));
+    store->fd = -1;
+}
@@ -0,0 +1,102 @@
+/***
+    Filename: blockstore.h
+    Author: Benjamin Baird
+    Description: Header file for blockstore.c, the documents of a
+                 generation compressed in blocks, written by indexer --store
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef STDINT_H_INCLUDED
+#define STDINT_H_INCLUDED
+#include <stdint.h>
+#endif
+
+// Compressed documents of a generation, written by indexer --store
+#define STORE_FILE "documents.bin"
+// Bytes of documents packed into a block before it's compressed. A block
+// holds whole documents, one longer than this is a block of its own
+#define STORE_BLOCK 65536
+
+/***
+    Where every document is in the blocks of a STORE_FILE, which are read
+    from the file as documents are asked for
+***/
+typedef struct BlockStore {
+    long numDocs;
+    long numBlocks;
+    int64_t *blockStart;    // numBlocks + 1 offsets of the compressed blocks in the file
+    uint32_t *blockSize;    // bytes of each block uncompressed, stored as is if it
+                            // didn't compress
+    uint32_t *docBlock;     // block of each document
+    uint32_t *docOffset;    // where it starts in the uncompressed block
+    uint32_t *docLength;
+    int64_t *docStart;      // byte offset of its $DOC in its corpus file, as in
+                            // snippets.bin
+    int fd;
+}BlockStore;
+
+/***
+    Read the documents of a generation directory out of its corpus files,
+    each from its $DOC to the next, and write its STORE_FILE, replacing it
+    atomically. Needs docids.txt and files.txt
+    @return 0 : success
+    @return -1 : the index or corpus files couldn't be read or STORE_FILE
+                 written
+***/
+int writeBlockStore (const char *dir);
+
+/***
+    Write the STORE_FILE of a compacted generation, or of a shard, from the
+    one it came from, without the corpus files
+    @call newDocno : docno of each old document, -1 if it was dropped.
+                     Kept documents keep their order
+    @return 0 : success
+    @return -1 : the old file couldn't be read or the new one written
+***/
+int compactBlockStore (const char *from, const char *to, long oldDocs, long newDocno[], long numDocs);
+
+/***
+    Write the STORE_FILE of a generation that adds documents to the one it
+    came from, the old documents copied from its STORE_FILE and the new ones,
+    docnos oldDocs on, read out of one of its files. Needs to's docids.txt
+    and files.txt
+    @return 0 : success, or from has no STORE_FILE to carry
+    @return -1 : the old file or the new documents couldn't be read, or the
+                 new file written
+***/
+int extendBlockStore (const char *from, const char *to, long oldDocs, int fileid);
+
+/***
+    Open a STORE_FILE written for an index of numDocs documents
+    @return 0 : success
+    @return -1 : the file couldn't be read, is malformed or belongs to
+                 another index
+***/
+int loadBlockStore (BlockStore *store, const char *path, long numDocs);
+
+/***
+    Decompress the block of a document and copy the document out.
+    Safe to call from any number of threads
+    @return : malloc'd text of the document, '\0' terminated, with its
+              length in length. NULL if it couldn't be read
+***/
+char *storedDocument (BlockStore *store, long docno, long *length);
+
+/***
+    Close the store
+***/
+void freeBlockStore (BlockStore *store);
@@ -0,0 +1,176 @@
+/***
+    Filename: buildstats.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Build progress and accounting for the indexer. Tokenizers add
+                 to the shared counts once per document, whichever thread
+                 notices a report is due prints it. Memory is counted by
+                 walking the trees after tokenizing rather than on every
+                 allocation, so the tokenizers pay nothing for it.
+***/
+
+#ifndef BUILDSTATS_H_INCLUDED
+#define BUILDSTATS_H_INCLUDED
+#include "buildstats.h"
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+#ifndef RESOURCE_H_INCLUDED
+#define RESOURCE_H_INCLUDED
+#include <sys/resource.h>
+#endif
+
+#define MB (1024.0*1024.0)
+
+/***
+    Elapsed (wall) time in seconds, from the monotonic clock
+***/
+static double wallClock (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***
+    CPU time of every thread in the process in seconds
+***/
+static double cpuClock (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/***
+    Formats seconds as 1h02m03s, 4m05s or 12.3s
+***/
+static void formatDuration (double seconds, char *buffer, size_t size) {
+    long whole = (long)seconds;
+    if (whole >= 3600)
+        snprintf(buffer, size, "%ldh%02ldm%02lds", whole / 3600, whole / 60 % 60, whole % 60);
+    else if (whole >= 60)
+        snprintf(buffer, size, "%ldm%02lds", whole / 60, whole % 60);
+    else
+        snprintf(buffer, size, "%.1fs", seconds);
+}
+
+void initBuildStats (BuildStats *stats, long totalBytes) {
+    memset(stats, 0, sizeof(BuildStats));
+    stats->totalBytes = totalBytes;
+    stats->start = wallClock();
+    stats->lastReport = stats->start;
+    startPhase(stats);
+}
+
+/***
+    Print one progress line
+***/
+static void printProgress (BuildStats *stats, long bytes, long docs, double now) {
+    double elapsed = now - stats->start;
+    double rate = (elapsed > 0) ? bytes / elapsed : 0;
+    if (stats->totalBytes > 0) {
+        char eta[32] = "?";
+        if (rate > 0 && bytes <= stats->totalBytes)
+            formatDuration((stats->totalBytes - bytes) / rate, eta, sizeof(eta));
+        fprintf(stderr, "Tokenized %.1f of %.1f MB (%.1f%%), %ld docs, %.1f MB/s, ETA %s\n",
+                bytes / MB, stats->totalBytes / MB, 100.0 * bytes / stats->totalBytes, docs,
+                rate / MB, eta);
+    } else {
+        fprintf(stderr, "Tokenized %.1f MB, %ld docs, %.1f MB/s\n", bytes / MB, docs, rate / MB);
+    }
+}
+
+void addProgress (BuildStats *stats, long bytes, long docs) {
+    long total = __atomic_add_fetch(&stats->bytes, bytes, __ATOMIC_RELAXED);
+    long totalDocs = __atomic_add_fetch(&stats->docs, docs, __ATOMIC_RELAXED);
+
+    double now = wallClock();
+    double last;
+    __atomic_load(&stats->lastReport, &last, __ATOMIC_RELAXED);
+    if (now - last < PROGRESS_INTERVAL)
+        return;
+    // One thread reports, the others carry on tokenizing
+    if (__atomic_exchange_n(&stats->reporting, 1, __ATOMIC_ACQUIRE) != 0)
+        return;
+    __atomic_load(&stats->lastReport, &last, __ATOMIC_RELAXED);
+    if (now - last >= PROGRESS_INTERVAL) {
+        printProgress(stats, total, totalDocs, now);
+        __atomic_store(&stats->lastReport, &now, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&stats->reporting, 0, __ATOMIC_RELEASE);
+}
+
+void startPhase (BuildStats *stats) {
+    stats->markWall = wallClock();
+    stats->markCpu = cpuClock();
+}
+
+void endPhase (BuildStats *stats, int phase) {
+    double wall = wallClock();
+    double cpu = cpuClock();
+    stats->phaseWall[phase] += wall - stats->markWall;
+    stats->phaseCpu[phase] += cpu - stats->markCpu;
+    stats->markWall = wall;
+    stats->markCpu = cpu;
+}
+
+void initBuildMemory (BuildMemory *memory) {
+    memset(memory, 0, sizeof(BuildMemory));
+}
+
+void addTreeMemory (BuildMemory *memory, TreeNode *tree) {
+    TreeIter iter;
+    initTreeIter(&iter, tree);
+    TreeNode *node;
+    while ((node = nextTreeNode(&iter)) != NULL) {
+        memory->treeNodes++;
+        memory->treeBytes += sizeof(TreeNode);
+        memory->stringBytes += strlen(node->term) + 1;
+        for (Node *post = node->dictionary; post != NULL; post = post->next) {
+            memory->postingNodes++;
+            memory->postingBytes += sizeof(Node);
+            memory->stringBytes += strlen(post->docId) + 1;
+        }
+    }
+}
+
+void addDocTableMemory (BuildMemory *memory, DocTable *docs) {
+    memory->stringBytes += docs->poolCap;
+    memory->docTableBytes += docs->cap * (sizeof(long) * 2) + docs->numSlots * sizeof(long);
+}
+
+void printBuildSummary (BuildStats *stats, BuildMemory *memory) {
+    static const char *phaseNames[NUM_BUILD_PHASES] = { "parse", "postings", "write" };
+    double wall = 0;
+    double cpu = 0;
+    for (int i = 0; i < NUM_BUILD_PHASES; i++) {
+        wall += stats->phaseWall[i];
+        cpu += stats->phaseCpu[i];
+    }
+
+    fprintf(stderr, "---- Index build ----\n");
+    fprintf(stderr, "%-9s %10s %10s\n", "phase", "wall s", "cpu s");
+    for (int i = 0; i < NUM_BUILD_PHASES; i++) {
+        fprintf(stderr, "%-9s %10.3f %10.3f\n", phaseNames[i], stats->phaseWall[i],
+                stats->phaseCpu[i]);
+    }
+    fprintf(stderr, "%-9s %10.3f %10.3f\n", "total", wall, cpu);
+    fprintf(stderr, "%ld docs, %.1f MB tokenized at %.1f MB/s\n", stats->docs, stats->bytes / MB,
+            stats->phaseWall[BUILD_PARSE] > 0 ? stats->bytes / MB / stats->phaseWall[BUILD_PARSE] : 0.0);
+
+    long total = memory->treeBytes + memory->postingBytes + memory->stringBytes + memory->docTableBytes;
+    fprintf(stderr, "Memory: %.1f MB in the index before writing\n", total / MB);
+    fprintf(stderr, "    tree nodes    %10.1f MB  %ld nodes\n", memory->treeBytes / MB, memory->treeNodes);
+    fprintf(stderr, "    posting nodes %10.1f MB  %ld nodes\n", memory->postingBytes / MB,
+            memory->postingNodes);
+    fprintf(stderr, "    strings       %10.1f MB\n", memory->stringBytes / MB);
+    fprintf(stderr, "    doc tables    %10.1f MB\n", memory->docTableBytes / MB);
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        fprintf(stderr, "    peak RSS      %10.1f MB\n", usage.ru_maxrss * 1024.0 / MB);
+}
@@ -0,0 +1,112 @@
+/***
+    Filename: buildstats.h
+    Author: Benjamin Baird
+    Description: Header file for buildstats.c, the indexer's progress reports,
+                 phase timings and memory accounting
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef TREE_H_INCLUDED
+#define TREE_H_INCLUDED
+#include "tree.h"
+#endif
+
+#ifndef DOCTABLE_H_INCLUDED
+#define DOCTABLE_H_INCLUDED
+#include "doctable.h"
+#endif
+
+// Seconds between progress reports while tokenizing
+#define PROGRESS_INTERVAL 2.0
+
+/***
+    Phases of an index build
+***/
+enum { BUILD_PARSE, BUILD_POSTINGS, BUILD_WRITE, NUM_BUILD_PHASES };
+
+/***
+    Progress and timings of one build. bytes and docs are added to by every
+    tokenizing thread
+***/
+typedef struct BuildStats {
+    long bytes;                         // input tokenized so far
+    long docs;
+    long totalBytes;                    // size of the input, 0 when unknown
+    double start;                       // wall clock when the build started
+    double lastReport;
+    int reporting;                      // a thread is printing a report
+    double phaseWall[NUM_BUILD_PHASES]; // seconds spent in each phase
+    double phaseCpu[NUM_BUILD_PHASES];  // CPU seconds of every thread
+    double markWall;                    // start of the current phase
+    double markCpu;
+}BuildStats;
+
+/***
+    Bytes held by the in-memory index, counted once tokenizing is done
+    since it only grows until the files are written. Sizes are of the
+    structs and strings themselves, without malloc's overhead
+***/
+typedef struct BuildMemory {
+    long treeNodes;
+    long postingNodes;
+    long treeBytes;
+    long postingBytes;
+    long stringBytes;       // terms, the postings' docIds and the doc table pool
+    long docTableBytes;     // the doc table's arrays and hash
+}BuildMemory;
+
+/***
+    Initializes the stats of a build of totalBytes of input (0 if unknown)
+    and starts its clock
+***/
+void initBuildStats (BuildStats *stats, long totalBytes);
+
+/***
+    Add tokenized input, printing a progress report to stderr at most every
+    PROGRESS_INTERVAL seconds. Safe to call from several threads
+***/
+void addProgress (BuildStats *stats, long bytes, long docs);
+
+/***
+    Start timing a phase
+***/
+void startPhase (BuildStats *stats);
+
+/***
+    Charge the time since startPhase to a phase
+***/
+void endPhase (BuildStats *stats, int phase);
+
+/***
+    Initializes empty memory counts
+***/
+void initBuildMemory (BuildMemory *memory);
+
+/***
+    Add the nodes and strings of a term tree
+***/
+void addTreeMemory (BuildMemory *memory, TreeNode *tree);
+
+/***
+    Add a doc table's pool and arrays
+***/
+void addDocTableMemory (BuildMemory *memory, DocTable *docs);
+
+/***
+    Print the phase timings, throughput and memory to stderr
+***/
+void printBuildSummary (BuildStats *stats, BuildMemory *memory);
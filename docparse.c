@@ -0,0 +1,118 @@
+/***
+    Filename: docparse.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Incremental tokenizer. Words are delimited by spaces and
+                 newlines, "$DOC <docid>" starts a document and the words
+                 after its $TITLE/$BODY tags are added to the term tree. The
+                 input is fed in pieces, so the indexer can hand it large
+                 reads and the retriever whatever a pipe has delivered.
+                 The indexer can have the title words kept apart as well.
+***/
+
+#ifndef DOCPARSE_H_INCLUDED
+#define DOCPARSE_H_INCLUDED
+#include "docparse.h"
+#endif
+
+void initDocParser (DocParser *parser, TreeNode **termTree, DocTable *docs, long *numPostings) {
+    memset(parser, 0, sizeof(DocParser));
+    parser->termTree = termTree;
+    parser->docs = docs;
+    parser->numPostings = numPostings;
+    parser->docno = -1;
+}
+
+void keepFields (DocParser *parser, TreeNode **titleTree, long *titlePostings,
+                 FieldLengths *lengths) {
+    parser->titleTree = titleTree;
+    parser->titlePostings = titlePostings;
+    parser->lengths = lengths;
+}
+
+int parseWord (DocParser *parser, char *word, int delim) {
+    int started = 0;
+    if (strncmp(word, "$", 1) == 0) {
+        if (strcmp(word, "$DOC") == 0) {
+            parser->metaTags = 1;
+            parser->docno = -1;
+            started = 1;
+        } else {
+            // $TITLE or $BODY
+            parser->metaTags++;
+        }
+        parser->inTitle = strcmp(word, "$TITLE") == 0;
+
+    } else if (parser->metaTags == 1) {
+        // Load docid
+        strcpy(parser->docId, word);
+        parser->docLine = parser->lineNum;
+
+    } else if (parser->metaTags > 1) {
+        // Update the tree
+        int indexed = strlen(word) >= 1 && strncmp(word, "0",1) > 0;
+        if (indexed) {
+            if ((*parser->termTree) != NULL ) {
+                (*parser->termTree) = addTerm((*parser->termTree), word, parser->docId,
+                                              parser->numPostings);
+            } else {
+                (*parser->termTree) = initTreeNode(word, parser->docId);
+                (*parser->numPostings)++;
+            }
+        }
+        if (indexed && parser->inTitle && parser->titleTree != NULL) {
+            if ((*parser->titleTree) != NULL) {
+                (*parser->titleTree) = addTerm((*parser->titleTree), word, parser->docId,
+                                               parser->titlePostings);
+            } else {
+                (*parser->titleTree) = initTreeNode(word, parser->docId);
+                (*parser->titlePostings)++;
+            }
+        }
+
+        // Making sure document is not empty
+        if (parser->metaTags == 2) {
+            parser->docno = addDoc(parser->docs, parser->docId, parser->docLine);
+            if (parser->docno < 0)
+                return -1;
+            parser->metaTags++;
+        }
+        if (indexed && parser->lengths != NULL && parser->docno >= 0
+                && countFieldTerm(parser->lengths, parser->docno, parser->inTitle) != 0)
+            return -1;
+        parser->numTerms++;
+    }
+
+    // Found a newline
+    if (delim == '\n')
+        parser->lineNum++;
+    return started;
+}
+
+long parseBytes (DocParser *parser, const char *data, long size) {
+    long started = 0;
+    for (long i = 0; i < size; i++) {
+        char c = data[i];
+        if (c != ' ' && c != '\n') {
+            if (parser->length < MAX_WORD)
+                parser->word[parser->length++] = c;
+            continue;
+        }
+        parser->word[parser->length] = '\0';
+        parser->length = 0;
+        int ret = parseWord(parser, parser->word, c);
+        if (ret < 0)
+            return -1;
+        started += ret;
+    }
+    return started;
+}
+
+int finishParse (DocParser *parser) {
+    if (parser->length == 0)
+        return 0;
+    parser->word[parser->length] = '\0';
+    parser->length = 0;
+    return (parseWord(parser, parser->word, EOF) < 0) ? -1 : 0;
+}
@@ -0,0 +1,80 @@
+/***
+    Filename: docparse.h
+    Author: Benjamin Baird
+    Description: Header file for docparse.c, the $DOC/$TITLE/$BODY tokenizer
+                 shared by the indexer and the retriever's ingest thread
+***/
+
+#ifndef TREE_H_INCLUDED
+#define TREE_H_INCLUDED
+#include "tree.h"
+#endif
+
+#ifndef DOCTABLE_H_INCLUDED
+#define DOCTABLE_H_INCLUDED
+#include "doctable.h"
+#endif
+
+#ifndef FIELDS_H_INCLUDED
+#define FIELDS_H_INCLUDED
+#include "fields.h"
+#endif
+
+// Longest word kept while tokenizing, longer words are truncated
+#define MAX_WORD 199
+
+/***
+    Tokenizer state, kept between pieces of the input so a word or a
+    document may span any number of them
+***/
+typedef struct DocParser {
+    TreeNode **termTree;
+    DocTable *docs;
+    long *numPostings;      // incremented for every posting added to termTree
+    int metaTags;           // 1 after $DOC, >1 after $TITLE or $BODY
+    int inTitle;            // after $TITLE and before the next tag
+    long docno;             // of the document being read, -1 until it's added
+    TreeNode **titleTree;   // title words are also added to it unless it's NULL
+    long *titlePostings;    // incremented for every posting added to titleTree
+    FieldLengths *lengths;  // terms of each field, counted with titleTree
+    char docId [MAX_WORD+1];
+    long docLine;
+    long lineNum;           // lines read so far
+    char word [MAX_WORD+1]; // the word being read
+    int length;
+    int numTerms;
+}DocParser;
+
+/***
+    Initializes a parser adding terms to termTree and documents to docs
+***/
+void initDocParser (DocParser *parser, TreeNode **termTree, DocTable *docs, long *numPostings);
+
+/***
+    Also add the words of the documents' titles to titleTree and count the
+    terms of their fields into lengths
+***/
+void keepFields (DocParser *parser, TreeNode **titleTree, long *titlePostings,
+                 FieldLengths *lengths);
+
+/***
+    Add one word, ended by delim (' ', '\n' or EOF)
+    @return 1 : the word started a document
+    @return 0 : success
+    @return -1 : out of memory
+***/
+int parseWord (DocParser *parser, char *word, int delim);
+
+/***
+    Tokenize the next size bytes of the input
+    @return >=0 : number of documents started
+    @return -1 : out of memory
+***/
+long parseBytes (DocParser *parser, const char *data, long size);
+
+/***
+    End the input, adding a last word that had no delimiter after it
+    @return 0 : success
+    @return -1 : out of memory
+***/
+int finishParse (DocParser *parser);
@@ -0,0 +1,127 @@
+/***
+    Filename: doctable.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Growable document table for invertedFileOffline.c. Documents
+                 are numbered in the order they are first added, docIds live
+                 in one string pool and are found through a hash of docnos.
+***/
+
+#ifndef DOCTABLE_H_INCLUDED
+#define DOCTABLE_H_INCLUDED
+#include "doctable.h"
+#endif
+
+/***
+    FNV-1a hash of a docId
+***/
+static unsigned long hashDocId (char *docId) {
+    unsigned long hash = 14695981039346656037UL;
+    while (*docId != '\0') {
+        hash ^= (unsigned char)*docId++;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+void initDocTable (DocTable *table) {
+    memset(table, 0, sizeof(DocTable));
+}
+
+void freeDocTable (DocTable *table) {
+    free(table->pool);
+    free(table->idOffset);
+    free(table->start);
+    free(table->slots);
+    initDocTable(table);
+}
+
+char *getDocId (DocTable *table, long docno) {
+    return table->pool + table->idOffset[docno];
+}
+
+/***
+    Find the slot that holds docId, or the empty slot where it belongs
+***/
+static long findSlot (DocTable *table, char *docId) {
+    long mask = table->numSlots - 1;
+    long slot = (long)(hashDocId(docId) & (unsigned long)mask);
+    while (table->slots[slot] != 0) {
+        if (strcmp(getDocId(table, table->slots[slot] - 1), docId) == 0)
+            break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/***
+    Double the hash, keeping the load under one half
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int growSlots (DocTable *table) {
+    long numSlots = (table->numSlots == 0) ? 1024 : table->numSlots * 2;
+    long *slots = calloc(numSlots, sizeof(long));
+    if (slots == NULL)
+        return -1;
+
+    long *old = table->slots;
+    table->slots = slots;
+    table->numSlots = numSlots;
+    for (long docno = 0; docno < table->size; docno++) {
+        table->slots[findSlot(table, getDocId(table, docno))] = docno + 1;
+    }
+    free(old);
+    return 0;
+}
+
+long findDoc (DocTable *table, char *docId) {
+    if (table->size == 0)
+        return -1;
+    long slot = findSlot(table, docId);
+    return table->slots[slot] - 1;
+}
+
+long addDoc (DocTable *table, char *docId, long start) {
+    if ((table->size + 1) * 2 > table->numSlots && growSlots(table) != 0)
+        return -1;
+
+    long slot = findSlot(table, docId);
+    if (table->slots[slot] != 0)
+        return table->slots[slot] - 1;
+
+    // Grow the columns and the pool geometrically
+    if (table->size == table->cap) {
+        long cap = (table->cap == 0) ? 1024 : table->cap * 2;
+        long *idOffset = realloc(table->idOffset, sizeof(long)*cap);
+        if (idOffset == NULL)
+            return -1;
+        table->idOffset = idOffset;
+        long *start = realloc(table->start, sizeof(long)*cap);
+        if (start == NULL)
+            return -1;
+        table->start = start;
+        table->cap = cap;
+    }
+    long length = (long)strlen(docId) + 1;
+    if (table->poolSize + length > table->poolCap) {
+        long poolCap = (table->poolCap == 0) ? 16384 : table->poolCap * 2;
+        while (table->poolSize + length > poolCap)
+            poolCap *= 2;
+        char *pool = realloc(table->pool, sizeof(char)*poolCap);
+        if (pool == NULL)
+            return -1;
+        table->pool = pool;
+        table->poolCap = poolCap;
+    }
+
+    long docno = table->size;
+    memcpy(table->pool + table->poolSize, docId, length);
+    table->idOffset[docno] = table->poolSize;
+    table->start[docno] = start;
+    table->poolSize += length;
+    table->slots[slot] = docno + 1;
+    table->size++;
+    return docno;
+}
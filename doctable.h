@@ -0,0 +1,62 @@
+/***
+    Filename: doctable.h
+    Author: Benjamin Baird
+    Description: Header file for doctable.c, a growable table of documents
+                 whose docIds are interned into a single string pool
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+typedef struct DocTable {
+    char *pool;         // docIds back to back, each '\0' terminated
+    long poolSize;
+    long poolCap;
+    long *idOffset;     // offset of each docno's docId in pool
+    long *start;        // starting line of each docno in the input file
+    long size;          // number of documents
+    long cap;
+    long *slots;        // open addressing hash of docno+1, 0 is empty
+    long numSlots;
+}DocTable;
+
+/***
+    Initializes an empty DocTable, nothing is allocated until the first add
+***/
+void initDocTable (DocTable *table);
+
+/***
+    Frees the contents of a DocTable
+***/
+void freeDocTable (DocTable *table);
+
+/***
+    Interns a docId, the next docno is assigned if it has not been seen
+    @return >=0 : docno of the docId
+    @return -1 : out of memory
+***/
+long addDoc (DocTable *table, char *docId, long start);
+
+/***
+    Looks up the docno of a docId
+    @return >=0 : docno of the docId
+    @return -1 : docId not in the table
+***/
+long findDoc (DocTable *table, char *docId);
+
+/***
+    @return : docId of a docno
+***/
+char *getDocId (DocTable *table, long docno);
@@ -0,0 +1,1683 @@
+/***
+    Filename: engine.c
+    Author: Benjamin Baird
+    Date Created: April 2, 2016
+    Date Updated: October 19, 2026
+    Description: Loads the index files and retrieves relevant documents for a
+                 query using the vector space model. Split out of
+                 invertedFileOnline.c so the benchmarks can drive it.
+***/
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "engine.h"
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef POSTLOAD_H_INCLUDED
+#define POSTLOAD_H_INCLUDED
+#include "postload.h"
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+/***
+    Monotonic clock for profiling, free when the query isn't profiled
+***/
+static double profileClock (QueryProfile *profile) {
+    return (profile != NULL) ? metricsClock() / 1e9 : 0;
+}
+
+/***
+    Charge the time since mark to a phase
+    @return : the new mark
+***/
+static double profileLap (QueryProfile *profile, int phase, double mark) {
+    if (profile == NULL)
+        return 0;
+    double now = profileClock(profile);
+    profile->phase[phase] += now - mark;
+    return now;
+}
+
+/***
+    Compare function for qsort
+***/
+int cmp (const void *pa, const void *pb) {
+    const double *a = *(double**)pa;
+    const double *b = *(double**)pb;
+    if (a[1] > b[1])
+        return -1;
+    if (a[1] < b[1])
+        return 1;
+    return 0;
+}
+
+/***
+    Multiply two vectors of the same length
+***/
+double dotProduct (double vOne[], double vTwo[], long size) {
+    double product = 0;
+
+    for (long i = 0; i < size; i++) {
+        product += vOne[i] * vTwo[i];
+    }
+
+    return product;
+}
+
+/***
+    Normalize/find magnitude of same length vectors
+***/
+double normalize (double vectorOne[], double vectorTwo[], long size) {
+    double result = dotProduct(vectorOne, vectorTwo, size);
+    result = sqrt(result);
+    return result;
+}
+
+/***
+    Calculates the term frequency - inverse document frequency
+    @return >=0 : document relevancy
+                    closer to 0 = appears a lot
+                    closer to infinity appears little if at all
+***/
+double tfidf (double tf, long totalDocs, long df) {
+    if (df == 0)
+        return 10000;
+    return ((double)tf * log2((double)totalDocs/(double)df));
+}
+
+static const char *scoringNames[NUM_SCORINGS] = { "tfidf", "bm25", "bm25f" };
+
+int findScoring (const char *name) {
+    for (int m = 0; m < NUM_SCORINGS; m++) {
+        if (strcasecmp(name, scoringNames[m]) == 0)
+            return m;
+    }
+    return -1;
+}
+
+const char *scoringName (int model) {
+    return scoringNames[model];
+}
+
+/***
+    Binary search to locate a string in a dictionary index
+    @return >=0 : index of term in the dictionary
+    @return -1 : term not found
+***/
+long searchIndex ( DictIndex index[], long length, char *term) {
+    long min = 0;
+    long max = length;
+
+    // length is the last index, terms past the ends used to read off them
+    while (min <= max) {
+        long middle = min + (max - min)/2;
+        long cmp = strcasecmp(term, index[middle].term);
+        if (cmp == 0) {
+            return middle;
+        } else if ( cmp < 0 ) {
+            // BinarySearch moving down
+            max = middle - 1;
+        } else {
+            // BinarySearch moving up
+            min = middle + 1;
+        }
+    }
+
+    return -1;
+}
+
+/***
+    Document frequency of a term without deleted documents. Counted the first
+    time the term is queried after documents are deleted and cached in the
+    index's liveDf, which a new bitmap comes with a new one of
+    @return >=0 : number of live documents the term appears in
+***/
+long liveDf (Index *index, long entry) {
+    DictIndex *term = &index->dictIndex[entry];
+    if (index->live->numDeleted == 0)
+        return term->df;
+    // Queries on other threads may count the same entry, they store the same value
+    long df = __atomic_load_n(&index->liveDf[entry], __ATOMIC_RELAXED);
+    if (df < 0) {
+        df = 0;
+        for (long k = term->postIndex; k < term->postIndex + term->df; k++) {
+            if (!isDeleted(index->live, index->postIndex.docno[k]))
+                df++;
+        }
+        __atomic_store_n(&index->liveDf[entry], df, __ATOMIC_RELAXED);
+    }
+    return df;
+}
+
+long *newLiveDfCache (long dictSize) {
+    long *cache = malloc(sizeof(long) * (dictSize > 0 ? dictSize : 1));
+    for (long i = 0; cache != NULL && i < dictSize; i++)
+        cache[i] = -1;
+    return cache;
+}
+
+long totalDocs (Index *index) {
+    return index->numDocs + ((index->segment != NULL) ? index->segment->numDocs : 0);
+}
+
+DocIndex *getDoc (Index *index, long docno) {
+    if (docno >= index->numDocs)
+        return &index->segment->docIndex[docno - index->numDocs];
+    return &index->docIndex[docno];
+}
+
+char *docFile (Index *index, long docno) {
+    char **files = (docno >= index->numDocs) ? index->segment->files : index->files;
+    return files[getDoc(index, docno)->fileid];
+}
+
+/***
+    Live documents the idfs are taken over, of the index and its segment.
+    A shard counts the documents of every shard, less its own deleted ones
+***/
+static long collectionDocs (Index *index) {
+    long numDocs = (index->shardStats != NULL) ? index->shardStats->numDocs : index->numDocs;
+    if (index->segment != NULL)
+        numDocs += index->segment->numDocs;
+    return numDocs - index->live->numDeleted;
+}
+
+/***
+    Look a query term up in the index and its segment
+    @return : live document frequency of the term over both, over every
+              shard when the index is a shard
+***/
+static long lookupTerm (Index *index, char *term, long *entry, long *segEntry) {
+    *entry = searchIndex(index->dictIndex, index->dictSize - 1, term);
+    long df = (*entry >= 0) ? liveDf(index, *entry) : 0;
+    ShardStats *stats = index->shardStats;
+    if (stats != NULL) {
+        // The shard only knows of its own deleted documents
+        long deleted = (*entry >= 0) ? index->dictIndex[*entry].df - df : 0;
+        long global = searchIndex(stats->dict, stats->dictSize - 1, term);
+        if (global >= 0)
+            df = stats->dict[global].df - deleted;
+    }
+    *segEntry = -1;
+    Index *segment = index->segment;
+    if (segment != NULL) {
+        *segEntry = searchIndex(segment->dictIndex, segment->dictSize - 1, term);
+        if (*segEntry >= 0)
+            df += segment->dictIndex[*segEntry].df;
+    }
+    return df;
+}
+
+/***
+    A query's unique terms, their weights and where they are in the index
+***/
+typedef struct QueryTerms {
+    long count;
+    char *text;         // copy of the query the terms point into
+    char **term;        // in the order they first occur
+    double *weight;     // tf-idf weight of each term, 0 when it isn't found or is dropped
+    double *tf;         // frequency of each term in the query
+    long *df;           // live document frequency, see lookupTerm
+    long *entry;        // dictionary entry of each term in the index, -1 if missing
+    long *segEntry;     // in the segment
+    long found;         // terms with a live document frequency
+    long dropped;       // found terms left out of a long query
+    double magnitude;   // of the weights
+}QueryTerms;
+
+/***
+    FNV-1a hash of a query term
+***/
+static unsigned long hashTerm (const char *term) {
+    unsigned long hash = 14695981039346656037UL;
+    while (*term != '\0') {
+        hash ^= (unsigned char)*term++;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+static int cmpDf (const void *a, const void *b) {
+    long x = *(const long*)a;
+    long y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+/***
+    Split a query into its unique terms, weighing each by its frequency in
+    the query and its idf over the live documents of the index and its
+    segment. Tokens are counted through a hash of the terms, so every term
+    is compared and looked up once however long the query is. Past
+    LONG_QUERY_TERMS found terms only the rarest are kept
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int parseQuery (const char *query, Index *index, QueryTerms *terms, QueryProfile *profile) {
+    long numLive = collectionDocs(index);
+    double mark = profileClock(profile);
+    memset(terms, 0, sizeof(QueryTerms));
+
+    // A term takes a character and its delimiter, at most
+    long length = (long)strlen(query);
+    long maxTerms = length/2 + 1;
+    long mask = 1;
+    while (mask < maxTerms*2)
+        mask *= 2;
+    mask--;
+    terms->text = malloc(length + 1);
+    terms->term = malloc(sizeof(char*)*maxTerms);
+    terms->weight = malloc(sizeof(double)*maxTerms);
+    terms->tf = malloc(sizeof(double)*maxTerms);
+    terms->entry = malloc(sizeof(long)*maxTerms);
+    terms->segEntry = malloc(sizeof(long)*maxTerms);
+    terms->df = malloc(sizeof(long)*maxTerms);
+    long *slots = calloc(mask + 1, sizeof(long));   // term+1, 0 is empty
+    if (terms->text == NULL || terms->term == NULL || terms->weight == NULL || terms->tf == NULL
+            || terms->df == NULL || terms->entry == NULL || terms->segEntry == NULL || slots == NULL) {
+        free(slots);
+        return -1;
+    }
+    long *df = terms->df;
+    char *save;     // strtok_r's position, queries may run on several threads
+    char *delims = " \n";
+    double maxTf = 0;
+
+    // Count each term, adding it the first time it occurs
+    strcpy(terms->text, query);
+    for (char *token = strtok_r(terms->text, delims, &save); token != NULL;
+            token = strtok_r(NULL, delims, &save)) {
+        unsigned long slot = hashTerm(token) & (unsigned long)mask;
+        while (slots[slot] != 0 && strcmp(terms->term[slots[slot]-1], token) != 0)
+            slot = (slot + 1) & (unsigned long)mask;
+        if (slots[slot] == 0) {
+            terms->term[terms->count] = token;
+            terms->tf[terms->count] = 0;
+            slots[slot] = ++terms->count;
+        }
+        long i = slots[slot] - 1;
+        if (++terms->tf[i] > maxTf)
+            maxTf = terms->tf[i];
+    }
+    free(slots);
+    mark = profileLap(profile, PHASE_TOKENIZE, mark);
+
+    // Go through all the words for the query
+    for (long i = 0; i < terms->count; i++) {
+        df[i] = lookupTerm(index, terms->term[i], &terms->entry[i], &terms->segEntry[i]);
+        if (df[i] > 0)
+            terms->found++;
+    }
+
+    // The common terms of a long query add many postings and little to the
+    // ranking, keep the LONG_QUERY_TERMS rarest and any as rare as the last
+    long cutoff = numLive + 1;
+    if (terms->found > LONG_QUERY_TERMS) {
+        long *sorted = malloc(sizeof(long)*terms->found);
+        if (sorted == NULL)
+            return -1;
+        long k = 0;
+        for (long i = 0; i < terms->count; i++) {
+            if (df[i] > 0)
+                sorted[k++] = df[i];
+        }
+        qsort(sorted, k, sizeof(long), cmpDf);
+        cutoff = sorted[LONG_QUERY_TERMS - 1];
+        free(sorted);
+    }
+
+    for (long i = 0; i < terms->count; i++) {
+        // Assign vector weights
+        if (df[i] > 0 && df[i] <= cutoff) {
+            terms->weight[i] = tfidf(terms->tf[i]/maxTf, numLive, df[i]);
+            // Read by the reload thread while queries are answered
+            if (terms->entry[i] >= 0 && index->termHits != NULL)
+                __atomic_fetch_add(&index->termHits[terms->entry[i]], 1, __ATOMIC_RELAXED);
+        } else {
+            if (df[i] > 0)
+                terms->dropped++;
+            terms->weight[i] = 0;
+            terms->entry[i] = -1;
+            terms->segEntry[i] = -1;
+        }
+    }
+    terms->magnitude = normalize(terms->weight, terms->weight, terms->count);
+    profileLap(profile, PHASE_LOOKUP, mark);
+    return 0;
+}
+
+static void freeQueryTerms (QueryTerms *terms) {
+    free(terms->text);
+    free(terms->term);
+    free(terms->weight);
+    free(terms->tf);
+    free(terms->df);
+    free(terms->entry);
+    free(terms->segEntry);
+}
+
+/***
+    Score the segment's postings of the query terms into its part of
+    docMatrix and divide them by the documents' magnitudes
+    @return : postings scored
+***/
+static long scoreSegment (Index *index, QueryTerms *terms, double docMatrix[]) {
+    Index *segment = index->segment;
+    if (segment == NULL)
+        return 0;
+    long numLive = collectionDocs(index);
+    long postingsScored = 0;
+    for (long i = 0; i < terms->count; i++) {
+        if (terms->segEntry[i] < 0)
+            continue;
+        // The segment's docnos start after the index's
+        DictIndex *entry = &segment->dictIndex[terms->segEntry[i]];
+        double idf = tfidf(1.0, numLive, terms->df[i]);
+        scorePostings(&segment->postIndex, entry->postIndex, entry->df, idf,
+                      terms->weight[i], docMatrix + index->numDocs);
+        postingsScored += entry->df;
+    }
+    for (long i = 0; i < segment->numDocs; i++) {
+        double denominator = segment->docTermVector[i] * terms->magnitude;
+        double *score = &docMatrix[index->numDocs + i];
+        if (denominator == 0)
+            *score = 0;
+        else
+            *score /= denominator;
+    }
+    return postingsScored;
+}
+
+/***
+    Sort the documents by score and flag the first one without any match
+    @return : [docno, weight] pairs
+***/
+static double **rankDocuments (double docMatrix[], long numDocs) {
+    double **sorted = malloc(sizeof(double**)*numDocs);
+    for (long i = 0; i < numDocs; i++) {
+        sorted[i] = malloc(sizeof(double*)*2);
+        sorted[i][0] = i;
+        sorted[i][1] = docMatrix[i];
+    }
+
+    qsort( sorted, numDocs, sizeof(double*), cmp );
+
+    for (long i = 0; i < numDocs; i++) {
+        if (sorted[i][1] == 0.0) {
+            sorted[i][1] = -1.0;
+            break;
+        }
+    }
+    return sorted;
+}
+
+/***
+    Count a query into the metrics and its profile
+***/
+static void recordQuery (QueryProfile *profile, QueryTerms *terms, long postingsScored,
+                         long docsTouched, long long start) {
+    countMetric(METRIC_QUERIES, 1);
+    countMetric(METRIC_QUERY_TERMS, terms->count);
+    countMetric(METRIC_LOOKUP_MISSES, terms->count - terms->found);
+    countMetric(METRIC_POSTINGS_SCORED, postingsScored);
+    recordMetric(METRIC_QUERY_LATENCY, metricsClock() - start);
+
+    if (profile != NULL) {
+        profile->terms += terms->count;
+        profile->termsFound += terms->found;
+        profile->termsDropped += terms->dropped;
+        profile->postingsScored += postingsScored;
+        profile->docsTouched += docsTouched;
+    }
+}
+
+/***
+    Title postings of a term that aren't of deleted documents
+***/
+static long liveTitleDf (FieldIndex *fields, long entry, LiveDocs *live) {
+    long df = 0;
+    for (long k = fields->termStart[entry]; k < fields->termStart[entry + 1]; k++)
+        df += !isDeleted(live, fields->docno[k]);
+    return df;
+}
+
+/***
+    Score a term's title postings into docMatrix
+        docMatrix[docno] += titleTf * idf * queryWeight
+    @return : postings scored
+***/
+static long scoreTitles (FieldIndex *fields, long entry, double idf, double queryWeight,
+                         double docMatrix[]) {
+    double weight = idf * queryWeight;
+    for (long k = fields->termStart[entry]; k < fields->termStart[entry + 1]; k++)
+        docMatrix[fields->docno[k]] += fields->tf[k] * weight;
+    return fields->termStart[entry + 1] - fields->termStart[entry];
+}
+
+/***
+    Score a query against the titles alone: its terms are weighed by their
+    idf over the live titles and the documents divided by the magnitudes of
+    their titles. The segment's documents have no title postings
+    @return : postings scored
+***/
+static long scoreTitleOnly (Index *index, QueryTerms *terms, double docMatrix[]) {
+    FieldIndex *fields = index->fields;
+    long numLive = index->numDocs - index->live->numDeleted;
+    long postingsScored = 0;
+    double *idf = malloc(sizeof(double)*(terms->count + 1));
+    if (idf == NULL)
+        return 0;
+    for (long i = 0; i < terms->count; i++) {
+        long df = (terms->entry[i] >= 0) ? liveTitleDf(fields, terms->entry[i], index->live) : 0;
+        idf[i] = (df > 0) ? tfidf(1.0, numLive, df) : 0;
+        terms->weight[i] = terms->tf[i] * idf[i];
+    }
+    terms->magnitude = normalize(terms->weight, terms->weight, terms->count);
+    for (long i = 0; i < terms->count; i++) {
+        if (idf[i] > 0)
+            postingsScored += scoreTitles(fields, terms->entry[i], idf[i], terms->weight[i], docMatrix);
+    }
+    for (long i = 0; i < index->numDocs; i++) {
+        double denominator = fields->titleVector[i] * terms->magnitude;
+        if (denominator == 0 || isDeleted(index->live, i))
+            docMatrix[i] = 0;
+        else
+            docMatrix[i] /= denominator;
+    }
+    free(idf);
+    return postingsScored;
+}
+
+/***
+    Score a query by BM25, or by BM25F over the titles and bodies when fields
+    isn't NULL, with idfs over the live documents of the index and its
+    segment. The segment's documents have no fields and are scored by BM25,
+    normalized by the index's average length. Deleted documents are zeroed
+    @return : postings scored
+***/
+static long scoreOkapi (Index *index, QueryTerms *terms, Scoring *scoring, FieldIndex *fields,
+                        double titleWeight, double docMatrix[]) {
+    Index *segment = index->segment;
+    long numLive = collectionDocs(index);
+    double k1 = scoring->k1;
+    double b = scoring->b;
+    double avgLength = index->avgLength;
+    if (avgLength == 0 && segment != NULL)
+        avgLength = segment->avgLength;
+    if (avgLength == 0)
+        avgLength = 1;
+
+    // The model is picked here, once per term, and not in the kernels' loops
+    OkapiTerm term;
+    memset(&term, 0, sizeof(term));
+    term.k1 = k1;
+    long postingsScored = 0;
+    for (long i = 0; i < terms->count; i++) {
+        long entry = terms->entry[i];
+        long segEntry = terms->segEntry[i];
+        long df = terms->df[i];
+        if (df == 0 || (entry < 0 && segEntry < 0))
+            continue;
+        double idf = log(1 + (numLive - df + 0.5) / (df + 0.5));
+        term.weight = idf * (k1 + 1) * terms->tf[i];
+
+        if (entry >= 0 && fields != NULL) {
+            term.base = 1 - b;
+            term.slope = (fields->avgBody > 0) ? b / fields->avgBody : 0;
+            term.length = fields->bodyLength;
+            term.titleBase = (1 - b) / titleWeight;
+            term.titleSlope = (fields->avgTitle > 0) ? b / (fields->avgTitle * titleWeight) : 0;
+            term.titleLength = fields->titleLength;
+            term.titleDocno = fields->docno + fields->termStart[entry];
+            term.titleTf = fields->tf + fields->termStart[entry];
+            term.titleCount = fields->termStart[entry + 1] - fields->termStart[entry];
+            scoreBM25F(&index->postIndex, index->dictIndex[entry].postIndex,
+                       index->dictIndex[entry].df, &term, docMatrix);
+            postingsScored += index->dictIndex[entry].df + term.titleCount;
+        } else if (entry >= 0) {
+            term.base = k1 * (1 - b);
+            term.slope = k1 * b / avgLength;
+            term.length = index->docLength;
+            scoreBM25(&index->postIndex, index->dictIndex[entry].postIndex,
+                      index->dictIndex[entry].df, &term, docMatrix);
+            postingsScored += index->dictIndex[entry].df;
+        }
+        if (segEntry >= 0) {
+            // The segment's docnos start after the index's
+            term.base = k1 * (1 - b);
+            term.slope = k1 * b / avgLength;
+            term.length = segment->docLength;
+            scoreBM25(&segment->postIndex, segment->dictIndex[segEntry].postIndex,
+                      segment->dictIndex[segEntry].df, &term, docMatrix + index->numDocs);
+            postingsScored += segment->dictIndex[segEntry].df;
+        }
+    }
+    for (long i = 0; i < index->numDocs; i++) {
+        if (isDeleted(index->live, i))
+            docMatrix[i] = 0;
+    }
+    return postingsScored;
+}
+
+/***
+    Perform a weighted retrieval of relevant documents, deleted documents are
+    given no weight and idfs are taken over the live documents of the index
+    and its segment. Documents are scored by the model of scoring and the
+    fields of scope are searched when the index has them, either may be NULL
+    @return : array of relevant documents, with corresponding weights and ranking
+***/
+static double **evaluateQuery (const char *query, Index *index, Scoring *scoring, FieldScope *scope,
+                               QueryProfile *profile) {
+    DictIndex *dictIndex = index->dictIndex;
+    PostColumns *postIndex = &index->postIndex;
+    LiveDocs *live = index->live;
+    double *docTermVector = index->docTermVector;
+    long numDocs = totalDocs(index);
+    long numLive = collectionDocs(index);
+    long long start = metricsClock();
+    FieldIndex *fields = (scope != NULL) ? index->fields : NULL;
+    int model = (scoring != NULL) ? scoring->model : SCORING_TFIDF;
+
+    QueryTerms terms;
+    if (parseQuery(query, index, &terms, profile) != 0) {
+        freeQueryTerms(&terms);
+        return NULL;
+    }
+    double mark = profileClock(profile);
+
+    // Calculate the weighted vectors of each document
+    double *docMatrix = malloc(sizeof(double)*numDocs);
+
+    // Initialize vectors with 0 (Better way?)
+    for (long i = 0; i < numDocs; i++)
+        docMatrix[i] = 0;
+
+    long postingsScored = 0;
+    long docsTouched = 0;
+    if (fields != NULL && scope->titleOnly) {
+        postingsScored = scoreTitleOnly(index, &terms, docMatrix);
+        mark = profileLap(profile, PHASE_SCORE, mark);
+        countMetric(METRIC_TITLE_QUERIES, 1);
+    } else if (model != SCORING_TFIDF) {
+        FieldIndex *bodies = (model == SCORING_BM25F) ? index->fields : NULL;
+        double titleWeight = (scope != NULL) ? scope->titleWeight : 1;
+        postingsScored = scoreOkapi(index, &terms, scoring, bodies, titleWeight, docMatrix);
+        mark = profileLap(profile, PHASE_SCORE, mark);
+    } else {
+        // Accumulate the dot product of every doc that the words appear in
+        for (long i = 0; i < terms.count; i++) {
+            long result = terms.entry[i];
+            if (result < 0 || liveDf(index, result) == 0)
+                continue;
+            double idf = tfidf(1.0, numLive, terms.df[i]);
+            scorePostings(postIndex, dictIndex[result].postIndex, dictIndex[result].df,
+                          idf, terms.weight[i], docMatrix);
+            postingsScored += dictIndex[result].df;
+
+            // Title occurrences count titleWeight times, the full postings counted them once
+            if (fields != NULL && scope->titleWeight != 1)
+                postingsScored += scoreTitles(fields, result, idf,
+                                              terms.weight[i] * (scope->titleWeight - 1), docMatrix);
+        }
+        postingsScored += scoreSegment(index, &terms, docMatrix);
+        mark = profileLap(profile, PHASE_SCORE, mark);
+
+        // Cosine similarity of the vectors to get weighted results
+        for (long i = 0; i < index->numDocs; i++) {
+            double denominator = docTermVector[i] * terms.magnitude;
+            if (denominator == 0 || isDeleted(live, i))
+                docMatrix[i] = 0;   // No term(s) or deleted
+            else
+                docMatrix[i] /= denominator;
+        }
+    }
+    for (long i = 0; i < numDocs; i++)
+        docsTouched += (docMatrix[i] != 0);
+    mark = profileLap(profile, PHASE_NORMALIZE, mark);
+
+    double **sorted = rankDocuments(docMatrix, numDocs);
+    profileLap(profile, PHASE_SORT, mark);
+    recordQuery(profile, &terms, postingsScored, docsTouched, start);
+
+    free(docMatrix);
+    freeQueryTerms(&terms);
+    return sorted;
+}
+
+double **retrieveResults (const char *query, Index *index, QueryProfile *profile) {
+    return evaluateQuery(query, index, NULL, NULL, profile);
+}
+
+double **retrieveScored (const char *query, Index *index, Scoring *scoring, FieldScope *scope,
+                         QueryProfile *profile) {
+    return evaluateQuery(query, index, scoring, scope, profile);
+}
+
+/***
+    One impact segment of a query term, weighted by the term's query weight
+***/
+typedef struct QuerySegment {
+    double weight;      // added to the score of each of its documents
+    long segment;
+}QuerySegment;
+
+/***
+    Compare function for qsort, heaviest query segment first
+***/
+static int cmpSegment (const void *pa, const void *pb) {
+    const QuerySegment *a = pa;
+    const QuerySegment *b = pb;
+    if (a->weight > b->weight)
+        return -1;
+    if (a->weight < b->weight)
+        return 1;
+    return (a->segment > b->segment) - (a->segment < b->segment);
+}
+
+/***
+    Whether a query has used up its budget
+***/
+static int budgetSpent (QueryBudget *budget, long postingsScored, long long start) {
+    if (budget->postings > 0 && postingsScored >= budget->postings)
+        return 1;
+    return budget->seconds > 0 && (metricsClock() - start) / 1e9 >= budget->seconds;
+}
+
+/***
+    A query thread's document scores for retrieveImpacts, all 0 between its
+    queries, and the docnos the query being evaluated has scored
+***/
+typedef struct ScoreBuffer {
+    double *score;
+    long size;
+    long *touched;
+    long numTouched;
+    long capTouched;
+}ScoreBuffer;
+
+static __thread ScoreBuffer *localScores = NULL;
+// Its destructor frees a thread's buffer
+static pthread_key_t scoresKey;
+static pthread_once_t scoresOnce = PTHREAD_ONCE_INIT;
+static int scoresKeyMade = 0;
+
+static void freeScoreBuffer (void *arg) {
+    ScoreBuffer *buffer = arg;
+    localScores = NULL;
+    free(buffer->score);
+    free(buffer->touched);
+    free(buffer);
+}
+
+static void makeScoresKey (void) {
+    scoresKeyMade = pthread_key_create(&scoresKey, freeScoreBuffer) == 0;
+}
+
+/***
+    The calling thread's scores, grown to numDocs documents
+    @return : the buffer, NULL if out of memory
+***/
+static ScoreBuffer *scoreBuffer (long numDocs) {
+    ScoreBuffer *buffer = localScores;
+    if (buffer == NULL) {
+        pthread_once(&scoresOnce, makeScoresKey);
+        buffer = scoresKeyMade ? calloc(1, sizeof(ScoreBuffer)) : NULL;
+        if (buffer == NULL)
+            return NULL;
+        pthread_setspecific(scoresKey, buffer);
+        localScores = buffer;
+    }
+    if (buffer->size < numDocs) {
+        double *grown = realloc(buffer->score, sizeof(double)*numDocs);
+        if (grown == NULL)
+            return NULL;
+        memset(grown + buffer->size, 0, sizeof(double)*(numDocs - buffer->size));
+        buffer->score = grown;
+        buffer->size = numDocs;
+    }
+    return buffer;
+}
+
+/***
+    Make room for count more touched docnos
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int reserveTouched (ScoreBuffer *buffer, long count) {
+    if (buffer->numTouched + count <= buffer->capTouched)
+        return 0;
+    long cap = (buffer->capTouched > 0) ? buffer->capTouched : IMPACT_RUN;
+    while (cap < buffer->numTouched + count)
+        cap *= 2;
+    long *grown = realloc(buffer->touched, sizeof(long)*cap);
+    if (grown == NULL)
+        return -1;
+    buffer->touched = grown;
+    buffer->capTouched = cap;
+    return 0;
+}
+
+/***
+    Whether document a ranks above b, ties to the lower docno
+***/
+static int ranksAbove (const double score[], long a, long b) {
+    return score[a] > score[b] || (score[a] == score[b] && a < b);
+}
+
+/***
+    Sift heap[i] down a heap with its lowest ranked document on top
+***/
+static void siftDown (long heap[], long size, long i, const double score[]) {
+    while (1) {
+        long low = i;
+        long left = 2*i + 1;
+        if (left < size && ranksAbove(score, heap[low], heap[left]))
+            low = left;
+        if (left + 1 < size && ranksAbove(score, heap[low], heap[left + 1]))
+            low = left + 1;
+        if (low == i)
+            return;
+        long swap = heap[i];
+        heap[i] = heap[low];
+        heap[low] = swap;
+        i = low;
+    }
+}
+
+/***
+    Select the depth best of the touched documents left with a score
+    through a heap of depth docnos, so the work is in the documents the
+    query touched and not the collection. Every touched score is reset to
+    0 for the thread's next query
+    @return : [docno, weight] pairs sorted by weight, numRanked set to their
+              count. NULL when out of memory
+***/
+static double **rankTouched (ScoreBuffer *buffer, long depth, long *numRanked) {
+    double *score = buffer->score;
+    long cap = (depth < buffer->numTouched) ? depth : buffer->numTouched;
+    long *heap = malloc(sizeof(long)*(cap + 1));
+    long size = 0;
+    for (long t = 0; heap != NULL && t < buffer->numTouched; t++) {
+        long d = buffer->touched[t];
+        if (score[d] == 0)
+            continue;
+        if (size < cap) {
+            heap[size++] = d;
+            // Full, the lowest ranked goes on top
+            for (long i = size/2 - 1; size == cap && i >= 0; i--)
+                siftDown(heap, size, i, score);
+        } else if (cap > 0 && ranksAbove(score, d, heap[0])) {
+            heap[0] = d;
+            siftDown(heap, size, 0, score);
+        }
+    }
+
+    // Popping the lowest to the end leaves the best first
+    for (long i = size/2 - 1; size < cap && i >= 0; i--)
+        siftDown(heap, size, i, score);
+    for (long end = size - 1; end > 0; end--) {
+        long swap = heap[0];
+        heap[0] = heap[end];
+        heap[end] = swap;
+        siftDown(heap, end, 0, score);
+    }
+    double **sorted = (heap != NULL) ? malloc(sizeof(double*)*(size + 1)) : NULL;
+    *numRanked = 0;
+    for (long i = 0; sorted != NULL && i < size; i++) {
+        sorted[i] = malloc(sizeof(double)*2);
+        if (sorted[i] == NULL) {
+            freeResults(sorted, i);
+            sorted = NULL;
+            break;
+        }
+        sorted[i][0] = heap[i];
+        sorted[i][1] = score[heap[i]];
+    }
+    if (sorted != NULL)
+        *numRanked = size;
+
+    for (long t = 0; t < buffer->numTouched; t++)
+        score[buffer->touched[t]] = 0;
+    buffer->numTouched = 0;
+    free(heap);
+    return sorted;
+}
+
+double **retrieveImpacts (const char *query, Index *index, QueryBudget *budget, long depth,
+                          int *exact, long *numRanked, QueryProfile *profile) {
+    ImpactIndex *impacts = index->impacts;
+    long numDocs = totalDocs(index);
+    *exact = 1;
+    *numRanked = numDocs;
+    if (impacts == NULL)
+        return retrieveResults(query, index, profile);
+    LiveDocs *live = index->live;
+    long long start = metricsClock();
+
+    QueryTerms terms;
+    if (parseQuery(query, index, &terms, profile) != 0) {
+        freeQueryTerms(&terms);
+        return NULL;
+    }
+    double mark = profileClock(profile);
+
+    // Every impact segment of the query terms that adds to a score, heaviest first
+    long numSegments = 0;
+    for (long i = 0; i < terms.count; i++) {
+        if (terms.entry[i] >= 0)
+            numSegments += impacts->termSegments[terms.entry[i] + 1] - impacts->termSegments[terms.entry[i]];
+    }
+    QuerySegment *segments = malloc(sizeof(QuerySegment)*(numSegments + 1));
+    ScoreBuffer *buffer = scoreBuffer(numDocs);
+    if (segments == NULL || buffer == NULL) {
+        free(segments);
+        freeQueryTerms(&terms);
+        return NULL;
+    }
+    double *docMatrix = buffer->score;
+    numSegments = 0;
+    for (long i = 0; i < terms.count; i++) {
+        if (terms.entry[i] < 0)
+            continue;
+        for (long s = impacts->termSegments[terms.entry[i]]; s < impacts->termSegments[terms.entry[i] + 1]; s++) {
+            segments[numSegments].weight = impacts->impact[s] * impacts->scale * terms.weight[i];
+            segments[numSegments].segment = s;
+            numSegments += (segments[numSegments].weight > 0);
+        }
+    }
+    qsort(segments, numSegments, sizeof(QuerySegment), cmpSegment);
+
+    // Score at a time until the budget runs out, a run at a time so one
+    // long segment can't overrun it. The first run of the heaviest segment
+    // is always scored, a deadline spent parsing still finds the best matches
+    long postingsScored = 0;
+    long postingsSkipped = 0;
+    int ok = 1;
+    for (long s = 0; ok && s < numSegments; s++) {
+        long first = impacts->segStart[segments[s].segment];
+        long last = impacts->segStart[segments[s].segment + 1];
+        for (long k = first; k < last; k += IMPACT_RUN) {
+            if ((s > 0 || k > first) && budgetSpent(budget, postingsScored, start)) {
+                postingsSkipped += last - k;
+                break;
+            }
+            long run = (last - k < IMPACT_RUN) ? last - k : IMPACT_RUN;
+            if (budget->postings > 0 && run > budget->postings - postingsScored)
+                run = budget->postings - postingsScored;
+            if (reserveTouched(buffer, run) != 0) {
+                ok = 0;
+                break;
+            }
+            buffer->numTouched += addImpact(impacts->docno + k, run, segments[s].weight, docMatrix,
+                                            buffer->touched + buffer->numTouched);
+            postingsScored += run;
+            if (run < IMPACT_RUN && k + run < last) {
+                postingsSkipped += last - k - run;
+                break;
+            }
+        }
+    }
+    if (postingsSkipped > 0) {
+        *exact = 0;
+        countMetric(METRIC_QUERIES_TRUNCATED, 1);
+    }
+    // The segment's documents are few, each is given its score or left at 0
+    postingsScored += scoreSegment(index, &terms, docMatrix);
+    if (reserveTouched(buffer, numDocs - index->numDocs) != 0)
+        ok = 0;
+    for (long i = index->numDocs; ok && i < numDocs; i++) {
+        if (docMatrix[i] != 0)
+            buffer->touched[buffer->numTouched++] = i;
+    }
+    mark = profileLap(profile, PHASE_SCORE, mark);
+
+    // The impacts are divided by the documents' magnitudes already
+    long docsTouched = 0;
+    for (long t = 0; t < buffer->numTouched; t++) {
+        long d = buffer->touched[t];
+        if (d < index->numDocs && (terms.magnitude == 0 || isDeleted(live, d)))
+            docMatrix[d] = 0;
+        else if (d < index->numDocs)
+            docMatrix[d] /= terms.magnitude;
+        docsTouched += (docMatrix[d] != 0);
+    }
+    mark = profileLap(profile, PHASE_NORMALIZE, mark);
+
+    // Out of memory the scores are still reset, the results dropped
+    double **sorted = rankTouched(buffer, ok ? depth : 0, numRanked);
+    if (!ok && sorted != NULL) {
+        free(sorted);
+        sorted = NULL;
+    }
+    for (long i = index->numDocs; !ok && i < numDocs; i++)
+        docMatrix[i] = 0;
+    profileLap(profile, PHASE_SORT, mark);
+    recordQuery(profile, &terms, postingsScored, docsTouched, start);
+    if (profile != NULL) {
+        profile->postingsSkipped += postingsSkipped;
+        profile->truncated += !*exact;
+    }
+
+    free(segments);
+    freeQueryTerms(&terms);
+    return sorted;
+}
+
+/***
+    Charge a title fetch to the metrics and a profile, the file position is
+    the bytes read
+***/
+static void recordTitle (QueryProfile *profile, FILE *fp, double mark, long long start) {
+    long bytes = ftell(fp);
+    countMetric(METRIC_TITLES, 1);
+    countMetric(METRIC_TITLE_BYTES, bytes);
+    recordMetric(METRIC_TITLE_LATENCY, metricsClock() - start);
+    if (profile == NULL)
+        return;
+    profileLap(profile, PHASE_TITLES, mark);
+    profile->titlesFetched++;
+    profile->titleBytes += bytes;
+}
+
+/***
+    Open a document, out of the index's store if it has one or else its
+    corpus file
+    @return : the stream, line lines before the document's $DOC. NULL if
+              the document can't be read
+    @return text : the stored document, freed by closeDocument
+***/
+static FILE *openDocument (Index *index, long docno, long *line, char **text) {
+    *text = NULL;
+    if (index->store == NULL || docno >= index->numDocs) {
+        *line = getDoc(index, docno)->line;
+        return fopen(docFile(index, docno), "r");
+    }
+    long length = 0;
+    *line = 0;
+    *text = storedDocument(index->store, docno, &length);
+    FILE *fp = (*text != NULL && length > 0) ? fmemopen(*text, length, "r") : NULL;
+    if (fp == NULL) {
+        free(*text);
+        *text = NULL;
+    }
+    return fp;
+}
+
+static void closeDocument (FILE *fp, char *text) {
+    fclose(fp);
+    free(text);
+}
+
+/***
+    Grabs the title from the datafile
+***/
+char *getTitle(long docno, Index *index, QueryProfile *profile) {
+    long long start = metricsClock();
+    double mark = profileClock(profile);
+    DocIndex *doc = getDoc(index, docno);
+    char *title = malloc(sizeof(char)*2000);
+    title = strcpy (title, "\0");
+    char *docId = malloc(sizeof(char)*200);
+    char letter [2] = "\0\0";
+
+    // Loop through the files
+    long line = 0;
+    char *text = NULL;
+    FILE *fp = openDocument(index, docno, &line, &text);
+    if (fp == NULL) {
+        countMetric(METRIC_TITLE_ERRORS, 1);
+        free(docId);
+        free(title);
+        return NULL;
+    }
+
+    // Navigate to document's starting line
+    letter[0] = fgetc(fp);
+    long counter = 0;
+    while (letter[0] != EOF && counter < line) {
+        if (letter[0] == '\n')
+            counter++;
+        letter[0] = fgetc(fp);
+    }
+
+    // Grab the first word in the file
+    char *buffer = malloc(sizeof(char)*200);
+    buffer = strcpy(buffer,letter);
+    letter[0] = fgetc(fp);
+    while ((letter[0] != ' ') && (letter[0] != '\n')){
+        if (letter[0] == EOF) {
+            free(buffer);
+            buffer = NULL;
+            break;
+        }
+        buffer = strcat(buffer, letter);
+        letter[0] = fgetc(fp);
+    }
+
+    long docFound = 0;
+    // Read words from file based on the space deliminator
+    while (buffer != NULL) {
+        if (strncmp(buffer, "$", 1) == 0) {
+            if (strcmp(buffer, "$DOC") == 0) {
+                // Check if the docid is correct
+                buffer = strcpy(buffer, "\0");
+                letter[0] = fgetc(fp);
+                while (letter[0] != EOF && letter[0] !='\n') {
+                    buffer = strcat(buffer, letter);
+                    letter[0] = fgetc(fp);
+                }
+                if (strcasecmp(doc->docid, buffer) != 0) {
+                    break;
+                }
+                docFound = 1;
+
+            } else if (strcmp(buffer, "$TITLE") == 0) {
+                // Grab the title
+                letter[0] = fgetc(fp);
+                buffer = strcpy(buffer, "\0");
+                while (letter[0] != '$' && letter[0] != EOF) {
+                    title = strcat(title, letter);
+                    letter[0] = fgetc(fp);
+                }
+                free(buffer);
+                free(docId);
+                recordTitle(profile, fp, mark, start);
+                closeDocument(fp, text);
+                return title;
+            } else {
+                if (docFound) {
+                    title = strcpy(title, "<No Title>\n\0");
+                    free(buffer);
+                    free(docId);
+                    recordTitle(profile, fp, mark, start);
+                    closeDocument(fp, text);
+                    return title;
+                }
+            }
+        }
+
+        // Grab next word
+        buffer = strcpy(buffer,"\0");
+        letter[0] = fgetc(fp);
+        while ((letter[0] != ' ') && (letter[0] != '\n')){
+            if (letter[0] == EOF) {
+                free(buffer);
+                buffer = NULL;
+                break;
+            }
+            buffer = strcat(buffer, letter);
+            letter[0] = fgetc(fp);
+        }
+    }
+    recordTitle(profile, fp, mark, start);
+    closeDocument(fp, text);
+
+    free(docId);
+    return title;
+}
+
+char *getDocument (long docno, Index *index) {
+    long length = 0;
+    if (index->store != NULL && docno < index->numDocs)
+        return storedDocument(index->store, docno, &length);
+    return corpusDocument(docFile(index, docno), getDoc(index, docno)->line);
+}
+
+char *corpusDocument (const char *path, long start) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return NULL;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t got = 0;
+    long length = 0;
+    long cap = 4096;
+    char *text = malloc(cap);
+    for (long i = 0; i < start && getline(&line, &size, fp) != -1; i++)
+        ;
+    // Up to the next $DOC line
+    for (int first = 1; text != NULL && (got = getline(&line, &size, fp)) != -1; first = 0) {
+        if (!first && strncmp(line, "$DOC", 4) == 0)
+            break;
+        while (text != NULL && length + got + 1 > cap) {
+            char *grown = realloc(text, cap*2);
+            if (grown == NULL)
+                free(text);
+            text = grown;
+            cap *= 2;
+        }
+        if (text != NULL) {
+            memcpy(text + length, line, got);
+            length += got;
+        }
+    }
+    if (text != NULL)
+        text[length] = '\0';
+    free(line);
+    fclose(fp);
+    return text;
+}
+
+/***
+    An occurrence of a query term in a document
+***/
+typedef struct QueryHit {
+    long offset;
+    int term;
+}QueryHit;
+
+/***
+    Compare function for qsort, hits by offset
+***/
+static int cmpQueryHit (const void *pa, const void *pb) {
+    const QueryHit *a = pa;
+    const QueryHit *b = pb;
+    return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+/***
+    Start of the SNIPPET_WINDOW bytes holding the most distinct query terms,
+    the earliest of the best
+***/
+static long bestWindow (QueryHit hits[], int numHits, int numTerms) {
+    int *inWindow = calloc(numTerms + 1, sizeof(int));
+    if (inWindow == NULL)
+        return hits[0].offset;
+    int distinct = 0;
+    int best = 0;
+    long bestStart = hits[0].offset;
+    for (int first = 0, last = 0; last < numHits; last++) {
+        if (inWindow[hits[last].term]++ == 0)
+            distinct++;
+        while (hits[last].offset - hits[first].offset >= SNIPPET_WINDOW) {
+            if (--inWindow[hits[first].term] == 0)
+                distinct--;
+            first++;
+        }
+        if (distinct > best) {
+            best = distinct;
+            bestStart = hits[first].offset;
+        }
+    }
+    free(inWindow);
+    return bestStart;
+}
+
+/***
+    Join the words of the bytes read into a snippet, leaving out the tags,
+    the docid and the words cut by either end, bracketing the query terms
+    @call text : the bytes read, with the byte before them when before is
+                 set and the byte after them when after is set
+***/
+static char *joinSnippet (char *text, long length, int before, int after, char *terms[], int numTerms) {
+    char *snippet = malloc(length*2 + 8);
+    if (snippet == NULL)
+        return NULL;
+    strcpy(snippet, before ? "..." : "");
+    char *first = text + before;
+    char *end = first + length;
+    if (before && text[0] != ' ' && text[0] != '\n')
+        first += strcspn(first, " \n");
+    if (after) {
+        while (*end != ' ' && *end != '\n' && end > first)
+            end--;
+    }
+    if (first > end)
+        first = end;
+    *end = '\0';
+
+    char *save;
+    char *prev = "";
+    int words = 0;
+    for (char *word = strtok_r(first, " \n", &save); word != NULL; word = strtok_r(NULL, " \n", &save)) {
+        int skip = word[0] == '$' || strcmp(prev, "$DOC") == 0;
+        prev = word;
+        if (skip)
+            continue;
+        int match = 0;
+        for (int t = 0; t < numTerms && !match; t++)
+            match = strcasecmp(word, terms[t]) == 0;
+        strcat(snippet, (words++ > 0) ? " " : "");
+        strcat(snippet, match ? "[" : "");
+        strcat(snippet, word);
+        strcat(snippet, match ? "]" : "");
+    }
+    if (after)
+        strcat(snippet, "...");
+    return snippet;
+}
+
+char *getSnippet (const char *query, long docno, Index *index, QueryProfile *profile) {
+    SnippetIndex *snippets = index->snippets;
+    if (snippets == NULL || docno >= index->numDocs)
+        return NULL;
+    double mark = profileClock(profile);
+
+    // Where the query terms first occur in the document
+    long length = (long)strlen(query);
+    char *copy = malloc(length + 1);
+    char **terms = malloc(sizeof(char*)*(length + 1));
+    QueryHit *hits = malloc(sizeof(QueryHit)*(length*SNIPPET_HITS + 1));
+    if (copy == NULL || terms == NULL || hits == NULL) {
+        free(copy);
+        free(terms);
+        free(hits);
+        return NULL;
+    }
+    strcpy(copy, query);
+    char *save;
+    int numTerms = 0;
+    int numHits = 0;
+    for (char *term = strtok_r(copy, " \n", &save); term != NULL; term = strtok_r(NULL, " \n", &save)) {
+        terms[numTerms] = term;
+        long entry = searchIndex(index->dictIndex, index->dictSize - 1, term);
+        SnippetEntry *found = (entry >= 0) ? findSnippetEntry(snippets, docno, entry) : NULL;
+        for (int k = 0; found != NULL && k < SNIPPET_HITS && found->offset[k] != SNIPPET_NONE; k++) {
+            hits[numHits].offset = found->offset[k];
+            hits[numHits++].term = numTerms;
+        }
+        numTerms++;
+    }
+    qsort(hits, numHits, sizeof(QueryHit), cmpQueryHit);
+    long docLength = snippets->docLength[docno];
+    long begin = (numHits > 0) ? bestWindow(hits, numHits, numTerms) - SNIPPET_BEFORE : 0;
+    if (begin < 0)
+        begin = 0;
+    long end = (begin + SNIPPET_BYTES < docLength) ? begin + SNIPPET_BYTES : docLength;
+
+    // One read of the bytes around the window, with the bytes either side
+    // of them to know whether they cut a word
+    int before = begin > 0;
+    int after = end < docLength;
+    char *snippet = NULL;
+    char *text = malloc(SNIPPET_BYTES + 3);
+    long size = end - begin + before + after;
+    ssize_t got = -1;
+    if (index->store != NULL && text != NULL) {
+        // The stored document starts at its $DOC too
+        long length = 0;
+        char *doc = storedDocument(index->store, docno, &length);
+        if (doc != NULL && begin - before + size <= length) {
+            memcpy(text, doc + begin - before, size);
+            got = size;
+        }
+        free(doc);
+    } else if (text != NULL) {
+        int fd = open(docFile(index, docno), O_RDONLY);
+        got = (fd >= 0) ? pread(fd, text, size, snippets->docStart[docno] + begin - before) : -1;
+        if (fd >= 0)
+            close(fd);
+    }
+    if (got == size) {
+        text[size] = '\0';
+        snippet = joinSnippet(text, end - begin, before, after, terms, numTerms);
+    }
+    countMetric(METRIC_SNIPPETS, 1);
+    if (profile != NULL) {
+        profileLap(profile, PHASE_SNIPPETS, mark);
+        profile->snippetBytes += (got > 0) ? got : 0;
+    }
+    free(text);
+    free(hits);
+    free(terms);
+    free(copy);
+    return snippet;
+}
+
+void freeResults (double **results, long numDocs) {
+    for (long i = 0; i < numDocs; i++) {
+        free(results[i]);
+    }
+    free(results);
+}
+
+void initIndex (Index *index) {
+    memset(index, 0, sizeof(Index));
+}
+
+void freeIndex (Index *index) {
+    if (index->files != NULL)
+        freeFiles(index->files, index->numFiles);
+    if (index->live != NULL)
+        freeLiveDocs(index->live);
+    free(index->live);
+    free(index->liveDf);
+    free(index->docTermVector);
+    freeDictArray(index->dictIndex, index->dictSize);
+    freeDocArray(index->docIndex, index->numDocs);
+    free(index->dictIndex);
+    free(index->docIndex);
+    freePostColumns(&index->postIndex);
+    free(index->termHits);
+    free(index->dir);
+    free(index->liveDocsPath);
+    if (index->impacts != NULL)
+        freeImpacts(index->impacts);
+    free(index->impacts);
+    if (index->snippets != NULL)
+        freeSnippets(index->snippets);
+    free(index->snippets);
+    if (index->fields != NULL)
+        freeFields(index->fields);
+    free(index->fields);
+    if (index->store != NULL)
+        freeBlockStore(index->store);
+    free(index->store);
+    free(index->docLength);
+    if (index->shardStats != NULL) {
+        freeDictArray(index->shardStats->dict, index->shardStats->dictSize);
+        free(index->shardStats->dict);
+    }
+    free(index->shardStats);
+    initIndex(index);
+}
+
+void setIndexGauges (Index *index) {
+    setGauge(METRIC_INDEX_TERMS, index->dictSize);
+    setGauge(METRIC_INDEX_POSTINGS, index->postSize);
+    setGauge(METRIC_INDEX_DOCS, index->numDocs);
+    setGauge(METRIC_INDEX_DELETED, index->live->numDeleted);
+}
+
+int loadIndex (Index *index) {
+    char dir[GENERATION_NAME];
+    if (currentGeneration(dir, sizeof(dir)) != 0) {
+        initIndex(index);
+        printf("Error reading %s\n", MANIFEST_FILE);
+        return -1;
+    }
+    if (loadIndexFrom(index, dir) != 0)
+        return -1;
+    setIndexGauges(index);
+    return 0;
+}
+
+/***
+    Load a shard's SHARD_STATS_FILE
+    @return 0 : success
+    @return -1 : the file couldn't be read or is malformed
+***/
+static int loadShardStats (ShardStats *stats, const char *path) {
+    memset(stats, 0, sizeof(ShardStats));
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    long numTerms = 0;
+    long dictSize = 0;
+    int ok = fscanf(fp, "%ld %ld %ld", &stats->numDocs, &numTerms, &dictSize) == 3
+             && stats->numDocs >= 0 && numTerms >= 0 && dictSize >= 0;
+    stats->dict = ok ? malloc(sizeof(DictIndex)*(dictSize + 1)) : NULL;
+    char term [200];
+    for (long i = 0; stats->dict != NULL && i < dictSize; i++) {
+        long df = 0;
+        if (fscanf(fp, "%199s %ld", term, &df) != 2 || df <= 0) {
+            ok = 0;
+            break;
+        }
+        stats->dict[i] = initDictIndex(term, df, 0);
+        stats->dictSize++;
+    }
+    fclose(fp);
+    if (!ok || stats->dict == NULL) {
+        freeDictArray(stats->dict, stats->dictSize);
+        free(stats->dict);
+        return -1;
+    }
+    stats->avgLength = (stats->numDocs > 0) ? (double)numTerms / stats->numDocs : 0;
+    return 0;
+}
+
+/***
+    Weigh the documents' magnitudes by the idfs over every shard, the
+    postings were loaded with the shard's own
+***/
+static void setShardNorms (Index *index) {
+    ShardStats *stats = index->shardStats;
+    for (long i = 0; i < index->numDocs; i++)
+        index->docTermVector[i] = 0;
+    for (long t = 0; t < index->dictSize; t++) {
+        DictIndex *entry = &index->dictIndex[t];
+        long global = searchIndex(stats->dict, stats->dictSize - 1, entry->term);
+        double idf = tfidf(1.0, stats->numDocs, (global >= 0) ? stats->dict[global].df : entry->df);
+        for (long k = entry->postIndex; k < entry->postIndex + entry->df; k++) {
+            double weight = index->postIndex.tf[k] * idf;
+            index->docTermVector[index->postIndex.docno[k]] += weight * weight;
+        }
+    }
+    for (long i = 0; i < index->numDocs; i++)
+        index->docTermVector[i] = sqrt(index->docTermVector[i]);
+}
+
+int loadIndexFrom (Index *index, const char *dir) {
+    initIndex(index);
+    index->dir = malloc(strlen(dir) + 1);
+    strcpy(index->dir, dir);
+    index->liveDocsPath = generationPath(dir, LIVE_DOCS_FILE);
+
+    // Load the dictionary.txt into memory
+    char *path = generationPath(dir, "dictionary.txt");
+    FILE *dictionary = fopen(path, "r");
+    if (dictionary == NULL) {
+        printf("Error loading %s\n", path);
+        free(path);
+        freeIndex(index);
+        return -1;
+    }
+    free(path);
+    long dictSize = 0;
+    long ret = fscanf(dictionary, "%ld", &dictSize);
+    if ( ret != 1 ){
+        fclose(dictionary);
+        freeIndex(index);
+        return -1;
+    }
+    long cur = 0;
+
+    index->dictIndex = malloc(sizeof(DictIndex)*dictSize);
+    char *term = malloc(sizeof(char)*200);
+    for (long i = 0; i < dictSize; i++) {
+        long df = 0;
+        ret = fscanf( dictionary, "%199s %ld\n", term, &df);
+        if (ret != 2) {
+            fclose(dictionary);
+            free(term);
+            freeIndex(index);
+            return -1;
+        }
+        index->dictIndex[i] = initDictIndex(term, df, cur);
+        index->dictSize++;
+        cur += df;
+    }
+    free(term);
+    fclose(dictionary);
+
+    // Load the docid
+    path = generationPath(dir, "docids.txt");
+    FILE *docfp = fopen(path, "r");
+    if (docfp == NULL) {
+        printf("Error loading %s\n", path);
+        free(path);
+        freeIndex(index);
+        return -1;
+    }
+    free(path);
+    long numDocs = 0;
+    ret = fscanf(docfp, "%ld", &numDocs);
+    if (ret != 1) {
+        fclose(docfp);
+        freeIndex(index);
+        return -1;
+    }
+
+    index->docIndex = malloc(sizeof(DocIndex)*numDocs);
+    char *docid = malloc(sizeof(char)*200);
+    for (long i = 0; i < numDocs; i++) {
+        long line = 0;
+        int fileid = 0;
+        ret = fscanf( docfp, "%199s %d %ld\n", docid, &fileid, &line);
+        if (ret != 3) {
+            free(docid);
+            fclose(docfp);
+            freeIndex(index);
+            return -1;
+        }
+        index->docIndex[i] = initDocIndex(docid, fileid, line);
+        index->numDocs++;
+    }
+    free(docid);
+    fclose(docfp);
+
+    // Load the deleted documents
+    index->live = malloc(sizeof(LiveDocs));
+    initLiveDocs(index->live, numDocs);
+    if (loadLiveDocs(index->live, index->liveDocsPath) != 0)
+        printf("Error loading %s, no documents are deleted\n", index->liveDocsPath);
+
+    // Store the number of words in each document
+    index->docTermVector = malloc(sizeof(double) * numDocs);
+    double *docTermVector = index->docTermVector;
+    for (long i = 0; i < numDocs; i++) {
+        docTermVector[i] = 0;
+    }
+
+    // Load the posting file, computing the documents' magnitudes as it goes
+    path = generationPath(dir, "postings.txt");
+    if (loadPostings(path, index->dictIndex, index->dictSize, numDocs,
+                     &index->postIndex, docTermVector) != 0) {
+        printf("Error loading %s\n", path);
+        free(path);
+        freeIndex(index);
+        return -1;
+    }
+    free(path);
+    index->postSize = index->postIndex.size;
+    index->termHits = calloc(dictSize > 0 ? dictSize : 1, sizeof(long));
+    index->liveDf = newLiveDfCache(dictSize);
+    if (index->termHits == NULL || index->liveDf == NULL) {
+        printf("Error loading %s, out of memory\n", dir);
+        freeIndex(index);
+        return -1;
+    }
+
+    // Impact-ordered postings, only written by indexer --impacts
+    path = generationPath(dir, IMPACTS_FILE);
+    index->impacts = malloc(sizeof(ImpactIndex));
+    if (index->impacts != NULL && loadImpacts(index->impacts, path, dictSize, numDocs) != 0) {
+        if (access(path, F_OK) == 0)
+            printf("Error loading %s, queries with a budget are evaluated in full\n", path);
+        free(index->impacts);
+        index->impacts = NULL;
+    }
+    free(path);
+
+    // Token offsets for snippets, only written by indexer --snippets
+    path = generationPath(dir, SNIPPETS_FILE);
+    index->snippets = malloc(sizeof(SnippetIndex));
+    if (index->snippets != NULL && loadSnippets(index->snippets, path, numDocs, dictSize) != 0) {
+        if (access(path, F_OK) == 0)
+            printf("Error loading %s, results have no snippets\n", path);
+        free(index->snippets);
+        index->snippets = NULL;
+    }
+    free(path);
+
+    // Compressed documents, only written by indexer --store
+    path = generationPath(dir, STORE_FILE);
+    index->store = malloc(sizeof(BlockStore));
+    if (index->store != NULL && loadBlockStore(index->store, path, numDocs) != 0) {
+        if (access(path, F_OK) == 0)
+            printf("Error loading %s, documents are read from the corpus\n", path);
+        free(index->store);
+        index->store = NULL;
+    }
+    free(path);
+
+    // Title postings and field lengths, only written by indexer --fields
+    path = generationPath(dir, FIELDS_FILE);
+    index->fields = malloc(sizeof(FieldIndex));
+    if (index->fields != NULL && loadFields(index->fields, path, dictSize, numDocs) != 0) {
+        if (access(path, F_OK) == 0)
+            printf("Error loading %s, queries search every field\n", path);
+        free(index->fields);
+        index->fields = NULL;
+    }
+    free(path);
+
+    // Collection statistics, only written by indexer --shards
+    path = generationPath(dir, SHARD_STATS_FILE);
+    index->shardStats = malloc(sizeof(ShardStats));
+    if (index->shardStats != NULL && loadShardStats(index->shardStats, path) != 0) {
+        if (access(path, F_OK) == 0)
+            printf("Error loading %s, the shard is scored by its own statistics\n", path);
+        free(index->shardStats);
+        index->shardStats = NULL;
+    }
+    free(path);
+    if (index->shardStats != NULL)
+        setShardNorms(index);
+
+    if (setDocLengths(index) != 0) {
+        printf("Error loading %s, out of memory\n", dir);
+        freeIndex(index);
+        return -1;
+    }
+
+    // Corpus files that the documents are read from
+    path = generationPath(dir, "files.txt");
+    index->files = loadFiles(path, &index->numFiles);
+    if (index->files == NULL)
+        index->numFiles = 0;
+    free(path);
+    return 0;
+}
+
+int setDocLengths (Index *index) {
+    index->docLength = calloc(index->numDocs + 1, sizeof(uint32_t));
+    if (index->docLength == NULL)
+        return -1;
+    FieldIndex *fields = index->fields;
+    double total = 0;
+    if (fields != NULL) {
+        for (long d = 0; d < index->numDocs; d++)
+            index->docLength[d] = fields->titleLength[d] + fields->bodyLength[d];
+    } else {
+        // tfs past POST_TF_MAX are saturated, such documents come out shorter
+        for (long k = 0; k < index->postSize; k++)
+            index->docLength[index->postIndex.docno[k]] += index->postIndex.tf[k];
+    }
+    for (long d = 0; d < index->numDocs; d++)
+        total += index->docLength[d];
+    index->avgLength = (index->numDocs > 0) ? total / index->numDocs : 0;
+    // A shard normalizes by the length of the documents of every shard
+    if (index->shardStats != NULL)
+        index->avgLength = index->shardStats->avgLength;
+    return 0;
+}
+
+int checkIndexFiles (Index *index) {
+    for (long i = 0; i < index->numDocs; i++) {
+        if (index->docIndex[i].fileid < 0 || index->docIndex[i].fileid >= index->numFiles) {
+            printf("Error: docids.txt refers to file %d, not in files.txt\n", index->docIndex[i].fileid);
+            return -1;
+        }
+    }
+    return 0;
+}
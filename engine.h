@@ -0,0 +1,339 @@
+/***
+    engine.c header file. Loads the index and evaluates queries against it
+***/
+
+#ifndef INDEXES_H_INCLUDED
+#define INDEXES_H_INCLUDED
+#include "indexes.h"
+#endif
+
+#ifndef POSTINGS_H_INCLUDED
+#define POSTINGS_H_INCLUDED
+#include "postings.h"
+#endif
+
+#ifndef LIVEDOCS_H_INCLUDED
+#define LIVEDOCS_H_INCLUDED
+#include "livedocs.h"
+#endif
+
+#ifndef METRICS_H_INCLUDED
+#define METRICS_H_INCLUDED
+#include "metrics.h"
+#endif
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#ifndef IMPACTS_H_INCLUDED
+#define IMPACTS_H_INCLUDED
+#include "impacts.h"
+#endif
+
+#ifndef SNIPPETS_H_INCLUDED
+#define SNIPPETS_H_INCLUDED
+#include "snippets.h"
+#endif
+
+#ifndef FIELDS_H_INCLUDED
+#define FIELDS_H_INCLUDED
+#include "fields.h"
+#endif
+
+#ifndef BLOCKSTORE_H_INCLUDED
+#define BLOCKSTORE_H_INCLUDED
+#include "blockstore.h"
+#endif
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+#include "profile.h"
+#endif
+
+/***
+    The document count and dfs of the whole index a shard was split from,
+    from its SHARD_STATS_FILE. A shard's terms are weighed by these so its
+    scores compare with the other shards'
+***/
+typedef struct ShardStats {
+    long numDocs;
+    double avgLength;   // terms per document
+    long dictSize;
+    DictIndex *dict;    // every term of the index with its df there
+}ShardStats;
+
+/***
+    The index files loaded into memory
+***/
+typedef struct Index {
+    DictIndex *dictIndex;
+    long dictSize;
+    PostColumns postIndex;
+    long postSize;
+    DocIndex *docIndex;
+    long numDocs;
+    double *docTermVector;  // magnitude of each document's tf-idf vector
+    LiveDocs *live;         // shared by the snapshots combining this index with a segment
+    long *liveDf;           // liveDf of each dictionary entry under live, -1 until counted
+    char **files;           // corpus files by file-id, NULL without files.txt
+    int numFiles;
+    long *termHits;         // queries that found each dictionary entry
+    char *dir;              // generation directory the files were loaded from
+    char *liveDocsPath;     // deleted.bin of that generation
+    struct Index *segment;  // in-memory segment searched along with the index, its
+                            // docnos follow numDocs. NULL without one
+    ImpactIndex *impacts;   // impact-ordered postings, NULL without IMPACTS_FILE
+    SnippetIndex *snippets; // token offsets, NULL without SNIPPETS_FILE
+    FieldIndex *fields;     // title postings and field lengths, NULL without FIELDS_FILE
+    BlockStore *store;      // compressed documents, NULL without STORE_FILE
+    uint32_t *docLength;    // terms in each document, set by setDocLengths
+    double avgLength;
+    struct ShardStats *shardStats; // of the index a shard was split from, NULL
+                            // unless the index is a shard
+}Index;
+
+// Impact postings scored between checks of a query's budget
+#define IMPACT_RUN 4096
+
+// Found terms of a query past which its most common ones are dropped
+#define LONG_QUERY_TERMS 64
+
+// Bytes of a document the query terms of a snippet are looked for in
+#define SNIPPET_WINDOW 120
+// Bytes of context read before the window
+#define SNIPPET_BEFORE 40
+// Bytes read for a snippet
+#define SNIPPET_BYTES 220
+
+/***
+    Work a query evaluated over the impact-ordered postings may do, 0 for
+    no limit
+***/
+typedef struct QueryBudget {
+    long postings;      // postings scored
+    double seconds;     // since the query started
+}QueryBudget;
+
+// Scoring models, selected per engine
+enum { SCORING_TFIDF, SCORING_BM25, SCORING_BM25F, NUM_SCORINGS };
+
+// BM25 defaults
+#define BM25_K1 1.2
+#define BM25_B 0.75
+
+/***
+    How documents are scored. The cosine similarity of tf-idf vectors, or
+    BM25 over the documents' lengths, or BM25F over their titles and bodies
+    when the index has FIELDS_FILE (BM25 without it)
+***/
+typedef struct Scoring {
+    int model;
+    double k1;          // term frequency saturation of BM25 and BM25F
+    double b;           // length normalization of BM25 and BM25F, 0 to 1
+}Scoring;
+
+/***
+    Which fields of the documents a query searches, with FIELDS_FILE
+***/
+typedef struct FieldScope {
+    int titleOnly;          // match the query against the titles alone
+    double titleWeight;     // a title occurrence counts this many times, 1 for once.
+                            // BM25F weighs the title field by it
+}FieldScope;
+
+/***
+    @return : the scoring model named name, -1 if there's none
+***/
+int findScoring (const char *name);
+
+/***
+    @return : the name of a scoring model
+***/
+const char *scoringName (int model);
+
+/***
+    Compare function for qsort
+***/
+int cmp (const void *pa, const void *pb);
+
+/***
+    Multiply two vectors of the same length
+***/
+double dotProduct (double vOne[], double vTwo[], long size);
+
+/***
+    Normalize/find magnitude of same length vectors
+***/
+double normalize (double vectorOne[], double vectorTwo[], long size);
+
+/***
+    Calculates the term frequency - inverse document frequency
+    @return >=0 : document relevancy
+***/
+double tfidf (double tf, long totalDocs, long df);
+
+/***
+    Binary search to locate a string in a dictionary index
+    @return >=0 : index of term in the dictionary
+    @return -1 : term not found
+***/
+long searchIndex ( DictIndex index[], long length, char *term);
+
+/***
+    Document frequency of a dictionary entry without deleted documents
+***/
+long liveDf (Index *index, long entry);
+
+/***
+    A liveDf cache for dictSize dictionary entries with none counted, goes
+    with the LiveDocs it is counted under
+    @return : NULL if out of memory
+***/
+long *newLiveDfCache (long dictSize);
+
+/***
+    Perform a weighted retrieval of relevant documents, profiling the query
+    into profile unless it's NULL. Queries may run on several threads at
+    once against the same index
+    @return : totalDocs [docno, weight] pairs sorted by weight, the first
+              document without a match has its weight set to -1. NULL when
+              out of memory
+***/
+double **retrieveResults (const char *query, Index *index, QueryProfile *profile);
+
+/***
+    As retrieveResults, scoring by a model and searching the fields of
+    scope, either may be NULL for tf-idf over every field. Title-only
+    queries scan the title postings and rank the documents by the cosine
+    similarity of their titles, whatever the model. tf-idf queries with a
+    title weight add the title occurrences of each term again
+    (titleWeight - 1) times before the documents are divided by their
+    unweighted magnitudes. BM25 scores are summed over the terms with
+    nothing to divide by. Without fields, title-only and title-weighted
+    queries search every field and BM25F is BM25
+    @return : as retrieveResults
+***/
+double **retrieveScored (const char *query, Index *index, Scoring *scoring, FieldScope *scope,
+                         QueryProfile *profile);
+
+/***
+    Evaluate a query score at a time over the impact-ordered postings,
+    heaviest impact segments first, until every posting is scored or the
+    budget runs out, though never before the first IMPACT_RUN postings of
+    the heaviest segment. Scores are the cosine similarities of retrieveResults
+    with the documents' weights quantized; the segment and idfs over
+    deleted documents are exact. Only the documents the query scores are
+    ranked, into a heap of depth, so a query cut short costs no more than
+    the postings it scored. Without impacts the query is evaluated by
+    retrieveResults
+    @call depth : matches wanted, the rest aren't ranked
+    @call exact : set to 0 when the budget ran out before every posting of
+                  the query was scored, 1 otherwise
+    @call numRanked : set to the length of the results, to free them with
+    @return : at most depth matches as [docno, weight] pairs sorted by
+              weight, the results of retrieveResults without impacts. NULL
+              when out of memory
+***/
+double **retrieveImpacts (const char *query, Index *index, QueryBudget *budget, long depth,
+                          int *exact, long *numRanked, QueryProfile *profile);
+
+/***
+    @return : documents in the index and its segment, the length of the
+              results of retrieveResults
+***/
+long totalDocs (Index *index);
+
+/***
+    The document a docno of the index or its segment refers to
+***/
+DocIndex *getDoc (Index *index, long docno);
+
+/***
+    The corpus file a docno of the index or its segment is in
+***/
+char *docFile (Index *index, long docno);
+
+/***
+    Free the results of retrieveResults
+***/
+void freeResults (double **results, long numDocs);
+
+/***
+    Grabs the title from the datafile, or the index's store, adding its cost
+    to profile unless it's NULL
+    @return : title, NULL if the document's file can't be read
+***/
+char *getTitle(long docno, Index *index, QueryProfile *profile);
+
+/***
+    The text of a document from its $DOC line up to the next document, out
+    of the index's store if it has one or else its corpus file
+    @return : malloc'd text, NULL if it can't be read
+***/
+char *getDocument (long docno, Index *index);
+
+/***
+    The text of the document on line start of a corpus file up to the next
+    $DOC line
+    @return : malloc'd text, NULL if the file can't be read
+***/
+char *corpusDocument (const char *path, long start);
+
+/***
+    Cut a snippet of a document around the SNIPPET_WINDOW bytes holding the
+    most query terms, with them in [brackets], adding its cost to profile
+    unless it's NULL. Reads SNIPPET_BYTES of the corpus however long the
+    document is, or decompresses its block of the index's store
+    @return : malloc'd snippet, NULL when the index (or its segment) has no
+              snippets or the document's file can't be read
+***/
+char *getSnippet (const char *query, long docno, Index *index, QueryProfile *profile);
+
+/***
+    Initialize an empty index
+***/
+void initIndex (Index *index);
+
+/***
+    Load dictionary.txt, docids.txt, postings.txt, deleted.bin and files.txt
+    from the generation named by the manifest, or from the current directory
+    without one
+    @return 0 : success
+    @return -1 : an index file is missing or malformed
+***/
+int loadIndex (Index *index);
+
+/***
+    Load the index files from a generation directory, without publishing
+    its size to the metrics
+    @return 0 : success
+    @return -1 : an index file is missing or malformed
+***/
+int loadIndexFrom (Index *index, const char *dir);
+
+/***
+    Set the documents' lengths that BM25 normalizes by, from FIELDS_FILE
+    when the index has it and summed from the postings otherwise
+    @return 0 : success
+    @return -1 : out of memory
+***/
+int setDocLengths (Index *index);
+
+/***
+    Publish the size of the loaded index to the metrics
+***/
+void setIndexGauges (Index *index);
+
+/***
+    Check that every document's file-id is in the files
+    @return 0 : valid
+    @return -1 : a document refers to a missing file
+***/
+int checkIndexFiles (Index *index);
+
+/***
+    Free an index's contents
+***/
+void freeIndex (Index *index);
@@ -0,0 +1,251 @@
+/***
+    Filename: fields.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Field-scoped postings. The full postings count a word the
+                 same whether it's in a document's $TITLE or its $BODY, so
+                 the indexer also keeps the postings of the title words, by
+                 dictionary entry of the full index, and how many terms each
+                 field of a document holds. A title-only query scans these
+                 instead of the full postings. fields.bin is binary, in the
+                 byte order of the machine that wrote it:
+                    header: magic, dictSize, numDocs, numPostings
+                    termStart: dictSize + 1 int64
+                    docno, tf: numPostings uint32 each
+                    titleLength, bodyLength: numDocs uint32 each
+***/
+
+#ifndef FIELDS_H_INCLUDED
+#define FIELDS_H_INCLUDED
+#include "fields.h"
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#define FIELDS_MAGIC "BFIELDS1"
+
+typedef struct FieldHeader {
+    char magic[8];
+    int64_t dictSize;
+    int64_t numDocs;
+    int64_t numPostings;
+}FieldHeader;
+
+void initFieldLengths (FieldLengths *lengths) {
+    memset(lengths, 0, sizeof(FieldLengths));
+}
+
+int countFieldTerm (FieldLengths *lengths, long docno, int title) {
+    if (docno >= lengths->cap) {
+        long cap = (lengths->cap > 0) ? lengths->cap*2 : 1024;
+        while (cap <= docno)
+            cap *= 2;
+        uint32_t *grown = realloc(lengths->title, sizeof(uint32_t)*cap);
+        if (grown == NULL)
+            return -1;
+        lengths->title = grown;
+        grown = realloc(lengths->body, sizeof(uint32_t)*cap);
+        if (grown == NULL)
+            return -1;
+        lengths->body = grown;
+        memset(lengths->title + lengths->cap, 0, sizeof(uint32_t)*(cap - lengths->cap));
+        memset(lengths->body + lengths->cap, 0, sizeof(uint32_t)*(cap - lengths->cap));
+        lengths->cap = cap;
+    }
+    if (docno >= lengths->size)
+        lengths->size = docno + 1;
+    if (title)
+        lengths->title[docno]++;
+    else
+        lengths->body[docno]++;
+    return 0;
+}
+
+void freeFieldLengths (FieldLengths *lengths) {
+    free(lengths->title);
+    free(lengths->body);
+    initFieldLengths(lengths);
+}
+
+int saveFields (const char *dir, FieldIndex *fields) {
+    char *path = generationPath(dir, FIELDS_FILE);
+    if (path == NULL)
+        return -1;
+    char *temp = malloc(sizeof(char)*((int)strlen(path)+5));
+    sprintf(temp, "%s.tmp", path);
+    FILE *fp = fopen(temp, "wb");
+    if (fp == NULL) {
+        free(temp);
+        free(path);
+        return -1;
+    }
+
+    FieldHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FIELDS_MAGIC, sizeof(header.magic));
+    header.dictSize = fields->dictSize;
+    header.numDocs = fields->numDocs;
+    header.numPostings = fields->numPostings;
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && (long)fwrite(fields->termStart, sizeof(int64_t), fields->dictSize + 1, fp)
+                    == fields->dictSize + 1;
+    ok = ok && (long)fwrite(fields->docno, sizeof(uint32_t), fields->numPostings, fp)
+                    == fields->numPostings;
+    ok = ok && (long)fwrite(fields->tf, sizeof(uint32_t), fields->numPostings, fp)
+                    == fields->numPostings;
+    ok = ok && (long)fwrite(fields->titleLength, sizeof(uint32_t), fields->numDocs, fp)
+                    == fields->numDocs;
+    ok = ok && (long)fwrite(fields->bodyLength, sizeof(uint32_t), fields->numDocs, fp)
+                    == fields->numDocs;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+        ok = 0;
+    }
+    free(temp);
+    free(path);
+    return ok ? 0 : -1;
+}
+
+/***
+    Allocate the arrays of a FieldIndex of the given sizes
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int allocFields (FieldIndex *fields, long dictSize, long numDocs, long numPostings) {
+    fields->dictSize = dictSize;
+    fields->numDocs = numDocs;
+    fields->numPostings = numPostings;
+    fields->termStart = malloc(sizeof(int64_t)*(dictSize + 1));
+    fields->docno = malloc(sizeof(uint32_t)*(numPostings + 1));
+    fields->tf = malloc(sizeof(uint32_t)*(numPostings + 1));
+    fields->titleLength = malloc(sizeof(uint32_t)*(numDocs + 1));
+    fields->bodyLength = malloc(sizeof(uint32_t)*(numDocs + 1));
+    if (fields->termStart == NULL || fields->docno == NULL || fields->tf == NULL
+            || fields->titleLength == NULL || fields->bodyLength == NULL)
+        return -1;
+    return 0;
+}
+
+int loadFields (FieldIndex *fields, const char *path, long dictSize, long numDocs) {
+    memset(fields, 0, sizeof(FieldIndex));
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+
+    FieldHeader header;
+    int ok = fread(&header, sizeof(header), 1, fp) == 1
+             && memcmp(header.magic, FIELDS_MAGIC, sizeof(header.magic)) == 0
+             && header.dictSize == dictSize && header.numDocs == numDocs
+             && header.numPostings >= 0;
+    ok = ok && allocFields(fields, dictSize, numDocs, header.numPostings) == 0;
+    ok = ok && (long)fread(fields->termStart, sizeof(int64_t), dictSize + 1, fp) == dictSize + 1;
+    ok = ok && (long)fread(fields->docno, sizeof(uint32_t), fields->numPostings, fp)
+                    == fields->numPostings;
+    ok = ok && (long)fread(fields->tf, sizeof(uint32_t), fields->numPostings, fp)
+                    == fields->numPostings;
+    ok = ok && (long)fread(fields->titleLength, sizeof(uint32_t), numDocs, fp) == numDocs;
+    ok = ok && (long)fread(fields->bodyLength, sizeof(uint32_t), numDocs, fp) == numDocs;
+    fclose(fp);
+
+    // The offsets are trusted when titles are scored, check them once here
+    ok = ok && fields->termStart[0] == 0 && fields->termStart[dictSize] == fields->numPostings;
+    for (long t = 0; ok && t < dictSize; t++)
+        ok = fields->termStart[t] <= fields->termStart[t+1];
+    for (long i = 0; ok && i < fields->numPostings; i++)
+        ok = fields->docno[i] < numDocs;
+
+    // Magnitudes of the titles, with idfs over the titles as the retriever weighs them
+    if (ok) {
+        fields->titleVector = calloc(numDocs + 1, sizeof(double));
+        ok = fields->titleVector != NULL;
+    }
+    for (long t = 0; ok && t < dictSize; t++) {
+        long df = fields->termStart[t+1] - fields->termStart[t];
+        double idf = (df > 0) ? log2((double)numDocs/(double)df) : 0;
+        for (long i = fields->termStart[t]; i < fields->termStart[t+1]; i++)
+            fields->titleVector[fields->docno[i]] += (fields->tf[i]*idf) * (fields->tf[i]*idf);
+    }
+    double titleTerms = 0;
+    double bodyTerms = 0;
+    for (long d = 0; ok && d < numDocs; d++) {
+        fields->titleVector[d] = sqrt(fields->titleVector[d]);
+        titleTerms += fields->titleLength[d];
+        bodyTerms += fields->bodyLength[d];
+    }
+    if (ok && numDocs > 0) {
+        fields->avgTitle = titleTerms / numDocs;
+        fields->avgBody = bodyTerms / numDocs;
+    }
+    if (!ok) {
+        freeFields(fields);
+        return -1;
+    }
+    return 0;
+}
+
+int compactFields (const char *from, const char *to, long oldDocs, long oldTerms,
+                   long newDocno[], long newTerm[], long numDocs, long numTerms) {
+    char *path = generationPath(from, FIELDS_FILE);
+    FieldIndex old;
+    FieldIndex fields;
+    memset(&fields, 0, sizeof(fields));
+    int ret = (path != NULL && loadFields(&old, path, oldTerms, oldDocs) == 0) ? 0 : -1;
+    free(path);
+    if (ret != 0) {
+        printf("Error loading %s of %s\n", FIELDS_FILE, from);
+        return -1;
+    }
+
+    // Terms and documents keep their order, the dropped ones are skipped
+    if (allocFields(&fields, numTerms, numDocs, old.numPostings) != 0)
+        ret = -1;
+    long k = 0;
+    for (long t = 0; ret == 0 && t < oldTerms; t++) {
+        if (newTerm[t] < 0)
+            continue;
+        fields.termStart[newTerm[t]] = k;
+        for (long i = old.termStart[t]; i < old.termStart[t+1]; i++) {
+            if (newDocno[old.docno[i]] < 0)
+                continue;
+            fields.docno[k] = (uint32_t)newDocno[old.docno[i]];
+            fields.tf[k++] = old.tf[i];
+        }
+    }
+    for (long d = 0; ret == 0 && d < oldDocs; d++) {
+        if (newDocno[d] >= 0) {
+            fields.titleLength[newDocno[d]] = old.titleLength[d];
+            fields.bodyLength[newDocno[d]] = old.bodyLength[d];
+        }
+    }
+    if (ret == 0) {
+        fields.termStart[numTerms] = k;
+        fields.numPostings = k;
+        if (saveFields(to, &fields) != 0) {
+            printf("Error writing %s of %s\n", FIELDS_FILE, to);
+            ret = -1;
+        }
+    }
+    freeFields(&old);
+    freeFields(&fields);
+    return ret;
+}
+
+void freeFields (FieldIndex *fields) {
+    free(fields->termStart);
+    free(fields->docno);
+    free(fields->tf);
+    free(fields->titleLength);
+    free(fields->bodyLength);
+    free(fields->titleVector);
+    memset(fields, 0, sizeof(FieldIndex));
+}
@@ -0,0 +1,106 @@
+/***
+    Filename: fields.h
+    Author: Benjamin Baird
+    Description: Header file for fields.c, the title postings and field
+                 lengths the indexer keeps apart from the full postings
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef STDINT_H_INCLUDED
+#define STDINT_H_INCLUDED
+#include <stdint.h>
+#endif
+
+// Title postings and field lengths of a generation, written by indexer --fields
+#define FIELDS_FILE "fields.bin"
+
+/***
+    Terms of each field of the documents as they're tokenized, by docno
+***/
+typedef struct FieldLengths {
+    uint32_t *title;
+    uint32_t *body;
+    long size;
+    long cap;
+}FieldLengths;
+
+/***
+    The postings of the words in the documents' $TITLE fields, by dictionary
+    entry of the full index, and the terms in each field of every document
+***/
+typedef struct FieldIndex {
+    long dictSize;
+    long numDocs;
+    long numPostings;
+    int64_t *termStart;     // dictSize + 1 offsets of each term's title postings
+    uint32_t *docno;        // ascending within a term
+    uint32_t *tf;           // occurrences in the title
+    uint32_t *titleLength;  // terms in each document's title
+    uint32_t *bodyLength;   // and in its body
+    double *titleVector;    // magnitude of each title's tf-idf vector, set by loadFields
+    double avgTitle;        // average title and body lengths, set by loadFields
+    double avgBody;
+}FieldIndex;
+
+/***
+    Initialize empty field lengths
+***/
+void initFieldLengths (FieldLengths *lengths);
+
+/***
+    Count a term into the title or body of a document
+    @return 0 : success
+    @return -1 : out of memory
+***/
+int countFieldTerm (FieldLengths *lengths, long docno, int title);
+
+/***
+    Free field lengths
+***/
+void freeFieldLengths (FieldLengths *lengths);
+
+/***
+    Write a generation's FIELDS_FILE, replacing it atomically
+    @return 0 : success
+    @return -1 : the file couldn't be written
+***/
+int saveFields (const char *dir, FieldIndex *fields);
+
+/***
+    Load a FIELDS_FILE written for an index of dictSize terms and numDocs
+    documents, weighing the titles' terms by their idf over the titles
+    @return 0 : success
+    @return -1 : the file couldn't be read, is malformed or belongs to
+                 another index
+***/
+int loadFields (FieldIndex *fields, const char *path, long dictSize, long numDocs);
+
+/***
+    Write the FIELDS_FILE of a compacted generation from the one it was
+    compacted from
+    @call newDocno : docno of each old document, -1 if it was dropped
+    @call newTerm : dictionary entry of each old term, -1 if it was dropped
+    @return 0 : success
+    @return -1 : the old file couldn't be read or the new one written
+***/
+int compactFields (const char *from, const char *to, long oldDocs, long oldTerms,
+                   long newDocno[], long newTerm[], long numDocs, long numTerms);
+
+/***
+    Free the title postings and field lengths
+***/
+void freeFields (FieldIndex *fields);
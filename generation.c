@@ -0,0 +1,344 @@
+/***
+    Filename: generation.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Index generations. An index is never rewritten in place: the
+                 indexer writes a new gen.<n> directory, syncs it and renames
+                 CURRENT.tmp over CURRENT. A rename is atomic, so a retriever
+                 reading the manifest either finds the generation it already
+                 serves or a complete new one, never a half written file.
+***/
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#ifndef DIRENT_H_INCLUDED
+#define DIRENT_H_INCLUDED
+#include <dirent.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef ERRNO_H_INCLUDED
+#define ERRNO_H_INCLUDED
+#include <errno.h>
+#endif
+
+int currentGeneration (char *dir, size_t size) {
+    FILE *fp = fopen(MANIFEST_FILE, "r");
+    if (fp == NULL) {
+        if (errno != ENOENT)
+            return -1;
+        snprintf(dir, size, ".");
+        return 0;
+    }
+    char *ret = fgets(dir, size, fp);
+    fclose(fp);
+    if (ret == NULL)
+        return -1;
+    dir[strcspn(dir, "\n")] = '\0';
+    return (dir[0] != '\0') ? 0 : -1;
+}
+
+char *generationPath (const char *dir, const char *name) {
+    char *path = malloc(strlen(dir) + strlen(name) + 2);
+    if (path == NULL)
+        return NULL;
+    if (strcmp(dir, ".") == 0)
+        strcpy(path, name);
+    else
+        sprintf(path, "%s/%s", dir, name);
+    return path;
+}
+
+char *adoptFile (const char *from, const char *to, const char *path) {
+    size_t prefix = strlen(from);
+    if (strcmp(from, ".") == 0 || strcmp(from, to) == 0 || strncmp(path, from, prefix) != 0
+            || path[prefix] != '/') {
+        char *copy = malloc(strlen(path) + 1);
+        if (copy != NULL)
+            strcpy(copy, path);
+        return copy;
+    }
+    char *linked = generationPath(to, path + prefix + 1);
+    if (linked != NULL && link(path, linked) != 0 && errno != EEXIST) {
+        free(linked);
+        return NULL;
+    }
+    return linked;
+}
+
+int carryFile (const char *from, const char *to, const char *name) {
+    char *source = generationPath(from, name);
+    char *target = generationPath(to, name);
+    int ret = (source != NULL && target != NULL) ? 0 : -1;
+    if (ret == 0 && access(source, F_OK) == 0 && link(source, target) != 0 && errno != EEXIST)
+        ret = -1;
+    free(source);
+    free(target);
+    return ret;
+}
+
+/***
+    The number of a generation directory's name
+    @return >0 : n of gen.<n>
+    @return -1 : not a generation
+***/
+static long generationNumber (const char *name) {
+    size_t prefix = strlen(GENERATION_PREFIX);
+    if (strncmp(name, GENERATION_PREFIX, prefix) != 0 || name[prefix] == '\0')
+        return -1;
+    char *end;
+    long n = strtol(name + prefix, &end, 10);
+    return (*end == '\0' && n > 0) ? n : -1;
+}
+
+/***
+    Numbers of the generation directories in the current directory
+    @return : malloc'd array of count numbers, NULL if it can't be read
+***/
+static long *listGenerations (long *count) {
+    *count = 0;
+    DIR *cwd = opendir(".");
+    if (cwd == NULL)
+        return NULL;
+    long cap = 16;
+    long *numbers = malloc(sizeof(long)*cap);
+    struct dirent *entry;
+    while (numbers != NULL && (entry = readdir(cwd)) != NULL) {
+        long n = generationNumber(entry->d_name);
+        if (n < 0)
+            continue;
+        if (*count == cap) {
+            cap *= 2;
+            long *grown = realloc(numbers, sizeof(long)*cap);
+            if (grown == NULL) {
+                free(numbers);
+                numbers = NULL;
+                break;
+            }
+            numbers = grown;
+        }
+        numbers[(*count)++] = n;
+    }
+    closedir(cwd);
+    return numbers;
+}
+
+int newGeneration (char *dir, size_t size) {
+    long count = 0;
+    long *numbers = listGenerations(&count);
+    if (numbers == NULL)
+        return -1;
+    long next = 1;
+    for (long i = 0; i < count; i++) {
+        if (numbers[i] >= next)
+            next = numbers[i] + 1;
+    }
+    free(numbers);
+
+    // Another indexer may claim the same number first
+    while (1) {
+        snprintf(dir, size, "%s%ld", GENERATION_PREFIX, next);
+        if (mkdir(dir, 0755) == 0)
+            return 0;
+        if (errno != EEXIST)
+            return -1;
+        next++;
+    }
+}
+
+/***
+    Flush a file or directory to disk
+***/
+static int syncPath (const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    int ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+void removeGeneration (const char *dir) {
+    DIR *gen = opendir(dir);
+    if (gen != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(gen)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                continue;
+            char *path = generationPath(dir, entry->d_name);
+            if (path != NULL)
+                remove(path);
+            free(path);
+        }
+        closedir(gen);
+    }
+    rmdir(dir);
+}
+
+/***
+    Compare function for qsort, highest first
+***/
+static int cmpNewest (const void *pa, const void *pb) {
+    long a = *(const long *)pa;
+    long b = *(const long *)pb;
+    return (a < b) - (a > b);
+}
+
+/***
+    Remove the generations before current, keeping the GENERATIONS_KEPT - 1
+    newest of them. Newer directories are builds still being written
+***/
+static void pruneGenerations (long current) {
+    long count = 0;
+    long *numbers = listGenerations(&count);
+    if (numbers == NULL)
+        return;
+    qsort(numbers, count, sizeof(long), cmpNewest);
+    long older = 0;
+    for (long i = 0; i < count; i++) {
+        if (numbers[i] >= current || ++older < GENERATIONS_KEPT)
+            continue;
+        char dir[GENERATION_NAME];
+        snprintf(dir, sizeof(dir), "%s%ld", GENERATION_PREFIX, numbers[i]);
+        removeGeneration(dir);
+    }
+    free(numbers);
+}
+
+int publishGeneration (const char *dir) {
+    // The files must be on disk before a manifest that names them
+    DIR *gen = opendir(dir);
+    if (gen == NULL)
+        return -1;
+    struct dirent *entry;
+    while ((entry = readdir(gen)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        char *path = generationPath(dir, entry->d_name);
+        if (path != NULL)
+            syncPath(path);
+        free(path);
+    }
+    closedir(gen);
+    syncPath(dir);
+
+    FILE *fp = fopen(MANIFEST_FILE ".tmp", "w");
+    if (fp == NULL)
+        return -1;
+    int ret = (fprintf(fp, "%s\n", dir) > 0 && fflush(fp) == 0 && fsync(fileno(fp)) == 0) ? 0 : -1;
+    if (fclose(fp) != 0 || ret != 0 || rename(MANIFEST_FILE ".tmp", MANIFEST_FILE) != 0) {
+        remove(MANIFEST_FILE ".tmp");
+        return -1;
+    }
+    syncPath(".");
+
+    long current = generationNumber(dir);
+    if (current > 0)
+        pruneGenerations(current);
+    return 0;
+}
+
+/***
+    Read the paths of files.txt
+    @return 0 : success
+    @return -1 : failure
+***/
+static int readFiles (const char *dir, DocPlaces *places) {
+    char *path = generationPath(dir, "files.txt");
+    FILE *fp = (path != NULL) ? fopen(path, "r") : NULL;
+    free(path);
+    if (fp == NULL)
+        return -1;
+    char *line = NULL;
+    size_t size = 0;
+    int count = 0;
+    if (getline(&line, &size, fp) != -1 && sscanf(line, "%d", &count) == 1 && count >= 0)
+        places->files = calloc(count + 1, sizeof(char*));
+    while (places->files != NULL && places->numFiles < count && getline(&line, &size, fp) != -1) {
+        line[strcspn(line, "\n")] = '\0';
+        places->files[places->numFiles] = malloc(strlen(line) + 1);
+        if (places->files[places->numFiles] == NULL)
+            break;
+        strcpy(places->files[places->numFiles++], line);
+    }
+    free(line);
+    fclose(fp);
+    return (places->files != NULL && places->numFiles == count) ? 0 : -1;
+}
+
+/***
+    Compare function for qsort_r, docnos by file and line
+***/
+static int cmpDocPlace (const void *pa, const void *pb, void *arg) {
+    DocPlaces *places = arg;
+    long a = *(const long*)pa;
+    long b = *(const long*)pb;
+    if (places->fileid[a] != places->fileid[b])
+        return (places->fileid[a] < places->fileid[b]) ? -1 : 1;
+    return (places->line[a] > places->line[b]) - (places->line[a] < places->line[b]);
+}
+
+int readDocPlaces (const char *dir, DocPlaces *places) {
+    memset(places, 0, sizeof(DocPlaces));
+    int ret = readFiles(dir, places);
+    char *path = generationPath(dir, "docids.txt");
+    FILE *fp = (path != NULL) ? fopen(path, "r") : NULL;
+    free(path);
+    if (fp == NULL || fscanf(fp, "%ld", &places->numDocs) != 1 || places->numDocs < 0)
+        ret = -1;
+    long numDocs = (ret == 0) ? places->numDocs : 0;
+    places->fileid = malloc(sizeof(int)*(numDocs + 1));
+    places->line = malloc(sizeof(long)*(numDocs + 1));
+    places->order = malloc(sizeof(long)*(numDocs + 1));
+    if (places->fileid == NULL || places->line == NULL || places->order == NULL)
+        ret = -1;
+    for (long d = 0; ret == 0 && d < numDocs; d++) {
+        if (fscanf(fp, "%*s %d %ld", &places->fileid[d], &places->line[d]) != 2)
+            ret = -1;
+        places->order[d] = d;
+    }
+    if (fp != NULL)
+        fclose(fp);
+    if (ret == 0)
+        qsort_r(places->order, numDocs, sizeof(long), cmpDocPlace, places);
+    return ret;
+}
+
+long findDocPlace (DocPlaces *places, int fileid, long line) {
+    long *order = places->order;
+    while (places->next < places->numDocs && places->fileid[order[places->next]] == fileid
+               && places->line[order[places->next]] < line)
+        places->next++;
+    if (places->next < places->numDocs && places->fileid[order[places->next]] == fileid
+            && places->line[order[places->next]] == line)
+        return order[places->next++];
+    return -1;
+}
+
+void freeDocPlaces (DocPlaces *places) {
+    for (int f = 0; places->files != NULL && f < places->numFiles; f++)
+        free(places->files[f]);
+    free(places->files);
+    free(places->fileid);
+    free(places->line);
+    free(places->order);
+    memset(places, 0, sizeof(DocPlaces));
+}
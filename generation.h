@@ -0,0 +1,127 @@
+/***
+    Filename: generation.h
+    Author: Benjamin Baird
+    Description: Header file for generation.c, the index generations the
+                 indexer publishes and the retriever reloads. Each build is
+                 written to its own gen.<n> directory and published by
+                 renaming the CURRENT manifest, which names the directory
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+// Names the directory of the published generation
+#define MANIFEST_FILE "CURRENT"
+// Generation directories are gen.<n>, n counting up from 1
+#define GENERATION_PREFIX "gen."
+// Generations left on disk, a retriever still serving an older one can
+// read its titles until it has reloaded
+#define GENERATIONS_KEPT 3
+// Copy of a streamed corpus, written into the generation being built
+#define DOC_STORE "docstore.txt"
+// Longest generation directory name
+#define GENERATION_NAME 64
+// Shards written by indexer --shards are shard.<k> directories, k counting
+// up from 0, each with generations and a manifest of its own
+#define SHARD_PREFIX "shard."
+// Most shards an index is split into
+#define MAX_SHARDS 128
+// Document count and dfs of the whole index, in each shard's generations
+#define SHARD_STATS_FILE "shardstats.txt"
+
+/***
+    Where the documents of a generation are in its corpus files, from its
+    files.txt and docids.txt, for the passes reading the files again
+***/
+typedef struct DocPlaces {
+    char **files;           // paths of files.txt
+    int numFiles;
+    long numDocs;
+    int *fileid;            // file of each docno
+    long *line;             // line of each docno's docid
+    long *order;            // docnos sorted by file and line
+    long next;              // next document expected in order
+}DocPlaces;
+
+/***
+    The directory of the published generation, "." for an index written
+    into the current directory before generations
+    @return 0 : success
+    @return -1 : the manifest is unreadable
+***/
+int currentGeneration (char *dir, size_t size);
+
+/***
+    Path of an index file in a generation directory
+    @return : malloc'd dir/name, or name itself when dir is "."
+***/
+char *generationPath (const char *dir, const char *name);
+
+/***
+    Path of a corpus file for the generation to. A file kept inside the
+    generation from (a stream's DOC_STORE) is hard linked into to, so to
+    doesn't depend on a directory that will be pruned
+    @return : malloc'd path, NULL if the link failed
+***/
+char *adoptFile (const char *from, const char *to, const char *path);
+
+/***
+    Hard link a file of the generation from into to, when from has it
+    @return 0 : linked, or from has no such file
+    @return -1 : the link failed
+***/
+int carryFile (const char *from, const char *to, const char *name);
+
+/***
+    Create the directory of the next generation
+    @return 0 : success
+    @return -1 : the directory couldn't be created
+***/
+int newGeneration (char *dir, size_t size);
+
+/***
+    Sync a written generation and point the manifest at it through a
+    rename, so readers see either the old generation or the whole new one.
+    Generations older than the GENERATIONS_KEPT newest are removed
+    @return 0 : success
+    @return -1 : the manifest couldn't be written
+***/
+int publishGeneration (const char *dir);
+
+/***
+    Remove a generation directory and the files in it
+***/
+void removeGeneration (const char *dir);
+
+/***
+    Read where the documents of a generation are
+    @return 0 : success
+    @return -1 : files.txt or docids.txt couldn't be read, or out of memory
+***/
+int readDocPlaces (const char *dir, DocPlaces *places);
+
+/***
+    The document whose docid is on a line of a file, reading the files in
+    order and each from its start. Documents on earlier lines that were
+    never asked for are skipped
+    @return >=0 : its docno
+    @return -1 : no indexed document's docid is there
+***/
+long findDocPlace (DocPlaces *places, int fileid, long line);
+
+/***
+    Free what readDocPlaces read
+***/
+void freeDocPlaces (DocPlaces *places);
@@ -0,0 +1,93 @@
+/***
+    Filename: histogram.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: HDR-style histogram. A value v >= HIST_SUB_BUCKETS lands in
+                 magnitude m = bits(v) - 7 and sub-bucket v >> m, so every
+                 bucket is at most 1/64 of its value wide.
+***/
+
+#ifndef HISTOGRAM_H_INCLUDED
+#define HISTOGRAM_H_INCLUDED
+#include "histogram.h"
+#endif
+
+void initHistogram (Histogram *hist) {
+    memset(hist, 0, sizeof(Histogram));
+}
+
+/***
+    Finds the bucket of a value
+***/
+void bucketOf (long long value, int *magnitude, int *sub) {
+    if (value < HIST_SUB_BUCKETS) {
+        *magnitude = 0;
+        *sub = (int)value;
+        return;
+    }
+    int bits = 64 - __builtin_clzll((unsigned long long)value);
+    *magnitude = bits - 7;
+    if (*magnitude >= HIST_MAGNITUDES) {
+        *magnitude = HIST_MAGNITUDES - 1;
+        *sub = HIST_SUB_BUCKETS - 1;
+        return;
+    }
+    *sub = (int)(value >> *magnitude);
+}
+
+void recordValue (Histogram *hist, long long value) {
+    if (value < 0)
+        value = 0;
+    int magnitude = 0;
+    int sub = 0;
+    bucketOf(value, &magnitude, &sub);
+    hist->counts[magnitude][sub]++;
+    if (hist->total == 0 || value < hist->min)
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+    hist->total++;
+    hist->sum += (double)value;
+}
+
+void mergeHistogram (Histogram *dst, Histogram *src) {
+    if (src->total == 0)
+        return;
+    for (int m = 0; m < HIST_MAGNITUDES; m++) {
+        for (int s = 0; s < HIST_SUB_BUCKETS; s++)
+            dst->counts[m][s] += src->counts[m][s];
+    }
+    if (dst->total == 0 || src->min < dst->min)
+        dst->min = src->min;
+    if (src->max > dst->max)
+        dst->max = src->max;
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+long long histPercentile (Histogram *hist, double p) {
+    if (hist->total == 0)
+        return 0;
+    long long target = (long long)(p / 100.0 * hist->total + 0.5);
+    if (target < 1)
+        target = 1;
+    long long seen = 0;
+    for (int m = 0; m < HIST_MAGNITUDES; m++) {
+        for (int s = 0; s < HIST_SUB_BUCKETS; s++) {
+            seen += hist->counts[m][s];
+            if (seen >= target && hist->counts[m][s] > 0) {
+                // Highest value the bucket holds, capped by the real maximum
+                long long high = ((long long)(s + 1) << m) - 1;
+                return (high < hist->max) ? high : hist->max;
+            }
+        }
+    }
+    return hist->max;
+}
+
+double histMean (Histogram *hist) {
+    if (hist->total == 0)
+        return 0;
+    return hist->sum / hist->total;
+}
@@ -0,0 +1,59 @@
+/***
+    Filename: histogram.h
+    Author: Benjamin Baird
+    Description: Header file for histogram.c, an HDR-style log-linear latency
+                 histogram with about 1.6% precision over the whole range
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+// Linear buckets per power of two, values below this are exact
+#define HIST_SUB_BUCKETS 128
+// Powers of two covered, enough for nanoseconds up to days
+#define HIST_MAGNITUDES 48
+
+typedef struct Histogram {
+    long long counts[HIST_MAGNITUDES][HIST_SUB_BUCKETS];
+    long long total;
+    long long min;
+    long long max;
+    double sum;
+}Histogram;
+
+/***
+    Initializes an empty histogram
+***/
+void initHistogram (Histogram *hist);
+
+/***
+    Records one value, negative values are recorded as 0
+***/
+void recordValue (Histogram *hist, long long value);
+
+/***
+    Adds every value recorded in src to dst
+***/
+void mergeHistogram (Histogram *dst, Histogram *src);
+
+/***
+    @return : value at or below which p percent of the values lie, 0 if empty
+***/
+long long histPercentile (Histogram *hist, double p);
+
+/***
+    @return : mean of the recorded values, 0 if empty
+***/
+double histMean (Histogram *hist);
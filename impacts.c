@@ -0,0 +1,283 @@
+/***
+    Filename: impacts.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Impact-ordered postings. The indexer quantizes every
+                 posting's normalized tf-idf weight to 8 bits against the
+                 largest weight in the index and regroups each term's
+                 postings by impact, highest first, so the retriever can
+                 score the postings that matter most before a budget runs
+                 out. Postings weighing nothing (terms in every document)
+                 are left out. impacts.bin is binary, in the byte order of
+                 the machine that wrote it:
+                    header: magic, dictSize, numDocs, numSegments,
+                            numPostings, scale
+                    termSegments: dictSize + 1 int64
+                    segStart: numSegments + 1 int64
+                    impact: numSegments bytes
+                    docno: numPostings uint32
+***/
+
+#ifndef IMPACTS_H_INCLUDED
+#define IMPACTS_H_INCLUDED
+#include "impacts.h"
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#define IMPACTS_MAGIC "BIMPACT1"
+
+typedef struct ImpactHeader {
+    char magic[8];
+    int64_t dictSize;
+    int64_t numDocs;
+    int64_t numSegments;
+    int64_t numPostings;
+    double scale;
+}ImpactHeader;
+
+/***
+    Read the count on the first line of an index file of a generation
+    @return : the file positioned after the count, NULL on failure
+***/
+static FILE *openCounted (const char *dir, const char *name, long *count) {
+    char *path = generationPath(dir, name);
+    FILE *fp = (path != NULL) ? fopen(path, "r") : NULL;
+    if (fp == NULL || fscanf(fp, "%ld", count) != 1 || *count < 0) {
+        printf("Error loading %s\n", (path != NULL) ? path : name);
+        if (fp != NULL)
+            fclose(fp);
+        fp = NULL;
+    }
+    free(path);
+    return fp;
+}
+
+/***
+    Write the impact-ordered postings beside the old file and rename over it
+    @return 0 : success
+    @return -1 : failure
+***/
+static int saveImpacts (const char *dir, ImpactIndex *impacts) {
+    char *path = generationPath(dir, IMPACTS_FILE);
+    if (path == NULL)
+        return -1;
+    char *temp = malloc(sizeof(char)*((int)strlen(path)+5));
+    sprintf(temp, "%s.tmp", path);
+    FILE *fp = fopen(temp, "wb");
+    if (fp == NULL) {
+        free(temp);
+        free(path);
+        return -1;
+    }
+
+    ImpactHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMPACTS_MAGIC, sizeof(header.magic));
+    header.dictSize = impacts->dictSize;
+    header.numDocs = impacts->numDocs;
+    header.numSegments = impacts->numSegments;
+    header.numPostings = impacts->numPostings;
+    header.scale = impacts->scale;
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && (long)fwrite(impacts->termSegments, sizeof(int64_t), impacts->dictSize + 1, fp)
+                    == impacts->dictSize + 1;
+    ok = ok && (long)fwrite(impacts->segStart, sizeof(int64_t), impacts->numSegments + 1, fp)
+                    == impacts->numSegments + 1;
+    ok = ok && (long)fwrite(impacts->impact, 1, impacts->numSegments, fp) == impacts->numSegments;
+    ok = ok && (long)fwrite(impacts->docno, sizeof(uint32_t), impacts->numPostings, fp)
+                    == impacts->numPostings;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+        ok = 0;
+    }
+    free(temp);
+    free(path);
+    return ok ? 0 : -1;
+}
+
+int writeImpacts (const char *dir) {
+    long dictSize = 0;
+    long numDocs = 0;
+    long postSize = 0;
+    FILE *dictFp = openCounted(dir, "dictionary.txt", &dictSize);
+    FILE *docFp = openCounted(dir, "docids.txt", &numDocs);
+    FILE *postFp = openCounted(dir, "postings.txt", &postSize);
+    int ret = (dictFp != NULL && docFp != NULL && postFp != NULL) ? 0 : -1;
+    if (docFp != NULL)
+        fclose(docFp);
+
+    long *df = malloc(sizeof(long)*(dictSize + 1));
+    uint32_t *docno = malloc(sizeof(uint32_t)*(postSize + 1));
+    double *weight = malloc(sizeof(double)*(postSize + 1));
+    double *norms = calloc(numDocs + 1, sizeof(double));
+    ImpactIndex impacts;
+    memset(&impacts, 0, sizeof(impacts));
+    if (df == NULL || docno == NULL || weight == NULL || norms == NULL)
+        ret = -1;
+
+    // Weigh every posting as the retriever does and sum the documents' magnitudes
+    long k = 0;
+    for (long t = 0; ret == 0 && t < dictSize; t++) {
+        if (fscanf(dictFp, "%*s %ld", &df[t]) != 1 || df[t] < 0 || k + df[t] > postSize) {
+            ret = -1;
+            break;
+        }
+        double idf = (df[t] > 0) ? log2((double)numDocs/(double)df[t]) : 0;
+        for (long end = k + df[t]; k < end; k++) {
+            long d = 0;
+            long tf = 0;
+            if (fscanf(postFp, "%ld %ld", &d, &tf) != 2 || d < 0 || d >= numDocs) {
+                ret = -1;
+                break;
+            }
+            docno[k] = (uint32_t)d;
+            weight[k] = tf * idf;
+            norms[d] += weight[k] * weight[k];
+        }
+    }
+    if (ret == 0 && k != postSize)
+        ret = -1;
+    if (ret != 0)
+        printf("Error reading the index files of %s\n", dir);
+
+    double maxWeight = 0;
+    for (long d = 0; ret == 0 && d < numDocs; d++)
+        norms[d] = sqrt(norms[d]);
+    for (long i = 0; ret == 0 && i < postSize; i++) {
+        if (weight[i] > 0)
+            weight[i] /= norms[docno[i]];
+        if (weight[i] > maxWeight)
+            maxWeight = weight[i];
+    }
+
+    // Counting sort of each term's postings by impact, keeping docno order
+    if (ret == 0) {
+        impacts.dictSize = dictSize;
+        impacts.numDocs = numDocs;
+        impacts.scale = (maxWeight > 0) ? maxWeight / IMPACT_LEVELS : 1;
+        impacts.termSegments = malloc(sizeof(int64_t)*(dictSize + 1));
+        impacts.segStart = malloc(sizeof(int64_t)*(postSize + 1));
+        impacts.impact = malloc(postSize + 1);
+        impacts.docno = malloc(sizeof(uint32_t)*(postSize + 1));
+        if (impacts.termSegments == NULL || impacts.segStart == NULL || impacts.impact == NULL
+                || impacts.docno == NULL)
+            ret = -1;
+    }
+    long start = 0;
+    for (long t = 0; ret == 0 && t < dictSize; t++) {
+        long counts[IMPACT_LEVELS + 1];
+        memset(counts, 0, sizeof(counts));
+        for (long i = start; i < start + df[t]; i++) {
+            long q = lround(weight[i] / impacts.scale);
+            if (weight[i] > 0 && q < 1)
+                q = 1;
+            if (q > IMPACT_LEVELS)
+                q = IMPACT_LEVELS;
+            weight[i] = q;
+            counts[q]++;
+        }
+
+        impacts.termSegments[t] = impacts.numSegments;
+        long next[IMPACT_LEVELS + 1];
+        for (int q = IMPACT_LEVELS; q >= 1; q--) {
+            next[q] = impacts.numPostings;
+            if (counts[q] == 0)
+                continue;
+            impacts.impact[impacts.numSegments] = (uint8_t)q;
+            impacts.segStart[impacts.numSegments++] = impacts.numPostings;
+            impacts.numPostings += counts[q];
+        }
+        for (long i = start; i < start + df[t]; i++) {
+            long q = (long)weight[i];
+            if (q > 0)
+                impacts.docno[next[q]++] = docno[i];
+        }
+        start += df[t];
+    }
+    if (ret == 0) {
+        impacts.termSegments[dictSize] = impacts.numSegments;
+        impacts.segStart[impacts.numSegments] = impacts.numPostings;
+        if (saveImpacts(dir, &impacts) != 0) {
+            printf("Error writing %s of %s\n", IMPACTS_FILE, dir);
+            ret = -1;
+        }
+    }
+
+    if (dictFp != NULL)
+        fclose(dictFp);
+    if (postFp != NULL)
+        fclose(postFp);
+    free(df);
+    free(docno);
+    free(weight);
+    free(norms);
+    freeImpacts(&impacts);
+    return ret;
+}
+
+int loadImpacts (ImpactIndex *impacts, const char *path, long dictSize, long numDocs) {
+    memset(impacts, 0, sizeof(ImpactIndex));
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+
+    ImpactHeader header;
+    int ok = fread(&header, sizeof(header), 1, fp) == 1
+             && memcmp(header.magic, IMPACTS_MAGIC, sizeof(header.magic)) == 0
+             && header.dictSize == dictSize && header.numDocs == numDocs
+             && header.numSegments >= 0 && header.numPostings >= 0 && header.scale > 0;
+    if (ok) {
+        impacts->dictSize = dictSize;
+        impacts->numDocs = numDocs;
+        impacts->numSegments = header.numSegments;
+        impacts->numPostings = header.numPostings;
+        impacts->scale = header.scale;
+        impacts->termSegments = malloc(sizeof(int64_t)*(dictSize + 1));
+        impacts->segStart = malloc(sizeof(int64_t)*(header.numSegments + 1));
+        impacts->impact = malloc(header.numSegments + 1);
+        impacts->docno = malloc(sizeof(uint32_t)*(header.numPostings + 1));
+        ok = impacts->termSegments != NULL && impacts->segStart != NULL
+             && impacts->impact != NULL && impacts->docno != NULL;
+    }
+    ok = ok && (long)fread(impacts->termSegments, sizeof(int64_t), dictSize + 1, fp) == dictSize + 1;
+    ok = ok && (long)fread(impacts->segStart, sizeof(int64_t), impacts->numSegments + 1, fp)
+                    == impacts->numSegments + 1;
+    ok = ok && (long)fread(impacts->impact, 1, impacts->numSegments, fp) == impacts->numSegments;
+    ok = ok && (long)fread(impacts->docno, sizeof(uint32_t), impacts->numPostings, fp)
+                    == impacts->numPostings;
+    fclose(fp);
+
+    // The offsets are trusted by the evaluator, check them once here
+    ok = ok && impacts->termSegments[0] == 0 && impacts->termSegments[dictSize] == impacts->numSegments
+            && impacts->segStart[0] == 0 && impacts->segStart[impacts->numSegments] == impacts->numPostings;
+    for (long t = 0; ok && t < dictSize; t++)
+        ok = impacts->termSegments[t] <= impacts->termSegments[t+1];
+    for (long s = 0; ok && s < impacts->numSegments; s++)
+        ok = impacts->segStart[s] <= impacts->segStart[s+1];
+    for (long i = 0; ok && i < impacts->numPostings; i++)
+        ok = impacts->docno[i] < numDocs;
+    if (!ok) {
+        freeImpacts(impacts);
+        return -1;
+    }
+    return 0;
+}
+
+void freeImpacts (ImpactIndex *impacts) {
+    free(impacts->termSegments);
+    free(impacts->segStart);
+    free(impacts->impact);
+    free(impacts->docno);
+    memset(impacts, 0, sizeof(ImpactIndex));
+}
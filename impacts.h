@@ -0,0 +1,73 @@
+/***
+    Filename: impacts.h
+    Author: Benjamin Baird
+    Description: Header file for impacts.c, impact-ordered postings written
+                 by the indexer next to postings.txt and evaluated score at a
+                 time by the retriever
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef STDINT_H_INCLUDED
+#define STDINT_H_INCLUDED
+#include <stdint.h>
+#endif
+
+// Impact-ordered postings of a generation, written by indexer --impacts
+#define IMPACTS_FILE "impacts.bin"
+// Highest quantized impact, a posting's impact is 1 to IMPACT_LEVELS
+#define IMPACT_LEVELS 255
+
+/***
+    Each term's postings grouped into segments of equal impact, highest
+    first, the docnos in a segment ascending. A posting's impact is its
+    tf-idf weight divided by its document's magnitude, quantized to 8 bits:
+    the weight it adds to the document's cosine score is about
+    impact * scale * query weight
+***/
+typedef struct ImpactIndex {
+    long dictSize;
+    long numDocs;
+    long numSegments;
+    long numPostings;       // postings with a non-zero weight
+    double scale;           // weight of impact 1
+    int64_t *termSegments;  // dictSize + 1 offsets of each term's first segment
+    int64_t *segStart;      // numSegments + 1 offsets of each segment's first docno
+    uint8_t *impact;        // of each segment
+    uint32_t *docno;
+}ImpactIndex;
+
+/***
+    Read dictionary.txt and postings.txt of a generation directory and write
+    its IMPACTS_FILE, replacing it atomically
+    @return 0 : success
+    @return -1 : the index files couldn't be read or IMPACTS_FILE written
+***/
+int writeImpacts (const char *dir);
+
+/***
+    Load an IMPACTS_FILE written for an index of dictSize terms and numDocs
+    documents
+    @return 0 : success
+    @return -1 : the file couldn't be read, is malformed or belongs to
+                 another index
+***/
+int loadImpacts (ImpactIndex *impacts, const char *path, long dictSize, long numDocs);
+
+/***
+    Free the impact-ordered postings
+***/
+void freeImpacts (ImpactIndex *impacts);
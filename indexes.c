@@ -23,17 +23,24 @@ DictIndex initDictIndex(char *term, long df, long postIndex){
     return index;
 }
 
-PostIndex initPostIndex(long docno, long tf) {
-    PostIndex index;
-    index.docno = docno;
-    index.tf = tf;
+PostColumns initPostColumns(long size) {
+    PostColumns index;
+    index.docno = malloc(sizeof(uint32_t)*size);
+    index.tf = malloc(sizeof(uint16_t)*size);
+    index.size = size;
     return index;
 }
 
-DocIndex initDocIndex(char *docid, long line) {
+void setPost(PostColumns *pIndex, long i, long docno, long tf) {
+    pIndex->docno[i] = (uint32_t)docno;
+    pIndex->tf[i] = (tf > POST_TF_MAX) ? POST_TF_MAX : (uint16_t)tf;
+}
+
+DocIndex initDocIndex(char *docid, int fileid, long line) {
     DocIndex index;
     index.docid = malloc(sizeof(char)*(long)strlen(docid)+1);
     index.docid = strcpy(index.docid, docid);
+    index.fileid = fileid;
     index.line = line;
     return index;
 }
@@ -50,15 +57,23 @@ void freeDictArray ( DictIndex dIndex[], long dictSize ) {
     }
 }
 
-void printPostArray (PostIndex pIndex[], long pSize) {
-    for (long i = 0; i < pSize; i++) {
-        printf("Post: %ld: %ld %ld\n", i , pIndex[i].docno, pIndex[i].tf);
+void printPostColumns (PostColumns *pIndex) {
+    for (long i = 0; i < pIndex->size; i++) {
+        printf("Post: %ld: %u %u\n", i , pIndex->docno[i], pIndex->tf[i]);
     }
 }
 
+void freePostColumns (PostColumns *pIndex) {
+    free(pIndex->docno);
+    free(pIndex->tf);
+    pIndex->docno = NULL;
+    pIndex->tf = NULL;
+    pIndex->size = 0;
+}
+
 void printDocArray (DocIndex dIndex[], long docSize) {
     for (long i = 0; i < docSize; i++) {
-        printf("DocNum: %ld: %s %ld\n", i , dIndex[i].docid, dIndex[i].line);
+        printf("DocNum: %ld: %s %d %ld\n", i , dIndex[i].docid, dIndex[i].fileid, dIndex[i].line);
     }
 }
 
@@ -67,3 +82,35 @@ void freeDocArray ( DocIndex dIndex[], long docSize ) {
         free(dIndex[i].docid);
     }
 }
+
+char **loadFiles (char *path, int *numFiles) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return NULL;
+
+    char line[500];
+    if (fscanf(fp, "%d\n", numFiles) != 1 || *numFiles <= 0) {
+        fclose(fp);
+        return NULL;
+    }
+    char **files = malloc(sizeof(char*)*(*numFiles));
+    for (int i = 0; i < *numFiles; i++) {
+        if (fgets(line, 500, fp) == NULL) {
+            freeFiles(files, i);
+            fclose(fp);
+            return NULL;
+        }
+        line[strcspn(line, "\n")] = '\0';
+        files[i] = malloc(sizeof(char)*(long)strlen(line)+1);
+        files[i] = strcpy(files[i], line);
+    }
+    fclose(fp);
+    return files;
+}
+
+void freeFiles ( char *files[], int numFiles ) {
+    for (int i = 0; i < numFiles; i++) {
+        free(files[i]);
+    }
+    free(files);
+}
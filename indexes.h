@@ -17,19 +17,33 @@
 #include <string.h>
 #endif
 
+#ifndef STDINT_H_INCLUDED
+#define STDINT_H_INCLUDED
+#include <stdint.h>
+#endif
+
+// Largest term frequency a posting can hold, larger values are saturated
+#define POST_TF_MAX UINT16_MAX
+
 typedef struct DictIndex {
     char *term;
     long df;
     long postIndex;
 }DictIndex;
 
-typedef struct PostIndex {
-    long docno;
-    long tf;
-}PostIndex;
+/***
+    Postings stored as columns (structure-of-arrays) so the scoring
+    kernels can stream through docnos and tfs separately
+***/
+typedef struct PostColumns {
+    uint32_t *docno;
+    uint16_t *tf;
+    long size;
+}PostColumns;
 
 typedef struct {
     char *docid;
+    int fileid;
     long line;
 }DocIndex;
 
@@ -40,16 +54,21 @@ typedef struct {
 DictIndex initDictIndex(char *term, long df, long pIndex);
 
 /***
-    Initialize a PostIndex with docno and tf
-    @return : pointer to PostIndex created
+    Allocate the docno and tf columns for size postings
+    @return : PostColumns created, columns are NULL on failure
 ***/
-PostIndex initPostIndex(long docno, long tf);
+PostColumns initPostColumns(long size);
 
 /***
-    Initialize a DocIndex with docid and line
+    Store a posting at index i, tf is saturated to POST_TF_MAX
+***/
+void setPost(PostColumns *pIndex, long i, long docno, long tf);
+
+/***
+    Initialize a DocIndex with docid, the file it is in and its line
     @return : pointer to DocIndex created
 ***/
-DocIndex initDocIndex(char *docid, long line);
+DocIndex initDocIndex(char *docid, int fileid, long line);
 
 /***
     Print the dictionary array
@@ -62,9 +81,15 @@ void printDictArray (DictIndex dIndex[], long dictSize);
 void freeDictArray ( DictIndex dIndex[], long dictSize );
 
 /***
-    Print the posting array
+    Print the posting columns
+***/
+void printPostColumns (PostColumns *pIndex);
+
+/***
+    Free the posting columns
 ***/
-void printPostArray (PostIndex pIndex[], long pSize);
+void freePostColumns (PostColumns *pIndex);
+
 /***
     Print the doc array
 ***/
@@ -74,3 +99,16 @@ void printDocArray (DocIndex dIndex[], long docSize);
     Free doc array's terms
 ***/
 void freeDocArray ( DocIndex dIndex[], long docSize );
+
+/***
+    Load the corpus file paths listed in files.txt, indexed by file-id
+        <total number of files>
+        <path1>
+    @return : array of paths, NULL if the file can't be read
+***/
+char **loadFiles (char *path, int *numFiles);
+
+/***
+    Free the corpus file paths
+***/
+void freeFiles ( char *files[], int numFiles );
@@ -0,0 +1,695 @@
+/***
+    Filename: ingest.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Near real-time ingest. The ingest thread reads $DOC documents
+                 from a pipe or a growing file into a term tree, the same one
+                 the indexer builds, and every refresh interval freezes the
+                 tree into a small in-memory segment. The segment is published
+                 together with the served generation as a new snapshot, its
+                 docnos following the generation's. Every flush interval the
+                 generation and the segment are merged into a new generation
+                 on disk and the tree starts over. The input is copied to
+                 INGEST_STORE as it's read, titles are read from there.
+***/
+
+#ifndef INGEST_H_INCLUDED
+#define INGEST_H_INCLUDED
+#include "ingest.h"
+#endif
+
+#ifndef OUTBUF_H_INCLUDED
+#define OUTBUF_H_INCLUDED
+#include "outbuf.h"
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef POLL_H_INCLUDED
+#define POLL_H_INCLUDED
+#include <poll.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef ERRNO_H_INCLUDED
+#define ERRNO_H_INCLUDED
+#include <errno.h>
+#endif
+
+/***
+    Build a searchable segment from the documents added since the last
+    flush. idfs are taken over the generation and the segment together, so
+    the segment's document magnitudes match the generation's
+    @return : snapshot with one reference, NULL if out of memory
+***/
+static Snapshot *freezeSegment (Ingest *ingest, Index *base) {
+    DocTable *docs = &ingest->docs;
+    long numTerms = countTreeNodes(ingest->termTree);
+    Index segment;
+    initIndex(&segment);
+    segment.dictIndex = malloc(sizeof(DictIndex)*(numTerms > 0 ? numTerms : 1));
+    segment.postIndex = initPostColumns(ingest->numPostings > 0 ? ingest->numPostings : 1);
+    segment.docIndex = malloc(sizeof(DocIndex)*docs->size);
+    segment.docTermVector = calloc(docs->size, sizeof(double));
+    segment.files = malloc(sizeof(char*));
+    if (segment.files != NULL) {
+        segment.files[0] = malloc(strlen(INGEST_STORE) + 1);
+        if (segment.files[0] != NULL) {
+            strcpy(segment.files[0], INGEST_STORE);
+            segment.numFiles = 1;
+        }
+    }
+    if (segment.dictIndex == NULL || segment.postIndex.docno == NULL
+            || segment.postIndex.tf == NULL || segment.docIndex == NULL
+            || segment.docTermVector == NULL || segment.numFiles == 0) {
+        freeIndex(&segment);
+        return NULL;
+    }
+
+    // Terms in alphabetical order, postings in the order the documents arrived
+    long numDocs = base->numDocs + docs->size;
+    long post = 0;
+    TreeIter iter;
+    initTreeIter(&iter, ingest->termTree);
+    TreeNode *node;
+    while ((node = nextTreeNode(&iter)) != NULL) {
+        long df = 0;
+        for (Node *doc = node->dictionary; doc != NULL; doc = doc->next)
+            setPost(&segment.postIndex, post + df++, findDoc(docs, doc->docId), doc->freq);
+
+        long entry = searchIndex(base->dictIndex, base->dictSize - 1, node->term);
+        double idf = tfidf(1.0, numDocs, df + (entry >= 0 ? base->dictIndex[entry].df : 0));
+        for (long k = post; k < post + df; k++) {
+            double weight = segment.postIndex.tf[k] * idf;
+            segment.docTermVector[segment.postIndex.docno[k]] += weight * weight;
+        }
+        segment.dictIndex[segment.dictSize++] = initDictIndex(node->term, df, post);
+        post += df;
+    }
+    segment.postSize = post;
+
+    for (long d = 0; d < docs->size; d++) {
+        segment.docIndex[d] = initDocIndex(getDocId(docs, d), 0, docs->start[d]);
+        segment.numDocs++;
+        segment.docTermVector[d] = sqrt(segment.docTermVector[d]);
+    }
+    if (setDocLengths(&segment) != 0) {
+        freeIndex(&segment);
+        return NULL;
+    }
+    return newSnapshot(&segment);
+}
+
+/***
+    Publish a generation with the documents added since the last flush
+    @return 0 : success
+    @return -1 : out of memory, the served snapshot is unchanged
+***/
+static int publishSegment (Ingest *ingest, Snapshot *generation) {
+    // Titles of the new documents are read from the store
+    fflush(ingest->store);
+    Snapshot *segment = NULL;
+    if (ingest->docs.size > 0) {
+        segment = freezeSegment(ingest, &generation->index);
+        if (segment == NULL)
+            return -1;
+    }
+    int ret = publishIndex(ingest->reloader, generation, segment);
+    if (segment != NULL)
+        releaseIndex(ingest->reloader, segment);
+    setGauge(METRIC_SEGMENT_DOCS, ingest->docs.size);
+    return ret;
+}
+
+/***
+    Opens an index file of a generation
+    @return : the file, NULL if it couldn't be opened
+***/
+static FILE *openGenerationFile (const char *dir, const char *name, const char *mode) {
+    char *path = generationPath(dir, name);
+    if (path == NULL)
+        return NULL;
+    FILE *fp = fopen(path, mode);
+    free(path);
+    return fp;
+}
+
+/***
+    Copies files.txt from the generation from to to and adds INGEST_STORE
+    unless it's already listed
+    @return >=0 : file-id of INGEST_STORE
+    @return -1 : failure
+***/
+static int mergeFiles (const char *from, const char *to) {
+    FILE *in = openGenerationFile(from, "files.txt", "r");
+    FILE *out = openGenerationFile(to, "files.txt", "w");
+    int numFiles = 0;
+    if (in == NULL || out == NULL || fscanf(in, "%d\n", &numFiles) != 1) {
+        if (in != NULL)
+            fclose(in);
+        if (out != NULL)
+            fclose(out);
+        return -1;
+    }
+
+    char **paths = malloc(sizeof(char*)*(numFiles + 1));
+    char *line = NULL;
+    size_t size = 0;
+    int count = 0;
+    int storeId = -1;
+    while (paths != NULL && count < numFiles && getline(&line, &size, in) != -1) {
+        line[strcspn(line, "\n")] = '\0';
+        // A stream's doc store is hard linked in, like a compaction does
+        paths[count] = adoptFile(from, to, line);
+        if (paths[count] == NULL)
+            break;
+        if (strcmp(paths[count], INGEST_STORE) == 0)
+            storeId = count;
+        count++;
+    }
+    free(line);
+    fclose(in);
+
+    int ret = -1;
+    if (count == numFiles) {
+        if (storeId < 0)
+            storeId = numFiles++;
+        fprintf(out, "%d\n", numFiles);
+        for (int f = 0; f < count; f++)
+            fprintf(out, "%s\n", paths[f]);
+        if (count < numFiles)
+            fprintf(out, "%s\n", INGEST_STORE);
+        ret = storeId;
+    }
+    if (fclose(out) != 0)
+        ret = -1;
+    for (int f = 0; f < count; f++)
+        free(paths[f]);
+    free(paths);
+    return ret;
+}
+
+/***
+    Copies docids.txt from the generation from to to, followed by the
+    segment's documents in INGEST_STORE
+    @return >=0 : documents in the generation from
+    @return -1 : failure
+***/
+static long mergeDocids (Ingest *ingest, const char *from, const char *to, int storeId) {
+    FILE *in = openGenerationFile(from, "docids.txt", "r");
+    FILE *out = openGenerationFile(to, "docids.txt", "w");
+    long numDocs = 0;
+    long ret = -1;
+    OutBuffer buffer;
+    if (in != NULL && out != NULL && fscanf(in, "%ld", &numDocs) == 1
+            && initOutBuffer(&buffer, out) == 0) {
+        fprintf(out, "%.6ld\n", numDocs + ingest->docs.size);
+        char docid [MAX_WORD+1];
+        int fileid = 0;
+        long line = 0;
+        long docno = 0;
+        for (; docno < numDocs && fscanf(in, "%199s %d %ld", docid, &fileid, &line) == 3; docno++) {
+            putString(&buffer, docid);
+            putChar(&buffer, ' ');
+            putLong(&buffer, fileid);
+            putChar(&buffer, ' ');
+            putLong(&buffer, line);
+            putChar(&buffer, '\n');
+        }
+        for (long d = 0; d < ingest->docs.size; d++) {
+            putString(&buffer, getDocId(&ingest->docs, d));
+            putChar(&buffer, ' ');
+            putLong(&buffer, storeId);
+            putChar(&buffer, ' ');
+            putLong(&buffer, ingest->docs.start[d]);
+            putChar(&buffer, '\n');
+        }
+        if (flushOutBuffer(&buffer) == 0 && docno == numDocs)
+            ret = numDocs;
+        freeOutBuffer(&buffer);
+    }
+    if (in != NULL)
+        fclose(in);
+    if (out != NULL && fclose(out) != 0)
+        ret = -1;
+    return ret;
+}
+
+/***
+    Merges the dictionary and postings of the generation from with the
+    segment's term tree into to, alphabetically like the indexer's merge.
+    A term's postings are the generation's followed by the segment's, whose
+    docnos start at numDocs
+    @return 0 : success
+    @return -1 : failure
+***/
+static int mergeTerms (Ingest *ingest, const char *from, const char *to, long numDocs) {
+    FILE *dictIn = openGenerationFile(from, "dictionary.txt", "r");
+    FILE *postIn = openGenerationFile(from, "postings.txt", "r");
+    FILE *dictOut = openGenerationFile(to, "dictionary.txt", "w");
+    FILE *postOut = openGenerationFile(to, "postings.txt", "w");
+    long dictSize = 0;
+    long postSize = 0;
+    int ret = -1;
+    OutBuffer dict;
+    OutBuffer post;
+    if (dictIn == NULL || postIn == NULL || dictOut == NULL || postOut == NULL
+            || fscanf(dictIn, "%ld", &dictSize) != 1 || fscanf(postIn, "%ld", &postSize) != 1
+            || initOutBuffer(&dict, NULL) != 0) {
+        dictSize = -1;
+    } else if (initOutBuffer(&post, postOut) != 0) {
+        freeOutBuffer(&dict);
+        dictSize = -1;
+    }
+
+    if (dictSize >= 0) {
+        fprintf(postOut, "%.15ld\n", postSize + ingest->numPostings);
+        TreeIter iter;
+        initTreeIter(&iter, ingest->termTree);
+        TreeNode *node = nextTreeNode(&iter);
+        char term [MAX_WORD+1];
+        long baseDf = 0;
+        long t = 0;
+        int haveTerm = (t < dictSize && fscanf(dictIn, "%199s %ld", term, &baseDf) == 2);
+        long numTerms = 0;
+        ret = 0;
+        while (ret == 0 && (haveTerm || node != NULL)) {
+            int order = !haveTerm ? 1 : (node == NULL) ? -1 : strcmp(term, node->term);
+            putString(&dict, (order <= 0) ? term : node->term);
+            long df = 0;
+            if (order <= 0) {
+                for (long k = 0; k < baseDf; k++) {
+                    long docno = 0;
+                    long tf = 0;
+                    if (fscanf(postIn, "%ld %ld", &docno, &tf) != 2) {
+                        ret = -1;
+                        break;
+                    }
+                    putLong(&post, docno);
+                    putChar(&post, ' ');
+                    putLong(&post, tf);
+                    putChar(&post, '\n');
+                }
+                df += baseDf;
+                t++;
+                haveTerm = (t < dictSize && fscanf(dictIn, "%199s %ld", term, &baseDf) == 2);
+                if (t < dictSize && !haveTerm)
+                    ret = -1;
+            }
+            if (order >= 0) {
+                for (Node *doc = node->dictionary; doc != NULL; doc = doc->next) {
+                    putLong(&post, numDocs + findDoc(&ingest->docs, doc->docId));
+                    putChar(&post, ' ');
+                    putLong(&post, doc->freq);
+                    putChar(&post, '\n');
+                    df++;
+                }
+                node = nextTreeNode(&iter);
+            }
+            putChar(&dict, ' ');
+            putLong(&dict, df);
+            putChar(&dict, '\n');
+            numTerms++;
+        }
+
+        fprintf(dictOut, "%ld\n", numTerms);
+        if (flushOutBuffer(&post) != 0 || dict.error
+                || (long)fwrite(dict.data, 1, dict.size, dictOut) != dict.size)
+            ret = -1;
+        freeOutBuffer(&dict);
+        freeOutBuffer(&post);
+    }
+
+    FILE *all [4] = {dictIn, postIn, dictOut, postOut};
+    for (int i = 0; i < 4; i++) {
+        if (all[i] != NULL && fclose(all[i]) != 0)
+            ret = -1;
+    }
+    return ret;
+}
+
+/***
+    Carries the deleted documents of the generation from over to to, the
+    merged generation keeps their docnos
+    @return 0 : success
+    @return -1 : failure
+***/
+static int mergeDeleted (const char *from, const char *to, long numDocs, long totalDocs) {
+    char *fromPath = generationPath(from, LIVE_DOCS_FILE);
+    char *toPath = generationPath(to, LIVE_DOCS_FILE);
+    LiveDocs live;
+    initLiveDocs(&live, numDocs);
+    int ret = (fromPath != NULL && toPath != NULL && loadLiveDocs(&live, fromPath) == 0) ? 0 : -1;
+    if (ret == 0 && live.numDeleted > 0) {
+        long *docnos = malloc(sizeof(long)*live.numDeleted);
+        long count = 0;
+        for (long docno = 0; docnos != NULL && docno < numDocs; docno++) {
+            if (isDeleted(&live, docno))
+                docnos[count++] = docno;
+        }
+        if (docnos == NULL || deleteDocs(toPath, totalDocs, docnos, count) < 0)
+            ret = -1;
+        free(docnos);
+    }
+    freeLiveDocs(&live);
+    free(fromPath);
+    free(toPath);
+    return ret;
+}
+
+/***
+    Writes the served generation merged with the segment to a new
+    generation, publishes it and starts a new segment. A document still
+    being received is cut off at the words read so far
+    @return 1 : flushed, the generation is loaded by the next poll if it
+                couldn't be loaded here
+    @return 0 : nothing to flush, or the indexer published a generation
+                first and the segment is kept to flush on top of it
+    @return -1 : the generation couldn't be written
+***/
+static int flushSegment (Ingest *ingest) {
+    if (ingest->docs.size == 0)
+        return 0;
+    Reloader *reloader = ingest->reloader;
+    const char *from = reloader->generation->index.dir;
+    char dir[GENERATION_NAME];
+    // The store must be on disk before a generation that lists it
+    if (fflush(ingest->store) != 0 || fsync(fileno(ingest->store)) != 0
+            || newGeneration(dir, sizeof(dir)) != 0) {
+        fprintf(stderr, "Ingest: could not create a generation to flush to\n");
+        return -1;
+    }
+
+    long numDocs = -1;
+    int storeId = mergeFiles(from, dir);
+    if (storeId >= 0)
+        numDocs = mergeDocids(ingest, from, dir, storeId);
+    // A store keeps every document, the segment's are read back out of
+    // INGEST_STORE into it
+    int ret = (numDocs >= 0 && mergeTerms(ingest, from, dir, numDocs) == 0
+               && carryFile(from, dir, SHARD_STATS_FILE) == 0
+               && extendBlockStore(from, dir, numDocs, storeId) == 0) ? 0 : -1;
+    // Deletes wait from when the bitmap is carried over until the new
+    // generation is published, then go to it
+    char *livePath = generationPath(from, LIVE_DOCS_FILE);
+    int lock = (ret == 0 && livePath != NULL) ? lockLiveDocs(livePath) : -1;
+    free(livePath);
+    if (lock < 0 || mergeDeleted(from, dir, numDocs, numDocs + ingest->docs.size) != 0)
+        ret = -1;
+
+    // Publishing over a generation the indexer has just published would lose it
+    char current[GENERATION_NAME];
+    if (ret == 0 && (currentGeneration(current, sizeof(current)) != 0 || strcmp(current, from) != 0)) {
+        unlockLiveDocs(lock);
+        removeGeneration(dir);
+        return 0;
+    }
+    Index index;
+    if (ret != 0 || publishGeneration(dir) != 0) {
+        unlockLiveDocs(lock);
+        fprintf(stderr, "Ingest: could not write %s\n", dir);
+        removeGeneration(dir);
+        return -1;
+    }
+    unlockLiveDocs(lock);
+
+    // The published generation has the segment's documents now, kept they
+    // would be served twice and merged again by the next flush
+    long flushed = ingest->docs.size;
+    freeTree(ingest->termTree);
+    ingest->termTree = NULL;
+    freeDocTable(&ingest->docs);
+    initDocTable(&ingest->docs);
+    ingest->numPostings = 0;
+    // The rest of a document cut off by the flush has no docno to go to
+    if (ingest->parser.metaTags > 2)
+        ingest->parser.metaTags = 0;
+    countMetric(METRIC_SEGMENT_FLUSHES, 1);
+    fprintf(stderr, "Ingest: flushed %ld documents to %s\n", flushed, dir);
+
+    Snapshot *generation = NULL;
+    if (loadIndexFrom(&index, dir) != 0) {
+        // The next poll retries it like any published generation
+        fprintf(stderr, "Ingest: could not load %s, it is served once it is reloaded\n", dir);
+    } else if ((generation = newSnapshot(&index)) == NULL || publishSegment(ingest, generation) != 0) {
+        fprintf(stderr, "Ingest: out of memory, %s is served once it is reloaded\n", dir);
+    }
+    if (generation != NULL)
+        releaseIndex(reloader, generation);
+    return 1;
+}
+
+/***
+    Offset of the first document start in data, where the segment can be
+    flushed without splitting a document
+    @return >=0 : offset
+    @return -1 : no document starts in data
+***/
+static long docBoundary (Ingest *ingest, const char *data, long size) {
+    // Between $DOC and its first word the document isn't in the table yet
+    if (ingest->parser.metaTags <= 2)
+        return 0;
+    for (long i = 0; i + 4 < size; i++) {
+        int wordStart = (i == 0) ? (ingest->parser.length == 0) : (data[i-1] == ' ' || data[i-1] == '\n');
+        if (wordStart && strncmp(data + i, "$DOC", 4) == 0 && (data[i+4] == ' ' || data[i+4] == '\n'))
+            return i;
+    }
+    return -1;
+}
+
+/***
+    Copy a piece of the input to the store and add its words to the segment
+    @return >=0 : documents started
+    @return -1 : out of memory or the store couldn't be written
+***/
+static long ingestBytes (Ingest *ingest, const char *data, long size) {
+    if ((long)fwrite(data, 1, size, ingest->store) != size)
+        return -1;
+    long started = parseBytes(&ingest->parser, data, size);
+    if (started > 0)
+        countMetric(METRIC_INGESTED_DOCS, started);
+    return started;
+}
+
+/***
+    Add a piece of the input to the segment. When a flush is due it's made
+    at the first document starting in the piece
+    @return 1 : flushed, or the flush failed
+    @return 0 : added
+    @return -1 : out of memory or the store couldn't be written
+***/
+static int ingestChunk (Ingest *ingest, const char *data, long size, int flushDue) {
+    int flushed = 0;
+    if (flushDue && ingest->docs.size > 0) {
+        long boundary = docBoundary(ingest, data, size);
+        if (boundary >= 0) {
+            if (ingestBytes(ingest, data, boundary) < 0)
+                return -1;
+            // Kept to flush on top of a generation the indexer published first
+            flushed = (flushSegment(ingest) != 0);
+            data += boundary;
+            size -= boundary;
+        }
+    }
+    return (ingestBytes(ingest, data, size) < 0) ? -1 : flushed;
+}
+
+/***
+    Milliseconds from now until deadline, for poll
+***/
+static int pollTimeout (double now, double deadline) {
+    return (deadline > now) ? (int)((deadline - now) * 1000) + 1 : 0;
+}
+
+/***
+    Ingest thread, reads the input as it arrives until woken to stop
+***/
+static void *ingestWorker (void *arg) {
+    Ingest *ingest = arg;
+    Reloader *reloader = ingest->reloader;
+    char *chunk = malloc(INGEST_CHUNK);
+    if (chunk == NULL) {
+        fprintf(stderr, "Ingest: out of memory\n");
+        return NULL;
+    }
+    double now = metricsClock() / 1e9;
+    double nextPoll = now + RELOAD_INTERVAL;
+    double nextFlush = now + ingest->flush;
+    double nextRefresh = now;
+    double lastInput = now;
+    int dirty = 0;      // words read since the segment was published
+    int atEnd = 0;      // a file is read again at the next poll
+
+    while (1) {
+        double deadline = nextPoll;
+        if (dirty && nextRefresh < deadline)
+            deadline = nextRefresh;
+        if (ingest->docs.size > 0 && nextFlush < deadline)
+            deadline = nextFlush;
+        struct pollfd fds [2];
+        fds[0].fd = ingest->wake[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = ingest->fd;
+        fds[1].events = POLLIN;
+        int numFds = (ingest->fd >= 0 && !atEnd) ? 2 : 1;
+        if (poll(fds, numFds, pollTimeout(now, deadline)) < 0 && errno != EINTR)
+            break;
+        if (fds[0].revents != 0)
+            break;
+        now = metricsClock() / 1e9;
+
+        if (numFds == 2 && fds[1].revents != 0) {
+            ssize_t length = read(ingest->fd, chunk, INGEST_CHUNK);
+            int ret = 0;
+            if (length > 0) {
+                ret = ingestChunk(ingest, chunk, length, now >= nextFlush);
+                dirty = 1;
+                lastInput = now;
+            }
+            if (ret != 0)
+                nextFlush = now + ingest->flush;
+            if (length == 0) {
+                atEnd = 1;
+            } else if ((length < 0 && errno != EINTR && errno != EAGAIN) || ret < 0) {
+                fprintf(stderr, "Ingest: error reading %s or writing %s, no more documents"
+                        " are added\n", ingest->path, INGEST_STORE);
+                close(ingest->fd);
+                ingest->fd = -1;
+            }
+        }
+
+        if (now >= nextPoll) {
+            Snapshot *next;
+            if (pollGeneration(reloader, &next) == 1) {
+                if (publishSegment(ingest, next) != 0)
+                    publishIndex(reloader, next, NULL);
+                releaseIndex(reloader, next);
+                dirty = 0;
+            }
+            saveHotTermsDue(reloader);
+            atEnd = 0;
+            nextPoll = now + RELOAD_INTERVAL;
+        }
+        if (dirty && now >= nextRefresh) {
+            if (publishSegment(ingest, reloader->generation) == 0)
+                dirty = 0;
+            nextRefresh = now + ingest->refresh;
+        }
+        // A quiet input may be left inside a document, it's flushed as it is
+        if (now >= nextFlush && ingest->docs.size > 0 && (ingest->parser.metaTags <= 2
+                || now - lastInput >= ingest->refresh)) {
+            flushSegment(ingest);
+            nextFlush = now + ingest->flush;
+        }
+    }
+    free(chunk);
+    return NULL;
+}
+
+/***
+    Count the lines of the store, ending it with a newline if it doesn't,
+    so the documents appended to it are numbered after them
+    @return >=0 : lines in the store
+    @return -1 : it couldn't be read
+***/
+static long storeLines (FILE *store) {
+    char buffer [INGEST_CHUNK];
+    long lines = 0;
+    int last = '\n';
+    size_t length;
+    rewind(store);
+    while ((length = fread(buffer, 1, sizeof(buffer), store)) > 0) {
+        for (size_t i = 0; i < length; i++)
+            lines += (buffer[i] == '\n');
+        last = buffer[length-1];
+    }
+    if (ferror(store))
+        return -1;
+    if (last != '\n') {
+        fputc('\n', store);
+        lines++;
+    }
+    return lines;
+}
+
+int startIngest (Ingest *ingest, Reloader *reloader, char *path, int refresh, int flush) {
+    memset(ingest, 0, sizeof(Ingest));
+    ingest->reloader = reloader;
+    ingest->path = path;
+    ingest->refresh = refresh;
+    ingest->flush = flush;
+
+    // A pipe is opened for writing too, so it neither blocks for a writer
+    // nor ends when one closes it
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        printf("Could not open %s\n", path);
+        return -1;
+    }
+    ingest->fd = open(path, S_ISFIFO(info.st_mode) ? O_RDWR : O_RDONLY);
+    if (ingest->fd < 0) {
+        printf("Could not open %s\n", path);
+        return -1;
+    }
+    ingest->store = fopen(INGEST_STORE, "a+");
+    long lines = (ingest->store != NULL) ? storeLines(ingest->store) : -1;
+    if (lines < 0 || pipe(ingest->wake) != 0) {
+        printf("Could not open %s\n", INGEST_STORE);
+        if (ingest->store != NULL)
+            fclose(ingest->store);
+        close(ingest->fd);
+        return -1;
+    }
+
+    initDocTable(&ingest->docs);
+    initDocParser(&ingest->parser, &ingest->termTree, &ingest->docs, &ingest->numPostings);
+    ingest->parser.lineNum = lines;
+    if (pthread_create(&ingest->thread, NULL, ingestWorker, ingest) != 0) {
+        printf("Could not start the ingest thread\n");
+        close(ingest->wake[0]);
+        close(ingest->wake[1]);
+        fclose(ingest->store);
+        close(ingest->fd);
+        return -1;
+    }
+    ingest->running = 1;
+    return 0;
+}
+
+void stopIngest (Ingest *ingest) {
+    if (!ingest->running)
+        return;
+    if (write(ingest->wake[1], "", 1) != 1)
+        fprintf(stderr, "Ingest: could not wake the ingest thread\n");
+    pthread_join(ingest->thread, NULL);
+    ingest->running = 0;
+
+    finishParse(&ingest->parser);
+    flushSegment(ingest);
+    if (ingest->termTree != NULL)
+        freeTree(ingest->termTree);
+    freeDocTable(&ingest->docs);
+    fclose(ingest->store);
+    if (ingest->fd >= 0)
+        close(ingest->fd);
+    close(ingest->wake[0]);
+    close(ingest->wake[1]);
+}
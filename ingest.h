@@ -0,0 +1,62 @@
+/***
+    Filename: ingest.h
+    Author: Benjamin Baird
+    Description: Header file for ingest.c, the retriever thread that indexes
+                 documents written to a pipe or file into an in-memory
+                 segment and flushes it to a new generation
+***/
+
+#ifndef RELOAD_H_INCLUDED
+#define RELOAD_H_INCLUDED
+#include "reload.h"
+#endif
+
+#ifndef DOCPARSE_H_INCLUDED
+#define DOCPARSE_H_INCLUDED
+#include "docparse.h"
+#endif
+
+// Copy of the ingested documents that titles are read from, appended to
+// across restarts and listed in the files.txt of every flushed generation
+#define INGEST_STORE "ingest.txt"
+// Default seconds before added documents are searchable
+#define INGEST_REFRESH 1
+// Default seconds between flushes of the segment to a generation
+#define INGEST_FLUSH 60
+// Bytes read from the input at a time
+#define INGEST_CHUNK 65536
+
+/***
+    The ingest thread and the documents it has added since the last flush
+***/
+typedef struct Ingest {
+    Reloader *reloader;     // the ingest thread also reloads published generations
+    char *path;
+    int fd;                 // the input, -1 once it failed
+    TreeNode *termTree;     // documents added since the last flush
+    DocTable docs;
+    long numPostings;
+    DocParser parser;
+    FILE *store;            // INGEST_STORE, every byte read is appended to it
+    int refresh;            // seconds between segments
+    int flush;              // seconds between flushes
+    int wake[2];            // pipe that wakes the thread to stop
+    pthread_t thread;
+    int running;
+}Ingest;
+
+/***
+    Start indexing the documents written to path on another thread. New
+    documents become searchable within refresh seconds and are written to
+    a new generation every flush seconds. The thread takes over checking
+    for published generations from the reload thread
+    @return 0 : started
+    @return -1 : path or INGEST_STORE couldn't be opened, or the thread
+                 couldn't be started
+***/
+int startIngest (Ingest *ingest, Reloader *reloader, char *path, int refresh, int flush);
+
+/***
+    Stop the ingest thread, flushing the documents it has added
+***/
+void stopIngest (Ingest *ingest);
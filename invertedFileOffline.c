@@ -4,7 +4,7 @@ Author: Benjamin Baird
 Date Created: April 2, 2016
 Last Updated: April 8, 2016
 Description: Implements the inverted file data structure to be used "Offline".
-             Creates 3 files based on the given input file.
+             Creates 4 files based on the given input files.
                 - dictionary.txt: contains all terms in the binary search tree
                                   along with the number of documents in which they occur.
                                   Sorted alphabetically.
@@ -17,10 +17,25 @@ Description: Implements the inverted file data structure to be used "Offline".
                     <docno1> <term-frequency1>
                     <docno2> <term-frequency2>
 
-                - docids.txt: docid's with their starting positions from the input file
+                - docids.txt: docid's with the input file they are in and their
+                              starting positions in it
                     <total number of documents>
-                    <docid1> <start-position1>
-                    <docid2> <start-position2>
+                    <docid1> <file-id1> <start-position1>
+                    <docid2> <file-id2> <start-position2>
+
+                - files.txt: the input files, a file-id is a line number in it
+                    <total number of files>
+                    <path1>
+                    <path2>
+
+             The files are written to a new gen.<n> directory that is published
+             by renaming the CURRENT manifest, see generation.c. With --impacts
+             the generation also gets impacts.bin, see impacts.c, and with
+             --snippets the token offsets in snippets.bin, see snippets.c, and
+             with --fields the title postings and field lengths in fields.bin,
+             see fields.c, and with --store the documents compressed in
+             documents.bin, see blockstore.c. --shards splits the current generation into shard.<k>
+             indexes that keep the statistics of the whole index, see shards.c
 Tested: 0 memory leaks or errors
 */
 
@@ -49,229 +64,1460 @@ Tested: 0 memory leaks or errors
 #include "tree.h"
 #endif
 
-typedef struct DocNode {
-    char *docId;
-    int start;
-}DocNode;
+#ifndef DOCTABLE_H_INCLUDED
+#define DOCTABLE_H_INCLUDED
+#include "doctable.h"
+#endif
+
+#ifndef LIVEDOCS_H_INCLUDED
+#define LIVEDOCS_H_INCLUDED
+#include "livedocs.h"
+#endif
+
+#ifndef BUILDSTATS_H_INCLUDED
+#define BUILDSTATS_H_INCLUDED
+#include "buildstats.h"
+#endif
+
+#ifndef OUTBUF_H_INCLUDED
+#define OUTBUF_H_INCLUDED
+#include "outbuf.h"
+#endif
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#ifndef DOCPARSE_H_INCLUDED
+#define DOCPARSE_H_INCLUDED
+#include "docparse.h"
+#endif
+
+#ifndef IMPACTS_H_INCLUDED
+#define IMPACTS_H_INCLUDED
+#include "impacts.h"
+#endif
+
+#ifndef SNIPPETS_H_INCLUDED
+#define SNIPPETS_H_INCLUDED
+#include "snippets.h"
+#endif
+
+#ifndef FIELDS_H_INCLUDED
+#define FIELDS_H_INCLUDED
+#include "fields.h"
+#endif
+
+#ifndef BLOCKSTORE_H_INCLUDED
+#define BLOCKSTORE_H_INCLUDED
+#include "blockstore.h"
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+#ifndef DIRENT_H_INCLUDED
+#define DIRENT_H_INCLUDED
+#include <dirent.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef ERRNO_H_INCLUDED
+#define ERRNO_H_INCLUDED
+#include <errno.h>
+#endif
+
+// --impacts, generations are written with impact-ordered postings
+static int withImpacts = 0;
+// --snippets, generations are written with the token offsets of their documents
+static int withSnippets = 0;
+// --fields, generations are written with their title postings and field lengths
+static int withFields = 0;
+// --store, generations are written with their documents compressed
+static int withStore = 0;
 
 /***
-    Initialize a DocNode with docno and start
-    @return pointer to a DocNode
+    Terms and documents of one corpus file, indexed independently of the others
 ***/
-DocNode *initDocNode (char *docId, int start) {
-    DocNode *node = malloc(sizeof(DocNode));
-    node->docId = malloc(sizeof(char)*((int)strlen(docId)+1));
-    node->docId = strcpy(node->docId, docId);
-    node->start = start;
-    return node;
-}
+typedef struct FileIndex {
+    char *path;
+    TreeNode *termTree;
+    DocTable docs;
+    int numTerms;
+    long numPostings;   // posting list entries in termTree
+    TreeNode *titleTree;    // words of the titles, kept with --fields
+    long titlePostings;     // posting list entries in titleTree
+    FieldLengths lengths;   // terms of each document's fields, by docno in docs
+}FileIndex;
 
 /***
-    Frees up a DocNode and it's contents
+    Initialize an empty FileIndex for path
 ***/
-void freeDocNode ( DocNode *node ) {
-    free(node->docId);
-    free(node);
+void initFileIndex (FileIndex *file, char *path) {
+    file->path = malloc(sizeof(char)*((int)strlen(path)+1));
+    file->path = strcpy(file->path, path);
+    file->termTree = NULL;
+    initDocTable(&file->docs);
+    file->numTerms = 0;
+    file->numPostings = 0;
+    file->titleTree = NULL;
+    file->titlePostings = 0;
+    initFieldLengths(&file->lengths);
 }
 
 /***
-    Generates the dictionary file. Sorted alphabetically.
-        <total number of terms>
-        <term1> <document-frequency1>
-        <term2> <document-frequency2>
+    Frees up a FileIndex's contents
 ***/
-int genDictionary ( FILE *fp, TreeNode *termTree ) {
-    int retVal = 0;
-    // Left Side
-    while (termTree->left != NULL && retVal == 0)
-        retVal = genDictionary(fp, termTree->left);
-
-    // Itself
-    int df = 0;
-    Node *temp = termTree->dictionary;
-    while (temp != NULL) {
-        df++;
-        temp = temp->next;
-    }
-    fprintf(fp,"%s %d\n", termTree->term, df);
-    retVal = 0;
-
-    // Right Side
-    while (termTree->right != NULL && retVal == 0)
-        retVal = genDictionary(fp, termTree->right);
-
-    return 1;
+void freeFileIndex (FileIndex *file) {
+    free(file->path);
+    if (file->termTree != NULL)
+        freeTree(file->termTree);
+    if (file->titleTree != NULL)
+        freeTree(file->titleTree);
+    freeDocTable(&file->docs);
+    freeFieldLengths(&file->lengths);
 }
 
+// Size of the stdio buffers used while streaming, bounds memory use on pipes
+#define STREAM_BUFFER 1048576
+
 /****
-    Processes the files to create dictionary, postings, and docids files
-    @call fp : pointer to file that is to be read
+    Tokenizes $DOC/$TITLE/$BODY documents from a stream as they arrive into
+        a file's term tree and docs, and its title tree with --fields
+    @call fp : stream to read, does not need to be seekable
+    @call store : if not NULL every character read is copied to it, so the
+                  line numbers recorded in docs refer to the doc store
+    @call stats : if not NULL the bytes and documents read are added to it
     @return >0 : number of terms read
+    @return -1 : out of memory
 ****/
-int processDocs(TreeNode **termTree, DocNode **docs, char *filename){
-    int metaTags = 0;
-    int numTerms = 0;
-    char *docId = malloc(sizeof(char)*200);
-    int docCount = 0;
-    int docLine = 0;
+int processStream(FileIndex *file, FILE *fp, FILE *store, BuildStats *stats){
+    char *chunk = malloc(STREAM_BUFFER);
+    if (chunk == NULL)
+        return -1;
+    DocParser parser;
+    initDocParser(&parser, &file->termTree, &file->docs, &file->numPostings);
+    if (withFields)
+        keepFields(&parser, &file->titleTree, &file->titlePostings, &file->lengths);
+
+    size_t length;
+    while ((length = fread(chunk, 1, STREAM_BUFFER, fp)) > 0) {
+        if (store != NULL && fwrite(chunk, 1, length, store) != length) {
+            free(chunk);
+            return -1;
+        }
+        long started = parseBytes(&parser, chunk, length);
+        if (started < 0) {
+            free(chunk);
+            return -1;
+        }
+        if (stats != NULL)
+            addProgress(stats, length, started);
+    }
+    free(chunk);
+    if (finishParse(&parser) != 0)
+        return -1;
+    return parser.numTerms;
+}
 
+/****
+    Processes a file's path to create dictionary, postings, and docids files
+    @call stats : if not NULL the bytes and documents read are added to it
+    @return >0 : number of terms read
+    @return -1 : file could not be read
+****/
+int processDocs(FileIndex *file, BuildStats *stats){
     // Load file to process
-    FILE *fp = fopen(filename, "r");
+    FILE *fp = fopen(file->path, "r");
     if (fp == NULL) {
-        free(docId);
         return -1;
     }
-    int lineNum = 0;
+    int numTerms = processStream(file, fp, NULL, stats);
+    fclose(fp);
+    return numTerms;
+}
 
-    // Grab the first word in the file
-    char *buffer = malloc(sizeof(char)*200);
-    char letter [2] = "\0\0";
-    buffer = strcpy(buffer,"\0");
-    letter[0] = fgetc(fp);
-    while ((letter[0] != ' ') && (letter[0] != '\n')){
-        if (letter[0] == EOF) {
-            free(buffer);
-            buffer = NULL;
-            break;
+/***
+    Creates the docids.txt file based off of the docs tables, in docno order.
+        Docnos are numbered through the files in order.
+        <total number of documents>
+        <docid1> <file-id1> <start-position1>
+        <docid2> <file-id2> <start-position2>
+***/
+int genDocid(FILE *fp, FileIndex files[], int numFiles) {
+    long numDocs = 0;
+    for (int f = 0; f < numFiles; f++)
+        numDocs += files[f].docs.size;
+
+    OutBuffer out;
+    if (initOutBuffer(&out, fp) != 0)
+        return -1;
+    fprintf(fp,"%.6ld\n", numDocs);
+    for (int f = 0; f < numFiles; f++) {
+        DocTable *docs = &files[f].docs;
+        for (long i = 0; i < docs->size; i++) {
+            putString(&out, getDocId(docs, i));
+            putChar(&out, ' ');
+            putLong(&out, f);
+            putChar(&out, ' ');
+            putLong(&out, docs->start[i]);
+            putChar(&out, '\n');
         }
-        buffer = strcat(buffer, letter);
-        letter[0] = fgetc(fp);
-    }
-
-    // Read words from file based on the space deliminator
-    while (buffer != NULL) {
-        if (strncmp(buffer, "$", 1) == 0) {
-                if (strcmp(buffer, "$DOC") == 0) {
-                    metaTags = 1;
-                } else {
-                    // $TITLE or $BODY
-                    metaTags++;
-                }
+    }
+    int ret = flushOutBuffer(&out);
+    freeOutBuffer(&out);
+    return ret;
+}
 
-        } else if (metaTags == 1) {
-            // Load docid
-            docId = strcpy(docId, buffer);
-            docLine = lineNum;
-
-        } else if (metaTags > 1) {
-            // Update the tree
-            if (strlen(buffer) >= 1 && strncmp(buffer, "0",1) > 0){
-                if ((*termTree) != NULL ) {
-                    (*termTree) = addTerm ((*termTree), buffer, docId);
-                } else {
-                    (*termTree) = initTreeNode(buffer, docId);
-                }
+/***
+    Creates the files.txt file, the corpus files that file-ids refer to
+        <total number of files>
+        <path1>
+        <path2>
+***/
+int genFiles(FILE *fp, FileIndex files[], int numFiles) {
+    fprintf(fp, "%d\n", numFiles);
+    for (int f = 0; f < numFiles; f++) {
+        fprintf(fp, "%s\n", files[f].path);
+    }
+    return 0;
+}
+
+/***
+    @return : 1 if file a's current term sorts before file b's,
+              ties go to the lower file so docnos stay ascending
+***/
+int headLess(TreeNode *heads[], int a, int b) {
+    int cmp = strcmp(heads[a]->term, heads[b]->term);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/***
+    Restores the min-heap of files below position i
+***/
+void siftDown(int heap[], int size, int i, TreeNode *heads[]) {
+    while (1) {
+        int smallest = i;
+        int left = 2*i + 1;
+        int right = 2*i + 2;
+        if (left < size && headLess(heads, heap[left], heap[smallest]))
+            smallest = left;
+        if (right < size && headLess(heads, heap[right], heap[smallest]))
+            smallest = right;
+        if (smallest == i)
+            return;
+        int temp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = temp;
+        i = smallest;
+    }
+}
+
+/***
+    Allocates the title postings of the files' title trees, with room for
+    every term of their term trees, and gathers their field lengths by docno
+    @return 0 : success
+    @return -1 : out of memory
+***/
+int initFields(FieldIndex *fields, FileIndex files[], int numFiles) {
+    long numTerms = 0;
+    long numPostings = 0;
+    long numDocs = 0;
+    memset(fields, 0, sizeof(FieldIndex));
+    for (int f = 0; f < numFiles; f++) {
+        numTerms += countTreeNodes(files[f].termTree);
+        numPostings += files[f].titlePostings;
+        numDocs += files[f].docs.size;
+    }
+    fields->numDocs = numDocs;
+    fields->termStart = malloc(sizeof(int64_t)*(numTerms + 1));
+    fields->docno = malloc(sizeof(uint32_t)*(numPostings + 1));
+    fields->tf = malloc(sizeof(uint32_t)*(numPostings + 1));
+    fields->titleLength = calloc(numDocs + 1, sizeof(uint32_t));
+    fields->bodyLength = calloc(numDocs + 1, sizeof(uint32_t));
+    if (fields->termStart == NULL || fields->docno == NULL || fields->tf == NULL
+            || fields->titleLength == NULL || fields->bodyLength == NULL) {
+        freeFields(fields);
+        return -1;
+    }
+    long docno = 0;
+    for (int f = 0; f < numFiles; f++) {
+        FieldLengths *lengths = &files[f].lengths;
+        for (long d = 0; d < lengths->size && d < files[f].docs.size; d++) {
+            fields->titleLength[docno + d] = lengths->title[d];
+            fields->bodyLength[docno + d] = lengths->body[d];
+        }
+        docno += files[f].docs.size;
+    }
+    return 0;
+}
+
+/***
+    Generates the dictionary and postings files in one pass by merging the
+        files' term trees alphabetically. A term's postings are the
+        concatenation of its posting lists in file order.
+        The postings count was tracked while tokenizing so postings.txt is
+        written front to back. The dictionary is much smaller and is held in
+        memory until its count is known, so neither file is seeked.
+    dictionary:
+        <total number of terms>
+        <term1> <document-frequency1>
+    postings:
+        <total number of entries>
+        <docno1> <term-frequency1>
+    With fields the files' title trees are merged alongside, their postings
+    kept under the dictionary entry of the same term
+    @return 0 : success
+    @return -1 : out of memory or a write failed
+***/
+int genIndex(FILE *dictFp, FILE *postFp, FileIndex files[], int numFiles, FieldIndex *fields) {
+    TreeIter *iters = malloc(sizeof(TreeIter)*numFiles);
+    TreeNode **heads = malloc(sizeof(TreeNode*)*numFiles);
+    int *heap = malloc(sizeof(int)*numFiles);
+    long *base = malloc(sizeof(long)*numFiles);
+    TreeIter *titleIters = malloc(sizeof(TreeIter)*numFiles);
+    TreeNode **titleHeads = malloc(sizeof(TreeNode*)*numFiles);
+    int *titleHeap = malloc(sizeof(int)*numFiles);
+    if (iters == NULL || heads == NULL || heap == NULL || base == NULL || titleIters == NULL
+            || titleHeads == NULL || titleHeap == NULL
+            || (fields != NULL && initFields(fields, files, numFiles) != 0)) {
+        free(iters);
+        free(heads);
+        free(heap);
+        free(base);
+        free(titleIters);
+        free(titleHeads);
+        free(titleHeap);
+        return -1;
+    }
+
+    int size = 0;
+    long numDocs = 0;
+    long numEntries = 0;
+    for (int f = 0; f < numFiles; f++) {
+        base[f] = numDocs;
+        numDocs += files[f].docs.size;
+        numEntries += files[f].numPostings;
+        initTreeIter(&iters[f], files[f].termTree);
+        heads[f] = nextTreeNode(&iters[f]);
+        if (heads[f] != NULL)
+            heap[size++] = f;
+    }
+    for (int i = size/2 - 1; i >= 0; i--)
+        siftDown(heap, size, i, heads);
+    int titleSize = 0;
+    for (int f = 0; fields != NULL && f < numFiles; f++) {
+        initTreeIter(&titleIters[f], files[f].titleTree);
+        titleHeads[f] = nextTreeNode(&titleIters[f]);
+        if (titleHeads[f] != NULL)
+            titleHeap[titleSize++] = f;
+    }
+    for (int i = titleSize/2 - 1; i >= 0; i--)
+        siftDown(titleHeap, titleSize, i, titleHeads);
+
+    OutBuffer dict;
+    OutBuffer post;
+    initOutBuffer(&dict, NULL);
+    initOutBuffer(&post, postFp);
+    fprintf(postFp, "%.15ld\n", numEntries);
+    long numTerms = 0;
+
+    while (size > 0) {
+        char *term = heads[heap[0]]->term;
+        long df = 0;
+
+        // Every file holding the term, lowest file first
+        while (size > 0 && strcmp(heads[heap[0]]->term, term) == 0) {
+            int f = heap[0];
+            Node *node = heads[f]->dictionary;
+            while (node != NULL) {
+                putLong(&post, base[f] + findDoc(&files[f].docs, node->docId));
+                putChar(&post, ' ');
+                putLong(&post, node->freq);
+                putChar(&post, '\n');
+                df++;
+                node = node->next;
             }
 
-            // Making sure document is not empty
-            if (metaTags == 2) {
-                freeDocNode(docs[docCount]); // Free the temp node
-                docs[docCount] = initDocNode(docId, docLine);
-                docCount++;
-                metaTags++;
+            heads[f] = nextTreeNode(&iters[f]);
+            if (heads[f] == NULL)
+                heap[0] = heap[--size];
+            siftDown(heap, size, 0, heads);
+        }
+
+        // Title words are indexed words too, a title term is always this term or a later one
+        if (fields != NULL)
+            fields->termStart[numTerms] = fields->numPostings;
+        while (titleSize > 0 && strcmp(titleHeads[titleHeap[0]]->term, term) == 0) {
+            int f = titleHeap[0];
+            for (Node *node = titleHeads[f]->dictionary; node != NULL; node = node->next) {
+                fields->docno[fields->numPostings] = base[f] + findDoc(&files[f].docs, node->docId);
+                fields->tf[fields->numPostings++] = node->freq;
             }
-            numTerms++;
+            titleHeads[f] = nextTreeNode(&titleIters[f]);
+            if (titleHeads[f] == NULL)
+                titleHeap[0] = titleHeap[--titleSize];
+            siftDown(titleHeap, titleSize, 0, titleHeads);
         }
 
-        // Found a newline
-        if (letter[0] == '\n')
-            lineNum++;
-
-        // Grab next word
-        buffer = strcpy(buffer,"\0");
-        letter[0] = fgetc(fp);
-        while ((letter[0] != ' ') && (letter[0] != '\n')){
-            if (letter[0] == EOF) {
-                free(buffer);
-                buffer = NULL;
-                break;
+        putString(&dict, term);
+        putChar(&dict, ' ');
+        putLong(&dict, df);
+        putChar(&dict, '\n');
+        numTerms++;
+    }
+
+    if (fields != NULL) {
+        fields->dictSize = numTerms;
+        fields->termStart[numTerms] = fields->numPostings;
+    }
+    fprintf(dictFp, "%ld\n", numTerms);
+    int ret = flushOutBuffer(&post);
+    if (dict.error || (ret == 0 && (long)fwrite(dict.data, 1, dict.size, dictFp) != dict.size))
+        ret = -1;
+
+    freeOutBuffer(&dict);
+    freeOutBuffer(&post);
+    free(iters);
+    free(heads);
+    free(heap);
+    free(base);
+    free(titleIters);
+    free(titleHeads);
+    free(titleHeap);
+    return ret;
+}
+
+/***
+    Opens an index file in a generation directory
+    @return : the file, NULL if it couldn't be created
+***/
+FILE *openIndexFile(const char *dir, const char *name) {
+    char *path = generationPath(dir, name);
+    if (path == NULL)
+        return NULL;
+    FILE *fp = fopen(path, "w+");
+    free(path);
+    return fp;
+}
+
+/***
+    Writes dictionary.txt, postings.txt, docids.txt and files.txt (and
+    impacts.bin with --impacts, snippets.bin with --snippets, fields.bin
+    with --fields, documents.bin with --store) for the indexed files into the generation
+    directory dir and publishes it,
+    timing the postings and write phases into stats
+    @return 0 : success
+    @return -1 : a file could not be written
+***/
+int writeIndex(FileIndex files[], int numFiles, BuildStats *stats, const char *dir) {
+    // Generate dictionary.txt and postings.txt
+    startPhase(stats);
+    FILE *dictFp = openIndexFile(dir, "dictionary.txt");
+    if (dictFp == NULL)
+        return -1;
+    FILE *postFp = openIndexFile(dir, "postings.txt");
+    if (postFp == NULL) {
+        fclose(dictFp);
+        return -1;
+    }
+    // The records are gathered in OUT_BUFFER pieces, stdio needn't copy them again
+    setvbuf(dictFp, NULL, _IONBF, 0);
+    setvbuf(postFp, NULL, _IONBF, 0);
+    FieldIndex fields;
+    memset(&fields, 0, sizeof(fields));
+    int ret = genIndex(dictFp, postFp, files, numFiles, withFields ? &fields : NULL);
+    endPhase(stats, BUILD_POSTINGS);
+    fclose(dictFp);
+    fclose(postFp);
+    if (ret == 0 && withFields && saveFields(dir, &fields) != 0) {
+        printf("Error writing %s of %s\n", FIELDS_FILE, dir);
+        ret = -1;
+    }
+    freeFields(&fields);
+    if (ret != 0)
+        return -1;
+
+    //Generate DocIds.txt
+    FILE *fp = openIndexFile(dir, "docids.txt");
+    if (fp == NULL)
+        return -1;
+    ret = genDocid(fp, files, numFiles);
+    if (fclose(fp) != 0 || ret != 0)
+        return -1;
+
+    //Generate Files.txt
+    fp = openIndexFile(dir, "files.txt");
+    if (fp == NULL)
+        return -1;
+    genFiles(fp, files, numFiles);
+    if (fclose(fp) != 0)
+        return -1;
+    if (withImpacts && writeImpacts(dir) != 0)
+        return -1;
+    if (withStore && writeBlockStore(dir) != 0)
+        return -1;
+    if (withSnippets && writeSnippets(dir) != 0)
+        return -1;
+
+    // A running retriever picks the new generation up from the manifest
+    ret = publishGeneration(dir);
+    endPhase(stats, BUILD_WRITE);
+    return ret;
+}
+
+/***
+    Writes the indexed files into a new generation and publishes it
+    @return 0 : success
+    @return -1 : the generation could not be written, nothing is published
+***/
+int writeGeneration(FileIndex files[], int numFiles, BuildStats *stats) {
+    char dir[GENERATION_NAME];
+    if (newGeneration(dir, sizeof(dir)) != 0)
+        return -1;
+    if (writeIndex(files, numFiles, stats, dir) != 0) {
+        removeGeneration(dir);
+        return -1;
+    }
+    return 0;
+}
+
+/***
+    Prints the build's timings and the memory held by the indexed files
+***/
+void reportBuild(BuildStats *stats, FileIndex files[], int numFiles) {
+    BuildMemory memory;
+    initBuildMemory(&memory);
+    for (int f = 0; f < numFiles; f++) {
+        addTreeMemory(&memory, files[f].termTree);
+        addDocTableMemory(&memory, &files[f].docs);
+    }
+    printBuildSummary(stats, &memory);
+}
+
+/***
+    Indexes a stream (stdin when path is "-") without prompting, copying it
+    to DOC_STORE in the new generation as it is read so that documents can
+    be viewed later
+    @return 0 : success
+    @return 1 : failure
+***/
+int indexStream(char *path) {
+    char dir[GENERATION_NAME];
+    if (newGeneration(dir, sizeof(dir)) != 0) {
+        printf("Error creating a generation directory\n");
+        return 1;
+    }
+    char *storePath = generationPath(dir, DOC_STORE);
+    FileIndex file;
+    initFileIndex(&file, storePath);
+    free(storePath);
+
+    FILE *fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (fp == NULL) {
+        printf("Error opening %s\n", path);
+        freeFileIndex(&file);
+        removeGeneration(dir);
+        return 1;
+    }
+    FILE *store = fopen(file.path, "w");
+    if (store == NULL) {
+        printf("Error creating %s\n", file.path);
+        if (fp != stdin)
+            fclose(fp);
+        freeFileIndex(&file);
+        removeGeneration(dir);
+        return 1;
+    }
+    setvbuf(fp, NULL, _IOFBF, STREAM_BUFFER);
+    setvbuf(store, NULL, _IOFBF, STREAM_BUFFER);
+
+    // Pipes have no size to estimate the time left from
+    struct stat info;
+    BuildStats stats;
+    initBuildStats(&stats, (fstat(fileno(fp), &info) == 0 && S_ISREG(info.st_mode)) ? info.st_size : 0);
+
+    file.numTerms = processStream(&file, fp, store, &stats);
+    if (fp != stdin)
+        fclose(fp);
+    int ret = (fclose(store) == 0 && file.numTerms >= 0) ? 0 : 1;
+    endPhase(&stats, BUILD_PARSE);
+    if (ret == 0)
+        ret = (writeIndex(&file, 1, &stats, dir) == 0) ? 0 : 1;
+    if (ret != 0) {
+        printf("Error processing stream.\n");
+        removeGeneration(dir);
+    } else {
+        reportBuild(&stats, &file, 1);
+    }
+
+    freeFileIndex(&file);
+    return ret;
+}
+
+/***
+    Work shared by the indexing threads, each takes the next unclaimed file
+***/
+typedef struct IndexQueue {
+    FileIndex *files;
+    int numFiles;
+    int next;
+    pthread_mutex_t lock;
+    BuildStats *stats;
+}IndexQueue;
+
+/***
+    Indexing thread, tokenizes files from the queue until none are left
+***/
+void *indexWorker (void *arg) {
+    IndexQueue *queue = arg;
+    while (1) {
+        pthread_mutex_lock(&queue->lock);
+        int f = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (f >= queue->numFiles)
+            break;
+        FileIndex *file = &queue->files[f];
+        file->numTerms = processDocs(file, queue->stats);
+    }
+    return NULL;
+}
+
+/***
+    Compare function for qsort, sorts paths by name
+***/
+int cmpPath (const void *pa, const void *pb) {
+    return strcmp(*(char**)pa, *(char**)pb);
+}
+
+/***
+    Adds path to the list of files to index. A directory adds each regular
+    file directly inside it (not hidden ones), sorted by name.
+    @return 0 : success
+    @return -1 : path could not be read
+***/
+int addPath (char ***paths, int *numPaths, int *cap, char *path) {
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return -1;
+
+    if (!S_ISDIR(info.st_mode)) {
+        if (*numPaths == *cap) {
+            *cap = (*cap == 0) ? 16 : *cap * 2;
+            *paths = realloc(*paths, sizeof(char*)*(*cap));
+        }
+        (*paths)[*numPaths] = malloc(sizeof(char)*((int)strlen(path)+1));
+        strcpy((*paths)[*numPaths], path);
+        (*numPaths)++;
+        return 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return -1;
+    int first = *numPaths;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.')
+            continue;
+        char *child = malloc(sizeof(char)*(strlen(path) + strlen(entry->d_name) + 2));
+        sprintf(child, "%s/%s", path, entry->d_name);
+        if (stat(child, &info) == 0 && S_ISREG(info.st_mode))
+            addPath(paths, numPaths, cap, child);
+        free(child);
+    }
+    closedir(dir);
+    qsort(*paths + first, *numPaths - first, sizeof(char*), cmpPath);
+    return 0;
+}
+
+/***
+    Indexes files and directories without prompting, one thread per core
+    tokenizes a file at a time, then the files are merged into one index
+    @return 0 : success
+    @return 1 : failure
+***/
+int indexFiles(char *args[], int numArgs) {
+    char **paths = NULL;
+    int numPaths = 0;
+    int cap = 0;
+    int ret = 0;
+
+    for (int i = 0; i < numArgs; i++) {
+        if (addPath(&paths, &numPaths, &cap, args[i]) != 0) {
+            printf("Error reading %s\n", args[i]);
+            ret = 1;
+        }
+    }
+    if (numPaths == 0)
+        ret = 1;
+
+    FileIndex *files = malloc(sizeof(FileIndex)*(numPaths > 0 ? numPaths : 1));
+    long totalBytes = 0;
+    for (int f = 0; f < numPaths; f++) {
+        initFileIndex(&files[f], paths[f]);
+        struct stat info;
+        if (stat(paths[f], &info) == 0)
+            totalBytes += info.st_size;
+    }
+
+    BuildStats stats;
+    initBuildStats(&stats, totalBytes);
+    if (ret == 0) {
+        IndexQueue queue;
+        queue.files = files;
+        queue.numFiles = numPaths;
+        queue.next = 0;
+        pthread_mutex_init(&queue.lock, NULL);
+        queue.stats = &stats;
+
+        long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (numThreads < 1)
+            numThreads = 1;
+        if (numThreads > numPaths)
+            numThreads = numPaths;
+        pthread_t *threads = malloc(sizeof(pthread_t)*numThreads);
+        for (long t = 0; t < numThreads; t++)
+            pthread_create(&threads[t], NULL, indexWorker, &queue);
+        for (long t = 0; t < numThreads; t++)
+            pthread_join(threads[t], NULL);
+        free(threads);
+        pthread_mutex_destroy(&queue.lock);
+
+        for (int f = 0; f < numPaths; f++) {
+            if (files[f].numTerms < 0) {
+                printf("Error processing %s\n", files[f].path);
+                ret = 1;
             }
-            buffer = strcat(buffer, letter);
-            letter[0] = fgetc(fp);
         }
+        endPhase(&stats, BUILD_PARSE);
+    }
+    if (ret == 0 && writeGeneration(files, numPaths, &stats) != 0) {
+        printf("Error processing files.\n");
+        ret = 1;
+    } else if (ret == 0) {
+        reportBuild(&stats, files, numPaths);
+    }
 
+    for (int f = 0; f < numPaths; f++) {
+        freeFileIndex(&files[f]);
+        free(paths[f]);
     }
+    free(files);
+    free(paths);
+    return ret;
+}
 
+/***
+    Reads the current generation and takes the lock of its deleted
+    documents. A generation published while waiting for it, by compaction
+    or an ingest flush, has the bitmap now, its lock is taken instead
+    @return >=0 : the lock, with the generation in dir
+    @return -1 : the manifest couldn't be read or the lock taken
+***/
+int lockCurrent(char *dir, size_t size) {
+    char current[GENERATION_NAME];
+    while (currentGeneration(dir, size) == 0) {
+        char *path = generationPath(dir, LIVE_DOCS_FILE);
+        int lock = (path != NULL) ? lockLiveDocs(path) : -1;
+        free(path);
+        if (lock < 0 || currentGeneration(current, sizeof(current)) != 0) {
+            unlockLiveDocs(lock);
+            return -1;
+        }
+        if (strcmp(current, dir) == 0)
+            return lock;
+        unlockLiveDocs(lock);
+    }
+    return -1;
+}
+
+/***
+    Marks documents deleted by docid without reindexing, the postings stay
+    in postings.txt until the index is compacted or rebuilt
+    @return 0 : success
+    @return 1 : failure
+***/
+int deleteDocids(char *docids[], int count) {
+    char dir[GENERATION_NAME];
+    int lock = lockCurrent(dir, sizeof(dir));
+    if (lock < 0) {
+        printf("Error reading %s\n", MANIFEST_FILE);
+        return 1;
+    }
+    char *path = generationPath(dir, "docids.txt");
+    FILE *fp = fopen(path, "r");
+    long numDocs = 0;
+    if (fp == NULL || fscanf(fp, "%ld", &numDocs) != 1) {
+        printf("Error loading %s\n", path);
+        if (fp != NULL)
+            fclose(fp);
+        free(path);
+        unlockLiveDocs(lock);
+        return 1;
+    }
+    free(path);
+
+    // The docids to delete, as a set
+    DocTable wanted;
+    initDocTable(&wanted);
+    for (int i = 0; i < count; i++)
+        addDoc(&wanted, docids[i], 0);
+
+    long *docnos = malloc(sizeof(long)*count);
+    char *found = calloc(count, sizeof(char));
+    long numFound = 0;
+    char docid [MAX_WORD+1];
+    int fileid = 0;
+    long line = 0;
+    for (long docno = 0; docno < numDocs && numFound < count; docno++) {
+        if (fscanf(fp, "%199s %d %ld", docid, &fileid, &line) != 3)
+            break;
+        long w = findDoc(&wanted, docid);
+        if (w >= 0 && !found[w]) {
+            found[w] = 1;
+            docnos[numFound++] = docno;
+        }
+    }
     fclose(fp);
-    free(docId);
-    return numTerms;
+
+    for (long w = 0; w < wanted.size; w++) {
+        if (!found[w])
+            printf("No document %s\n", getDocId(&wanted, w));
+    }
+    // The bitmap belongs to the generation its docnos are from
+    char *livePath = generationPath(dir, LIVE_DOCS_FILE);
+    long deleted = deleteDocs(livePath, numDocs, docnos, numFound);
+    if (deleted >= 0)
+        printf("Deleted %ld documents\n", deleted);
+    else
+        printf("Error writing %s\n", livePath);
+    unlockLiveDocs(lock);
+
+    free(livePath);
+    free(docnos);
+    free(found);
+    freeDocTable(&wanted);
+    return (deleted >= 0) ? 0 : 1;
 }
 
 /***
-    Creates the docids.txt file based off of the docs array.
-        <total number of documents>
-        <docid1> <start-position1>
-        <docid2> <start-position2>
+    Opens an index file of a generation for reading
+    @return : the file, NULL if it couldn't be opened
+***/
+FILE *readIndexFile(const char *dir, const char *name) {
+    char *path = generationPath(dir, name);
+    if (path == NULL)
+        return NULL;
+    FILE *fp = fopen(path, "r");
+    free(path);
+    return fp;
+}
+
+/***
+    Copies files.txt from one generation to another, adopting the files
+    kept inside the old generation into the new one
+    @return 0 : success
+    @return -1 : failure
 ***/
+int copyFiles(const char *from, const char *to) {
+    FILE *in = readIndexFile(from, "files.txt");
+    if (in == NULL)
+        return 0;
+    FILE *out = openIndexFile(to, "files.txt");
+    if (out == NULL) {
+        fclose(in);
+        return -1;
+    }
 
-int genDocid(FILE *fp, DocNode **docs) {
-    int numDocs = 0;
-    fprintf(fp,"      \n");
+    char *line = NULL;
+    size_t size = 0;
+    int ret = 0;
+    // The count line is copied as it is, like every path
+    while (ret == 0 && getline(&line, &size, in) != -1) {
+        line[strcspn(line, "\n")] = '\0';
+        char *path = adoptFile(from, to, line);
+        if (path == NULL)
+            ret = -1;
+        else
+            fprintf(out, "%s\n", path);
+        free(path);
+    }
+    free(line);
+    fclose(in);
+    if (fclose(out) != 0)
+        ret = -1;
+    return ret;
+}
 
-    for (int i = 0; i < 100000; i++) {
-        if (docs[i]->start != -1) {
-            fprintf(fp, "%s %d\n", docs[i]->docId, docs[i]->start);
-            numDocs++;
+/***
+    Writes dictionary.txt, postings.txt and docids.txt without the deleted
+    documents to a new generation, renumbering docnos and dropping terms
+    left with no documents. Impacts, snippets and fields are rewritten if
+    the index had them
+    @return 0 : success
+    @return 1 : failure
+***/
+int compactIndex() {
+    char dir[GENERATION_NAME];
+    char newDir[GENERATION_NAME];
+    // Held until the new generation is published, a delete waiting for it
+    // then goes to the new generation
+    int lock = lockCurrent(dir, sizeof(dir));
+    if (lock < 0) {
+        printf("Error reading %s\n", MANIFEST_FILE);
+        return 1;
+    }
+    if (newGeneration(newDir, sizeof(newDir)) != 0) {
+        printf("Error creating a generation directory\n");
+        unlockLiveDocs(lock);
+        return 1;
+    }
+    FILE *docIn = readIndexFile(dir, "docids.txt");
+    FILE *dictIn = readIndexFile(dir, "dictionary.txt");
+    FILE *postIn = readIndexFile(dir, "postings.txt");
+    FILE *docOut = openIndexFile(newDir, "docids.txt");
+    FILE *dictOut = openIndexFile(newDir, "dictionary.txt");
+    FILE *postOut = openIndexFile(newDir, "postings.txt");
+    char *livePath = generationPath(dir, LIVE_DOCS_FILE);
+    long numDocs = 0;
+    long dictSize = 0;
+    long postSize = 0;
+    int ret = 0;
+
+    if (docIn == NULL || dictIn == NULL || postIn == NULL || docOut == NULL || dictOut == NULL
+            || postOut == NULL || fscanf(docIn, "%ld", &numDocs) != 1
+            || fscanf(dictIn, "%ld", &dictSize) != 1 || fscanf(postIn, "%ld", &postSize) != 1) {
+        printf("Error opening the index files\n");
+        ret = 1;
+    }
+
+    LiveDocs live;
+    initLiveDocs(&live, numDocs);
+    if (ret == 0 && loadLiveDocs(&live, livePath) != 0) {
+        printf("Error loading %s\n", livePath);
+        ret = 1;
+    }
+
+    // Docnos of the live documents after compaction
+    long *newDocno = malloc(sizeof(long)*(numDocs > 0 ? numDocs : 1));
+    char docid [MAX_WORD+1];
+    int fileid = 0;
+    long line = 0;
+    long numLive = 0;
+    if (ret == 0)
+        fprintf(docOut, "%.6ld\n", numDocs - live.numDeleted);
+    for (long docno = 0; ret == 0 && docno < numDocs; docno++) {
+        if (fscanf(docIn, "%199s %d %ld", docid, &fileid, &line) != 3) {
+            ret = 1;
+            break;
+        }
+        newDocno[docno] = -1;
+        if (!isDeleted(&live, docno)) {
+            newDocno[docno] = numLive++;
+            fprintf(docOut, "%s %d %ld\n", docid, fileid, line);
         }
     }
-    fseek(fp, 0, SEEK_SET);
-    fprintf(fp,"%.6d\n", numDocs);
-    return 0;
+
+    // Counts are patched into the padded headers at the end
+    long numTerms = 0;
+    long numEntries = 0;
+    // Dictionary entries of the terms after compaction
+    long *newTerm = malloc(sizeof(long)*(dictSize > 0 ? dictSize : 1));
+    if (newTerm == NULL)
+        ret = 1;
+    if (ret == 0) {
+        fprintf(dictOut, "               \n");
+        fprintf(postOut, "               \n");
+    }
+    for (long t = 0; ret == 0 && t < dictSize; t++) {
+        long df = 0;
+        if (fscanf(dictIn, "%199s %ld", docid, &df) != 2) {
+            ret = 1;
+            break;
+        }
+        long newDf = 0;
+        for (long k = 0; k < df; k++) {
+            long docno = 0;
+            long tf = 0;
+            if (fscanf(postIn, "%ld %ld", &docno, &tf) != 2 || docno < 0 || docno >= numDocs) {
+                ret = 1;
+                break;
+            }
+            if (newDocno[docno] >= 0) {
+                fprintf(postOut, "%ld %ld\n", newDocno[docno], tf);
+                newDf++;
+            }
+        }
+        newTerm[t] = (newDf > 0) ? numTerms : -1;
+        if (newDf > 0) {
+            fprintf(dictOut, "%s %ld\n", docid, newDf);
+            numTerms++;
+            numEntries += newDf;
+        }
+    }
+    if (ret == 0) {
+        fseek(dictOut, 0, SEEK_SET);
+        fprintf(dictOut, "%.15ld\n", numTerms);
+        fseek(postOut, 0, SEEK_SET);
+        fprintf(postOut, "%.15ld\n", numEntries);
+    }
+
+    FILE *all [6] = {docIn, dictIn, postIn, docOut, dictOut, postOut};
+    for (int i = 0; i < 6; i++) {
+        if (all[i] != NULL && fclose(all[i]) != 0)
+            ret = 1;
+    }
+
+    // The documents' magnitudes change with the terms that are dropped
+    char *impactsPath = generationPath(dir, IMPACTS_FILE);
+    if (ret == 0 && (withImpacts || access(impactsPath, F_OK) == 0) && writeImpacts(newDir) != 0)
+        ret = 1;
+    free(impactsPath);
+    if (ret == 0 && copyFiles(dir, newDir) != 0)
+        ret = 1;
+    // A shard keeps the statistics of the index it was split from
+    if (ret == 0 && carryFile(dir, newDir, SHARD_STATS_FILE) != 0)
+        ret = 1;
+    // The corpus files may be gone, the documents are copied from the old store
+    char *storePath = generationPath(dir, STORE_FILE);
+    if (ret == 0 && access(storePath, F_OK) == 0) {
+        if (compactBlockStore(dir, newDir, numDocs, newDocno, numLive) != 0)
+            ret = 1;
+    } else if (ret == 0 && withStore && writeBlockStore(newDir) != 0) {
+        ret = 1;
+    }
+    free(storePath);
+    // Offsets are kept by docno, and the docnos were renumbered. Read out of
+    // the new store when there is one
+    char *snippetsPath = generationPath(dir, SNIPPETS_FILE);
+    if (ret == 0 && (withSnippets || access(snippetsPath, F_OK) == 0) && writeSnippets(newDir) != 0)
+        ret = 1;
+    free(snippetsPath);
+    char *fieldsPath = generationPath(dir, FIELDS_FILE);
+    if (ret == 0 && access(fieldsPath, F_OK) == 0
+            && compactFields(dir, newDir, numDocs, dictSize, newDocno, newTerm, numLive, numTerms) != 0)
+        ret = 1;
+    free(fieldsPath);
+    if (ret == 0 && publishGeneration(newDir) != 0)
+        ret = 1;
+    if (ret == 0) {
+        printf("Removed %ld deleted documents, %ld documents and %ld terms left\n",
+               live.numDeleted, numLive, numTerms);
+    } else {
+        printf("Error compacting the index\n");
+        removeGeneration(newDir);
+    }
+    unlockLiveDocs(lock);
+
+    free(livePath);
+    free(newDocno);
+    free(newTerm);
+    freeLiveDocs(&live);
+    return ret;
+}
+
+/***
+    Enters the directory of a shard, where its manifest and generations are
+    @return 0 : success
+    @return -1 : the directory couldn't be entered
+***/
+int enterShard(int shard) {
+    char name[GENERATION_NAME];
+    snprintf(name, sizeof(name), "%s%d", SHARD_PREFIX, shard);
+    return chdir(name);
+}
+
+/***
+    Runs a function of a generation in a shard's directory and comes back
+    to the directory top
+    @return : what run returned, -1 if the directory couldn't be entered
+***/
+int inShard(int top, int shard, int (*run)(const char *), const char *dir) {
+    if (enterShard(shard) != 0)
+        return -1;
+    int ret = run(dir);
+    if (fchdir(top) != 0)
+        return -1;
+    return ret;
 }
 
 /***
-    Generates postings.txt. Contains the document's number, based off
-        of its index in the docs array, and it's term frequency. Ordered by term.
-        Depth-First traversal of termTree
-    <docno1> <term-frequency1>
-    <docno2> <term-frequency2>
+    Absolute path of a file that no longer exists
+    @return : malloc'd path, NULL on failure
 ***/
-int genPostings(FILE *fp, TreeNode *termTree, DocNode **docs) {
-    if (termTree == NULL || docs == NULL)
+char *missingPath(const char *path) {
+    if (path[0] == '/') {
+        char *copy = malloc(strlen(path) + 1);
+        if (copy != NULL)
+            strcpy(copy, path);
+        return copy;
+    }
+    char *cwd = realpath(".", NULL);
+    char *absolute = (cwd != NULL) ? malloc(strlen(cwd) + strlen(path) + 2) : NULL;
+    if (absolute != NULL)
+        sprintf(absolute, "%s/%s", cwd, path);
+    free(cwd);
+    return absolute;
+}
+
+/***
+    Writes files.txt of a shard's generation from the index's. The paths
+    are made absolute since a shard is served from its own directory, and
+    files kept inside the index's generation are linked into the shard's
+    @return 0 : success
+    @return -1 : failure
+***/
+int shardFiles(const char *from, const char *to) {
+    FILE *in = readIndexFile(from, "files.txt");
+    if (in == NULL)
         return 0;
+    FILE *out = openIndexFile(to, "files.txt");
+    if (out == NULL) {
+        fclose(in);
+        return -1;
+    }
 
-    int totalEntries = 0;
-    int retVal = 0;
+    char *line = NULL;
+    size_t size = 0;
+    int count = 0;
+    int ret = (getline(&line, &size, in) != -1 && sscanf(line, "%d", &count) == 1) ? 0 : -1;
+    if (ret == 0)
+        fprintf(out, "%d\n", count);
+    for (int f = 0; ret == 0 && f < count && getline(&line, &size, in) != -1; f++) {
+        line[strcspn(line, "\n")] = '\0';
+        char *path = adoptFile(from, to, line);
+        char *absolute = (path != NULL) ? realpath(path, NULL) : NULL;
+        // A corpus file dropped for the store is named from where it was
+        if (absolute == NULL && path != NULL && errno == ENOENT)
+            absolute = missingPath(path);
+        if (absolute == NULL) {
+            printf("Error resolving %s\n", line);
+            ret = -1;
+        } else {
+            fprintf(out, "%s\n", absolute);
+        }
+        free(path);
+        free(absolute);
+    }
+    free(line);
+    fclose(in);
+    if (fclose(out) != 0)
+        ret = -1;
+    return ret;
+}
 
-    // Left Side Traversal
-    while (termTree->left != NULL && retVal == 0) {
-        retVal = genPostings(fp, termTree->left, docs);
+/***
+    Splits the published index into numShards shards of contiguous runs of
+    its live documents, leaving the deleted ones out. Each shard.<k>
+    directory gets a generation of its own with the shard's dictionary,
+    postings, docids and files, and SHARD_STATS_FILE with the document
+    count and dfs of the whole index, which its retriever weighs terms by
+    so the scores of different shards compare:
+        <documents> <terms in the documents>
+        <total number of terms>
+        <term1> <document-frequency1>
+    Snippets are rewritten for the shards if the index had them, and the
+    store of documents is split, impacts and fields are not. The shards are
+    published once all of them are written. If publishing one fails, the
+    shards before it are left on the new split and the rest on their old
+    one, with mixed statistics
+    @return 0 : success
+    @return 1 : failure
+***/
+int shardIndex(int numShards) {
+    char dir[GENERATION_NAME];
+    if (currentGeneration(dir, sizeof(dir)) != 0) {
+        printf("Error reading %s\n", MANIFEST_FILE);
+        return 1;
     }
-    totalEntries += retVal;
+    int top = open(".", O_RDONLY);
+    char (*gens)[GENERATION_NAME] = calloc(numShards, GENERATION_NAME);
+    char (*paths)[2*GENERATION_NAME] = calloc(numShards, 2*GENERATION_NAME);
+    FILE **docOut = calloc(numShards, sizeof(FILE*));
+    FILE **dictOut = calloc(numShards, sizeof(FILE*));
+    FILE **postOut = calloc(numShards, sizeof(FILE*));
+    long *shardDocs = calloc(numShards, sizeof(long));
+    long *shardTerms = calloc(numShards, sizeof(long));
+    long *shardEntries = calloc(numShards, sizeof(long));
+    long *shardDf = calloc(numShards, sizeof(long));
+    int ret = (top >= 0 && gens != NULL && paths != NULL && docOut != NULL && dictOut != NULL
+               && postOut != NULL && shardDocs != NULL && shardTerms != NULL
+               && shardEntries != NULL && shardDf != NULL) ? 0 : 1;
 
-    // Print the node's posting
-    Node *node = termTree->dictionary;
-    while (node != NULL) {
-        int index = 0;
-        for (index = 0; index < 10000000; index++) {
-            if (strcmp(docs[index]->docId, node->docId) == 0)
+    // Each shard's next generation, in its own directory
+    int created = 0;
+    for (int s = 0; ret == 0 && s < numShards; s++) {
+        snprintf(paths[s], sizeof(paths[s]), "%s%d", SHARD_PREFIX, s);
+        int made = -1;
+        if ((mkdir(paths[s], 0755) == 0 || errno == EEXIST) && enterShard(s) == 0) {
+            made = newGeneration(gens[s], GENERATION_NAME);
+            if (fchdir(top) != 0)
+                made = -1;
+        }
+        if (made != 0) {
+            printf("Error creating a generation in %s\n", paths[s]);
+            ret = 1;
+            break;
+        }
+        created++;
+        snprintf(paths[s], sizeof(paths[s]), "%s%d/%s", SHARD_PREFIX, s, gens[s]);
+        docOut[s] = openIndexFile(paths[s], "docids.txt");
+        dictOut[s] = openIndexFile(paths[s], "dictionary.txt");
+        postOut[s] = openIndexFile(paths[s], "postings.txt");
+        if (docOut[s] == NULL || dictOut[s] == NULL || postOut[s] == NULL)
+            ret = 1;
+    }
+
+    FILE *docIn = readIndexFile(dir, "docids.txt");
+    FILE *dictIn = readIndexFile(dir, "dictionary.txt");
+    FILE *postIn = readIndexFile(dir, "postings.txt");
+    FILE *statsOut = (ret == 0) ? openIndexFile(paths[0], SHARD_STATS_FILE) : NULL;
+    char *livePath = generationPath(dir, LIVE_DOCS_FILE);
+    long numDocs = 0;
+    long dictSize = 0;
+    long postSize = 0;
+    if (ret == 0 && (docIn == NULL || dictIn == NULL || postIn == NULL || statsOut == NULL
+                     || fscanf(docIn, "%ld", &numDocs) != 1 || fscanf(dictIn, "%ld", &dictSize) != 1
+                     || fscanf(postIn, "%ld", &postSize) != 1)) {
+        printf("Error opening the index files\n");
+        ret = 1;
+    }
+
+    LiveDocs live;
+    initLiveDocs(&live, numDocs);
+    if (ret == 0 && loadLiveDocs(&live, livePath) != 0) {
+        printf("Error loading %s\n", livePath);
+        ret = 1;
+    }
+
+    // The shard of every live document and its docno there
+    long numLive = numDocs - live.numDeleted;
+    int *shardOf = malloc(sizeof(int)*(numDocs > 0 ? numDocs : 1));
+    long *newDocno = malloc(sizeof(long)*(numDocs > 0 ? numDocs : 1));
+    if (shardOf == NULL || newDocno == NULL)
+        ret = 1;
+    for (long docno = 0, j = 0; ret == 0 && docno < numDocs; docno++) {
+        shardOf[docno] = -1;
+        if (isDeleted(&live, docno))
+            continue;
+        int s = (int)(j++ * numShards / numLive);
+        shardOf[docno] = s;
+        newDocno[docno] = shardDocs[s]++;
+    }
+    for (int s = 0; ret == 0 && s < numShards; s++)
+        fprintf(docOut[s], "%.6ld\n", shardDocs[s]);
+    char docid [MAX_WORD+1];
+    int fileid = 0;
+    long line = 0;
+    for (long docno = 0; ret == 0 && docno < numDocs; docno++) {
+        if (fscanf(docIn, "%199s %d %ld", docid, &fileid, &line) != 3) {
+            ret = 1;
+            break;
+        }
+        if (shardOf[docno] >= 0)
+            fprintf(docOut[shardOf[docno]], "%s %d %ld\n", docid, fileid, line);
+    }
+
+    // Counts are patched into the padded headers at the end
+    long numTerms = 0;
+    long numTokens = 0;
+    if (ret == 0) {
+        fprintf(statsOut, "                               \n               \n");
+        for (int s = 0; s < numShards; s++) {
+            fprintf(dictOut[s], "               \n");
+            fprintf(postOut[s], "               \n");
+        }
+    }
+    for (long t = 0; ret == 0 && t < dictSize; t++) {
+        long df = 0;
+        if (fscanf(dictIn, "%199s %ld", docid, &df) != 2) {
+            ret = 1;
+            break;
+        }
+        long liveDf = 0;
+        for (long k = 0; k < df; k++) {
+            long docno = 0;
+            long tf = 0;
+            if (fscanf(postIn, "%ld %ld", &docno, &tf) != 2 || docno < 0 || docno >= numDocs) {
+                ret = 1;
                 break;
+            }
+            int s = shardOf[docno];
+            if (s >= 0) {
+                fprintf(postOut[s], "%ld %ld\n", newDocno[docno], tf);
+                shardDf[s]++;
+                liveDf++;
+                numTokens += tf;
+            }
+        }
+        for (int s = 0; s < numShards; s++) {
+            if (shardDf[s] > 0) {
+                fprintf(dictOut[s], "%s %ld\n", docid, shardDf[s]);
+                shardTerms[s]++;
+                shardEntries[s] += shardDf[s];
+                shardDf[s] = 0;
+            }
+        }
+        if (liveDf > 0) {
+            fprintf(statsOut, "%s %ld\n", docid, liveDf);
+            numTerms++;
+        }
+    }
+    if (ret == 0) {
+        fseek(statsOut, 0, SEEK_SET);
+        fprintf(statsOut, "%.15ld %.15ld\n%.15ld\n", numLive, numTokens, numTerms);
+        for (int s = 0; s < numShards; s++) {
+            fseek(dictOut[s], 0, SEEK_SET);
+            fprintf(dictOut[s], "%.15ld\n", shardTerms[s]);
+            fseek(postOut[s], 0, SEEK_SET);
+            fprintf(postOut[s], "%.15ld\n", shardEntries[s]);
         }
-        fprintf(fp,"%d %d\n", index, node->freq);
-        totalEntries++;
-        node = node->next;
     }
 
-    retVal = 0;
+    FILE *in [3] = {docIn, dictIn, postIn};
+    for (int i = 0; i < 3; i++) {
+        if (in[i] != NULL)
+            fclose(in[i]);
+    }
+    if (statsOut != NULL && fclose(statsOut) != 0)
+        ret = 1;
+    for (int s = 0; docOut != NULL && dictOut != NULL && postOut != NULL && s < numShards; s++) {
+        FILE *out [3] = {docOut[s], dictOut[s], postOut[s]};
+        for (int i = 0; i < 3; i++) {
+            if (out[i] != NULL && fclose(out[i]) != 0)
+                ret = 1;
+        }
+    }
 
-    // Right Side Traversal
-    while (termTree->right != NULL && retVal == 0) {
-        retVal = genPostings(fp, termTree->right, docs);
+    // Every shard gets the same statistics, and the corpus files with their paths resolved
+    for (int s = 1; ret == 0 && s < numShards; s++) {
+        if (carryFile(paths[0], paths[s], SHARD_STATS_FILE) != 0)
+            ret = 1;
+    }
+    for (int s = 0; ret == 0 && s < numShards; s++) {
+        if (shardFiles(dir, paths[s]) != 0)
+            ret = 1;
+    }
+    // Each shard's documents out of the store, or the corpus files without one
+    char *storePath = generationPath(dir, STORE_FILE);
+    int stored = access(storePath, F_OK) == 0;
+    long *storeDocno = (stored && ret == 0) ? malloc(sizeof(long)*(numDocs > 0 ? numDocs : 1)) : NULL;
+    if (stored && storeDocno == NULL)
+        ret = 1;
+    for (int s = 0; ret == 0 && (stored || withStore) && s < numShards; s++) {
+        for (long docno = 0; stored && docno < numDocs; docno++)
+            storeDocno[docno] = (shardOf[docno] == s) ? newDocno[docno] : -1;
+        if (stored ? compactBlockStore(dir, paths[s], numDocs, storeDocno, shardDocs[s]) != 0
+                   : writeBlockStore(paths[s]) != 0)
+            ret = 1;
+    }
+    free(storeDocno);
+    free(storePath);
+    // Offsets are kept by docno, and the docnos were renumbered. Read out of
+    // the new store when there is one
+    char *snippetsPath = generationPath(dir, SNIPPETS_FILE);
+    int snippets = withSnippets || access(snippetsPath, F_OK) == 0;
+    for (int s = 0; ret == 0 && snippets && s < numShards; s++) {
+        if (inShard(top, s, writeSnippets, gens[s]) != 0)
+            ret = 1;
+    }
+    free(snippetsPath);
+    // Every shard is written before any is published, the ones published
+    // are served and mustn't be removed
+    int published = 0;
+    for (int s = 0; ret == 0 && s < numShards; s++) {
+        if (inShard(top, s, publishGeneration, gens[s]) != 0)
+            ret = 1;
+        else
+            published++;
+    }
+    if (ret == 0) {
+        printf("Split %ld documents and %ld terms into %d shards\n", numLive, numTerms, numShards);
+    } else {
+        printf("Error splitting the index into shards\n");
+        if (published > 0)
+            printf("%d of %d shards have the new split and the others their old one, their"
+                   " statistics differ until the index is split again\n", published, numShards);
+        for (int s = published; s < created; s++)
+            removeGeneration(paths[s]);
     }
-    totalEntries += retVal;
 
-    return totalEntries;
+    if (top >= 0)
+        close(top);
+    free(livePath);
+    free(shardOf);
+    free(newDocno);
+    free(gens);
+    free(paths);
+    free(docOut);
+    free(dictOut);
+    free(postOut);
+    free(shardDocs);
+    free(shardTerms);
+    free(shardEntries);
+    free(shardDf);
+    freeLiveDocs(&live);
+    return ret;
 }
 
 int main (int argc, char *argv[]){
-    char *buffer = malloc(sizeof(char)*200);
-    TreeNode *termTree = NULL;
-    DocNode (**docs) = malloc(sizeof(DocNode)*999999);
-    int numTerms = 0;
+    // The other modes read their arguments as if the leading flags weren't there
+    while (argc >= 2 && (strcmp(argv[1], "--impacts") == 0 || strcmp(argv[1], "--snippets") == 0
+                         || strcmp(argv[1], "--fields") == 0 || strcmp(argv[1], "--store") == 0)) {
+        if (strcmp(argv[1], "--impacts") == 0)
+            withImpacts = 1;
+        else if (strcmp(argv[1], "--snippets") == 0)
+            withSnippets = 1;
+        else if (strcmp(argv[1], "--fields") == 0)
+            withFields = 1;
+        else
+            withStore = 1;
+        argv++;
+        argc--;
+    }
 
-    for (int i = 0; i < 999999; i++) {
-        docs[i] = initDocNode("replace", -1);
+    // Non-interactive modes
+    if (argc >= 3 && strcmp(argv[1], "--delete") == 0)
+        return deleteDocids(argv + 2, argc - 2);
+    if (argc == 2 && strcmp(argv[1], "--compact") == 0)
+        return compactIndex();
+    if (argc == 3 && strcmp(argv[1], "--shards") == 0) {
+        int numShards = atoi(argv[2]);
+        if (numShards < 1 || numShards > MAX_SHARDS) {
+            printf("Shards must be 1 to %d\n", MAX_SHARDS);
+            return 1;
+        }
+        return shardIndex(numShards);
     }
+    if (argc == 2 && strcmp(argv[1], "-") == 0)
+        return indexStream("-");
+    if (argc == 3 && strcmp(argv[1], "--stream") == 0)
+        return indexStream(argv[2]);
+    if (argc >= 2)
+        return indexFiles(argv + 1, argc - 1);
+
+    char *buffer = malloc(sizeof(char)*200);
+    FileIndex *files = NULL;
+    int numFiles = 0;
+
     // Command loop
     while (1) {
         printf("What would you like to do?\n \
@@ -281,77 +1527,63 @@ int main (int argc, char *argv[]){
                 q - Quit\n");
         int ret = scanf("%s", buffer);
         if (ret == 0) {
-            free(buffer);
-            for (int i = 100000-1; i >= 0; i--) {
-                freeDocNode(docs[i]);
-            }
-            free(docs);
-            return 1;
+            break;
         }
 
         if (strcmp(buffer, "q") == 0){
             break;
 
         } else if (strcmp(buffer, "2") == 0) {
-            if (termTree == NULL) {
+            if (numFiles == 0) {
                 printf("Tree is empty\n");
                 continue;
             }
-            printTree(termTree);
+            for (int f = 0; f < numFiles; f++) {
+                if (files[f].termTree != NULL)
+                    printTree(files[f].termTree);
+            }
 
         } else if (strcmp(buffer, "3") == 0) {
-            for (int i = 0; i < 100000; i++) {
-                if (docs[i]->start != -1)
-                    printf("DocNo: %s | LineNumber: %d\n", docs[i]->docId, docs[i]->start);
+            for (int f = 0; f < numFiles; f++) {
+                for (long i = 0; i < files[f].docs.size; i++) {
+                    printf("DocNo: %s | File: %s | LineNumber: %ld\n", getDocId(&files[f].docs, i),
+                           files[f].path, files[f].docs.start[i]);
+                }
             }
             continue;
 
         } else if (strcmp(buffer, "1") == 0){
+            // Each file processed is added to the index
             printf("Enter the filename of file to process...\n");
             char *filename = malloc(sizeof(char)*500);
-            if (scanf("%s", filename) == 0) {
+            if (scanf("%499s", filename) != 1) {
                 free(filename);
-                free(buffer);
-                for (int i = 100000-1; i >= 0; i--) {
-                    freeDocNode(docs[i]);
-                }
-                free(docs);
+                break;
             }
-            numTerms = processDocs(&termTree, docs, filename);
+            files = realloc(files, sizeof(FileIndex)*(numFiles+1));
+            initFileIndex(&files[numFiles], filename);
             free(filename);
-            if ( numTerms == -1) {
+            FileIndex *file = &files[numFiles];
+            numFiles++;
+
+            struct stat info;
+            BuildStats stats;
+            initBuildStats(&stats, (stat(file->path, &info) == 0) ? info.st_size : 0);
+            file->numTerms = processDocs(file, &stats);
+            endPhase(&stats, BUILD_PARSE);
+            if (file->numTerms == -1 || writeGeneration(files, numFiles, &stats) != 0) {
                 printf("Error processing files.\n");
-                return 1;
+                numFiles--;
+                freeFileIndex(file);
+            } else {
+                reportBuild(&stats, files, numFiles);
             }
-
-            // Generate dictionary.txt
-            FILE *fp = fopen("dictionary.txt", "w+");
-            fprintf(fp, "%d\n", countTreeNodes(termTree));
-            genDictionary( fp, termTree );
-            fclose(fp);
-
-            //Generate Postings.txt
-            fp = fopen("postings.txt", "w+");
-            fprintf(fp, "               \n");
-            int numEntries = genPostings(fp, termTree, docs);
-            fseek(fp, 0, SEEK_SET);
-            fprintf(fp, "%.15d\n", numEntries);
-            fclose(fp);
-
-            //Generate DocIds.txt
-            fp= fopen("docids.txt","w+");
-            genDocid(fp, docs);
-            fclose(fp);
-
         }
     }
 
     free(buffer);
-    if (termTree != NULL)
-        freeTree(termTree);
-    for (int i = 100000-1; i >= 0; i--) {
-        freeDocNode(docs[i]);
-    }
-    free(docs);
+    for (int f = 0; f < numFiles; f++)
+        freeFileIndex(&files[f]);
+    free(files);
     return 0;
 }
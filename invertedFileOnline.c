@@ -17,8 +17,67 @@ Description: Loads the 3 files created during the "online" mode %ldo memory and
 
                 - docids.txt
                     <total number of documents>
-                    <docid1> <start-position1>
-                    <docid2> <start-position2>
+                    <docid1> <file-id1> <start-position1>
+                    <docid2> <file-id2> <start-position2>
+
+                - files.txt (optional, the filename is asked for without it)
+                    <total number of files>
+                    <path1>
+Usage: retriever [--explain] [--batch] [--metrics path [--metrics-interval seconds]] [--no-warmup]
+                 [--no-reload] [--ingest path [--refresh seconds] [--flush seconds]]
+                 [--max-postings n] [--deadline ms] [--snippets]
+                 [--title-only] [--title-weight w] [--model tfidf|bm25|bm25f [--k1 k1] [--b b]]
+                 [--shards n | --shard socket ... | --serve-shard socket]
+             --explain : print where each query spent its time after its results
+             --batch   : read queries from stdin, one per line, and print the top
+                         10 results of each without prompting. With --explain
+                         each query is printed as a JSON line with its profile
+             --metrics : write the query, lookup and title metrics to path in
+                         the Prometheus text format every 10 seconds (or
+                         --metrics-interval) and on exit
+             --no-warmup : don't read ahead the corpus pages of the terms in
+                         hotterms.txt at startup. The most queried terms are
+                         saved to hotterms.txt every 1000 queries by the
+                         reload thread and on exit
+             --no-reload : keep serving the index loaded at startup. Otherwise a
+                         generation published by the indexer is loaded in the
+                         background and swapped in between queries
+             --ingest  : index the $DOC documents written to path, a named
+                         pipe or a file that's appended to, while serving.
+                         They're searchable within a second (or --refresh)
+                         and written to a new generation every 60 seconds
+                         (or --flush) and on exit. The input is copied to
+                         ingest.txt, which titles are read from
+             --max-postings, --deadline : evaluate each query over the
+                         impact-ordered postings written by indexer --impacts,
+                         highest impacts first, stopping after n postings or
+                         ms milliseconds. Results cut short are flagged
+             --snippets : print under each result the passage of its document
+                         with the most query terms, cut with the token
+                         offsets written by indexer --snippets
+             --title-only : match queries against the documents' titles
+                         alone, scanning the title postings written by
+                         indexer --fields
+             --title-weight : count each occurrence of a query term in a
+                         title w times, with the title postings written by
+                         indexer --fields. bm25f weighs the title field by w
+             --model   : score documents by the cosine similarity of their
+                         tf-idf vectors (the default), by BM25 normalized by
+                         their lengths, or by BM25F over their titles and
+                         bodies with the fields written by indexer --fields.
+                         --k1 and --b set BM25's saturation (1.2) and length
+                         normalization (0.75)
+             --shards  : search an index split by indexer --shards n. A
+                         worker process serves each shard.<k> directory on
+                         shard.<k>/shard.sock and every query is sent to all
+                         of them at once, their results merged by score.
+                         Shards that don't answer are left out of the results
+             --shard   : search with the workers already listening on these
+                         sockets, one --shard for each
+             --serve-shard : serve the index in the current directory as a
+                         shard's worker on socket until SIGTERM or SIGINT
+             The retriever is a client of libinvertedfile (invertedfile.h),
+             which programs can link to search an index in process
 Tested: 0 memory leaks , but error from 1 line
 */
 
@@ -37,567 +96,466 @@ Tested: 0 memory leaks , but error from 1 line
 #include <string.h>
 #endif
 
-#ifndef INDEXES_H_INCLUDED
-#define INDEXES_H_INCLUDED
-#include "indexes.h"
+#ifndef INVERTEDFILE_H_INCLUDED
+#define INVERTEDFILE_H_INCLUDED
+#include "invertedfile.h"
 #endif
 
-#ifndef MATH_H_INCLUDED
-#define MATH_H_INCLUDED
-#include <math.h>
+#ifndef METRICS_H_INCLUDED
+#define METRICS_H_INCLUDED
+#include "metrics.h"
 #endif
 
+#ifndef SHARDS_H_INCLUDED
+#define SHARDS_H_INCLUDED
+#include "shards.h"
+#endif
 
-/***
-    Compare function for qsort
-***/
-int cmp (const void *pa, const void *pb) {
-    const double *a = *(double**)pa;
-    const double *b = *(double**)pb;
-    if (a[1] > b[1])
-        return -1;
-    if (a[1] < b[1])
-        return 1;
-    return 0;
-}
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
 
-/***
-    Multiply two vectors of the same length
-***/
-double dotProduct (double vOne[], double vTwo[], long size) {
-    double product = 0;
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
 
-    for (long i = 0; i < size; i++) {
-        product += vOne[i] * vTwo[i];
-    }
+#ifndef WAIT_H_INCLUDED
+#define WAIT_H_INCLUDED
+#include <sys/wait.h>
+#endif
 
-    return product;
-}
+#ifdef __linux__
+#ifndef PRCTL_H_INCLUDED
+#define PRCTL_H_INCLUDED
+#include <sys/prctl.h>
+#endif
+#endif
+
+#define BATCH_RESULTS 10
+#define PAGE_RESULTS 10
 
 /***
-    Normalize/find magnitude of same length vectors
+    Print a string as a JSON string literal
 ***/
-double normalize (double vectorOne[], double vectorTwo[], long size) {
-    double result = dotProduct(vectorOne, vectorTwo, size);
-    result = sqrt(result);
-    return result;
+static void printJsonString (FILE *fp, const char *str) {
+    fputc('"', fp);
+    for (; *str != '\0'; str++) {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c == '\n')
+            fprintf(fp, "\\n");
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
 }
 
 /***
-    Calculates the term frequency - inverse document frequency
-    @return >=0 : document relevancy
-                    closer to 0 = appears a lot
-                    closer to infinity appears little if at all
+    Answer queries from stdin, one per line, with their top results
 ***/
-double tfidf (double tf, long totalDocs, long df) {
-    if (df == 0)
-        return 10000;
-    return ((double)tf * log2((double)totalDocs/(double)df));
+static void runBatch (SearchEngine *engine, int explain, int snippets) {
+    char *input = NULL;
+    size_t size = 0;
+    ssize_t length;
+    SearchResult *results = malloc(sizeof(SearchResult)*BATCH_RESULTS);
+    if (results == NULL)
+        return;
+
+    while ((length = getline(&input, &size, stdin)) != -1) {
+        if (length > 0 && input[length-1] == '\n')
+            input[--length] = '\0';
+        if (length == 0)
+            continue;
+
+        QueryProfile profile;
+        initProfile(&profile);
+        int count = searchPage(engine, input, 0, BATCH_RESULTS, results, NULL, explain ? &profile : NULL);
+
+        if (explain) {
+            printf("{\"query\":");
+            printJsonString(stdout, input);
+            printf(",\"results\":[");
+        } else {
+            printf("Query: %s\n", input);
+        }
+        for (int i = 0; i < count; i++) {
+            // Titles keep the newline from the corpus
+            char *title = results[i].title;
+            size_t end = strlen(title);
+            while (end > 0 && (title[end-1] == '\n' || title[end-1] == ' '))
+                title[--end] = '\0';
+            if (explain) {
+                printf("%s{\"rank\":%d,\"docid\":", i > 0 ? "," : "", i+1);
+                printJsonString(stdout, results[i].docid);
+                printf(",\"score\":%.6f,\"title\":", results[i].score);
+                printJsonString(stdout, title);
+                if (snippets) {
+                    printf(",\"snippet\":");
+                    printJsonString(stdout, results[i].snippet);
+                }
+                printf("}");
+            } else {
+                printf("%d %s %.6f %s\n", i+1, results[i].docid, results[i].score, title);
+                if (snippets && results[i].snippet[0] != '\0')
+                    printf("    %s\n", results[i].snippet);
+            }
+        }
+        if (explain) {
+            printf("],\"profile\":");
+            printProfileJson(stdout, &profile);
+            printf("}\n");
+        }
+    }
+    free(results);
+    free(input);
 }
 
 /***
-    Binary search to locate a string in a dictionary index
-    @return >=0 : index of term in the dictionary
-    @return -1 : term not found
+    Print a result's document from its $DOC line up to the next document
 ***/
-long searchIndex ( DictIndex index[], long length, char *term) {
-    long middle = (long)(length/2);
-    long max = length;
-    long min = 0;
-
-    while (1) {
-        long cmp = strcasecmp(term, index[middle].term);
-        if (cmp == 0) {
-            return middle;
-        } else if ( min == max || (min == middle && max == middle)) {
-            // No term found
-            break;
-        } else if ( cmp < 0 ) {
-            // BinarySearch moving down
-            max = middle;
-            middle = (min+max)/2;
-
-        } else if (cmp > 0 ) {
-            // BinarySearch moving up
-            min = middle + 1;
-            middle = (max +middle)/2 + 1;
-        }
+static void printDocument (SearchEngine *engine, SearchResult *result) {
+    char *text = readDocument(engine, result);
+    if (text == NULL) {
+        printf("Could not read %s\n", result->docid);
+        return;
     }
-
-    return -1;
+    fputs(text, stdout);
+    free(text);
 }
 
-
 /***
-    Perform a weighted retrieval of relevant documents
-    @return : array of relevant documents, with corresponding weights and ranking
+    Ask for the file to search when the index has no files.txt
+    @return : malloc'd path, NULL if it can't be opened
 ***/
-double **retrieveResults (char *query, double docTermVector[], DictIndex dictIndex[], PostIndex postIndex[],
-                    DocIndex docIndex[], long dictSize, long postSize, long numDocs) {
-
-    // Calculate weighted vector of query
-    double *queryVector = malloc(sizeof(double)*(long)strlen(query));
-    char *buffer;
-    char *delims = " \n";
-    char *token = malloc(sizeof(char)*(long)strlen(query)+1);
-    long queryCounter = 0;
-    char *uniqueTokens = malloc(sizeof(char)*(long)strlen(query)+1);
-    uniqueTokens = strcpy(uniqueTokens, "\0");
-    double maxTf = 0;
-
-    // Count the most frequent word and remove duplicates
-    token = strcpy(token, query);
-    buffer = strtok(token, delims);
-    while (buffer != NULL) {
-        double tf = 0;
-
-        // Count the tf in the query
-        char *temp = query;
-        temp = strstr(temp, buffer);
-        while (temp != NULL) {
-            tf++;
-            temp++;
-            temp = strstr(temp, buffer);
-        }
-
-        char *tmp2 = strstr(uniqueTokens, buffer);
-        if ( tmp2 == NULL) {
-            uniqueTokens = strcat(uniqueTokens, buffer);
-            uniqueTokens = strcat(uniqueTokens, " ");
-            queryVector[queryCounter] = tf;
-            queryCounter++;
-        }
-
-        if (tf > maxTf)
-            maxTf = tf;
-        buffer = strtok(NULL, delims);
+static char *askCorpus (void) {
+    char *filename = malloc(sizeof(char)*500);
+    printf("Enter the filename to search through: \n");
+    if (fgets(filename,499,stdin) == NULL) {
+        free(filename);
+        return NULL;
     }
-    uniqueTokens = strcat(uniqueTokens, "\0");
-    token = strcpy(token, uniqueTokens);
-    buffer = strtok(token, delims);
-
-    // Go through all the words for the query
-    for (long i = 0; i < queryCounter; i++) {
-        long result = searchIndex( dictIndex, dictSize - 1, buffer);
-        // Assign vector weights
-        if (result >= 0) {
-            queryVector[i] =  tfidf(queryVector[i]/maxTf, numDocs, dictIndex[result].df);
-        } else {
-            queryVector[i] = 0;
-        }
 
-        buffer = strtok(NULL, delims);
+    filename[strlen(filename)-1] = '\0';  // Remove newline
+    FILE *test = fopen(filename, "r");
+    if (test == NULL){
+        printf("Invalid file name/path\n");
+        free(filename);
+        return NULL;
     }
+    fclose(test);
+    return filename;
+}
 
-    queryVector = realloc(queryVector, sizeof(double)*queryCounter);
-    token = strcpy(token, uniqueTokens);
-
-    // Calculate the weighted vectors of each document
-    double docMatrix[numDocs];
-
-    buffer = strtok(token, delims);
-
-    // Initialize vectors with 0 (Better way?)
-    for (long i = 0; i < numDocs; i++)
-        docMatrix[i] = 0;
+static volatile sig_atomic_t stopServing = 0;
+static pid_t workers[MAX_SHARDS];
+static char *workerSockets[MAX_SHARDS];
+static int numWorkers = 0;
 
-    // Calculate document vectors
-    for (long i = 0; i < queryCounter; i++) {
-        long result = searchIndex( dictIndex, dictSize - 1, buffer);
+static void stopShard (int sig) {
+    (void)sig;
+    stopServing = 1;
+}
 
-        // Check if the query word exists in a document
-        if (result >= 0) {
-            long df = dictIndex[result].df;
-            long pindice = dictIndex[result].postIndex;
+/***
+    Serve the index in the current directory as a shard's worker until
+    SIGTERM or SIGINT
+    @return : exit status
+***/
+static int runShard (SearchOptions *options, const char *socketPath) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopShard;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    // A coordinator that went away mustn't kill the worker mid-reply
+    signal(SIGPIPE, SIG_IGN);
+
+    // Pages are fetched by the coordinator, there's no next one to read ahead
+    options->prefetch = 0;
+    SearchEngine *engine = openSearchEngine(options);
+    if (engine == NULL)
+        return 1;
+    int ret = serveShard(engine, socketPath, &stopServing);
+    closeSearchEngine(engine);
+    return (ret == 0) ? 0 : 1;
+}
 
-            // Loop through all docs that the word appears in
-            for (long k = pindice; (k < pindice + df) ; k++) {
-                //Locate word in dictionary and calculate it's cumulative dot product
-                double tfidfResult = tfidf((double)postIndex[k].tf, numDocs, df);
-                docMatrix[postIndex[k].docno] +=  tfidfResult * queryVector[i];
+/***
+    Start a worker for each shard.<k> directory of an index split by
+    indexer --shards, pointing options at their sockets
+    @return 0 : started
+    @return -1 : a worker couldn't be started, those that were are stopped
+***/
+static int startShards (SearchOptions *options, int numShards) {
+    for (int s = 0; s < numShards; s++) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "%s%d", SHARD_PREFIX, s);
+        workerSockets[s] = malloc(strlen(dir) + strlen(SHARD_SOCKET) + 2);
+        if (workerSockets[s] == NULL)
+            break;
+        sprintf(workerSockets[s], "%s/%s", dir, SHARD_SOCKET);
+
+        fflush(stdout);
+        workers[s] = fork();
+        if (workers[s] == 0) {
+#ifdef __linux__
+            // Don't outlive a retriever that was killed
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+            if (chdir(dir) != 0) {
+                printf("Could not open the shard %s\n", dir);
+                _exit(1);
             }
+            options->ingestPath = NULL;
+            _exit(runShard(options, SHARD_SOCKET));
         }
-        buffer = strtok(NULL, delims);
-    }
-
-    // Cosine similarity of the vectors to get weighted results
-    double queryMagn = normalize(queryVector, queryVector, queryCounter);
-    for (long i = 0; i < numDocs; i++) {
-        double denominator = docTermVector[i] * queryMagn;
-        if (denominator == 0)
-            docMatrix[i] = 0;   // No term(s)
-        else
-            docMatrix[i] /= denominator;
-    }
-
-    // Sort the results and flag the first one without any match
-    double **sorted = malloc(sizeof(double**)*numDocs);
-    for (long i = 0; i < numDocs; i++) {
-        sorted[i] = malloc(sizeof(double*)*2);
-        sorted[i][0] = i;
-        sorted[i][1] = docMatrix[i];
-    }
-
-    qsort( sorted, numDocs, sizeof(double*), cmp );
-
-    for (long i = 0; i < numDocs; i++) {
-        if (sorted[i][1] == 0.0) {
-            sorted[i][1] = -1.0;
+        numWorkers++;
+        if (workers[s] < 0)
             break;
-        }
     }
-
-    free(uniqueTokens);
-    free(queryVector);
-/*    free(buffer);*/
-    free(token);
-    return sorted;
+    if (numWorkers == numShards && workers[numShards-1] > 0) {
+        options->shards = workerSockets;
+        options->numShards = numShards;
+        return 0;
+    }
+    printf("Could not start the shard workers\n");
+    return -1;
 }
 
 /***
-    Grabs the title from the datafile
+    Stop the shard workers, if the retriever started them
 ***/
-char *getTitle(long docno, DocIndex docIndex[], long numDocs, char *filename) {
-    char *title = malloc(sizeof(char)*2000);
-    title = strcpy (title, "\0");
-    char *docId = malloc(sizeof(char)*200);
-    char letter [2] = "\0\0";
-
-    // Loop through the files
-    FILE *fp = fopen(filename, "r");
-    if (fp == NULL) {
-        free(docId);
-        free(title);
-        return NULL;
-    }
-
-    // Navigate to document's starting line
-    letter[0] = fgetc(fp);
-    long counter = 0;
-    while (letter[0] != EOF && counter < docIndex[docno].line) {
-        if (letter[0] == '\n')
-            counter++;
-        letter[0] = fgetc(fp);
-    }
-
-    // Grab the first word in the file
-    char *buffer = malloc(sizeof(char)*200);
-    buffer = strcpy(buffer,letter);
-    letter[0] = fgetc(fp);
-    while ((letter[0] != ' ') && (letter[0] != '\n')){
-        if (letter[0] == EOF) {
-            free(buffer);
-            buffer = NULL;
-            break;
-        }
-        buffer = strcat(buffer, letter);
-        letter[0] = fgetc(fp);
-    }
-
-    long docFound = 0;
-    // Read words from file based on the space deliminator
-    while (buffer != NULL) {
-        if (strncmp(buffer, "$", 1) == 0) {
-            if (strcmp(buffer, "$DOC") == 0) {
-                // Check if the docid is correct
-                buffer = strcpy(buffer, "\0");
-                letter[0] = fgetc(fp);
-                while (letter[0] != EOF && letter[0] !='\n') {
-                    buffer = strcat(buffer, letter);
-                    letter[0] = fgetc(fp);
-                }
-                if (strcasecmp(docIndex[docno].docid, buffer) != 0) {
-                    break;
-                }
-                docFound = 1;
-
-            } else if (strcmp(buffer, "$TITLE") == 0) {
-                // Grab the title
-                letter[0] = fgetc(fp);
-                buffer = strcpy(buffer, "\0");
-                while (letter[0] != '$' && letter[0] != EOF) {
-                    title = strcat(title, letter);
-                    letter[0] = fgetc(fp);
-                }
-                free(buffer);
-                free(docId);
-                fclose(fp);
-                return title;
-            } else {
-                if (docFound) {
-                    title = strcpy(title, "<No Title>\n\0");
-                    free(buffer);
-                    free(docId);
-                    fclose(fp);
-                    return title;
-                }
-            }
-        }
-
-        // Grab next word
-        buffer = strcpy(buffer,"\0");
-        letter[0] = fgetc(fp);
-        while ((letter[0] != ' ') && (letter[0] != '\n')){
-            if (letter[0] == EOF) {
-                free(buffer);
-                buffer = NULL;
-                break;
-            }
-            buffer = strcat(buffer, letter);
-            letter[0] = fgetc(fp);
+static void stopShards (void) {
+    for (int s = 0; s < numWorkers; s++) {
+        if (workers[s] > 0) {
+            kill(workers[s], SIGTERM);
+            waitpid(workers[s], NULL, 0);
         }
+        free(workerSockets[s]);
     }
-    fclose(fp);
-
-    free(docId);
-    return title;
+    numWorkers = 0;
 }
 
+/***
+    Write the last metrics snapshot and free the registry, and stop the
+    shard workers
+***/
+static void stopMetrics (void) {
+    stopMetricsDump();
+    freeMetrics();
+    stopShards();
+}
 
 int main (int argc, char * argv[]){
-    // Load the dictionary.txt into memory
-    FILE *dictionary = fopen("dictionary.txt", "r");
-    if (dictionary == NULL) {
-        printf("Error loading dictionary.txt");
-        return 1;
-    }
-    long dictSize = 0;
-    long ret = fscanf(dictionary, "%ld", &dictSize);
-    if ( ret == 0 ){
-        fclose(dictionary);
-        return 1;
-    }
-    long cur = 0;
-
-    DictIndex *dictIndex = malloc(sizeof(DictIndex)*dictSize);
-    char *term = malloc(sizeof(char)*200);
-    for (long i = 0; i < dictSize; i++) {
-        long df = 0;
-        ret = fscanf( dictionary, "%s %ld\n", term, &df);
-        if (ret == 0) {
-            fclose(dictionary);
-            free(term);
-            free(dictIndex);
+    int explain = 0;
+    int batch = 0;
+    char *metricsPath = NULL;
+    int metricsInterval = METRICS_INTERVAL;
+    int numShards = 0;
+    char *shardSockets[MAX_SHARDS];
+    int numSockets = 0;
+    char *serveSocket = NULL;
+    SearchOptions options;
+    initSearchOptions(&options);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--explain") == 0) {
+            explain = 1;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+        } else if (strcmp(argv[i], "--no-warmup") == 0) {
+            options.warmup = 0;
+        } else if (strcmp(argv[i], "--no-reload") == 0) {
+            options.reload = 0;
+        } else if (strcmp(argv[i], "--ingest") == 0 && i + 1 < argc) {
+            options.ingestPath = argv[++i];
+        } else if (strcmp(argv[i], "--refresh") == 0 && i + 1 < argc && atoi(argv[i+1]) > 0) {
+            options.refresh = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--flush") == 0 && i + 1 < argc && atoi(argv[i+1]) > 0) {
+            options.flush = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-postings") == 0 && i + 1 < argc && atol(argv[i+1]) > 0) {
+            options.maxPostings = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc && atof(argv[i+1]) > 0) {
+            options.deadline = atof(argv[++i]) / 1000;
+        } else if (strcmp(argv[i], "--snippets") == 0) {
+            options.snippets = 1;
+        } else if (strcmp(argv[i], "--title-only") == 0) {
+            options.titleOnly = 1;
+        } else if (strcmp(argv[i], "--title-weight") == 0 && i + 1 < argc && atof(argv[i+1]) > 0) {
+            options.titleWeight = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc && searchScoring(argv[i+1]) >= 0) {
+            options.scoring = searchScoring(argv[++i]);
+        } else if (strcmp(argv[i], "--k1") == 0 && i + 1 < argc && atof(argv[i+1]) >= 0) {
+            options.k1 = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--b") == 0 && i + 1 < argc && atof(argv[i+1]) >= 0
+                   && atof(argv[i+1]) <= 1) {
+            options.b = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc
+                   && atoi(argv[i+1]) > 0) {
+            metricsInterval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc && atoi(argv[i+1]) > 0
+                   && atoi(argv[i+1]) <= MAX_SHARDS && numSockets == 0) {
+            numShards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc && numSockets < MAX_SHARDS
+                   && numShards == 0) {
+            shardSockets[numSockets++] = argv[++i];
+        } else if (strcmp(argv[i], "--serve-shard") == 0 && i + 1 < argc) {
+            serveSocket = argv[++i];
+        } else {
+            printf("Usage: %s [--explain] [--batch] [--metrics path [--metrics-interval seconds]]"
+                   " [--no-warmup] [--no-reload]\n"
+                   "       [--ingest path [--refresh seconds] [--flush seconds]]"
+                   " [--max-postings n] [--deadline ms] [--snippets]\n"
+                   "       [--title-only] [--title-weight w] [--model tfidf|bm25|bm25f [--k1 k1] [--b b]]\n"
+                   "       [--shards n | --shard socket ... | --serve-shard socket]\n",
+                   argv[0]);
             return 1;
         }
-        dictIndex[i] = initDictIndex(term, df, cur);
-        cur += df;
     }
-    free(term);
-    fclose(dictionary);
-
-    // Load the docid
-    FILE *docfp = fopen("docids.txt", "r");
-    if (docfp == NULL) {
-        printf("Error loading docids.txt");
-        return 1;
-    }
-    long numDocs = 0;
-    ret = fscanf(docfp, "%ld", &numDocs);
-    if (ret == 0) {
-        fclose(docfp);
+    if (options.ingestPath != NULL && (numShards > 0 || numSockets > 0 || serveSocket != NULL)) {
+        printf("Documents can't be ingested into a sharded index\n");
         return 1;
     }
+    if (serveSocket != NULL)
+        return runShard(&options, serveSocket);
 
-    DocIndex *docIndex = malloc(sizeof(DocIndex)*numDocs);
-    for (long i = 0; i < numDocs; i++) {
-        long line = 0;
-        char *docid = malloc(sizeof(char)*200);
-        ret = fscanf( docfp, "%s %ld\n", docid, &line);
-        if (ret == 0) {
-            free(docid);
-            fclose(docfp);
-            free(dictIndex);
-            free(docIndex);
-            return 1;
-        }
-        docIndex[i] = initDocIndex(docid, line);
-        free(docid);
+    // The workers are forked before the metrics thread starts
+    if (numShards > 0 && startShards(&options, numShards) != 0) {
+        stopShards();
+        return 1;
     }
-    fclose(docfp);
-
-    // Store the number of words in each document
-    double *docTermVector= malloc(sizeof(double) * numDocs);
-    for (long i = 0; i < numDocs; i++) {
-        docTermVector[i] = 0;
+    if (numSockets > 0) {
+        options.shards = shardSockets;
+        options.numShards = numSockets;
     }
 
-    // Load the posting file
-    FILE *posting = fopen("postings.txt", "r");
-    if (posting == NULL) {
-        printf("Error loading postings.txt");
-        free(dictIndex);
-        free(docIndex);
+    if (metricsPath != NULL && startMetricsDump(metricsPath, metricsInterval) != 0) {
+        printf("Could not start writing metrics to %s\n", metricsPath);
+        stopShards();
         return 1;
     }
-    long postSize = 0;
-    ret = fscanf(posting, "%ld", &postSize);
-    if (ret == 0) {
-        fclose(posting);
-        free(dictIndex);
-        free(docIndex);
-        return 1;
-    }
-    PostIndex *postIndex = malloc(sizeof(PostIndex)*postSize);
-    long index = 0;
-    long pIndex = dictIndex[0].postIndex + dictIndex[0].df - 1;
-    for (long i = 0; i < postSize; i++) {
-        if (i > pIndex) {
-            index++;
-            pIndex = dictIndex[index].postIndex + dictIndex[index].df - 1;
-        }
-        long tf = 0;
-        long docno = 0;
-        ret = fscanf( posting, "%ld %ld\n", &docno, &tf);
-        if (ret == 0) {
-            fclose(posting);
-            free(dictIndex);
-            free(docIndex);
+    if (batch) {
+        // No prompts to answer in batch mode, and no next pages to prefetch
+        options.prefetch = 0;
+        SearchEngine *engine = openSearchEngine(&options);
+        if (engine == NULL) {
+            stopMetrics();
             return 1;
         }
-        postIndex[i] = initPostIndex(docno, tf);
-        docTermVector[docno] += pow(tfidf((double)tf, (double)numDocs, (double)dictIndex[index].df), 2);
-    }
-    fclose(posting);
-
-    for (long i = 0; i < numDocs; i++) {
-        docTermVector[i] = sqrt(docTermVector[i]);
+        runBatch(engine, explain, options.snippets);
+        closeSearchEngine(engine);
+        stopMetrics();
+        return 0;
     }
 
-    char *filename = malloc(sizeof(char)*500);
     printf("~~~~ Welcome to the Boogle file search engine ~~~~\n");
-    printf("Enter the filename to search through: \n");
-    filename = fgets(filename,499,stdin);
-    if (filename == NULL) {
-        free(filename);
-        free(docTermVector);
-        freeDictArray(dictIndex, dictSize);
-        freeDocArray(docIndex, numDocs);
-
-        free(dictIndex);
-        free(docIndex);
-        free(postIndex);
+    options.askCorpus = askCorpus;
+    SearchEngine *engine = openSearchEngine(&options);
+    SearchResult *results = malloc(sizeof(SearchResult)*PAGE_RESULTS);
+    if (engine == NULL || results == NULL) {
+        if (engine != NULL)
+            closeSearchEngine(engine);
+        free(results);
+        stopMetrics();
         return 1;
     }
 
-    filename[strlen(filename)-1] = '\0';  // Remove newline
-    FILE *test = fopen(filename, "r");
-    if (test == NULL){
-        printf("Invalid file name/path\n");
-        free(filename);
-        free(docTermVector);
-        freeDictArray(dictIndex, dictSize);
-        freeDocArray(docIndex, numDocs);
-
-        free(dictIndex);
-        free(docIndex);
-        free(postIndex);
-        return 1;
-    }
-    fclose(test);
-
-    // Command Loop
+    // Command Loop, queries can be as long as a whole document
+    char *input = NULL;
+    size_t size = 0;
     while (1) {
-        char *input = malloc(sizeof(char)*500);
         printf("Please enter a query. Seperate each keyword by a space. q to quit:\n");
-        input = fgets(input, 500, stdin);
-        if (strcasecmp(input, "q\n") == 0) {
-            free(input);
+        if (getline(&input, &size, stdin) == -1 || strcasecmp(input, "q\n") == 0) {
             break;
         } else {
-            double **results = retrieveResults(input, docTermVector, dictIndex, \
-                                    postIndex, docIndex, dictSize, postSize, numDocs);
-            long index = 0;
+            // Pages come from the one evaluation, on the index it was opened on
+            SearchQuery *query = openQuery(engine, input);
+            if (query == NULL) {
+                printf("Out of memory, try another query\n");
+                continue;
+            }
+            long offset = 0;
             long allDocsFound = 0;
             while (strcasecmp(input, "q\n") != 0) {
+                QueryProfile profile;
+                initProfile(&profile);
+                int exact = 1;
+                int count = queryPage(query, offset, PAGE_RESULTS, results, &exact, &profile);
+                if (count == SEARCH_TOO_DEEP) {
+                    printf("No more results, a sharded index pages through its first %d\n",
+                           SHARD_MAX_HITS);
+                    offset -= 10;
+                    continue;
+                }
                 printf("------------------------\n");
                 printf("Results for query:\n");
-                long i = index;
-
-                for (i = index; i < index + 10 && i < numDocs; i++) {
-                    if (results[i][1] != -1.0) {
-                        char *title = getTitle(results[i][0], docIndex, numDocs, filename);
-                        if (strcmp(title, "") != 0)
-                            printf("Result %ld: %s", (i+1), title);
-                        free(title);
-                    } else {
-                        allDocsFound = 1;
-                        break;
-                    }
+                for (int i = 0; i < count; i++) {
+                    if (strcmp(results[i].title, "") != 0)
+                        printf("Result %ld: %s", offset + i + 1, results[i].title);
+                    if (results[i].snippet[0] != '\0')
+                        printf("    %s\n", results[i].snippet);
                 }
+                allDocsFound = (count < PAGE_RESULTS);
 
-                if (i == 0 && allDocsFound == 1) {
+                if (offset == 0 && count <= 0) {
                     printf("No documents found\n");
                     printf("Try another query\n");
                     break;
                 }
                 printf("------------------------\n");
+                if (!exact)
+                    printf("Partial results, the query ran out of budget\n");
+                if (profile.shardsFailed > 0)
+                    printf("Partial results, %ld shards didn't answer\n", profile.shardsFailed);
+                if (explain) {
+                    printProfile(stdout, &profile);
+                    printf("------------------------\n");
+                }
                 printf("Enter 'q' to enter a new query.\n");
                 printf("Enter 'a' to view previous 10 results\n");
                 printf("Enter 'd' to view next 10 results\n");
                 printf("Enter a result # to view the document\n");
 
-                input = fgets(input, 500, stdin);
+                if (getline(&input, &size, stdin) == -1)
+                    strcpy(input, "q\n");
                 if (strcasecmp(input, "d\n") == 0) {
-                    index += 10;
+                    offset += 10;
                     if (allDocsFound) {
                         allDocsFound = 0;
-                        index -= 10;
+                        offset -= 10;
                     }
 
                 } else if (strcasecmp(input, "a\n") == 0) {
-                    index -= 10;
-                    if (index < 0)
-                        index = 0;
+                    offset -= 10;
+                    if (offset < 0)
+                        offset = 0;
                 } else {
                     // Is it a number?
                     char *endptr;
                     int choice = strtol( input, &endptr,10);
-                    if (choice > 0) {
-                        long docNo = (long)results[index+choice-1][0];
-                        FILE *doc = fopen(filename, "r");
-                        char * str = malloc(sizeof(char)*501);
-                        size_t *size = malloc(sizeof(size_t));
-                        *size = 501;
-                        int docCount = 0;
-
-                        for (long i = 0; i < docIndex[docNo].line; i++) {
-                            getline(&str, size, doc);
-                        }
-
-                        while ((str = fgets(str, 500, doc)) != NULL) {
-                            if (strncmp(str,"$DOC",4)==0) {
-                                docCount++;
-                            }
-                            if (docCount == 2) {
-                                break;
-                            }
-                            printf("%s", str);
-                        }
-                        free(str);
-                        free(size);
-                        fclose(doc);
+                    if (choice > 0 && choice <= count) {
+                        printDocument(engine, &results[choice-1]);
                         printf("Press any key to return to results...\n");
-                        fgets(input, 499, stdin);
+                        if (getline(&input, &size, stdin) == -1)
+                            strcpy(input, "q\n");
                         continue;
                     }
                 }
             }
-
-            for (long i = 0; i < numDocs; i++) {
-                free(results[i]);
-            }
-            free(results);
+            closeQuery(query);
         }
-        free(input);
     }
 
-    free(filename);
-    free(docTermVector);
-    freeDictArray(dictIndex, dictSize);
-    freeDocArray(docIndex, numDocs);
-    free(dictIndex);
-    free(docIndex);
-    free(postIndex);
+    free(input);
+    free(results);
+    closeSearchEngine(engine);
+    stopMetrics();
     return 0;
 }
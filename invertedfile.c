@@ -0,0 +1,405 @@
+/***
+    Filename: invertedfile.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: libinvertedfile, the query engine as a library. An engine
+                 owns the reloader serving the index and the warmup, reload
+                 and ingest threads around it. Every search takes a reference
+                 to the current snapshot, so searches on any number of
+                 threads run against an index that a reload can't free under
+                 them, and copies its results out before dropping it. An
+                 opened query keeps its reference and ranking while it is
+                 paged through. An engine opened on shards coordinates their workers instead,
+                 see shards.c.
+***/
+
+#ifndef INVERTEDFILE_H_INCLUDED
+#define INVERTEDFILE_H_INCLUDED
+#include "invertedfile.h"
+#endif
+
+#ifndef INGEST_H_INCLUDED
+#define INGEST_H_INCLUDED
+#include "ingest.h"
+#endif
+
+#ifndef TITLES_H_INCLUDED
+#define TITLES_H_INCLUDED
+#include "titles.h"
+#endif
+
+#ifndef SHARDS_H_INCLUDED
+#define SHARDS_H_INCLUDED
+#include "shards.h"
+#endif
+
+struct SearchEngine {
+    Reloader reloader;
+    Warmup warmup;
+    Ingest ingest;
+    TitlePool titles;
+    SearchOptions options;
+    Coordinator *coordinator;   // of the shards' workers, NULL when the index is loaded
+};
+
+void initSearchOptions (SearchOptions *options) {
+    options->warmup = 1;
+    options->reload = 1;
+    options->titles = 1;
+    options->titleThreads = TITLE_THREADS;
+    options->prefetch = 1;
+    options->snippets = 0;
+    options->hotTerms = HOT_TERMS_FILE;
+    options->ingestPath = NULL;
+    options->refresh = INGEST_REFRESH;
+    options->flush = INGEST_FLUSH;
+    options->askCorpus = NULL;
+    options->maxPostings = 0;
+    options->deadline = 0;
+    options->titleOnly = 0;
+    options->titleWeight = 1;
+    options->scoring = SEARCH_TFIDF;
+    options->k1 = BM25_K1;
+    options->b = BM25_B;
+    options->shards = NULL;
+    options->numShards = 0;
+}
+
+int searchScoring (const char *name) {
+    return findScoring(name);
+}
+
+SearchEngine *openSearchEngine (SearchOptions *options) {
+    SearchEngine *engine = calloc(1, sizeof(SearchEngine));
+    if (engine == NULL)
+        return NULL;
+    engine->options = *options;
+    if (options->numShards > 0) {
+        // The workers load the shards, scoring by the options they were started with
+        engine->coordinator = malloc(sizeof(Coordinator));
+        if (engine->coordinator == NULL
+                || openCoordinator(engine->coordinator, options->shards, options->numShards) != 0) {
+            free(engine->coordinator);
+            free(engine);
+            return NULL;
+        }
+        return engine;
+    }
+    Index index;
+    if (loadIndex(&index) != 0) {
+        free(engine);
+        return NULL;
+    }
+    if (options->hotTerms != NULL)
+        loadHotTerms(&index, options->hotTerms);
+
+    if (index.files == NULL) {
+        // Indexes without files.txt search the file the caller names. Flushed
+        // ingest generations list their files, they can't be built on one
+        char *corpus = NULL;
+        if (options->askCorpus != NULL && options->ingestPath == NULL)
+            corpus = options->askCorpus();
+        else
+            printf("The index has no files.txt, rebuild the index\n");
+        index.files = (corpus != NULL) ? malloc(sizeof(char*)) : NULL;
+        if (index.files == NULL) {
+            free(corpus);
+            freeIndex(&index);
+            free(engine);
+            return NULL;
+        }
+        index.files[0] = corpus;
+        index.numFiles = 1;
+    }
+    if (options->snippets && index.snippets == NULL)
+        printf("The index has no %s, results have no snippets\n", SNIPPETS_FILE);
+    if ((options->maxPostings > 0 || options->deadline > 0) && index.impacts == NULL)
+        printf("The index has no %s, queries are evaluated in full\n", IMPACTS_FILE);
+    if ((options->titleOnly || options->titleWeight != 1) && index.fields == NULL)
+        printf("The index has no %s, queries search every field\n", FIELDS_FILE);
+    if (options->scoring == SCORING_BM25F && index.fields == NULL)
+        printf("The index has no %s, documents are scored by bm25\n", FIELDS_FILE);
+    if (options->scoring != SCORING_TFIDF && (options->maxPostings > 0 || options->deadline > 0))
+        printf("Impacts are tf-idf weights, queries scored by %s are evaluated in full\n",
+               scoringName(options->scoring));
+    if (checkIndexFiles(&index) != 0) {
+        freeIndex(&index);
+        free(engine);
+        return NULL;
+    }
+    if (initReloader(&engine->reloader, &index, options->warmup ? &engine->warmup : NULL) != 0) {
+        free(engine);
+        return NULL;
+    }
+    // The reload or ingest thread saves them as queries come in
+    engine->reloader.hotTerms = options->hotTerms;
+    if (startTitlePool(&engine->titles, &engine->reloader, options->titles ? options->titleThreads : 0) != 0)
+        printf("Could not start the title threads, titles are read one at a time\n");
+
+    if (options->warmup)
+        startWarmup(&engine->warmup, &engine->reloader.current->index);
+    if (options->ingestPath != NULL) {
+        // The ingest thread publishes its segment and reloads generations
+        if (startIngest(&engine->ingest, &engine->reloader, options->ingestPath,
+                        options->refresh, options->flush) != 0)
+            printf("Could not start ingesting %s\n", options->ingestPath);
+    } else if (options->reload && startReloader(&engine->reloader) != 0) {
+        printf("Could not start watching for new index generations\n");
+    }
+    return engine;
+}
+
+void closeSearchEngine (SearchEngine *engine) {
+    if (engine->coordinator != NULL) {
+        closeCoordinator(engine->coordinator);
+        free(engine->coordinator);
+        free(engine);
+        return;
+    }
+    stopIngest(&engine->ingest);
+    stopReloader(&engine->reloader);
+    stopWarmup(&engine->warmup);
+    // Prefetches hold snapshots, they're released before the reloader's
+    stopTitlePool(&engine->titles);
+    if (engine->options.hotTerms != NULL
+            && saveHotTerms(&engine->reloader.current->index, engine->options.hotTerms) != 0)
+        printf("Could not save %s\n", engine->options.hotTerms);
+    freeReloader(&engine->reloader);
+    free(engine);
+}
+
+struct SearchQuery {
+    SearchEngine *engine;
+    char *query;
+    Snapshot *snapshot;     // the query is evaluated on, NULL when coordinating shards
+    double **ranked;        // NULL until the first page
+    long numRanked;
+    long matches;           // of ranked, the documents with a match
+    long depth;             // of a budgeted ranking, 0 once every match is ranked
+    int exact;
+};
+
+/***
+    Evaluate a query by the engine's options. A budgeted query ranks its
+    depth best matches, any other ranks every document
+    @return : numRanked [docno, weight] pairs sorted by weight, NULL if out
+              of memory
+***/
+static double **rankQuery (SearchEngine *engine, Index *index, const char *query, long depth,
+                           int *exact, long *numRanked, QueryProfile *profile) {
+    *exact = 1;
+    *numRanked = totalDocs(index);
+    if (engine->options.scoring != SCORING_TFIDF
+            || ((engine->options.titleOnly || engine->options.titleWeight != 1) && index->fields != NULL)) {
+        Scoring scoring = { engine->options.scoring, engine->options.k1, engine->options.b };
+        FieldScope scope = { engine->options.titleOnly, engine->options.titleWeight };
+        return retrieveScored(query, index, &scoring, &scope, profile);
+    }
+    if (engine->options.maxPostings > 0 || engine->options.deadline > 0) {
+        QueryBudget budget = { engine->options.maxPostings, engine->options.deadline };
+        return retrieveImpacts(query, index, &budget, depth, exact, numRanked, profile);
+    }
+    return retrieveResults(query, index, profile);
+}
+
+/***
+    @return : ranked documents before the first without a match
+***/
+static long countMatches (double **ranked, long numRanked) {
+    long matches = 0;
+    while (matches < numRanked && ranked[matches][1] != -1.0)
+        matches++;
+    return matches;
+}
+
+/***
+    Copy matches offset to offset + k - 1 of a ranking into results, with
+    their titles and snippets, and prefetch the next page's titles
+    @return >=0 : results written
+    @return -1 : out of memory
+***/
+static int writePage (SearchEngine *engine, Snapshot *snapshot, const char *query, double **ranked,
+                      long matches, long offset, int k, SearchResult results[], QueryProfile *profile) {
+    Index *index = &snapshot->index;
+    int count = 0;
+    long *docnos = malloc(sizeof(long)*(k > 0 ? 2*(long)k : 1));
+    char **titles = malloc(sizeof(char*)*(k > 0 ? k : 1));
+    if (docnos == NULL || titles == NULL) {
+        free(docnos);
+        free(titles);
+        return -1;
+    }
+    for (long i = offset; i < matches && count < k; i++) {
+        long docno = (long)ranked[i][0];
+        DocIndex *doc = getDoc(index, docno);
+        SearchResult *result = &results[count];
+        snprintf(result->docid, sizeof(result->docid), "%s", doc->docid);
+        result->score = ranked[i][1];
+        snprintf(result->file, sizeof(result->file), "%s", docFile(index, docno));
+        result->line = doc->line;
+        result->docno = docno;
+        result->title[0] = '\0';
+        result->snippet[0] = '\0';
+        if (engine->options.snippets) {
+            char *snippet = getSnippet(query, docno, index, profile);
+            if (snippet != NULL)
+                snprintf(result->snippet, sizeof(result->snippet), "%s", snippet);
+            free(snippet);
+        }
+        docnos[count++] = docno;
+    }
+
+    if (engine->options.titles) {
+        // The page's titles are read at once, then the next page's in the background
+        fetchTitles(&engine->titles, snapshot, docnos, count, titles, profile);
+        for (int r = 0; r < count; r++) {
+            if (titles[r] != NULL)
+                snprintf(results[r].title, sizeof(results[r].title), "%s", titles[r]);
+            free(titles[r]);
+        }
+        int next = 0;
+        for (long i = offset + k; engine->options.prefetch && i < matches && next < k; i++)
+            docnos[next++] = (long)ranked[i][0];
+        prefetchTitles(&engine->titles, snapshot, docnos, next);
+    }
+
+    free(docnos);
+    free(titles);
+    return count;
+}
+
+int searchHits (SearchEngine *engine, const char *query, long n, SearchHit hits[], long *found,
+                long offset, int k, SearchResult results[], int *exact, QueryProfile *profile) {
+    *found = 0;
+    if (exact != NULL)
+        *exact = 1;
+    if (engine->coordinator != NULL)
+        return -1;
+    // A reload swaps in a new snapshot for the next search, not this one
+    Snapshot *snapshot = acquireIndex(&engine->reloader);
+    Index *index = &snapshot->index;
+    // Deep enough for the hits, the page and the next page's titles
+    long depth = offset + 2*(long)k;
+    if (depth < n)
+        depth = n;
+    int evaluated;
+    long numRanked;
+    double **ranked = rankQuery(engine, index, query, depth, &evaluated, &numRanked, profile);
+    if (ranked == NULL) {
+        releaseIndex(&engine->reloader, snapshot);
+        return -1;
+    }
+    if (exact != NULL)
+        *exact = evaluated;
+
+    // The first document without a match ends the results
+    long matches = countMatches(ranked, numRanked);
+    for (long i = 0; i < n && i < matches; i++) {
+        DocIndex *doc = getDoc(index, (long)ranked[i][0]);
+        snprintf(hits[i].docid, sizeof(hits[i].docid), "%s", doc->docid);
+        hits[i].score = ranked[i][1];
+        (*found)++;
+    }
+
+    int count = writePage(engine, snapshot, query, ranked, matches, offset, k, results, profile);
+    freeResults(ranked, numRanked);
+    if (count >= 0)
+        countQuery(&engine->reloader);
+    releaseIndex(&engine->reloader, snapshot);
+    return count;
+}
+
+SearchQuery *openQuery (SearchEngine *engine, const char *query) {
+    SearchQuery *opened = calloc(1, sizeof(SearchQuery));
+    char *copy = malloc(strlen(query) + 1);
+    if (opened == NULL || copy == NULL) {
+        free(opened);
+        free(copy);
+        return NULL;
+    }
+    opened->engine = engine;
+    opened->query = strcpy(copy, query);
+    // Pages come from this snapshot whatever is reloaded in between
+    if (engine->coordinator == NULL)
+        opened->snapshot = acquireIndex(&engine->reloader);
+    return opened;
+}
+
+int queryPage (SearchQuery *query, long offset, int k, SearchResult results[], int *exact,
+               QueryProfile *profile) {
+    SearchEngine *engine = query->engine;
+    if (engine->coordinator != NULL)
+        return coordinatePage(engine->coordinator, query->query, offset, k, results, exact, profile);
+    Index *index = &query->snapshot->index;
+
+    if (query->ranked == NULL || (query->depth > 0 && offset + k > query->numRanked)) {
+        // Deep enough for the page and the next page's titles, and twice the
+        // last ranking so paging on doesn't evaluate the query every page
+        long depth = offset + 2*(long)k;
+        if (depth < 2*query->depth)
+            depth = 2*query->depth;
+        int evaluated;
+        long numRanked;
+        double **ranked = rankQuery(engine, index, query->query, depth, &evaluated, &numRanked, profile);
+        if (ranked == NULL)
+            return -1;
+        if (query->ranked != NULL)
+            freeResults(query->ranked, query->numRanked);
+        query->ranked = ranked;
+        query->numRanked = numRanked;
+        query->matches = countMatches(ranked, numRanked);
+        query->exact = evaluated;
+        // Fewer than depth ranked by a budget were every match it found
+        query->depth = (numRanked < depth || numRanked == totalDocs(index)) ? 0 : depth;
+        countQuery(&engine->reloader);
+    }
+    if (exact != NULL)
+        *exact = query->exact;
+    return writePage(engine, query->snapshot, query->query, query->ranked, query->matches,
+                     offset, k, results, profile);
+}
+
+void closeQuery (SearchQuery *query) {
+    if (query->ranked != NULL)
+        freeResults(query->ranked, query->numRanked);
+    if (query->snapshot != NULL)
+        releaseIndex(&query->engine->reloader, query->snapshot);
+    free(query->query);
+    free(query);
+}
+
+int searchPage (SearchEngine *engine, const char *query, long offset, int k,
+                SearchResult results[], int *exact, QueryProfile *profile) {
+    if (engine->coordinator != NULL)
+        return coordinatePage(engine->coordinator, query, offset, k, results, exact, profile);
+    long found;
+    return searchHits(engine, query, 0, NULL, &found, offset, k, results, exact, profile);
+}
+
+int search (SearchEngine *engine, const char *query, int k, SearchResult results[], int *exact) {
+    return searchPage(engine, query, 0, k, results, exact, NULL);
+}
+
+char *readDocument (SearchEngine *engine, const SearchResult *result) {
+    if (engine->coordinator != NULL) {
+        char *text = coordinateDocument(engine->coordinator, result->docid);
+        return (text != NULL) ? text : corpusDocument(result->file, result->line);
+    }
+    Snapshot *snapshot = acquireIndex(&engine->reloader);
+    Index *index = &snapshot->index;
+
+    // A reload since the search may have renumbered the documents
+    long numDocs = totalDocs(index);
+    long docno = result->docno;
+    if (docno < 0 || docno >= numDocs || strcmp(getDoc(index, docno)->docid, result->docid) != 0) {
+        for (docno = 0; docno < numDocs; docno++) {
+            if (strcmp(getDoc(index, docno)->docid, result->docid) == 0)
+                break;
+        }
+    }
+    char *text = (docno < numDocs) ? getDocument(docno, index)
+                                   : corpusDocument(result->file, result->line);
+    releaseIndex(&engine->reloader, snapshot);
+    return text;
+}
@@ -0,0 +1,189 @@
+/***
+    Filename: invertedfile.h
+    Author: Benjamin Baird
+    Description: Public header of libinvertedfile, the query engine behind
+                 the retriever for programs that search an index in process.
+                 An engine is opened on the index in the current directory
+                 and searched through an opaque handle from any number of
+                 threads. Results are copied into buffers the caller owns,
+                 so they stay valid after the engine swaps in a new index
+***/
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+#include "profile.h"
+#endif
+
+#ifndef LIMITS_H_INCLUDED
+#define LIMITS_H_INCLUDED
+#include <limits.h>
+#endif
+
+// Longest docid copied into a result
+#define SEARCH_DOCID 200
+// Longest title copied into a result, longer titles are cut
+#define SEARCH_TITLE 2000
+// Longest snippet copied into a result
+#define SEARCH_SNIPPET 512
+// searchPage's error for a page past the deepest a sharded index ranks
+#define SEARCH_TOO_DEEP -2
+
+// Scoring models of SearchOptions, the engine's in the same order
+enum { SEARCH_TFIDF, SEARCH_BM25, SEARCH_BM25F };
+
+typedef struct SearchEngine SearchEngine;
+
+// A query opened for paging, see openQuery
+typedef struct SearchQuery SearchQuery;
+
+/***
+    What an engine runs next to the queries. initSearchOptions sets the
+    defaults the retriever uses
+***/
+typedef struct SearchOptions {
+    int warmup;             // read ahead the hot terms' corpus pages at open
+    int reload;             // swap in generations published by the indexer
+    int titles;             // read each result's title from the corpus
+    int titleThreads;       // threads reading a page's titles at once, 0 for none
+    int prefetch;           // read the next page's titles after each page
+    int snippets;           // cut a snippet for each result, when the index has
+                            // token offsets (indexer --snippets)
+    char *hotTerms;         // most queried terms, loaded at open, saved by the
+                            // reload or ingest thread every HOT_TERMS_SAVE
+                            // queries and at close. NULL for none
+    char *ingestPath;       // pipe or file of documents to index, NULL for none
+    int refresh;            // seconds before ingested documents are searchable
+    int flush;              // seconds between flushes of ingested documents
+    char *(*askCorpus)(void); // for an index without files.txt, returns the
+                            // malloc'd path of its corpus file or NULL
+    long maxPostings;       // with either budget, queries are evaluated over the
+    double deadline;        // impact-ordered postings (indexer --impacts) until
+                            // they score maxPostings or run for deadline seconds.
+                            // 0 for no limit
+    int titleOnly;          // match queries against the documents' titles alone
+    double titleWeight;     // a title occurrence counts this many times, 1 for
+                            // once. Both need title postings (indexer --fields)
+                            // and are evaluated in full, whatever the budget
+    int scoring;            // SEARCH_TFIDF, SEARCH_BM25 or SEARCH_BM25F (with
+                            // indexer --fields), anything but tf-idf is evaluated
+                            // in full whatever the budget
+    double k1;              // BM25 term frequency saturation
+    double b;               // BM25 length normalization
+    char **shards;          // sockets of the workers serving the shards of an
+    int numShards;          // index split by indexer --shards. Queries are sent
+                            // to every worker and no index is loaded, 0 for none
+}SearchOptions;
+
+/***
+    One ranked document
+***/
+typedef struct SearchResult {
+    char docid [SEARCH_DOCID];
+    double score;
+    char title [SEARCH_TITLE];  // "" unless titles are read
+    char snippet [SEARCH_SNIPPET]; // query terms in [brackets], "" without one
+    char file [PATH_MAX];       // corpus file the document is in
+    long line;                  // line of the document's $DOC in file
+    long docno;                 // in the index it was found in, readDocument
+                                // checks it's still the docid's
+}SearchResult;
+
+/***
+    A ranked document without its title, the coordinator of a sharded index
+    merges these before asking the shards for a page
+***/
+typedef struct SearchHit {
+    char docid [SEARCH_DOCID];
+    double score;
+}SearchHit;
+
+/***
+    Set the options to the retriever's defaults
+***/
+void initSearchOptions (SearchOptions *options);
+
+/***
+    The scoring model named "tfidf", "bm25" or "bm25f", in any case
+    @return : SEARCH_TFIDF, SEARCH_BM25 or SEARCH_BM25F, -1 for another name
+***/
+int searchScoring (const char *name);
+
+/***
+    Load the index published in the current directory and start the
+    threads the options ask for. Errors are printed
+    @return : engine, NULL if the index couldn't be loaded
+***/
+SearchEngine *openSearchEngine (SearchOptions *options);
+
+/***
+    Stop the engine's threads, flush ingested documents, save the hot terms
+    and free the index once no search is using it
+***/
+void closeSearchEngine (SearchEngine *engine);
+
+/***
+    The k best matches of a query, best first. Safe to call from several
+    threads at once
+    @call exact : set to 0 when the query's budget (maxPostings, deadline)
+                  ran out before it was evaluated in full, 1 otherwise.
+                  May be NULL
+    @return >=0 : results written, fewer than k when fewer documents match
+    @return -1 : out of memory
+***/
+int search (SearchEngine *engine, const char *query, int k, SearchResult results[], int *exact);
+
+/***
+    Matches offset to offset + k - 1 of a query, profiling it into profile
+    unless it's NULL. exact is set as by search
+    @return >=0 : results written
+    @return -1 : out of memory
+    @return SEARCH_TOO_DEEP : the engine coordinates shards and the page
+                              ends past SHARD_MAX_HITS
+***/
+int searchPage (SearchEngine *engine, const char *query, long offset, int k,
+                SearchResult results[], int *exact, QueryProfile *profile);
+
+/***
+    Open a query to page through its matches with queryPage. It holds the
+    index it was opened on and its ranking until closeQuery, so paging
+    doesn't evaluate it again and its pages stay consistent across a
+    reload. An engine coordinating shards asks their workers for each page
+    @return : the query, NULL if out of memory
+***/
+SearchQuery *openQuery (SearchEngine *engine, const char *query);
+
+/***
+    Matches offset to offset + k - 1 of an opened query, as searchPage.
+    The first page evaluates it, a budgeted query is evaluated again deeper
+    when a page goes past the matches it ranked
+    @return >=0 : results written
+    @return -1 : out of memory
+    @return SEARCH_TOO_DEEP : the engine coordinates shards and the page
+                              ends past SHARD_MAX_HITS
+***/
+int queryPage (SearchQuery *query, long offset, int k, SearchResult results[], int *exact,
+               QueryProfile *profile);
+
+/***
+    Free an opened query and release the index it holds
+***/
+void closeQuery (SearchQuery *query);
+
+/***
+    The n best matches of a query as docids and scores, along with its
+    matches offset to offset + k - 1 in full, from one evaluation. exact is
+    set as by search. A shard's worker answers the coordinator with it
+    @return >=0 : results written, found is set to the hits written
+    @return -1 : out of memory, or the engine coordinates shards
+***/
+int searchHits (SearchEngine *engine, const char *query, long n, SearchHit hits[], long *found,
+                long offset, int k, SearchResult results[], int *exact, QueryProfile *profile);
+
+/***
+    The text of a result's document from its $DOC line up to the next
+    document, decompressed from the index's STORE_FILE when it has one,
+    so the corpus files needn't be kept, otherwise from the corpus file.
+    An engine coordinating shards asks their workers for it
+    @return : malloc'd text, NULL if it can't be read
+***/
+char *readDocument (SearchEngine *engine, const SearchResult *result);
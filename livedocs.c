@@ -0,0 +1,170 @@
+/***
+    Filename: livedocs.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Deleted document bitmap. Deletes only touch deleted.bin so they
+                 take effect without reindexing, the documents' postings stay
+                 in postings.txt until the index is rebuilt or compacted.
+                 Deletes, compaction and ingest flushes take an flock on
+                 deleted.bin.lock from reading the bitmap until they've
+                 replaced it or published the generation it was carried
+                 into, so concurrent deletes all stick.
+***/
+
+#ifndef LIVEDOCS_H_INCLUDED
+#define LIVEDOCS_H_INCLUDED
+#include "livedocs.h"
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef FILE_H_INCLUDED
+#define FILE_H_INCLUDED
+#include <sys/file.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef ERRNO_H_INCLUDED
+#define ERRNO_H_INCLUDED
+#include <errno.h>
+#endif
+
+void initLiveDocs (LiveDocs *live, long numDocs) {
+    live->bits = NULL;
+    live->numDocs = numDocs;
+    live->numDeleted = 0;
+    live->mtime.tv_sec = 0;
+    live->mtime.tv_nsec = 0;
+}
+
+void freeLiveDocs (LiveDocs *live) {
+    free(live->bits);
+    initLiveDocs(live, live->numDocs);
+}
+
+int isDeleted (LiveDocs *live, long docno) {
+    if (live->bits == NULL)
+        return 0;
+    return (live->bits[docno >> 3] >> (docno & 7)) & 1;
+}
+
+int loadLiveDocs (LiveDocs *live, char *path) {
+    freeLiveDocs(live);
+
+    struct stat info;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return 0;
+    if (fstat(fileno(fp), &info) != 0) {
+        fclose(fp);
+        return -1;
+    }
+    live->mtime = info.st_mtim;
+
+    // Documents past the end of a short bitmap are live
+    long numBytes = (live->numDocs + 7) / 8;
+    live->bits = calloc(numBytes > 0 ? numBytes : 1, 1);
+    if (live->bits == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    long read = (long)fread(live->bits, 1, numBytes, fp);
+    fclose(fp);
+
+    for (long i = 0; i < read; i++) {
+        live->numDeleted += __builtin_popcount(live->bits[i]);
+    }
+    // Bits past numDocs in the last byte are not documents
+    if (live->numDocs % 8 != 0 && read == numBytes) {
+        unsigned char extra = live->bits[numBytes-1] & (unsigned char)(0xFF << (live->numDocs % 8));
+        live->numDeleted -= __builtin_popcount(extra);
+        live->bits[numBytes-1] &= (unsigned char)~extra;
+    }
+    return 0;
+}
+
+int liveDocsChanged (LiveDocs *live, char *path) {
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return live->bits != NULL;
+    return info.st_mtim.tv_sec != live->mtime.tv_sec || info.st_mtim.tv_nsec != live->mtime.tv_nsec;
+}
+
+long deleteDocs (char *path, long numDocs, long docnos[], long count) {
+    long numBytes = (numDocs + 7) / 8;
+    unsigned char *bits = calloc(numBytes > 0 ? numBytes : 1, 1);
+    if (bits == NULL)
+        return -1;
+
+    FILE *fp = fopen(path, "rb");
+    if (fp != NULL) {
+        if (fread(bits, 1, numBytes, fp) == 0 && ferror(fp)) {
+            fclose(fp);
+            free(bits);
+            return -1;
+        }
+        fclose(fp);
+    }
+
+    long newlyDeleted = 0;
+    for (long i = 0; i < count; i++) {
+        if (docnos[i] < 0 || docnos[i] >= numDocs)
+            continue;
+        unsigned char mask = (unsigned char)(1 << (docnos[i] & 7));
+        if ((bits[docnos[i] >> 3] & mask) == 0) {
+            bits[docnos[i] >> 3] |= mask;
+            newlyDeleted++;
+        }
+    }
+
+    // Write beside the old bitmap and rename over it so readers never see half a file
+    char *temp = malloc(sizeof(char)*((int)strlen(path)+5));
+    sprintf(temp, "%s.tmp", path);
+    fp = fopen(temp, "wb");
+    if (fp == NULL) {
+        free(temp);
+        free(bits);
+        return -1;
+    }
+    int ok = (long)fwrite(bits, 1, numBytes, fp) == numBytes;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+        newlyDeleted = -1;
+    }
+    free(temp);
+    free(bits);
+    return newlyDeleted;
+}
+
+int lockLiveDocs (const char *path) {
+    char *lockPath = malloc(strlen(path) + strlen(LIVE_DOCS_LOCK) + 1);
+    if (lockPath == NULL)
+        return -1;
+    sprintf(lockPath, "%s%s", path, LIVE_DOCS_LOCK);
+    int lock = open(lockPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    free(lockPath);
+    if (lock < 0)
+        return -1;
+    int ret;
+    while ((ret = flock(lock, LOCK_EX)) != 0 && errno == EINTR)
+        ;
+    if (ret != 0) {
+        close(lock);
+        return -1;
+    }
+    return lock;
+}
+
+void unlockLiveDocs (int lock) {
+    if (lock >= 0)
+        close(lock);
+}
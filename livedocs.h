@@ -0,0 +1,90 @@
+/***
+    Filename: livedocs.h
+    Author: Benjamin Baird
+    Description: Header file for livedocs.c, the bitmap of deleted documents
+                 kept next to docids.txt in deleted.bin
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+// Bitmap of deleted docnos, bit (docno % 8) of byte (docno / 8)
+#define LIVE_DOCS_FILE "deleted.bin"
+// Locked beside the bitmap by whatever reads it to replace it or carry it
+// into a new generation, so no delete is written over
+#define LIVE_DOCS_LOCK ".lock"
+
+typedef struct LiveDocs {
+    unsigned char *bits;    // NULL while no document is deleted
+    long numDocs;
+    long numDeleted;
+    struct timespec mtime;  // of the bitmap file when it was loaded
+}LiveDocs;
+
+/***
+    Initializes LiveDocs with every one of numDocs documents live
+***/
+void initLiveDocs (LiveDocs *live, long numDocs);
+
+/***
+    Frees the bitmap
+***/
+void freeLiveDocs (LiveDocs *live);
+
+/***
+    Loads the bitmap file, a missing file means no document is deleted
+    @return 0 : success
+    @return -1 : file could not be read
+***/
+int loadLiveDocs (LiveDocs *live, char *path);
+
+/***
+    Checks whether the bitmap file changed since it was loaded. The bitmap
+    isn't reloaded in place, queries may be reading it
+    @return 1 : changed
+    @return 0 : unchanged
+***/
+int liveDocsChanged (LiveDocs *live, char *path);
+
+/***
+    @return 1 : docno is deleted
+    @return 0 : docno is live
+***/
+int isDeleted (LiveDocs *live, long docno);
+
+/***
+    Marks docnos deleted in the bitmap file, replacing it atomically. Deletes
+    from a published generation hold lockLiveDocs on it
+    @return >=0 : number of documents newly deleted
+    @return -1 : file could not be written
+***/
+long deleteDocs (char *path, long numDocs, long docnos[], long count);
+
+/***
+    Takes the lock of the bitmap file at path, waiting for whoever holds it
+    @return >=0 : the lock, for unlockLiveDocs
+    @return -1 : the lock file couldn't be opened
+***/
+int lockLiveDocs (const char *path);
+
+/***
+    Releases a lock taken by lockLiveDocs
+***/
+void unlockLiveDocs (int lock);
@@ -0,0 +1,182 @@
+/***
+    Filename: lzblock.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: A fast LZ77 codec for the document store's blocks. The
+                 compressor finds matches of 4 or more bytes within the last
+                 64 KB through a hash of the next 4 bytes, greedily, and
+                 skips ahead faster the longer it goes without one. Its
+                 output is the LZ4 block format, sequences of
+                    token: literal length << 4 | match length - 4
+                    literal length - 15 in 255s, when the token says 15
+                    literals
+                    offset: 2 bytes little endian
+                    match length - 19 in 255s, when the token says 15
+                 the last sequence holding only literals, the last 5 bytes
+                 of the input always among them
+***/
+
+#ifndef LZBLOCK_H_INCLUDED
+#define LZBLOCK_H_INCLUDED
+#include "lzblock.h"
+#endif
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 14
+// Bytes at the end that are always literals, and where the last match starts by
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+#define LZ_MAX_OFFSET 65535
+// Misses before the compressor skips 2 bytes at a time, then 3...
+#define LZ_SKIP_SHIFT 6
+
+static uint32_t read32 (const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash4 (uint32_t value) {
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/***
+    Write the rest of a length whose token nibble is 15
+***/
+static unsigned char *putLength (unsigned char *op, long length) {
+    length -= 15;
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+/***
+    Write a sequence of literals and the match after them, matchLength 0
+    without one
+***/
+static unsigned char *putSequence (unsigned char *op, const unsigned char *literals, long numLiterals,
+                                   long offset, long matchLength) {
+    unsigned char *token = op++;
+    *token = (unsigned char)((numLiterals >= 15 ? 15 : numLiterals) << 4);
+    if (numLiterals >= 15)
+        op = putLength(op, numLiterals);
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+    if (matchLength == 0)
+        return op;
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    long length = matchLength - LZ_MIN_MATCH;
+    *token |= (unsigned char)(length >= 15 ? 15 : length);
+    if (length >= 15)
+        op = putLength(op, length);
+    return op;
+}
+
+long lzCompress (const char *source, long size, char *dest, long cap) {
+    if (cap < LZ_BOUND(size))
+        return -1;
+    const unsigned char *src = (const unsigned char *)source;
+    unsigned char *op = (unsigned char *)dest;
+    int32_t table[1 << LZ_HASH_BITS];
+    for (int i = 0; i < (1 << LZ_HASH_BITS); i++)
+        table[i] = -1;
+
+    long anchor = 0;
+    long ip = 0;
+    long limit = size - LZ_MATCH_LIMIT;
+    long matchEnd = size - LZ_LAST_LITERALS;
+    while (ip < limit) {
+        uint32_t sequence = read32(src + ip);
+        uint32_t h = hash4(sequence);
+        long ref = table[h];
+        table[h] = (int32_t)ip;
+        if (ref < 0 || ip - ref > LZ_MAX_OFFSET || read32(src + ref) != sequence) {
+            ip += 1 + ((ip - anchor) >> LZ_SKIP_SHIFT);
+            continue;
+        }
+
+        // The match may start before the bytes that hashed to it
+        while (ip > anchor && ref > 0 && src[ip-1] == src[ref-1]) {
+            ip--;
+            ref--;
+        }
+        long end = ip + LZ_MIN_MATCH;
+        long from = ref + LZ_MIN_MATCH;
+        while (end < matchEnd && src[end] == src[from]) {
+            end++;
+            from++;
+        }
+        op = putSequence(op, src + anchor, ip - anchor, ip - ref, end - ip);
+        ip = end;
+        anchor = ip;
+        if (ip - 2 < limit)
+            table[hash4(read32(src + ip - 2))] = (int32_t)(ip - 2);
+    }
+    op = putSequence(op, src + anchor, size - anchor, 0, 0);
+    return (long)(op - (unsigned char *)dest);
+}
+
+/***
+    Read the rest of a length whose token nibble is 15
+    @return : the length, -1 past the end of the input
+***/
+static long takeLength (const unsigned char **ip, const unsigned char *end, long length) {
+    unsigned char byte;
+    do {
+        if (*ip >= end)
+            return -1;
+        byte = *(*ip)++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+long lzDecompress (const char *source, long size, char *dest, long rawSize) {
+    const unsigned char *ip = (const unsigned char *)source;
+    const unsigned char *end = ip + size;
+    unsigned char *out = (unsigned char *)dest;
+    unsigned char *op = out;
+    unsigned char *outEnd = out + rawSize;
+    while (ip < end) {
+        unsigned token = *ip++;
+        long literals = token >> 4;
+        if (literals == 15 && (literals = takeLength(&ip, end, literals)) < 0)
+            return -1;
+        if (literals > end - ip || literals > outEnd - op)
+            return -1;
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        // The last sequence has no match
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return -1;
+        long offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - out)
+            return -1;
+        long length = token & 15;
+        if (length == 15 && (length = takeLength(&ip, end, length)) < 0)
+            return -1;
+        length += LZ_MIN_MATCH;
+        if (length > outEnd - op)
+            return -1;
+        const unsigned char *match = op - offset;
+        if (offset >= length) {
+            memcpy(op, match, length);
+        } else {
+            // Overlapping, a run repeating the last offset bytes
+            for (long i = 0; i < length; i++)
+                op[i] = match[i];
+        }
+        op += length;
+    }
+    return (op == outEnd) ? rawSize : -1;
+}
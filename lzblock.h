@@ -0,0 +1,40 @@
+/***
+    Filename: lzblock.h
+    Author: Benjamin Baird
+    Description: Header file for lzblock.c, a fast LZ77 codec writing the
+                 LZ4 block format, bundled for the document store
+***/
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef STDINT_H_INCLUDED
+#define STDINT_H_INCLUDED
+#include <stdint.h>
+#endif
+
+// Most bytes size bytes can compress to, incompressible input grows a little
+#define LZ_BOUND(size) ((size) + (size)/255 + 16)
+
+/***
+    Compress size bytes of source into dest, which holds cap bytes
+    @return >=0 : compressed size
+    @return -1 : cap is below LZ_BOUND(size)
+***/
+long lzCompress (const char *source, long size, char *dest, long cap);
+
+/***
+    Decompress size bytes of source, which must come to exactly rawSize
+    bytes, into dest. Malformed input is caught, never read or written
+    past its buffers
+    @return >=0 : rawSize
+    @return -1 : source is malformed or doesn't decompress to rawSize
+***/
+long lzDecompress (const char *source, long size, char *dest, long rawSize);
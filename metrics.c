@@ -0,0 +1,336 @@
+/***
+    Filename: metrics.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Metrics registry. A thread's first recording gives it a shard
+                 that only it writes, so counting is a plain add with no
+                 shared cache line. Readers take the registry lock and sum the
+                 shards, each histogram is guarded by its shard's (uncontended)
+                 lock so a snapshot never sees one half updated. A thread's
+                 shard is merged into the retired shard when it exits, so
+                 threads started per connection don't each leave one behind.
+***/
+
+#ifndef METRICS_H_INCLUDED
+#define METRICS_H_INCLUDED
+#include "metrics.h"
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+typedef struct MetricsShard {
+    long counters[NUM_COUNTERS];
+    Histogram histograms[NUM_HISTOGRAMS];
+    pthread_mutex_t lock;
+    struct MetricsShard *next;
+}MetricsShard;
+
+static const char *counterNames[NUM_COUNTERS][2] = {
+    { "boogle_queries_total", "Queries evaluated" },
+    { "boogle_query_terms_total", "Unique terms looked up in the dictionary" },
+    { "boogle_lookup_misses_total", "Query terms without a live document" },
+    { "boogle_postings_scored_total", "Postings accumulated into document scores" },
+    { "boogle_titles_total", "Titles fetched from the corpus" },
+    { "boogle_title_bytes_total", "Bytes read from the corpus for titles" },
+    { "boogle_title_errors_total", "Titles whose corpus file couldn't be opened" },
+    { "boogle_index_reloads_total", "Index generations swapped in while serving" },
+    { "boogle_index_reload_errors_total", "Published generations that failed to load" },
+    { "boogle_ingested_documents_total", "Documents added by the ingest thread" },
+    { "boogle_segment_flushes_total", "In-memory segments written out as generations" },
+    { "boogle_queries_truncated_total", "Queries whose budget ran out before every posting was scored" },
+    { "boogle_title_cache_hits_total", "Result titles found prefetched" },
+    { "boogle_snippets_total", "Result snippets cut from the corpus" },
+    { "boogle_title_queries_total", "Queries matched against the title postings alone" }
+};
+
+static const char *histogramNames[NUM_HISTOGRAMS][2] = {
+    { "boogle_query_latency_seconds", "Time to score and rank a query" },
+    { "boogle_title_latency_seconds", "Time to fetch one title" }
+};
+
+static const char *gaugeNames[NUM_GAUGES][2] = {
+    { "boogle_index_terms", "Terms in the loaded dictionary" },
+    { "boogle_index_postings", "Postings in the loaded index" },
+    { "boogle_index_documents", "Documents in the loaded index" },
+    { "boogle_index_deleted_documents", "Documents deleted since the index was built" },
+    { "boogle_segment_documents", "Ingested documents not yet flushed to a generation" }
+};
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static MetricsShard *shards = NULL;
+static __thread MetricsShard *localShard = NULL;
+// Holds the counts of the threads that exited, the first shard to retire
+static MetricsShard *retired = NULL;
+// Its destructor retires a thread's shard
+static pthread_key_t shardKey;
+static int shardKeyMade = 0;
+static long gauges[NUM_GAUGES];
+
+// The dump thread
+static pthread_t dumpThread;
+static pthread_mutex_t dumpLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dumpWake = PTHREAD_COND_INITIALIZER;
+static int dumpRunning = 0;
+static int dumpStop = 0;
+static char *dumpPath = NULL;
+static int dumpInterval = METRICS_INTERVAL;
+
+long long metricsClock (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/***
+    Key destructor, adds the shard of an exiting thread to the retired shard
+    and frees it
+***/
+static void retireShard (void *arg) {
+    MetricsShard *shard = arg;
+    localShard = NULL;
+    pthread_mutex_lock(&registryLock);
+    if (retired == NULL) {
+        retired = shard;
+        pthread_mutex_unlock(&registryLock);
+        return;
+    }
+    // Readers sum the shards under the registry lock, none is reading them
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        __atomic_store_n(&retired->counters[i], retired->counters[i] + shard->counters[i], __ATOMIC_RELAXED);
+    for (int i = 0; i < NUM_HISTOGRAMS; i++)
+        mergeHistogram(&retired->histograms[i], &shard->histograms[i]);
+    MetricsShard **link = &shards;
+    while (*link != NULL && *link != shard)
+        link = &(*link)->next;
+    if (*link != NULL)
+        *link = shard->next;
+    pthread_mutex_unlock(&registryLock);
+    pthread_mutex_destroy(&shard->lock);
+    free(shard);
+}
+
+/***
+    The calling thread's shard, registered on first use
+    @return : the shard, NULL if it couldn't be allocated
+***/
+static MetricsShard *getShard (void) {
+    if (localShard != NULL)
+        return localShard;
+
+    MetricsShard *shard = calloc(1, sizeof(MetricsShard));
+    if (shard == NULL)
+        return NULL;
+    pthread_mutex_init(&shard->lock, NULL);
+    for (int i = 0; i < NUM_HISTOGRAMS; i++)
+        initHistogram(&shard->histograms[i]);
+
+    pthread_mutex_lock(&registryLock);
+    if (!shardKeyMade)
+        shardKeyMade = pthread_key_create(&shardKey, retireShard) == 0;
+    shard->next = shards;
+    shards = shard;
+    pthread_mutex_unlock(&registryLock);
+    // Without the key the shard is only freed by freeMetrics
+    if (shardKeyMade)
+        pthread_setspecific(shardKey, shard);
+    localShard = shard;
+    return shard;
+}
+
+void countMetric (int counter, long n) {
+    MetricsShard *shard = getShard();
+    if (shard == NULL)
+        return;
+    // Only this thread writes the counter, readers just need an untorn value
+    __atomic_store_n(&shard->counters[counter], shard->counters[counter] + n, __ATOMIC_RELAXED);
+}
+
+void recordMetric (int histogram, long long nanoseconds) {
+    MetricsShard *shard = getShard();
+    if (shard == NULL)
+        return;
+    pthread_mutex_lock(&shard->lock);
+    recordValue(&shard->histograms[histogram], nanoseconds);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void setGauge (int gauge, long value) {
+    __atomic_store_n(&gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+/***
+    Resident set size of the process from /proc
+    @return >=0 : bytes resident
+    @return -1 : not available
+***/
+static long residentBytes (void) {
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL)
+        return -1;
+    long size = 0;
+    long resident = 0;
+    int ret = fscanf(fp, "%ld %ld", &size, &resident);
+    fclose(fp);
+    if (ret != 2)
+        return -1;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void writeMetrics (FILE *fp) {
+    long counters[NUM_COUNTERS] = { 0 };
+    Histogram *histograms = malloc(sizeof(Histogram)*NUM_HISTOGRAMS);
+    if (histograms == NULL)
+        return;
+    for (int i = 0; i < NUM_HISTOGRAMS; i++)
+        initHistogram(&histograms[i]);
+
+    // Sum the shards
+    pthread_mutex_lock(&registryLock);
+    for (MetricsShard *shard = shards; shard != NULL; shard = shard->next) {
+        for (int i = 0; i < NUM_COUNTERS; i++)
+            counters[i] += __atomic_load_n(&shard->counters[i], __ATOMIC_RELAXED);
+        pthread_mutex_lock(&shard->lock);
+        for (int i = 0; i < NUM_HISTOGRAMS; i++)
+            mergeHistogram(&histograms[i], &shard->histograms[i]);
+        pthread_mutex_unlock(&shard->lock);
+    }
+    pthread_mutex_unlock(&registryLock);
+
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        fprintf(fp, "# HELP %s %s\n", counterNames[i][0], counterNames[i][1]);
+        fprintf(fp, "# TYPE %s counter\n", counterNames[i][0]);
+        fprintf(fp, "%s %ld\n", counterNames[i][0], counters[i]);
+    }
+
+    double quantiles[] = { 0.5, 0.9, 0.99 };
+    for (int i = 0; i < NUM_HISTOGRAMS; i++) {
+        const char *name = histogramNames[i][0];
+        fprintf(fp, "# HELP %s %s\n", name, histogramNames[i][1]);
+        fprintf(fp, "# TYPE %s summary\n", name);
+        for (int q = 0; q < 3; q++) {
+            fprintf(fp, "%s{quantile=\"%g\"} %.9f\n", name, quantiles[q],
+                    histPercentile(&histograms[i], quantiles[q] * 100) / 1e9);
+        }
+        fprintf(fp, "%s_sum %.9f\n", name, histograms[i].sum / 1e9);
+        fprintf(fp, "%s_count %lld\n", name, histograms[i].total);
+    }
+
+    for (int i = 0; i < NUM_GAUGES; i++) {
+        fprintf(fp, "# HELP %s %s\n", gaugeNames[i][0], gaugeNames[i][1]);
+        fprintf(fp, "# TYPE %s gauge\n", gaugeNames[i][0]);
+        fprintf(fp, "%s %ld\n", gaugeNames[i][0], __atomic_load_n(&gauges[i], __ATOMIC_RELAXED));
+    }
+
+    long resident = residentBytes();
+    if (resident >= 0) {
+        fprintf(fp, "# HELP process_resident_memory_bytes Resident memory size in bytes\n");
+        fprintf(fp, "# TYPE process_resident_memory_bytes gauge\n");
+        fprintf(fp, "process_resident_memory_bytes %ld\n", resident);
+    }
+    free(histograms);
+}
+
+int dumpMetrics (char *path) {
+    char *tmpPath = malloc(strlen(path) + 5);
+    if (tmpPath == NULL)
+        return -1;
+    sprintf(tmpPath, "%s.tmp", path);
+
+    FILE *fp = fopen(tmpPath, "w");
+    if (fp == NULL) {
+        free(tmpPath);
+        return -1;
+    }
+    writeMetrics(fp);
+    int failed = ferror(fp);
+    if (fclose(fp) != 0 || failed || rename(tmpPath, path) != 0) {
+        remove(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    free(tmpPath);
+    return 0;
+}
+
+/***
+    Dump thread, writes a snapshot every interval until stopped
+***/
+static void *dumpWorker (void *arg) {
+    pthread_mutex_lock(&dumpLock);
+    while (!dumpStop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += dumpInterval;
+        while (!dumpStop && pthread_cond_timedwait(&dumpWake, &dumpLock, &wake) == 0)
+            ;
+        pthread_mutex_unlock(&dumpLock);
+        if (dumpMetrics(dumpPath) != 0)
+            printf("Could not write metrics to %s\n", dumpPath);
+        pthread_mutex_lock(&dumpLock);
+    }
+    pthread_mutex_unlock(&dumpLock);
+    return NULL;
+}
+
+int startMetricsDump (char *path, int interval) {
+    if (dumpRunning)
+        return -1;
+    dumpPath = malloc(strlen(path) + 1);
+    if (dumpPath == NULL)
+        return -1;
+    strcpy(dumpPath, path);
+    dumpInterval = (interval > 0) ? interval : METRICS_INTERVAL;
+    dumpStop = 0;
+    if (pthread_create(&dumpThread, NULL, dumpWorker, NULL) != 0) {
+        free(dumpPath);
+        dumpPath = NULL;
+        return -1;
+    }
+    dumpRunning = 1;
+    return 0;
+}
+
+void stopMetricsDump (void) {
+    if (!dumpRunning)
+        return;
+    pthread_mutex_lock(&dumpLock);
+    dumpStop = 1;
+    pthread_cond_signal(&dumpWake);
+    pthread_mutex_unlock(&dumpLock);
+    // The thread writes its last snapshot on the way out
+    pthread_join(dumpThread, NULL);
+    dumpRunning = 0;
+    free(dumpPath);
+    dumpPath = NULL;
+}
+
+void freeMetrics (void) {
+    pthread_mutex_lock(&registryLock);
+    // Threads still running mustn't retire shards freed here
+    if (shardKeyMade)
+        pthread_key_delete(shardKey);
+    shardKeyMade = 0;
+    retired = NULL;
+    while (shards != NULL) {
+        MetricsShard *next = shards->next;
+        pthread_mutex_destroy(&shards->lock);
+        free(shards);
+        shards = next;
+    }
+    pthread_mutex_unlock(&registryLock);
+    localShard = NULL;
+}
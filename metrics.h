@@ -0,0 +1,100 @@
+/***
+    Filename: metrics.h
+    Author: Benjamin Baird
+    Description: Header file for metrics.c, the process-wide counters, gauges
+                 and latency histograms of the retriever. Every thread records
+                 into its own shard, the shards are summed when read
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef HISTOGRAM_H_INCLUDED
+#define HISTOGRAM_H_INCLUDED
+#include "histogram.h"
+#endif
+
+// Seconds between the snapshots written by startMetricsDump by default
+#define METRICS_INTERVAL 10
+
+/***
+    Monotonically increasing counts
+***/
+enum { METRIC_QUERIES, METRIC_QUERY_TERMS, METRIC_LOOKUP_MISSES, METRIC_POSTINGS_SCORED,
+       METRIC_TITLES, METRIC_TITLE_BYTES, METRIC_TITLE_ERRORS, METRIC_INDEX_RELOADS,
+       METRIC_RELOAD_ERRORS, METRIC_INGESTED_DOCS, METRIC_SEGMENT_FLUSHES,
+       METRIC_QUERIES_TRUNCATED, METRIC_TITLE_CACHE_HITS,
+       METRIC_SNIPPETS, METRIC_TITLE_QUERIES, NUM_COUNTERS };
+
+/***
+    Latencies, recorded in nanoseconds
+***/
+enum { METRIC_QUERY_LATENCY, METRIC_TITLE_LATENCY, NUM_HISTOGRAMS };
+
+/***
+    Values that are set rather than counted
+***/
+enum { METRIC_INDEX_TERMS, METRIC_INDEX_POSTINGS, METRIC_INDEX_DOCS, METRIC_INDEX_DELETED,
+       METRIC_SEGMENT_DOCS, NUM_GAUGES };
+
+/***
+    @return : monotonic clock in nanoseconds, for timing latencies
+***/
+long long metricsClock (void);
+
+/***
+    Add n to a counter in the calling thread's shard
+***/
+void countMetric (int counter, long n);
+
+/***
+    Record a latency in the calling thread's shard
+***/
+void recordMetric (int histogram, long long nanoseconds);
+
+/***
+    Set a gauge
+***/
+void setGauge (int gauge, long value);
+
+/***
+    Print a snapshot of every metric in the Prometheus text format
+***/
+void writeMetrics (FILE *fp);
+
+/***
+    Write a snapshot to path, through a temporary file so readers never see
+    a partial one
+    @return 0 : success
+    @return -1 : the file couldn't be written
+***/
+int dumpMetrics (char *path);
+
+/***
+    Start a thread that dumps the metrics to path every interval seconds
+    @return 0 : success
+    @return -1 : a dump thread is already running or couldn't be started
+***/
+int startMetricsDump (char *path, int interval);
+
+/***
+    Stop the dump thread, writing a last snapshot
+***/
+void stopMetricsDump (void);
+
+/***
+    Free every shard. Only call once the other recording threads have exited
+***/
+void freeMetrics (void);
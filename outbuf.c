@@ -0,0 +1,111 @@
+/***
+    Filename: outbuf.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Output buffer for the index files. Records are formatted
+                 straight into one large buffer, numbers without going through
+                 printf's format parsing, and the file gets a few big
+                 sequential writes instead of a call per line.
+***/
+
+#ifndef OUTBUF_H_INCLUDED
+#define OUTBUF_H_INCLUDED
+#include "outbuf.h"
+#endif
+
+int initOutBuffer (OutBuffer *out, FILE *fp) {
+    out->fp = fp;
+    out->size = 0;
+    out->cap = OUT_BUFFER;
+    out->error = 0;
+    out->data = malloc(sizeof(char)*out->cap);
+    if (out->data == NULL) {
+        out->cap = 0;
+        out->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+/***
+    Makes room for length more bytes, writing out or growing the buffer
+    @return 0 : there's room
+    @return -1 : the buffer failed
+***/
+static int reserve (OutBuffer *out, long length) {
+    if (out->error)
+        return -1;
+    if (out->size + length <= out->cap)
+        return 0;
+    if (out->fp != NULL && flushOutBuffer(out) != 0)
+        return -1;
+    if (out->size + length <= out->cap)
+        return 0;
+
+    long cap = out->cap * 2;
+    while (out->size + length > cap)
+        cap *= 2;
+    char *data = realloc(out->data, sizeof(char)*cap);
+    if (data == NULL) {
+        out->error = 1;
+        return -1;
+    }
+    out->data = data;
+    out->cap = cap;
+    return 0;
+}
+
+void putBytes (OutBuffer *out, const char *str, long length) {
+    if (reserve(out, length) != 0)
+        return;
+    memcpy(out->data + out->size, str, length);
+    out->size += length;
+}
+
+void putString (OutBuffer *out, const char *str) {
+    putBytes(out, str, (long)strlen(str));
+}
+
+void putChar (OutBuffer *out, char c) {
+    if (reserve(out, 1) != 0)
+        return;
+    out->data[out->size++] = c;
+}
+
+void putLong (OutBuffer *out, long value) {
+    // 20 digits and a sign cover every long
+    if (reserve(out, 21) != 0)
+        return;
+    char digits[21];
+    int length = 0;
+    unsigned long magnitude = (value < 0) ? -(unsigned long)value : (unsigned long)value;
+    do {
+        digits[sizeof(digits) - 1 - length++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+        digits[sizeof(digits) - 1 - length++] = '-';
+    memcpy(out->data + out->size, digits + sizeof(digits) - length, length);
+    out->size += length;
+}
+
+int flushOutBuffer (OutBuffer *out) {
+    if (out->error)
+        return -1;
+    if (out->fp != NULL && out->size > 0) {
+        if ((long)fwrite(out->data, 1, out->size, out->fp) != out->size) {
+            out->error = 1;
+            return -1;
+        }
+        out->size = 0;
+    }
+    return 0;
+}
+
+void freeOutBuffer (OutBuffer *out) {
+    free(out->data);
+    out->data = NULL;
+    out->size = 0;
+    out->cap = 0;
+}
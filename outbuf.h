@@ -0,0 +1,75 @@
+/***
+    Filename: outbuf.h
+    Author: Benjamin Baird
+    Description: Header file for outbuf.c, a large output buffer with fast
+                 integer formatting for writing the index files
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+// Bytes gathered before each write to a file
+#define OUT_BUFFER 4194304
+
+/***
+    Text gathered in memory and written to fp in OUT_BUFFER sized pieces.
+    Without a file the buffer grows to hold everything written to it
+***/
+typedef struct OutBuffer {
+    FILE *fp;
+    char *data;
+    long size;
+    long cap;
+    int error;      // a write or allocation failed, later puts are dropped
+}OutBuffer;
+
+/***
+    Initializes a buffer writing to fp, or held in memory when fp is NULL
+    @return 0 : success
+    @return -1 : out of memory
+***/
+int initOutBuffer (OutBuffer *out, FILE *fp);
+
+/***
+    Appends length bytes of str
+***/
+void putBytes (OutBuffer *out, const char *str, long length);
+
+/***
+    Appends a '\0' terminated string
+***/
+void putString (OutBuffer *out, const char *str);
+
+/***
+    Appends a character
+***/
+void putChar (OutBuffer *out, char c);
+
+/***
+    Appends a number in decimal
+***/
+void putLong (OutBuffer *out, long value);
+
+/***
+    Writes the buffered bytes to the buffer's file
+    @return 0 : success
+    @return -1 : a write failed now or earlier
+***/
+int flushOutBuffer (OutBuffer *out);
+
+/***
+    Frees the buffer, without flushing it
+***/
+void freeOutBuffer (OutBuffer *out);
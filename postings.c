@@ -0,0 +1,119 @@
+/***
+    Filename: postings.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Scoring kernels over the structure-of-arrays postings.
+                 Weights are computed a block at a time into a small buffer
+                 (vectorizable), then scattered into the accumulator.
+                 Each scoring model has its own kernel, chosen once per term,
+                 so the per-posting loops carry no model dispatch.
+***/
+
+#ifndef POSTINGS_H_INCLUDED
+#define POSTINGS_H_INCLUDED
+#include "postings.h"
+#endif
+
+void weighPostings (const uint16_t * restrict tf, long count, double idf, double queryWeight,
+                    double * restrict weights) {
+    for (long k = 0; k < count; k++) {
+        weights[k] = ((double)tf[k] * idf) * queryWeight;
+    }
+}
+
+void scatterPostings (const uint32_t * restrict docno, const double * restrict weights, long count,
+                      double docMatrix[]) {
+    for (long k = 0; k < count; k++) {
+        docMatrix[docno[k]] += weights[k];
+    }
+}
+
+long addImpact (const uint32_t * restrict docno, long count, double weight, double docMatrix[],
+                long * restrict touched) {
+    long numTouched = 0;
+    for (long k = 0; k < count; k++) {
+        touched[numTouched] = docno[k];
+        numTouched += (docMatrix[docno[k]] == 0);
+        docMatrix[docno[k]] += weight;
+    }
+    return numTouched;
+}
+
+void scorePostings (PostColumns *pIndex, long start, long count, double idf,
+                    double queryWeight, double docMatrix[]) {
+    double weights[POST_BLOCK];
+
+    for (long k = start; k < start + count; k += POST_BLOCK) {
+        long run = start + count - k;
+        if (run > POST_BLOCK)
+            run = POST_BLOCK;
+        weighPostings(pIndex->tf + k, run, idf, queryWeight, weights);
+        scatterPostings(pIndex->docno + k, weights, run, docMatrix);
+    }
+}
+
+/***
+    BM25 weights of a run of postings, the lengths are gathered by docno
+***/
+static void weighBM25 (const uint32_t * restrict docno, const uint16_t * restrict tf, long count,
+                       const OkapiTerm *term, double * restrict weights) {
+    const uint32_t * restrict length = term->length;
+    double base = term->base;
+    double slope = term->slope;
+    double weight = term->weight;
+    for (long k = 0; k < count; k++) {
+        double f = tf[k];
+        weights[k] = weight * f / (f + base + slope * length[docno[k]]);
+    }
+}
+
+void scoreBM25 (PostColumns *pIndex, long start, long count, OkapiTerm *term,
+                double docMatrix[]) {
+    double weights[POST_BLOCK];
+
+    for (long k = start; k < start + count; k += POST_BLOCK) {
+        long run = start + count - k;
+        if (run > POST_BLOCK)
+            run = POST_BLOCK;
+        weighBM25(pIndex->docno + k, pIndex->tf + k, run, term, weights);
+        scatterPostings(pIndex->docno + k, weights, run, docMatrix);
+    }
+}
+
+void scoreBM25F (PostColumns *pIndex, long start, long count, OkapiTerm *term,
+                 double docMatrix[]) {
+    double pseudo[POST_BLOCK];
+    const uint32_t * restrict length = term->length;
+    long t = 0;
+
+    for (long k = start; k < start + count; k += POST_BLOCK) {
+        long run = start + count - k;
+        if (run > POST_BLOCK)
+            run = POST_BLOCK;
+        const uint32_t *docno = pIndex->docno + k;
+        const uint16_t *tf = pIndex->tf + k;
+
+        // Every occurrence counted in the body first
+        for (long i = 0; i < run; i++)
+            pseudo[i] = tf[i] / (term->base + term->slope * length[docno[i]]);
+
+        // Then the title's moved out of the body, both lists are in docno order
+        for (long i = 0; i < run && t < term->titleCount; i++) {
+            while (t < term->titleCount && term->titleDocno[t] < docno[i])
+                t++;
+            if (t == term->titleCount || term->titleDocno[t] != docno[i])
+                continue;
+            long d = docno[i];
+            double titleTf = term->titleTf[t++];
+            double bodyTf = (tf[i] > titleTf) ? tf[i] - titleTf : 0;
+            pseudo[i] = titleTf / (term->titleBase + term->titleSlope * term->titleLength[d]);
+            if (bodyTf > 0)
+                pseudo[i] += bodyTf / (term->base + term->slope * length[d]);
+        }
+
+        for (long i = 0; i < run; i++)
+            pseudo[i] = term->weight * pseudo[i] / (pseudo[i] + term->k1);
+        scatterPostings(docno, pseudo, run, docMatrix);
+    }
+}
@@ -0,0 +1,79 @@
+/***
+    Filename: postings.h
+    Author: Benjamin Baird
+    Description: Header file for postings.c, scoring kernels that run over
+                 the PostColumns posting columns
+***/
+
+#ifndef INDEXES_H_INCLUDED
+#define INDEXES_H_INCLUDED
+#include "indexes.h"
+#endif
+
+// Number of postings weighted per block, sized to stay in L1
+#define POST_BLOCK 256
+
+/***
+    Weight a run of tfs: weights[k] = (tf[k] * idf) * queryWeight
+    Written as a flat loop over narrow tfs so the compiler vectorizes it
+***/
+void weighPostings (const uint16_t *tf, long count, double idf, double queryWeight,
+                    double *weights);
+
+/***
+    Scatter-add a run of weights into the document accumulator
+***/
+void scatterPostings (const uint32_t *docno, const double *weights, long count,
+                      double docMatrix[]);
+
+/***
+    Add the same weight, which must be positive, to the accumulator of
+    count documents
+        docMatrix[docno] += weight
+    @return : documents that were 0 before, their docnos written to touched
+***/
+long addImpact (const uint32_t *docno, long count, double weight, double docMatrix[], long *touched);
+
+/***
+    Score count postings of a term starting at start into docMatrix
+        docMatrix[docno] += tf * idf * queryWeight
+***/
+void scorePostings (PostColumns *pIndex, long start, long count, double idf,
+                    double queryWeight, double docMatrix[]);
+
+/***
+    What the BM25 kernels need of a term and the documents' lengths. A
+    document's length normalization is base + slope * length, with k1 and
+    the average length folded into base and slope
+***/
+typedef struct OkapiTerm {
+    double weight;              // idf * (k1 + 1) * tf of the term in the query
+    double k1;
+    double base;                // BM25: k1 * (1 - b), BM25F: of the body, 1 - b
+    double slope;               // BM25: k1 * b / average length, BM25F: of the body
+    const uint32_t *length;     // length of each document (of each body for BM25F)
+    double titleBase;           // BM25F: (1 - b) / title weight
+    double titleSlope;          // BM25F: b / (average title length * title weight)
+    const uint32_t *titleLength;
+    const uint32_t *titleDocno; // BM25F: the term's title postings, ascending and a
+    const uint32_t *titleTf;    // subset of its documents
+    long titleCount;
+}OkapiTerm;
+
+/***
+    Score count postings of a term starting at start into docMatrix by BM25
+        docMatrix[docno] += weight * tf / (tf + base + slope * length[docno])
+***/
+void scoreBM25 (PostColumns *pIndex, long start, long count, OkapiTerm *term,
+                double docMatrix[]);
+
+/***
+    Score count postings of a term starting at start into docMatrix by
+    BM25F over the title and body, the title tfs merged in from the term's
+    title postings
+        pseudo = bodyTf / (base + slope * bodyLength)
+                 + titleTf / (titleBase + titleSlope * titleLength)
+        docMatrix[docno] += weight * pseudo / (pseudo + k1)
+***/
+void scoreBM25F (PostColumns *pIndex, long start, long count, OkapiTerm *term,
+                 double docMatrix[]);
@@ -0,0 +1,327 @@
+/***
+    Filename: postload.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Parallel postings.txt loader. The file is mapped and cut into
+                 line aligned chunks, one per thread. A first pass counts each
+                 chunk's lines so every thread knows the posting number it
+                 starts at, a second parses the chunks into the columns and
+                 adds the squared weights into per-thread document norms, and
+                 a third sums the partial norms over ranges of documents.
+                 Numbers are parsed by a plain digit loop, without the
+                 locale and format handling fscanf pays for on every line.
+***/
+
+#ifndef POSTLOAD_H_INCLUDED
+#define POSTLOAD_H_INCLUDED
+#include "postload.h"
+#endif
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "engine.h"
+#endif
+
+#ifndef MATH_H_INCLUDED
+#define MATH_H_INCLUDED
+#include <math.h>
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+#ifndef MMAN_H_INCLUDED
+#define MMAN_H_INCLUDED
+#include <sys/mman.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+/***
+    One thread's share of the file and of the work
+***/
+typedef struct LoadChunk {
+    const char *begin;
+    const char *end;        // just past the chunk's last newline
+    long first;             // posting number of the chunk's first line
+    long lines;
+    double *norms;          // this thread's partial norms
+    long normBegin;         // documents summed by this thread in the last pass
+    long normEnd;
+    int error;
+    // Shared by every chunk
+    DictIndex *dict;
+    long dictSize;
+    long numDocs;
+    PostColumns *post;
+    double **partials;
+    int numPartials;
+    double *result;
+}LoadChunk;
+
+/***
+    Reads a non-negative decimal number, skipping leading blanks
+    @return : the character after the number, NULL if there's no number
+***/
+static const char *parseNumber (const char *p, const char *end, long *value) {
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p == end || (unsigned)(*p - '0') > 9)
+        return NULL;
+    long v = 0;
+    int digits = 0;
+    while (p < end && (unsigned)(*p - '0') <= 9) {
+        v = v * 10 + (*p - '0');
+        p++;
+        digits++;
+    }
+    // 18 digits can't overflow a long
+    if (digits > 18)
+        return NULL;
+    *value = v;
+    return p;
+}
+
+/***
+    Counts the lines of a chunk, a last line without a newline included
+***/
+static void *countLines (void *arg) {
+    LoadChunk *chunk = arg;
+    long lines = 0;
+    const char *p = chunk->begin;
+    while (p < chunk->end) {
+        const char *newline = memchr(p, '\n', chunk->end - p);
+        if (newline == NULL) {
+            lines++;
+            break;
+        }
+        lines++;
+        p = newline + 1;
+    }
+    chunk->lines = lines;
+    return NULL;
+}
+
+/***
+    Last dictionary entry starting at or before posting i, the entry holding
+    it since terms without postings share the next term's start
+***/
+static long entryOf (DictIndex dict[], long dictSize, long i) {
+    long low = 0;
+    long high = dictSize - 1;
+    while (low < high) {
+        long middle = low + (high - low + 1) / 2;
+        if (dict[middle].postIndex <= i)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+/***
+    Parses a chunk's postings into the columns and its norms
+***/
+static void *parseChunk (void *arg) {
+    LoadChunk *chunk = arg;
+    DictIndex *dict = chunk->dict;
+    PostColumns *post = chunk->post;
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+    if (chunk->lines == 0)
+        return NULL;
+
+    long entry = entryOf(dict, chunk->dictSize, chunk->first);
+    long last = dict[entry].postIndex + dict[entry].df - 1;
+    double idf = tfidf(1.0, chunk->numDocs, dict[entry].df);
+    for (long i = chunk->first; i < chunk->first + chunk->lines; i++) {
+        while (i > last) {
+            entry++;
+            last = dict[entry].postIndex + dict[entry].df - 1;
+            idf = tfidf(1.0, chunk->numDocs, dict[entry].df);
+        }
+
+        long docno = 0;
+        long tf = 0;
+        p = parseNumber(p, end, &docno);
+        if (p != NULL)
+            p = parseNumber(p, end, &tf);
+        if (p == NULL || docno >= chunk->numDocs) {
+            chunk->error = 1;
+            return NULL;
+        }
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+        if (p < end) {
+            if (*p != '\n') {
+                chunk->error = 1;
+                return NULL;
+            }
+            p++;
+        }
+
+        setPost(post, i, docno, tf);
+        // The same weight as tfidf(tf, numDocs, df), squared
+        double weight = post->tf[i] * idf;
+        chunk->norms[docno] += weight * weight;
+    }
+    return NULL;
+}
+
+/***
+    Sums the partial norms of a range of documents
+***/
+static void *sumNorms (void *arg) {
+    LoadChunk *chunk = arg;
+    for (long d = chunk->normBegin; d < chunk->normEnd; d++) {
+        double norm = chunk->result[d];
+        for (int t = 0; t < chunk->numPartials; t++)
+            norm += chunk->partials[t][d];
+        chunk->result[d] = sqrt(norm);
+    }
+    return NULL;
+}
+
+/***
+    Runs work on every chunk, the first on the calling thread
+***/
+static void runChunks (LoadChunk chunks[], int numChunks, void *(*work)(void *)) {
+    pthread_t *threads = malloc(sizeof(pthread_t)*numChunks);
+    int *started = calloc(numChunks, sizeof(int));
+    for (int t = 1; t < numChunks; t++) {
+        if (threads != NULL && started != NULL
+            && pthread_create(&threads[t], NULL, work, &chunks[t]) == 0)
+            started[t] = 1;
+    }
+    work(&chunks[0]);
+    for (int t = 1; t < numChunks; t++) {
+        if (started != NULL && started[t])
+            pthread_join(threads[t], NULL);
+        else
+            work(&chunks[t]);
+    }
+    free(threads);
+    free(started);
+}
+
+int loadPostings (char *path, DictIndex dict[], long dictSize, long numDocs, PostColumns *post,
+                  double *norms) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    long size = (long)info.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return -1;
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+    const char *end = data + size;
+
+    // Header: the number of postings, which the dfs must add up to
+    long postSize = 0;
+    const char *body = parseNumber(data, end, &postSize);
+    long expected = (dictSize > 0) ? dict[dictSize-1].postIndex + dict[dictSize-1].df : 0;
+    if (body != NULL)
+        body = memchr(body, '\n', end - body);
+    if (body == NULL || postSize != expected) {
+        munmap((void *)data, size);
+        return -1;
+    }
+    body++;
+
+    // Cut the body into line aligned chunks, keeping the partial norms in budget
+    long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numThreads < 1 || end - body < LOAD_PARALLEL_BYTES)
+        numThreads = 1;
+    long maxThreads = LOAD_NORM_BUDGET / ((numDocs > 0 ? numDocs : 1) * (long)sizeof(double));
+    if (numThreads > maxThreads)
+        numThreads = (maxThreads > 1) ? maxThreads : 1;
+
+    LoadChunk *chunks = calloc(numThreads, sizeof(LoadChunk));
+    double **partials = calloc(numThreads, sizeof(double*));
+    *post = initPostColumns(postSize);
+    int ret = (chunks == NULL || partials == NULL || (postSize > 0 && (post->docno == NULL || post->tf == NULL))) ? -1 : 0;
+    for (long t = 1; ret == 0 && t < numThreads; t++) {
+        partials[t] = calloc(numDocs > 0 ? numDocs : 1, sizeof(double));
+        if (partials[t] == NULL)
+            ret = -1;
+    }
+    if (ret == 0) {
+        partials[0] = norms;
+        const char *p = body;
+        for (long t = 0; t < numThreads; t++) {
+            const char *cut = body + (end - body) * (t + 1) / numThreads;
+            if (t == numThreads - 1 || cut <= p) {
+                cut = (t == numThreads - 1) ? end : p;
+            } else {
+                const char *newline = memchr(cut - 1, '\n', end - (cut - 1));
+                cut = (newline == NULL) ? end : newline + 1;
+            }
+            chunks[t].begin = p;
+            chunks[t].end = cut;
+            chunks[t].norms = partials[t];
+            chunks[t].dict = dict;
+            chunks[t].dictSize = dictSize;
+            chunks[t].numDocs = numDocs;
+            chunks[t].post = post;
+            chunks[t].partials = partials + 1;
+            chunks[t].numPartials = (int)numThreads - 1;
+            chunks[t].result = norms;
+            p = cut;
+        }
+
+        runChunks(chunks, numThreads, countLines);
+        long lines = 0;
+        for (long t = 0; t < numThreads; t++) {
+            chunks[t].first = lines;
+            lines += chunks[t].lines;
+        }
+        if (lines != postSize)
+            ret = -1;
+    }
+    if (ret == 0) {
+        runChunks(chunks, numThreads, parseChunk);
+        for (long t = 0; t < numThreads; t++) {
+            if (chunks[t].error)
+                ret = -1;
+        }
+    }
+    if (ret == 0) {
+        // Each thread adds every partial into the norms of its documents
+        for (long t = 0; t < numThreads; t++) {
+            chunks[t].normBegin = numDocs * t / numThreads;
+            chunks[t].normEnd = numDocs * (t + 1) / numThreads;
+        }
+        runChunks(chunks, numThreads, sumNorms);
+    }
+
+    for (long t = 1; partials != NULL && t < numThreads; t++)
+        free(partials[t]);
+    free(partials);
+    free(chunks);
+    munmap((void *)data, size);
+    if (ret != 0)
+        freePostColumns(post);
+    return ret;
+}
@@ -0,0 +1,45 @@
+/***
+    Filename: postload.h
+    Author: Benjamin Baird
+    Description: Header file for postload.c, the parallel loader of
+                 postings.txt used at retriever startup
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef INDEXES_H_INCLUDED
+#define INDEXES_H_INCLUDED
+#include "indexes.h"
+#endif
+
+// Postings files smaller than this are parsed by a single thread
+#define LOAD_PARALLEL_BYTES 1048576
+
+// Memory allowed for the threads' partial document norms
+#define LOAD_NORM_BUDGET 268435456
+
+/***
+    Maps a postings file and parses it on up to one thread per core into
+    post, summing the squared tf-idf weight of every posting into norms and
+    taking their square roots.
+    @call dict : the loaded dictionary, whose dfs say which term each posting
+                 belongs to and must add up to the postings count
+    @call norms : numDocs zeroed doubles, the documents' vector magnitudes
+    @return 0 : success
+    @return -1 : the file is missing, malformed or doesn't match dict
+***/
+int loadPostings (char *path, DictIndex dict[], long dictSize, long numDocs, PostColumns *post,
+                  double *norms);
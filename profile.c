@@ -0,0 +1,60 @@
+/***
+    Filename: profile.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Printing of query profiles. Split out of engine.c so the
+                 library's header doesn't need the index structures.
+***/
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+#include "profile.h"
+#endif
+
+static const char *phaseNames[NUM_PHASES] = {
+    "tokenize", "lookup", "score", "normalize", "sort", "titles", "snippets"
+};
+
+void initProfile (QueryProfile *profile) {
+    memset(profile, 0, sizeof(QueryProfile));
+}
+
+void printProfile (FILE *fp, QueryProfile *profile) {
+    double total = 0;
+    for (int i = 0; i < NUM_PHASES; i++)
+        total += profile->phase[i];
+
+    fprintf(fp, "---- Query profile ----\n");
+    for (int i = 0; i < NUM_PHASES; i++) {
+        fprintf(fp, "%-10s %10.3f ms %5.1f%%\n", phaseNames[i], profile->phase[i] * 1e3,
+                total > 0 ? 100 * profile->phase[i] / total : 0.0);
+    }
+    fprintf(fp, "%-10s %10.3f ms\n", "total", total * 1e3);
+    fprintf(fp, "terms %ld (%ld found), postings scored %ld, docs touched %ld\n",
+            profile->terms, profile->termsFound, profile->postingsScored, profile->docsTouched);
+    if (profile->termsDropped > 0)
+        fprintf(fp, "long query, %ld common terms dropped\n", profile->termsDropped);
+    if (profile->truncated > 0)
+        fprintf(fp, "inexact, budget ran out with %ld postings left\n", profile->postingsSkipped);
+    fprintf(fp, "titles fetched %ld, %ld bytes read, %ld prefetched\n",
+            profile->titlesFetched, profile->titleBytes, profile->titlesCached);
+    if (profile->snippetBytes > 0)
+        fprintf(fp, "snippet bytes read %ld\n", profile->snippetBytes);
+    if (profile->shardsFailed > 0)
+        fprintf(fp, "partial, %ld shards didn't answer\n", profile->shardsFailed);
+}
+
+void printProfileJson (FILE *fp, QueryProfile *profile) {
+    fprintf(fp, "{");
+    for (int i = 0; i < NUM_PHASES; i++)
+        fprintf(fp, "\"%s_ms\":%.6f,", phaseNames[i], profile->phase[i] * 1e3);
+    fprintf(fp, "\"terms\":%ld,\"terms_found\":%ld,\"terms_dropped\":%ld,\"postings_scored\":%ld,"
+            "\"postings_skipped\":%ld,\"exact\":%s,"
+            "\"docs_touched\":%ld,\"titles_fetched\":%ld,\"title_bytes\":%ld,"
+            "\"titles_cached\":%ld,\"snippet_bytes\":%ld,\"shards_failed\":%ld}",
+            profile->terms, profile->termsFound, profile->termsDropped, profile->postingsScored,
+            profile->postingsSkipped, (profile->truncated > 0) ? "false" : "true",
+            profile->docsTouched, profile->titlesFetched, profile->titleBytes,
+            profile->titlesCached, profile->snippetBytes, profile->shardsFailed);
+}
@@ -0,0 +1,57 @@
+/***
+    Filename: profile.h
+    Author: Benjamin Baird
+    Description: Header file for profile.c, the per-query breakdown of where
+                 the engine spent its time, filled in by engine.c
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+/***
+    Phases of a query timed by a QueryProfile
+***/
+enum { PHASE_TOKENIZE, PHASE_LOOKUP, PHASE_SCORE, PHASE_NORMALIZE, PHASE_SORT,
+       PHASE_TITLES, PHASE_SNIPPETS, NUM_PHASES };
+
+/***
+    Where one query spent its time and how much work it did. Filled in by
+    retrieveResults, getTitle and getSnippet when they're given one
+***/
+typedef struct QueryProfile {
+    double phase[NUM_PHASES];   // seconds spent in each phase
+    long terms;                 // unique query terms
+    long termsFound;            // terms with a live document frequency
+    long termsDropped;          // common terms left out of long queries
+    long postingsScored;        // postings accumulated into documents
+    long postingsSkipped;       // impact postings left when the budget ran out
+    long truncated;             // queries whose budget ran out, inexact results
+    long docsTouched;           // documents with a non-zero score
+    long titlesFetched;
+    long titleBytes;            // bytes read from the corpus for titles
+    long titlesCached;          // titles found prefetched
+    long snippetBytes;          // bytes read from the corpus for snippets
+    long shardsFailed;          // shards that didn't answer, partial results
+}QueryProfile;
+
+/***
+    Reset a profile before a query
+***/
+void initProfile (QueryProfile *profile);
+
+/***
+    Print a profile as a human readable breakdown
+***/
+void printProfile (FILE *fp, QueryProfile *profile);
+
+/***
+    Print a profile as a JSON object, without a trailing newline
+***/
+void printProfileJson (FILE *fp, QueryProfile *profile);
@@ -0,0 +1,303 @@
+/***
+    Filename: reload.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Hot index reload. The reload thread polls the manifest and
+                 loads a new generation next to the one being served, then
+                 swaps the current snapshot pointer. Documents deleted from
+                 the served generation are picked up the same way, loading
+                 only the new bitmap into a snapshot that shares the rest of
+                 the generation. The
+                 ingest thread swaps in snapshots combining the generation
+                 with the segment of documents it has added, through the
+                 same publishIndex.
+                 Queries hold a reference to the snapshot they started on,
+                 so a swap never waits for them and the old index is freed
+                 by whichever of the reload thread or the last query drops
+                 it. The lock only covers the pointer and the counts: taking
+                 a reference without it could race with the snapshot being
+                 freed.
+***/
+
+#ifndef RELOAD_H_INCLUDED
+#define RELOAD_H_INCLUDED
+#include "reload.h"
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+Snapshot *newSnapshot (Index *index) {
+    Snapshot *snapshot = malloc(sizeof(Snapshot));
+    if (snapshot == NULL) {
+        freeIndex(index);
+        return NULL;
+    }
+    snapshot->index = *index;
+    snapshot->refs = 1;
+    snapshot->generation = NULL;
+    snapshot->segment = NULL;
+    snapshot->base = NULL;
+    return snapshot;
+}
+
+int initReloader (Reloader *reloader, Index *index, Warmup *warmup) {
+    reloader->generation = newSnapshot(index);
+    if (reloader->generation == NULL)
+        return -1;
+    // Held as both the generation and the current snapshot
+    reloader->generation->refs = 2;
+    reloader->current = reloader->generation;
+    reloader->warmup = warmup;
+    reloader->failed[0] = '\0';
+    reloader->hotTerms = NULL;
+    reloader->queries = 0;
+    reloader->queriesSaved = 0;
+    reloader->running = 0;
+    reloader->stop = 0;
+    pthread_mutex_init(&reloader->lock, NULL);
+    pthread_cond_init(&reloader->wake, NULL);
+    return 0;
+}
+
+Snapshot *acquireIndex (Reloader *reloader) {
+    pthread_mutex_lock(&reloader->lock);
+    Snapshot *snapshot = reloader->current;
+    snapshot->refs++;
+    pthread_mutex_unlock(&reloader->lock);
+    return snapshot;
+}
+
+void holdIndex (Reloader *reloader, Snapshot *snapshot) {
+    pthread_mutex_lock(&reloader->lock);
+    snapshot->refs++;
+    pthread_mutex_unlock(&reloader->lock);
+}
+
+void releaseIndex (Reloader *reloader, Snapshot *snapshot) {
+    pthread_mutex_lock(&reloader->lock);
+    int refs = --snapshot->refs;
+    pthread_mutex_unlock(&reloader->lock);
+    if (refs > 0)
+        return;
+    if (snapshot->generation != NULL) {
+        // Combined, the arrays belong to its parts
+        releaseIndex(reloader, snapshot->generation);
+        releaseIndex(reloader, snapshot->segment);
+    } else if (snapshot->base != NULL) {
+        freeLiveDocs(snapshot->index.live);
+        free(snapshot->index.live);
+        free(snapshot->index.liveDf);
+        releaseIndex(reloader, snapshot->base);
+    } else {
+        freeIndex(&snapshot->index);
+    }
+    free(snapshot);
+}
+
+/***
+    Apply the bitmap deleted.bin was rewritten with to the served generation,
+    without changing the one running queries read
+    @return : snapshot with one reference, NULL if the bitmap couldn't be
+              read or out of memory
+***/
+static Snapshot *applyLiveDocs (Reloader *reloader, Snapshot *served) {
+    // Every bitmap applies to the generation that owns the arrays, not to the last one
+    Snapshot *base = (served->base != NULL) ? served->base : served;
+    Snapshot *snapshot = malloc(sizeof(Snapshot));
+    LiveDocs *live = malloc(sizeof(LiveDocs));
+    long *cache = newLiveDfCache(base->index.dictSize);
+    if (snapshot == NULL || live == NULL || cache == NULL) {
+        free(snapshot);
+        free(live);
+        free(cache);
+        return NULL;
+    }
+    initLiveDocs(live, base->index.numDocs);
+    if (loadLiveDocs(live, base->index.liveDocsPath) != 0) {
+        fprintf(stderr, "Reload: could not read %s, still serving the deleted documents before\n",
+                base->index.liveDocsPath);
+        freeLiveDocs(live);
+        free(live);
+        free(cache);
+        free(snapshot);
+        return NULL;
+    }
+    snapshot->index = base->index;
+    snapshot->index.live = live;
+    snapshot->index.liveDf = cache;
+    snapshot->refs = 1;
+    snapshot->generation = NULL;
+    snapshot->segment = NULL;
+    snapshot->base = base;
+    holdIndex(reloader, base);
+    return snapshot;
+}
+
+int pollGeneration (Reloader *reloader, Snapshot **next) {
+    char dir[GENERATION_NAME];
+    // Only the publishing thread replaces generation, it can be read without a reference
+    Index *served = &reloader->generation->index;
+    if (currentGeneration(dir, sizeof(dir)) != 0 || strcmp(dir, reloader->failed) == 0)
+        return 0;
+    // Deleting documents rewrites deleted.bin, the new bitmap goes in a new
+    // snapshot rather than changing the one under running queries
+    if (strcmp(dir, served->dir) == 0) {
+        if (!liveDocsChanged(served->live, served->liveDocsPath))
+            return 0;
+        *next = applyLiveDocs(reloader, reloader->generation);
+        if (*next == NULL)
+            return -1;
+        fprintf(stderr, "Reload: %ld documents of %s deleted\n", (*next)->index.live->numDeleted, dir);
+        return 1;
+    }
+
+    double start = metricsClock() / 1e9;
+    Index index;
+    if (loadIndexFrom(&index, dir) != 0 || index.files == NULL || checkIndexFiles(&index) != 0) {
+        fprintf(stderr, "Reload: could not load %s, still serving %s\n", dir, served->dir);
+        freeIndex(&index);
+        snprintf(reloader->failed, sizeof(reloader->failed), "%s", dir);
+        countMetric(METRIC_RELOAD_ERRORS, 1);
+        return -1;
+    }
+    *next = newSnapshot(&index);
+    if (*next == NULL)
+        return -1;
+    fprintf(stderr, "Reload: loaded %s, %ld documents and %ld terms in %.2f s\n", dir,
+            index.numDocs, index.dictSize, metricsClock() / 1e9 - start);
+    return 1;
+}
+
+int publishIndex (Reloader *reloader, Snapshot *generation, Snapshot *segment) {
+    Snapshot *next = generation;
+    if (segment != NULL) {
+        next = malloc(sizeof(Snapshot));
+        if (next == NULL)
+            return -1;
+        next->index = generation->index;
+        next->index.segment = &segment->index;
+        next->refs = 0;
+        next->generation = generation;
+        next->segment = segment;
+        next->base = NULL;
+    }
+
+    Snapshot *oldGeneration = reloader->generation;
+    int replaced = (generation != oldGeneration);
+    // A new bitmap over the same arrays keeps the hot terms and the warmup
+    int reloaded = replaced && generation->index.dictIndex != oldGeneration->index.dictIndex;
+    if (reloaded) {
+        carryHotTerms(&oldGeneration->index, &generation->index);
+        // The warmup reads the old generation, it must stop before that can be freed
+        if (reloader->warmup != NULL)
+            stopWarmup(reloader->warmup);
+    }
+
+    pthread_mutex_lock(&reloader->lock);
+    if (segment != NULL) {
+        generation->refs++;
+        segment->refs++;
+    }
+    next->refs++;
+    if (replaced)
+        generation->refs++;
+    Snapshot *old = reloader->current;
+    reloader->current = next;
+    reloader->generation = generation;
+    pthread_mutex_unlock(&reloader->lock);
+    releaseIndex(reloader, old);
+
+    if (replaced) {
+        releaseIndex(reloader, oldGeneration);
+        setIndexGauges(&generation->index);
+        countMetric(METRIC_INDEX_RELOADS, 1);
+    }
+    if (reloaded) {
+        fprintf(stderr, "Reload: serving %s\n", generation->index.dir);
+        if (reloader->warmup != NULL)
+            startWarmup(reloader->warmup, &generation->index);
+    }
+    return 0;
+}
+
+int reloadIndex (Reloader *reloader) {
+    Snapshot *next;
+    int ret = pollGeneration(reloader, &next);
+    if (ret != 1)
+        return ret;
+    ret = publishIndex(reloader, next, NULL);
+    releaseIndex(reloader, next);
+    return (ret == 0) ? 1 : -1;
+}
+
+void countQuery (Reloader *reloader) {
+    __atomic_add_fetch(&reloader->queries, 1, __ATOMIC_RELAXED);
+}
+
+void saveHotTermsDue (Reloader *reloader) {
+    long queries = __atomic_load_n(&reloader->queries, __ATOMIC_RELAXED);
+    if (reloader->hotTerms == NULL || queries - reloader->queriesSaved < HOT_TERMS_SAVE)
+        return;
+    reloader->queriesSaved = queries;
+    // Only this thread replaces the generation, it can be read without a reference
+    if (saveHotTerms(&reloader->generation->index, reloader->hotTerms) != 0)
+        fprintf(stderr, "Reload: could not save %s\n", reloader->hotTerms);
+}
+
+/***
+    Reload thread, checks the manifest every RELOAD_INTERVAL until stopped
+***/
+static void *reloadWorker (void *arg) {
+    Reloader *reloader = arg;
+    pthread_mutex_lock(&reloader->lock);
+    while (!reloader->stop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += RELOAD_INTERVAL;
+        while (!reloader->stop && pthread_cond_timedwait(&reloader->wake, &reloader->lock, &wake) == 0)
+            ;
+        if (reloader->stop)
+            break;
+        pthread_mutex_unlock(&reloader->lock);
+        reloadIndex(reloader);
+        saveHotTermsDue(reloader);
+        pthread_mutex_lock(&reloader->lock);
+    }
+    pthread_mutex_unlock(&reloader->lock);
+    return NULL;
+}
+
+int startReloader (Reloader *reloader) {
+    if (reloader->running)
+        return -1;
+    reloader->stop = 0;
+    if (pthread_create(&reloader->thread, NULL, reloadWorker, reloader) != 0)
+        return -1;
+    reloader->running = 1;
+    return 0;
+}
+
+void stopReloader (Reloader *reloader) {
+    if (!reloader->running)
+        return;
+    pthread_mutex_lock(&reloader->lock);
+    reloader->stop = 1;
+    pthread_cond_signal(&reloader->wake);
+    pthread_mutex_unlock(&reloader->lock);
+    pthread_join(reloader->thread, NULL);
+    reloader->running = 0;
+}
+
+void freeReloader (Reloader *reloader) {
+    stopReloader(reloader);
+    releaseIndex(reloader, reloader->current);
+    releaseIndex(reloader, reloader->generation);
+    reloader->current = NULL;
+    reloader->generation = NULL;
+    pthread_cond_destroy(&reloader->wake);
+    pthread_mutex_destroy(&reloader->lock);
+}
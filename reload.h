@@ -0,0 +1,149 @@
+/***
+    Filename: reload.h
+    Author: Benjamin Baird
+    Description: Header file for reload.c, the reference counted index
+                 snapshots the retriever serves and the thread that swaps in
+                 newly published generations
+***/
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "engine.h"
+#endif
+
+#ifndef WARMUP_H_INCLUDED
+#define WARMUP_H_INCLUDED
+#include "warmup.h"
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+// Seconds between checks of the manifest
+#define RELOAD_INTERVAL 1
+
+/***
+    An index shared by the queries using it. refs counts the queries that
+    acquired it and the snapshots and reloader holding it, the last release
+    frees it. A snapshot combining a generation with an in-memory segment
+    borrows its index's arrays from the two. One applying a new bitmap of
+    deleted documents to a generation borrows every array but live and
+    liveDf from it
+***/
+typedef struct Snapshot {
+    Index index;
+    int refs;
+    struct Snapshot *generation;    // snapshots the index borrows from, NULL
+    struct Snapshot *segment;       // when it owns its arrays
+    struct Snapshot *base;          // generation the bitmap is applied to, NULL
+}Snapshot;
+
+/***
+    The current snapshot and the thread replacing it
+***/
+typedef struct Reloader {
+    pthread_mutex_t lock;       // guards current, generation and every snapshot's refs
+    Snapshot *current;          // what queries acquire
+    Snapshot *generation;       // loaded generation current is built on
+    Warmup *warmup;             // restarted for each new generation, NULL for none
+    char failed[GENERATION_NAME]; // last generation that failed to load
+    char *hotTerms;             // sidecar of the most queried terms, NULL for none
+    long queries;               // counted by countQuery from any thread
+    long queriesSaved;          // at the last save of hotTerms
+    pthread_t thread;
+    pthread_cond_t wake;
+    int running;
+    int stop;
+}Reloader;
+
+/***
+    Initializes a reloader serving a loaded index, which it takes over.
+    warmup (NULL for none) is stopped and restarted on each reload
+    @return 0 : success
+    @return -1 : out of memory, the index is freed
+***/
+int initReloader (Reloader *reloader, Index *index, Warmup *warmup);
+
+/***
+    Take a reference to the current snapshot, held while a query uses it
+    and its results
+***/
+Snapshot *acquireIndex (Reloader *reloader);
+
+/***
+    Take another reference to a snapshot already held, for work that
+    outlives the query holding it
+***/
+void holdIndex (Reloader *reloader, Snapshot *snapshot);
+
+/***
+    Drop a reference, freeing the snapshot if it was replaced and this was
+    the last query using it
+***/
+void releaseIndex (Reloader *reloader, Snapshot *snapshot);
+
+/***
+    Wrap a loaded index in a snapshot, taking it over
+    @return : snapshot with one reference, NULL if out of memory (the index
+              is freed)
+***/
+Snapshot *newSnapshot (Index *index);
+
+/***
+    Load the generation the manifest names if it isn't the one served, or
+    only the bitmap if its deleted documents changed, without publishing it
+    @return 1 : *next is the new generation, with a reference for the caller
+    @return 0 : unchanged
+    @return -1 : the new generation failed to load
+***/
+int pollGeneration (Reloader *reloader, Snapshot **next);
+
+/***
+    Make a generation, combined with a segment unless it's NULL, the
+    snapshot new queries acquire. The reloader takes its own references.
+    Only one thread may publish
+    @return 0 : success
+    @return -1 : out of memory, nothing changed
+***/
+int publishIndex (Reloader *reloader, Snapshot *generation, Snapshot *segment);
+
+/***
+    Load the generation the manifest names if it isn't the one served, or
+    only the bitmap if its deleted documents changed, and swap it in.
+    Queries keep running on the old snapshot while it loads
+    @return 1 : a new generation was swapped in
+    @return 0 : unchanged
+    @return -1 : the new generation failed to load, the old one is kept
+***/
+int reloadIndex (Reloader *reloader);
+
+/***
+    Count a query served, from any thread
+***/
+void countQuery (Reloader *reloader);
+
+/***
+    Save the generation's hot terms to hotTerms once HOT_TERMS_SAVE queries
+    were counted since the last save. The thread publishing generations
+    calls it between polls, queries never wait on the file
+***/
+void saveHotTermsDue (Reloader *reloader);
+
+/***
+    Check the manifest every RELOAD_INTERVAL seconds on another thread
+    @return 0 : started
+    @return -1 : the thread couldn't be started
+***/
+int startReloader (Reloader *reloader);
+
+/***
+    Stop the reload thread, waiting for a reload in progress
+***/
+void stopReloader (Reloader *reloader);
+
+/***
+    Stop the reloader and release the current snapshot
+***/
+void freeReloader (Reloader *reloader);
@@ -0,0 +1,863 @@
+/***
+    Filename: shards.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Document-partitioned shards. indexer --shards splits an
+                 index into shard.<k> directories whose terms are weighed by
+                 the statistics of the whole index, so the scores of
+                 different shards compare. A worker serves one shard's
+                 engine on a Unix socket and the coordinator sends each
+                 query to every worker at once, merges their ranked docids
+                 by score and asks the shards that make up the page for its
+                 results. For the first page those come back with the
+                 docids. The protocol is lines of text, a query per request:
+                    Q <hits> <from> <count> <query>
+                 answered with the profile of the query, its best hits and
+                 its results from rank from in full
+                    R <hits> <results>
+                    P <phase seconds> <profile counters>
+                    <score> <docid>
+                    <score> <line> <docid>\t<file>\t<title>\t<snippet>
+                 with tabs, newlines and backslashes escaped in the fields,
+                 or E <reason> when the query couldn't be answered. The
+                 document viewer asks the workers for a result's text,
+                 which they read out of their shard's store
+                    D <docid>
+                 answered by the shard that has it with its length and
+                 the text
+                    T <bytes>
+                 or E <reason>
+***/
+
+#ifndef SHARDS_H_INCLUDED
+#define SHARDS_H_INCLUDED
+#include "shards.h"
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef SOCKET_H_INCLUDED
+#define SOCKET_H_INCLUDED
+#include <sys/socket.h>
+#endif
+
+#ifndef UN_H_INCLUDED
+#define UN_H_INCLUDED
+#include <sys/un.h>
+#endif
+
+#ifndef POLL_H_INCLUDED
+#define POLL_H_INCLUDED
+#include <poll.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#ifndef ERRNO_H_INCLUDED
+#define ERRNO_H_INCLUDED
+#include <errno.h>
+#endif
+
+#ifndef TIME_H_INCLUDED
+#define TIME_H_INCLUDED
+#include <time.h>
+#endif
+
+/***
+    A connection to a worker, or a worker's to the coordinator
+***/
+typedef struct ShardConn {
+    int fd;
+    FILE *in;
+    FILE *out;
+}ShardConn;
+
+/***
+    A shard's answer to one request
+***/
+typedef struct ShardReply {
+    ShardConn *conn;
+    SearchHit *hits;
+    long numHits;
+    SearchResult *results;
+    int numResults;
+    int failed;
+}ShardReply;
+
+/***
+    Buffered streams both ways over a connected socket
+    @return : the connection, NULL if out of memory. fd is closed on failure
+***/
+static ShardConn *openConn (int fd) {
+    ShardConn *conn = malloc(sizeof(ShardConn));
+    int copy = dup(fd);
+    FILE *in = (conn != NULL && copy >= 0) ? fdopen(fd, "r") : NULL;
+    FILE *out = (in != NULL) ? fdopen(copy, "w") : NULL;
+    if (out == NULL) {
+        if (in != NULL)
+            fclose(in);
+        else
+            close(fd);
+        if (copy >= 0)
+            close(copy);
+        free(conn);
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->in = in;
+    conn->out = out;
+    return conn;
+}
+
+static void closeConn (ShardConn *conn) {
+    fclose(conn->in);
+    fclose(conn->out);
+    free(conn);
+}
+
+/***
+    Connect to a worker's socket
+    @return : the connection, NULL if the worker isn't listening
+***/
+static ShardConn *connectShard (const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return NULL;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return NULL;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return NULL;
+    }
+    return openConn(fd);
+}
+
+/***
+    Write a field of a line, escaping the characters that separate them
+***/
+static void putField (FILE *fp, const char *field) {
+    for (; *field != '\0'; field++) {
+        if (*field == '\\')
+            fputs("\\\\", fp);
+        else if (*field == '\t')
+            fputs("\\t", fp);
+        else if (*field == '\n')
+            fputs("\\n", fp);
+        else
+            fputc(*field, fp);
+    }
+}
+
+/***
+    Copy the next field of a line into out, unescaped and cut to size
+    @return : the rest of the line after the field's tab
+***/
+static char *takeField (char *line, char *out, size_t size) {
+    size_t length = 0;
+    for (; *line != '\0' && *line != '\t' && *line != '\n'; line++) {
+        char c = *line;
+        if (c == '\\' && line[1] != '\0') {
+            line++;
+            c = (*line == 't') ? '\t' : (*line == 'n') ? '\n' : *line;
+        }
+        if (length + 1 < size)
+            out[length++] = c;
+    }
+    out[length] = '\0';
+    return (*line == '\t') ? line + 1 : line;
+}
+
+/***
+    Write a query's profile as a P line
+***/
+static void putProfile (FILE *fp, QueryProfile *profile) {
+    fprintf(fp, "P");
+    for (int i = 0; i < NUM_PHASES; i++)
+        fprintf(fp, " %.9g", profile->phase[i]);
+    fprintf(fp, " %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld\n", profile->terms,
+            profile->termsFound, profile->termsDropped, profile->postingsScored,
+            profile->postingsSkipped, profile->truncated, profile->docsTouched,
+            profile->titlesFetched, profile->titleBytes, profile->titlesCached,
+            profile->snippetBytes);
+}
+
+/***
+    Add a shard's P line into the profile of a round of requests. The
+    shards run at once, a round takes as long in a phase as the slowest.
+    The work they did adds up
+    @return 0 : success
+    @return -1 : malformed
+***/
+static int addProfile (const char *line, QueryProfile *round) {
+    QueryProfile shard;
+    initProfile(&shard);
+    int used = 0;
+    if (sscanf(line, "P%n", &used) != 0 || used == 0)
+        return -1;
+    line += used;
+    for (int i = 0; i < NUM_PHASES; i++) {
+        if (sscanf(line, " %lf%n", &shard.phase[i], &used) != 1)
+            return -1;
+        line += used;
+    }
+    if (sscanf(line, " %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld", &shard.terms,
+               &shard.termsFound, &shard.termsDropped, &shard.postingsScored,
+               &shard.postingsSkipped, &shard.truncated, &shard.docsTouched,
+               &shard.titlesFetched, &shard.titleBytes, &shard.titlesCached,
+               &shard.snippetBytes) != 11)
+        return -1;
+    for (int i = 0; i < NUM_PHASES; i++) {
+        if (shard.phase[i] > round->phase[i])
+            round->phase[i] = shard.phase[i];
+    }
+    // Every shard parses the same query
+    if (shard.terms > round->terms)
+        round->terms = shard.terms;
+    if (shard.termsFound > round->termsFound)
+        round->termsFound = shard.termsFound;
+    if (shard.termsDropped > round->termsDropped)
+        round->termsDropped = shard.termsDropped;
+    round->postingsScored += shard.postingsScored;
+    round->postingsSkipped += shard.postingsSkipped;
+    round->truncated += shard.truncated;
+    round->docsTouched += shard.docsTouched;
+    round->titlesFetched += shard.titlesFetched;
+    round->titleBytes += shard.titleBytes;
+    round->titlesCached += shard.titlesCached;
+    round->snippetBytes += shard.snippetBytes;
+    return 0;
+}
+
+int openCoordinator (Coordinator *coordinator, char *paths[], int numShards) {
+    memset(coordinator, 0, sizeof(Coordinator));
+    coordinator->shards = calloc(numShards, sizeof(ShardLink));
+    if (coordinator->shards == NULL)
+        return -1;
+    pthread_mutex_init(&coordinator->lock, NULL);
+    coordinator->numShards = numShards;
+    for (int s = 0; s < numShards; s++) {
+        ShardLink *link = &coordinator->shards[s];
+        link->path = malloc(strlen(paths[s]) + 1);
+        link->cap = 4;
+        link->idle = malloc(sizeof(ShardConn*)*link->cap);
+        if (link->path == NULL || link->idle == NULL) {
+            closeCoordinator(coordinator);
+            return -1;
+        }
+        strcpy(link->path, paths[s]);
+    }
+
+    // Workers load their shards before they listen
+    struct timespec pause = { 0, 100000000 };
+    for (int s = 0; s < numShards; s++) {
+        ShardLink *link = &coordinator->shards[s];
+        ShardConn *conn = connectShard(link->path);
+        for (int wait = 0; conn == NULL && wait < SHARD_CONNECT_WAIT*10; wait++) {
+            nanosleep(&pause, NULL);
+            conn = connectShard(link->path);
+        }
+        if (conn == NULL) {
+            printf("Could not connect to the shard at %s\n", link->path);
+            closeCoordinator(coordinator);
+            return -1;
+        }
+        link->idle[link->numIdle++] = conn;
+    }
+    return 0;
+}
+
+void closeCoordinator (Coordinator *coordinator) {
+    for (int s = 0; s < coordinator->numShards; s++) {
+        ShardLink *link = &coordinator->shards[s];
+        for (int i = 0; i < link->numIdle; i++)
+            closeConn(link->idle[i]);
+        free(link->idle);
+        free(link->path);
+    }
+    free(coordinator->shards);
+    pthread_mutex_destroy(&coordinator->lock);
+    memset(coordinator, 0, sizeof(Coordinator));
+}
+
+/***
+    An idle connection to a shard's worker, or a new one
+    @return : the connection, NULL if the worker can't be reached
+***/
+static ShardConn *takeConn (Coordinator *coordinator, int shard, int *pooled) {
+    ShardLink *link = &coordinator->shards[shard];
+    ShardConn *conn = NULL;
+    pthread_mutex_lock(&coordinator->lock);
+    if (link->numIdle > 0)
+        conn = link->idle[--link->numIdle];
+    pthread_mutex_unlock(&coordinator->lock);
+    *pooled = conn != NULL;
+    return (conn != NULL) ? conn : connectShard(link->path);
+}
+
+/***
+    Keep a connection whose reply was read in full for the next query
+***/
+static void giveConn (Coordinator *coordinator, int shard, ShardConn *conn) {
+    ShardLink *link = &coordinator->shards[shard];
+    pthread_mutex_lock(&coordinator->lock);
+    if (link->numIdle == link->cap) {
+        ShardConn **grown = realloc(link->idle, sizeof(ShardConn*)*link->cap*2);
+        if (grown != NULL) {
+            link->idle = grown;
+            link->cap *= 2;
+        }
+    }
+    if (link->numIdle < link->cap) {
+        link->idle[link->numIdle++] = conn;
+        conn = NULL;
+    }
+    pthread_mutex_unlock(&coordinator->lock);
+    if (conn != NULL)
+        closeConn(conn);
+}
+
+/***
+    Send a request of length bytes ending in a newline. Written with send,
+    a worker that went away mustn't raise SIGPIPE in the coordinator's
+    process
+    @return 0 : sent
+    @return -1 : the connection is broken
+***/
+static int sendRequest (ShardConn *conn, const char *request, int length) {
+    for (int sent = 0; sent < length; ) {
+        ssize_t wrote = send(conn->fd, request + sent, length - sent, MSG_NOSIGNAL);
+        if (wrote < 0 && errno != EINTR)
+            return -1;
+        if (wrote > 0)
+            sent += wrote;
+    }
+    return 0;
+}
+
+/***
+    Send a request for a query's n best hits and its count results from
+    rank from
+    @return 0 : sent
+    @return -1 : the connection is broken, or out of memory
+***/
+static int sendQuery (ShardConn *conn, long n, long from, int count, const char *query) {
+    size_t size = strlen(query) + 80;
+    char *request = malloc(size);
+    if (request == NULL)
+        return -1;
+    int length = snprintf(request, size, "Q %ld %ld %d %s", n, from, count, query);
+    // A query is one line
+    for (int i = 0; i < length; i++) {
+        if (request[i] == '\n' || request[i] == '\r')
+            request[i] = ' ';
+    }
+    request[length++] = '\n';
+    int ret = sendRequest(conn, request, length);
+    free(request);
+    return ret;
+}
+
+/***
+    Read a worker's reply, asked for at most n hits and count results
+    @return 0 : success
+    @return -1 : the connection is broken or the reply malformed
+***/
+static int readReply (ShardConn *conn, ShardReply *reply, long n, int count, QueryProfile *round) {
+    char *line = NULL;
+    size_t size = 0;
+    long numHits = 0;
+    int numResults = 0;
+    int ok = getline(&line, &size, conn->in) != -1
+             && sscanf(line, "R %ld %d", &numHits, &numResults) == 2
+             && numHits >= 0 && numHits <= n && numResults >= 0 && numResults <= count;
+    ok = ok && getline(&line, &size, conn->in) != -1 && addProfile(line, round) == 0;
+    reply->hits = ok ? malloc(sizeof(SearchHit)*(numHits + 1)) : NULL;
+    reply->results = ok ? malloc(sizeof(SearchResult)*(numResults + 1)) : NULL;
+    ok = ok && reply->hits != NULL && reply->results != NULL;
+    for (long i = 0; ok && i < numHits; i++) {
+        SearchHit *hit = &reply->hits[i];
+        int used = 0;
+        ok = getline(&line, &size, conn->in) != -1
+             && sscanf(line, "%lf %n", &hit->score, &used) == 1 && used > 0;
+        if (ok)
+            takeField(line + used, hit->docid, sizeof(hit->docid));
+        reply->numHits = i + 1;
+    }
+    for (int i = 0; ok && i < numResults; i++) {
+        SearchResult *result = &reply->results[i];
+        int used = 0;
+        ok = getline(&line, &size, conn->in) != -1
+             && sscanf(line, "%lf %ld %n", &result->score, &result->line, &used) == 2 && used > 0;
+        // Docnos are the shard's own
+        result->docno = -1;
+        if (ok) {
+            char *field = takeField(line + used, result->docid, sizeof(result->docid));
+            field = takeField(field, result->file, sizeof(result->file));
+            field = takeField(field, result->title, sizeof(result->title));
+            takeField(field, result->snippet, sizeof(result->snippet));
+        }
+        reply->numResults = i + 1;
+    }
+    free(line);
+    return ok ? 0 : -1;
+}
+
+/***
+    Send a request to every shard with count[s] > 0 or n > 0, then read
+    their replies. A connection that was idle may have been closed by its
+    worker since, the request is tried once more on a new one
+    @return : shards whose budget ran out before the query was evaluated
+              in full
+***/
+static long scatter (Coordinator *coordinator, ShardReply replies[], long n, long from[],
+                     int count[], const char *query, QueryProfile *profile) {
+    QueryProfile round;
+    initProfile(&round);
+    int numShards = coordinator->numShards;
+    int *pooled = calloc(numShards, sizeof(int));
+    for (int s = 0; s < numShards; s++) {
+        memset(&replies[s], 0, sizeof(ShardReply));
+        if (n == 0 && count[s] == 0)
+            continue;
+        int fresh = 0;
+        replies[s].conn = takeConn(coordinator, s, &fresh);
+        if (pooled != NULL)
+            pooled[s] = fresh;
+        if (replies[s].conn != NULL && sendQuery(replies[s].conn, n, from[s], count[s], query) != 0) {
+            closeConn(replies[s].conn);
+            replies[s].conn = connectShard(coordinator->shards[s].path);
+            if (pooled != NULL)
+                pooled[s] = 0;
+            if (replies[s].conn != NULL && sendQuery(replies[s].conn, n, from[s], count[s], query) != 0) {
+                closeConn(replies[s].conn);
+                replies[s].conn = NULL;
+            }
+        }
+        replies[s].failed = replies[s].conn == NULL;
+    }
+    for (int s = 0; s < numShards; s++) {
+        ShardReply *reply = &replies[s];
+        if (reply->conn == NULL)
+            continue;
+        int ret = readReply(reply->conn, reply, n, count[s], &round);
+        if (ret != 0 && pooled != NULL && pooled[s] && reply->numHits == 0 && reply->numResults == 0) {
+            closeConn(reply->conn);
+            free(reply->hits);
+            free(reply->results);
+            reply->hits = NULL;
+            reply->results = NULL;
+            reply->conn = connectShard(coordinator->shards[s].path);
+            ret = (reply->conn != NULL && sendQuery(reply->conn, n, from[s], count[s], query) == 0)
+                  ? readReply(reply->conn, reply, n, count[s], &round) : -1;
+        }
+        if (ret == 0) {
+            giveConn(coordinator, s, reply->conn);
+        } else {
+            if (reply->conn != NULL)
+                closeConn(reply->conn);
+            reply->numHits = 0;
+            reply->numResults = 0;
+            reply->failed = 1;
+        }
+        reply->conn = NULL;
+    }
+    free(pooled);
+
+    if (profile != NULL) {
+        for (int i = 0; i < NUM_PHASES; i++)
+            profile->phase[i] += round.phase[i];
+        if (round.terms > profile->terms)
+            profile->terms = round.terms;
+        if (round.termsFound > profile->termsFound)
+            profile->termsFound = round.termsFound;
+        if (round.termsDropped > profile->termsDropped)
+            profile->termsDropped = round.termsDropped;
+        profile->postingsScored += round.postingsScored;
+        profile->postingsSkipped += round.postingsSkipped;
+        profile->truncated += round.truncated;
+        profile->docsTouched += round.docsTouched;
+        profile->titlesFetched += round.titlesFetched;
+        profile->titleBytes += round.titleBytes;
+        profile->titlesCached += round.titlesCached;
+        profile->snippetBytes += round.snippetBytes;
+    }
+    return round.truncated;
+}
+
+static void freeReplies (ShardReply replies[], int numShards) {
+    for (int s = 0; s < numShards; s++) {
+        free(replies[s].hits);
+        free(replies[s].results);
+        replies[s].hits = NULL;
+        replies[s].results = NULL;
+    }
+}
+
+int coordinatePage (Coordinator *coordinator, const char *query, long offset, int k,
+                    SearchResult results[], int *exact, QueryProfile *profile) {
+    int numShards = coordinator->numShards;
+    if (exact != NULL)
+        *exact = 1;
+    if (k <= 0)
+        return 0;
+    // Workers refuse to rank deeper, asking would fail every shard
+    if (offset + k > SHARD_MAX_HITS)
+        return SEARCH_TOO_DEEP;
+    ShardReply *replies = calloc(numShards, sizeof(ShardReply));
+    ShardReply *pages = calloc(numShards, sizeof(ShardReply));
+    long *from = calloc(numShards, sizeof(long));
+    long *next = calloc(numShards, sizeof(long));
+    long *first = malloc(sizeof(long)*numShards);
+    int *count = calloc(numShards, sizeof(int));
+    int *slotShard = malloc(sizeof(int)*k);
+    long *slotRank = malloc(sizeof(long)*k);
+    int ret = (replies != NULL && pages != NULL && from != NULL && next != NULL && first != NULL
+               && count != NULL && slotShard != NULL && slotRank != NULL) ? 0 : -1;
+
+    // The first page of every shard comes back with its docids, a shard's
+    // part of the first page of the merge is the top of its own
+    long want = offset + k;
+    for (int s = 0; ret == 0 && s < numShards; s++)
+        count[s] = (offset == 0) ? k : 0;
+    long truncated = 0;
+    if (ret == 0)
+        truncated += scatter(coordinator, replies, want, from, count, query, profile);
+    for (int s = 0; ret == 0 && s < numShards; s++) {
+        first[s] = -1;
+        if (replies[s].failed && profile != NULL)
+            profile->shardsFailed++;
+    }
+
+    // Merge the hits by score, ties go to the lower shard
+    int numSlots = 0;
+    for (long r = 0; ret == 0 && r < want; r++) {
+        int best = -1;
+        for (int s = 0; s < numShards; s++) {
+            if (next[s] < replies[s].numHits
+                    && (best < 0 || replies[s].hits[next[s]].score > replies[best].hits[next[best]].score))
+                best = s;
+        }
+        if (best < 0)
+            break;
+        if (r >= offset) {
+            if (first[best] < 0)
+                first[best] = next[best];
+            slotShard[numSlots] = best;
+            slotRank[numSlots++] = next[best];
+        }
+        next[best]++;
+    }
+
+    // A shard's part of a later page is a run of its ranks, asked for now
+    ShardReply *details = replies;
+    if (ret == 0 && offset > 0) {
+        for (int s = 0; s < numShards; s++) {
+            from[s] = (first[s] >= 0) ? first[s] : 0;
+            count[s] = (first[s] >= 0) ? (int)(next[s] - first[s]) : 0;
+        }
+        truncated += scatter(coordinator, pages, 0, from, count, query, profile);
+        for (int s = 0; s < numShards; s++) {
+            if (pages[s].failed && profile != NULL)
+                profile->shardsFailed++;
+        }
+        details = pages;
+    }
+
+    // A shard reloaded between the rounds may send fewer results, its slots are left out
+    int written = 0;
+    for (int i = 0; ret == 0 && i < numSlots; i++) {
+        ShardReply *reply = &details[slotShard[i]];
+        long at = slotRank[i] - from[slotShard[i]];
+        if (at < reply->numResults)
+            results[written++] = reply->results[at];
+    }
+
+    if (replies != NULL)
+        freeReplies(replies, numShards);
+    if (pages != NULL)
+        freeReplies(pages, numShards);
+    free(replies);
+    free(pages);
+    free(from);
+    free(next);
+    free(first);
+    free(count);
+    free(slotShard);
+    free(slotRank);
+    if (exact != NULL && truncated > 0)
+        *exact = 0;
+    return (ret == 0) ? written : -1;
+}
+
+/***
+    Ask a worker for the text of a document
+    @return 0 : answered, text is NULL if the shard doesn't have it
+    @return -1 : the connection is broken or the reply malformed
+***/
+static int askDocument (ShardConn *conn, const char *docid, char **text) {
+    *text = NULL;
+    char request [SEARCH_DOCID + 4];
+    int length = snprintf(request, sizeof(request), "D %s\n", docid);
+    if (length >= (int)sizeof(request) || sendRequest(conn, request, length) != 0)
+        return -1;
+    char *line = NULL;
+    size_t size = 0;
+    long bytes = 0;
+    int ret = (getline(&line, &size, conn->in) != -1) ? 0 : -1;
+    if (ret == 0 && sscanf(line, "T %ld", &bytes) == 1 && bytes >= 0) {
+        *text = malloc(bytes + 1);
+        if (*text == NULL || (long)fread(*text, 1, bytes, conn->in) != bytes) {
+            free(*text);
+            *text = NULL;
+            ret = -1;
+        } else {
+            (*text)[bytes] = '\0';
+        }
+    } else if (ret == 0 && line[0] != 'E') {
+        ret = -1;
+    }
+    free(line);
+    return ret;
+}
+
+char *coordinateDocument (Coordinator *coordinator, const char *docid) {
+    char *text = NULL;
+    for (int s = 0; text == NULL && s < coordinator->numShards; s++) {
+        int pooled = 0;
+        ShardConn *conn = takeConn(coordinator, s, &pooled);
+        int ret = (conn != NULL) ? askDocument(conn, docid, &text) : -1;
+        // An idle connection the worker closed since
+        if (ret != 0 && pooled) {
+            closeConn(conn);
+            conn = connectShard(coordinator->shards[s].path);
+            ret = (conn != NULL) ? askDocument(conn, docid, &text) : -1;
+        }
+        if (ret == 0)
+            giveConn(coordinator, s, conn);
+        else if (conn != NULL)
+            closeConn(conn);
+    }
+    return text;
+}
+
+/***
+    The connections a worker is answering, shut down when it stops
+***/
+typedef struct ShardServer {
+    SearchEngine *engine;
+    pthread_mutex_t lock;
+    pthread_cond_t idle;        // a connection was closed
+    int *clients;               // their sockets
+    int numClients;
+    int cap;
+}ShardServer;
+
+typedef struct ShardClient {
+    ShardServer *server;
+    ShardConn *conn;
+}ShardClient;
+
+/***
+    Answer one request of a coordinator
+    @return 0 : answered
+    @return -1 : the connection is broken
+***/
+static int answerQuery (SearchEngine *engine, char *line, FILE *out) {
+    long n = 0;
+    long from = 0;
+    int count = 0;
+    int used = 0;
+    if (sscanf(line, "Q %ld %ld %d %n", &n, &from, &count, &used) != 3 || used == 0
+            || n < 0 || n > SHARD_MAX_HITS || from < 0 || count < 0 || count > SHARD_MAX_PAGE) {
+        fprintf(out, "E malformed request\n");
+        return (fflush(out) == 0) ? 0 : -1;
+    }
+    char *query = line + used;
+    query[strcspn(query, "\n")] = '\0';
+
+    SearchHit *hits = malloc(sizeof(SearchHit)*(n + 1));
+    SearchResult *results = malloc(sizeof(SearchResult)*(count + 1));
+    QueryProfile profile;
+    initProfile(&profile);
+    long found = 0;
+    int got = (hits != NULL && results != NULL)
+              ? searchHits(engine, query, n, hits, &found, from, count, results, NULL, &profile) : -1;
+    if (got < 0) {
+        fprintf(out, "E out of memory\n");
+    } else {
+        fprintf(out, "R %ld %d\n", found, got);
+        putProfile(out, &profile);
+        for (long i = 0; i < found; i++)
+            fprintf(out, "%.17g %s\n", hits[i].score, hits[i].docid);
+        for (int i = 0; i < got; i++) {
+            fprintf(out, "%.17g %ld ", results[i].score, results[i].line);
+            putField(out, results[i].docid);
+            fputc('\t', out);
+            putField(out, results[i].file);
+            fputc('\t', out);
+            putField(out, results[i].title);
+            fputc('\t', out);
+            putField(out, results[i].snippet);
+            fputc('\n', out);
+        }
+    }
+    free(hits);
+    free(results);
+    return (fflush(out) == 0) ? 0 : -1;
+}
+
+/***
+    Answer a coordinator's request for a document of the shard
+    @return 0 : answered
+    @return -1 : the connection is broken
+***/
+static int answerDocument (SearchEngine *engine, char *line, FILE *out) {
+    SearchResult result;
+    memset(&result, 0, sizeof(result));
+    result.docno = -1;
+    line[strcspn(line, "\n")] = '\0';
+    strncpy(result.docid, line + 2, sizeof(result.docid) - 1);
+    // Not found among the shard's documents, no file is read
+    char *text = (result.docid[0] != '\0') ? readDocument(engine, &result) : NULL;
+    if (text == NULL) {
+        fprintf(out, "E no such document\n");
+    } else {
+        long length = (long)strlen(text);
+        fprintf(out, "T %ld\n", length);
+        fwrite(text, 1, length, out);
+    }
+    free(text);
+    return (fflush(out) == 0) ? 0 : -1;
+}
+
+/***
+    Connection thread, answers requests until the coordinator hangs up
+***/
+static void *shardClient (void *arg) {
+    ShardClient *client = arg;
+    ShardServer *server = client->server;
+    char *line = NULL;
+    size_t size = 0;
+    while (getline(&line, &size, client->conn->in) != -1) {
+        int ret = (strncmp(line, "D ", 2) == 0) ? answerDocument(server->engine, line, client->conn->out)
+                                                : answerQuery(server->engine, line, client->conn->out);
+        if (ret != 0)
+            break;
+    }
+    free(line);
+
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < server->numClients; i++) {
+        if (server->clients[i] == client->conn->fd) {
+            server->clients[i] = server->clients[--server->numClients];
+            break;
+        }
+    }
+    closeConn(client->conn);
+    pthread_cond_broadcast(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+    free(client);
+    return NULL;
+}
+
+/***
+    Start a thread answering a new connection
+    @return 0 : started
+    @return -1 : out of memory or threads, the connection is closed
+***/
+static int startClient (ShardServer *server, int fd) {
+    ShardClient *client = malloc(sizeof(ShardClient));
+    ShardConn *conn = openConn(fd);
+    if (client == NULL || conn == NULL) {
+        free(client);
+        if (conn != NULL)
+            closeConn(conn);
+        return -1;
+    }
+    client->server = server;
+    client->conn = conn;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->numClients == server->cap) {
+        int cap = (server->cap > 0) ? server->cap*2 : 16;
+        int *grown = realloc(server->clients, sizeof(int)*cap);
+        if (grown != NULL) {
+            server->clients = grown;
+            server->cap = cap;
+        }
+    }
+    pthread_t thread;
+    int ret = (server->numClients < server->cap
+               && pthread_create(&thread, NULL, shardClient, client) == 0) ? 0 : -1;
+    if (ret == 0) {
+        server->clients[server->numClients++] = fd;
+        pthread_detach(thread);
+    }
+    pthread_mutex_unlock(&server->lock);
+    if (ret != 0) {
+        closeConn(conn);
+        free(client);
+    }
+    return ret;
+}
+
+int serveShard (SearchEngine *engine, const char *path, volatile sig_atomic_t *stop) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path %s is too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    // A socket left by a worker that didn't stop cleanly
+    unlink(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        printf("Could not listen on %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    ShardServer server;
+    memset(&server, 0, sizeof(server));
+    server.engine = engine;
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.idle, NULL);
+
+    // Polled so a stop is seen whichever thread the signal was delivered to
+    struct pollfd listening = { fd, POLLIN, 0 };
+    while (!*stop) {
+        if (poll(&listening, 1, 200) <= 0)
+            continue;
+        int client = accept(fd, NULL, NULL);
+        if (client >= 0 && startClient(&server, client) != 0)
+            printf("Could not answer a connection on %s\n", path);
+    }
+    close(fd);
+    unlink(path);
+
+    // The connection threads search the engine, it's closed after them
+    pthread_mutex_lock(&server.lock);
+    for (int i = 0; i < server.numClients; i++)
+        shutdown(server.clients[i], SHUT_RDWR);
+    while (server.numClients > 0)
+        pthread_cond_wait(&server.idle, &server.lock);
+    pthread_mutex_unlock(&server.lock);
+    free(server.clients);
+    pthread_cond_destroy(&server.idle);
+    pthread_mutex_destroy(&server.lock);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/***
+    Filename: shards.h
+    Author: Benjamin Baird
+    Description: Header file for shards.c, the workers serving the shards
+                 of an index split by indexer --shards and the coordinator
+                 fanning queries out to them over Unix sockets
+***/
+
+#ifndef INVERTEDFILE_H_INCLUDED
+#define INVERTEDFILE_H_INCLUDED
+#include "invertedfile.h"
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+#ifndef SIGNAL_H_INCLUDED
+#define SIGNAL_H_INCLUDED
+#include <signal.h>
+#endif
+
+// Socket a shard's worker listens on, in the shard's directory
+#define SHARD_SOCKET "shard.sock"
+// Seconds the coordinator waits for its workers to start listening
+#define SHARD_CONNECT_WAIT 60
+// Most ranked docids a worker sends for one query
+#define SHARD_MAX_HITS 100000
+// Most results with titles a worker sends for one query
+#define SHARD_MAX_PAGE 1000
+
+/***
+    Connections to one shard's worker that no query is using
+***/
+typedef struct ShardLink {
+    char *path;                 // the worker's socket
+    struct ShardConn **idle;
+    int numIdle;
+    int cap;
+}ShardLink;
+
+/***
+    The workers a coordinator sends each query to
+***/
+typedef struct Coordinator {
+    ShardLink *shards;
+    int numShards;
+    pthread_mutex_t lock;       // guards the idle connections
+}Coordinator;
+
+/***
+    Connect to the workers listening on paths, waiting up to
+    SHARD_CONNECT_WAIT seconds for them to start. Errors are printed
+    @return 0 : every worker answered
+    @return -1 : a worker didn't, or out of memory
+***/
+int openCoordinator (Coordinator *coordinator, char *paths[], int numShards);
+
+/***
+    Matches offset to offset + k - 1 of a query over every shard, like
+    searchPage. The shards' ranked docids are merged by score, then the
+    shards are asked for the results of the page they make up. Shards that
+    don't answer are left out and counted in the profile's shardsFailed.
+    exact is set to 0 when any shard's budget ran out, as by search
+    @return >=0 : results written
+    @return -1 : out of memory
+    @return SEARCH_TOO_DEEP : offset + k is past SHARD_MAX_HITS, deeper than
+                              the workers rank
+***/
+int coordinatePage (Coordinator *coordinator, const char *query, long offset, int k,
+                    SearchResult results[], int *exact, QueryProfile *profile);
+
+/***
+    The text of a document, asked of each shard's worker in turn
+    @return : malloc'd text, NULL if no worker has it
+***/
+char *coordinateDocument (Coordinator *coordinator, const char *docid);
+
+/***
+    Close the connections to the workers
+***/
+void closeCoordinator (Coordinator *coordinator);
+
+/***
+    Answer a coordinator's queries with engine on a Unix socket at path,
+    one thread per connection, until stop is set. Writes to a coordinator
+    that went away raise SIGPIPE, the program should ignore it
+    @return 0 : stopped
+    @return -1 : the socket couldn't be listened on
+***/
+int serveShard (SearchEngine *engine, const char *path, volatile sig_atomic_t *stop);
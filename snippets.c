@@ -0,0 +1,458 @@
+/***
+    Filename: snippets.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Token offsets for result snippets. The indexer tokenizes
+                 the corpus again once the generation is written, or the
+                 documents of its store when it has one, by the rules of
+                 docparse.c, and keeps where each document starts and
+                 ends in its file and the first SNIPPET_HITS byte
+                 offsets of each of its terms. The retriever finds the
+                 query terms in a result with a binary search over its
+                 entries and reads only the bytes around the best window,
+                 however long the document is. snippets.bin is binary, in
+                 the byte order of the machine that wrote it:
+                    header: magic, numDocs, numEntries
+                    docStart, docLength: numDocs int64 each
+                    docEntries: numDocs + 1 int64
+                    entries: numEntries SnippetEntry
+***/
+
+#ifndef SNIPPETS_H_INCLUDED
+#define SNIPPETS_H_INCLUDED
+#include "snippets.h"
+#endif
+
+#ifndef GENERATION_H_INCLUDED
+#define GENERATION_H_INCLUDED
+#include "generation.h"
+#endif
+
+#ifndef DOCPARSE_H_INCLUDED
+#define DOCPARSE_H_INCLUDED
+#include "docparse.h"
+#endif
+
+#ifndef BLOCKSTORE_H_INCLUDED
+#define BLOCKSTORE_H_INCLUDED
+#include "blockstore.h"
+#endif
+
+#define SNIPPETS_MAGIC "BSNIPPT1"
+
+typedef struct SnippetHeader {
+    char magic[8];
+    int64_t numDocs;
+    int64_t numEntries;
+}SnippetHeader;
+
+/***
+    An occurrence of a term while a document is tokenized
+***/
+typedef struct SnippetHit {
+    uint32_t term;
+    uint32_t offset;
+}SnippetHit;
+
+/***
+    Everything writeSnippets builds before writing it out in docno order
+***/
+typedef struct SnippetBuild {
+    char **terms;           // dictionary.txt, sorted as the retriever searches it
+    long dictSize;
+    DocPlaces places;
+    long numDocs;
+    SnippetIndex out;       // docEntries holds each document's first entry
+    long *docTerms;         // entries of each document
+    long capEntries;
+    SnippetHit *hits;       // of the document being tokenized
+    long numHits;
+    long capHits;
+    long doc;               // being tokenized, -1 between indexed documents
+}SnippetBuild;
+
+/***
+    Compare function for qsort, hits by term then offset
+***/
+static int cmpHit (const void *pa, const void *pb) {
+    const SnippetHit *a = pa;
+    const SnippetHit *b = pb;
+    if (a->term != b->term)
+        return (a->term < b->term) ? -1 : 1;
+    return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+/***
+    Binary search of the dictionary, as searchIndex does
+    @return >=0 : dictionary entry
+    @return -1 : not a term of the index
+***/
+static long findTerm (SnippetBuild *build, const char *word) {
+    long min = 0;
+    long max = build->dictSize - 1;
+    while (min <= max) {
+        long middle = min + (max - min)/2;
+        int cmp = strcasecmp(word, build->terms[middle]);
+        if (cmp == 0)
+            return middle;
+        if (cmp < 0)
+            max = middle - 1;
+        else
+            min = middle + 1;
+    }
+    return -1;
+}
+
+/***
+    Turn the hits of the document being tokenized into its entries
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int endDocument (SnippetBuild *build, long end) {
+    long doc = build->doc;
+    build->doc = -1;
+    if (doc < 0)
+        return 0;
+    build->out.docLength[doc] = end - build->out.docStart[doc];
+    qsort(build->hits, build->numHits, sizeof(SnippetHit), cmpHit);
+
+    build->out.docEntries[doc] = build->out.numEntries;
+    for (long h = 0; h < build->numHits; h++) {
+        if (h > 0 && build->hits[h].term == build->hits[h-1].term)
+            continue;
+        if (build->out.numEntries == build->capEntries) {
+            long cap = build->capEntries * 2 + 1024;
+            SnippetEntry *entries = realloc(build->out.entries, sizeof(SnippetEntry)*cap);
+            if (entries == NULL)
+                return -1;
+            build->out.entries = entries;
+            build->capEntries = cap;
+        }
+        SnippetEntry *entry = &build->out.entries[build->out.numEntries++];
+        entry->term = build->hits[h].term;
+        for (int k = 0; k < SNIPPET_HITS; k++) {
+            int same = h + k < build->numHits && build->hits[h+k].term == entry->term;
+            entry->offset[k] = same ? build->hits[h+k].offset : SNIPPET_NONE;
+        }
+    }
+    build->docTerms[doc] = build->out.numEntries - build->out.docEntries[doc];
+    build->numHits = 0;
+    return 0;
+}
+
+/***
+    Record a term of the document being tokenized
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int addHit (SnippetBuild *build, long term, long offset) {
+    if (build->numHits == build->capHits) {
+        long cap = build->capHits * 2 + 256;
+        SnippetHit *hits = realloc(build->hits, sizeof(SnippetHit)*cap);
+        if (hits == NULL)
+            return -1;
+        build->hits = hits;
+        build->capHits = cap;
+    }
+    build->hits[build->numHits].term = (uint32_t)term;
+    build->hits[build->numHits++].offset = (uint32_t)offset;
+    return 0;
+}
+
+/***
+    Tokenize text by the rules of docparse.c, recording the terms of its
+    indexed documents. Offsets count from base, where the text is in its
+    corpus file
+    @call stored : docno of the document the text is, read out of the
+                   store, -1 for a whole corpus file
+    @return 0 : success
+    @return -1 : out of memory
+***/
+static int scanText (SnippetBuild *build, FILE *fp, int fileid, long base, long stored) {
+    char word [MAX_WORD+1];
+    int length = 0;
+    long wordStart = 0;
+    long offset = base;
+    long lineNum = 0;
+    int metaTags = 0;
+    long docWord = 0;       // offset of the last $DOC
+    int ret = 0;
+    int c;
+    do {
+        c = fgetc(fp);
+        if (c != ' ' && c != '\n' && c != EOF) {
+            if (length == 0)
+                wordStart = offset;
+            if (length < MAX_WORD)
+                word[length++] = (char)c;
+            offset++;
+            continue;
+        }
+        word[length] = '\0';
+        if (strcmp(word, "$DOC") == 0) {
+            ret = endDocument(build, wordStart);
+            metaTags = 1;
+            docWord = wordStart;
+        } else if (word[0] == '$') {
+            metaTags++;
+        } else if (metaTags == 1 && length > 0 && stored >= 0) {
+            build->doc = stored;
+            build->out.docStart[stored] = docWord;
+        } else if (metaTags == 1 && length > 0) {
+            // The docid, the document is tokenized if it's indexed
+            build->doc = findDocPlace(&build->places, fileid, lineNum);
+            if (build->doc >= 0)
+                build->out.docStart[build->doc] = docWord;
+        } else if (metaTags > 1 && build->doc >= 0 && strncmp(word, "0", 1) > 0) {
+            // The same words the tokenizer adds to the term tree
+            long term = findTerm(build, word);
+            if (term >= 0)
+                ret = addHit(build, term, wordStart - build->out.docStart[build->doc]);
+        }
+        length = 0;
+        if (c == '\n')
+            lineNum++;
+        if (c != EOF)
+            offset++;
+    } while (c != EOF && ret == 0);
+    if (ret == 0)
+        ret = endDocument(build, offset);
+    return ret;
+}
+
+/***
+    Tokenize a corpus file
+    @return 0 : success
+    @return -1 : the file couldn't be read or out of memory
+***/
+static int scanFile (SnippetBuild *build, int fileid, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Error opening %s\n", path);
+        return -1;
+    }
+    int ret = scanText(build, fp, fileid, 0, -1);
+    fclose(fp);
+    return ret;
+}
+
+/***
+    Tokenize the documents of a generation's STORE_FILE instead of its
+    corpus files, each where the store says it was in its file
+    @return 0 : success
+    @return -1 : a document couldn't be read or out of memory
+***/
+static int scanStore (SnippetBuild *build, BlockStore *store) {
+    int ret = 0;
+    for (long d = 0; ret == 0 && d < build->numDocs; d++) {
+        long length = 0;
+        char *text = storedDocument(store, d, &length);
+        FILE *fp = (text != NULL && length > 0) ? fmemopen(text, length, "r") : NULL;
+        if (fp == NULL) {
+            printf("Error reading document %ld of %s\n", d, STORE_FILE);
+            ret = -1;
+        } else {
+            ret = scanText(build, fp, build->places.fileid[d], store->docStart[d], d);
+            fclose(fp);
+        }
+        free(text);
+    }
+    build->places.next = build->numDocs;
+    return ret;
+}
+
+/***
+    Write the offsets beside the old file, in docno order, and rename over it
+    @return 0 : success
+    @return -1 : failure
+***/
+static int saveSnippets (const char *dir, SnippetBuild *build) {
+    char *path = generationPath(dir, SNIPPETS_FILE);
+    if (path == NULL)
+        return -1;
+    char *temp = malloc(sizeof(char)*((int)strlen(path)+5));
+    sprintf(temp, "%s.tmp", path);
+    FILE *fp = fopen(temp, "wb");
+    if (fp == NULL) {
+        free(temp);
+        free(path);
+        return -1;
+    }
+
+    SnippetIndex *out = &build->out;
+    SnippetHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNIPPETS_MAGIC, sizeof(header.magic));
+    header.numDocs = out->numDocs;
+    header.numEntries = out->numEntries;
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && (long)fwrite(out->docStart, sizeof(int64_t), out->numDocs, fp) == out->numDocs;
+    ok = ok && (long)fwrite(out->docLength, sizeof(int64_t), out->numDocs, fp) == out->numDocs;
+    int64_t first = 0;
+    for (long d = 0; ok && d <= out->numDocs; d++) {
+        ok = fwrite(&first, sizeof(int64_t), 1, fp) == 1;
+        if (d < out->numDocs)
+            first += build->docTerms[d];
+    }
+    for (long d = 0; ok && d < out->numDocs; d++) {
+        ok = (long)fwrite(out->entries + out->docEntries[d], sizeof(SnippetEntry), build->docTerms[d], fp)
+             == build->docTerms[d];
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+        ok = 0;
+    }
+    free(temp);
+    free(path);
+    return ok ? 0 : -1;
+}
+
+/***
+    Read dictionary.txt and where the documents are into a build
+    @return 0 : success
+    @return -1 : failure
+***/
+static int readIndex (const char *dir, SnippetBuild *build) {
+    char *path = generationPath(dir, "dictionary.txt");
+    FILE *fp = (path != NULL) ? fopen(path, "r") : NULL;
+    free(path);
+    int ret = (fp != NULL && fscanf(fp, "%ld", &build->dictSize) == 1 && build->dictSize >= 0) ? 0 : -1;
+    if (ret == 0)
+        build->terms = calloc(build->dictSize + 1, sizeof(char*));
+    char term [MAX_WORD+1];
+    long df = 0;
+    for (long t = 0; ret == 0 && t < build->dictSize; t++) {
+        build->terms[t] = (fscanf(fp, "%199s %ld", term, &df) == 2) ? malloc(strlen(term) + 1) : NULL;
+        if (build->terms[t] == NULL)
+            ret = -1;
+        else
+            strcpy(build->terms[t], term);
+    }
+    if (fp != NULL)
+        fclose(fp);
+
+    if (readDocPlaces(dir, &build->places) != 0)
+        ret = -1;
+    build->numDocs = (ret == 0) ? build->places.numDocs : 0;
+    long numDocs = build->numDocs;
+    build->docTerms = calloc(numDocs + 1, sizeof(long));
+    build->out.numDocs = numDocs;
+    build->out.docStart = calloc(numDocs + 1, sizeof(int64_t));
+    build->out.docLength = calloc(numDocs + 1, sizeof(int64_t));
+    build->out.docEntries = calloc(numDocs + 1, sizeof(int64_t));
+    if (build->docTerms == NULL || build->out.docStart == NULL || build->out.docLength == NULL
+            || build->out.docEntries == NULL)
+        ret = -1;
+    return ret;
+}
+
+static void freeBuild (SnippetBuild *build) {
+    for (long t = 0; build->terms != NULL && t < build->dictSize; t++)
+        free(build->terms[t]);
+    free(build->terms);
+    freeDocPlaces(&build->places);
+    free(build->docTerms);
+    free(build->hits);
+    freeSnippets(&build->out);
+}
+
+int writeSnippets (const char *dir) {
+    SnippetBuild build;
+    memset(&build, 0, sizeof(build));
+    build.doc = -1;
+    int ret = readIndex(dir, &build);
+    if (ret != 0)
+        printf("Error reading the index files of %s\n", dir);
+
+    // The store has every document, the corpus files may be gone
+    BlockStore store;
+    char *path = generationPath(dir, STORE_FILE);
+    int stored = ret == 0 && path != NULL && loadBlockStore(&store, path, build.numDocs) == 0;
+    free(path);
+
+    if (ret == 0 && stored)
+        ret = scanStore(&build, &store);
+    for (int f = 0; ret == 0 && !stored && f < build.places.numFiles; f++)
+        ret = scanFile(&build, f, build.places.files[f]);
+    if (stored)
+        freeBlockStore(&store);
+    if (ret == 0 && build.places.next < build.numDocs) {
+        printf("Error: %ld documents of %s weren't found in its files\n", build.numDocs - build.places.next, dir);
+        ret = -1;
+    }
+    if (ret == 0 && saveSnippets(dir, &build) != 0) {
+        printf("Error writing %s of %s\n", SNIPPETS_FILE, dir);
+        ret = -1;
+    }
+
+    freeBuild(&build);
+    return ret;
+}
+
+int loadSnippets (SnippetIndex *snippets, const char *path, long numDocs, long dictSize) {
+    memset(snippets, 0, sizeof(SnippetIndex));
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+
+    SnippetHeader header;
+    int ok = fread(&header, sizeof(header), 1, fp) == 1
+             && memcmp(header.magic, SNIPPETS_MAGIC, sizeof(header.magic)) == 0
+             && header.numDocs == numDocs && header.numEntries >= 0;
+    if (ok) {
+        snippets->numDocs = numDocs;
+        snippets->numEntries = header.numEntries;
+        snippets->docStart = malloc(sizeof(int64_t)*(numDocs + 1));
+        snippets->docLength = malloc(sizeof(int64_t)*(numDocs + 1));
+        snippets->docEntries = malloc(sizeof(int64_t)*(numDocs + 1));
+        snippets->entries = malloc(sizeof(SnippetEntry)*(header.numEntries + 1));
+        ok = snippets->docStart != NULL && snippets->docLength != NULL
+             && snippets->docEntries != NULL && snippets->entries != NULL;
+    }
+    ok = ok && (long)fread(snippets->docStart, sizeof(int64_t), numDocs, fp) == numDocs;
+    ok = ok && (long)fread(snippets->docLength, sizeof(int64_t), numDocs, fp) == numDocs;
+    ok = ok && (long)fread(snippets->docEntries, sizeof(int64_t), numDocs + 1, fp) == numDocs + 1;
+    ok = ok && (long)fread(snippets->entries, sizeof(SnippetEntry), snippets->numEntries, fp)
+                    == snippets->numEntries;
+    fclose(fp);
+
+    // The offsets are trusted when snippets are cut, check them once here
+    ok = ok && snippets->docEntries[0] == 0 && snippets->docEntries[numDocs] == snippets->numEntries;
+    for (long d = 0; ok && d < numDocs; d++) {
+        ok = snippets->docEntries[d] <= snippets->docEntries[d+1] && snippets->docStart[d] >= 0
+             && snippets->docLength[d] >= 0;
+    }
+    for (long e = 0; ok && e < snippets->numEntries; e++)
+        ok = snippets->entries[e].term < dictSize;
+    if (!ok) {
+        freeSnippets(snippets);
+        return -1;
+    }
+    return 0;
+}
+
+SnippetEntry *findSnippetEntry (SnippetIndex *snippets, long docno, long term) {
+    long min = snippets->docEntries[docno];
+    long max = snippets->docEntries[docno + 1] - 1;
+    while (min <= max) {
+        long middle = min + (max - min)/2;
+        long cmp = (long)snippets->entries[middle].term - term;
+        if (cmp == 0)
+            return &snippets->entries[middle];
+        if (cmp > 0)
+            max = middle - 1;
+        else
+            min = middle + 1;
+    }
+    return NULL;
+}
+
+void freeSnippets (SnippetIndex *snippets) {
+    free(snippets->docStart);
+    free(snippets->docLength);
+    free(snippets->docEntries);
+    free(snippets->entries);
+    memset(snippets, 0, sizeof(SnippetIndex));
+}
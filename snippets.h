@@ -0,0 +1,85 @@
+/***
+    Filename: snippets.h
+    Author: Benjamin Baird
+    Description: Header file for snippets.c, the token offsets written by
+                 the indexer that the retriever cuts result snippets with
+***/
+
+#ifndef STDIO_H_INCLUDED
+#define STDIO_H_INCLUDED
+#include <stdio.h>
+#endif
+
+#ifndef STDLIB_H_INCLUDED
+#define STDLIB_H_INCLUDED
+#include <stdlib.h>
+#endif
+
+#ifndef STRING_H_INCLUDED
+#define STRING_H_INCLUDED
+#include <string.h>
+#endif
+
+#ifndef STDINT_H_INCLUDED
+#define STDINT_H_INCLUDED
+#include <stdint.h>
+#endif
+
+// Token offsets of a generation's documents, written by indexer --snippets
+#define SNIPPETS_FILE "snippets.bin"
+// Occurrences of a term kept per document, the first ones
+#define SNIPPET_HITS 3
+// No occurrence
+#define SNIPPET_NONE UINT32_MAX
+
+/***
+    Where the terms of a document first occur, as byte offsets from the
+    start of its $DOC line
+***/
+typedef struct SnippetEntry {
+    uint32_t term;                  // dictionary entry
+    uint32_t offset[SNIPPET_HITS];  // ascending, SNIPPET_NONE past the last
+}SnippetEntry;
+
+/***
+    Every document's byte range in its corpus file and its entries, sorted
+    by term so a query term is found by binary search
+***/
+typedef struct SnippetIndex {
+    long numDocs;
+    long numEntries;
+    int64_t *docStart;      // byte offset of each document's $DOC line
+    int64_t *docLength;     // bytes up to the next document or the end of the file
+    int64_t *docEntries;    // numDocs + 1 offsets of each document's first entry
+    SnippetEntry *entries;
+}SnippetIndex;
+
+/***
+    Tokenize the corpus files of a generation directory again, recording
+    where the terms of its documents occur, and write its SNIPPETS_FILE,
+    replacing it atomically. Needs dictionary.txt, docids.txt and files.txt
+    @return 0 : success
+    @return -1 : the index or corpus files couldn't be read or
+                 SNIPPETS_FILE written
+***/
+int writeSnippets (const char *dir);
+
+/***
+    Load a SNIPPETS_FILE written for an index of numDocs documents and
+    dictSize terms
+    @return 0 : success
+    @return -1 : the file couldn't be read, is malformed or belongs to
+                 another index
+***/
+int loadSnippets (SnippetIndex *snippets, const char *path, long numDocs, long dictSize);
+
+/***
+    The entry of a term in a document
+    @return : the entry, NULL if the term isn't in the document
+***/
+SnippetEntry *findSnippetEntry (SnippetIndex *snippets, long docno, long term);
+
+/***
+    Free the token offsets
+***/
+void freeSnippets (SnippetIndex *snippets);
@@ -0,0 +1,298 @@
+/***
+    Filename: titles.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Concurrent title reads for result pages. Each title scans
+                 its corpus file up to the document's line, so a page read
+                 one title after another waits on every file in turn. A page
+                 is queued as one batch whose titles the pool's threads and
+                 the caller claim one at a time. Once a page is shown the
+                 next page's titles are queued behind any page being read
+                 and kept in a small cache, keyed by file and line so they
+                 survive the query being run again for the next page or the
+                 index being reloaded in between.
+***/
+
+#ifndef TITLES_H_INCLUDED
+#define TITLES_H_INCLUDED
+#include "titles.h"
+#endif
+
+/***
+    Titles of a page or of a prefetch, claimed one at a time
+***/
+typedef struct TitleBatch {
+    Snapshot *snapshot;
+    long *docnos;
+    char **titles;              // read titles of a page, NULL for a prefetch
+    QueryProfile *profiles;     // of each title, NULL when the page isn't profiled
+    int count;
+    int claimed;
+    int pending;                // titles claimed or not, that aren't read yet
+    struct TitleBatch *next;
+}TitleBatch;
+
+/***
+    Look a document's title up in the cache, the pool's lock is held
+    @return : a copy of the title, NULL if it isn't cached
+***/
+static char *cachedTitle (TitlePool *pool, char *file, long line) {
+    for (int i = 0; i < TITLE_CACHE; i++) {
+        TitleEntry *entry = &pool->cache[i];
+        if (entry->file != NULL && entry->line == line && strcmp(entry->file, file) == 0) {
+            char *title = malloc(strlen(entry->title) + 1);
+            if (title != NULL)
+                strcpy(title, entry->title);
+            return title;
+        }
+    }
+    return NULL;
+}
+
+/***
+    Keep a prefetched title in the cache, replacing the oldest entry. The
+    pool's lock is held
+***/
+static void cacheTitle (TitlePool *pool, char *file, long line, char *title) {
+    TitleEntry *entry = &pool->cache[pool->cacheNext];
+    char *copy = malloc(strlen(file) + 1);
+    if (copy == NULL) {
+        free(title);
+        return;
+    }
+    strcpy(copy, file);
+    free(entry->file);
+    free(entry->title);
+    entry->file = copy;
+    entry->line = line;
+    entry->title = title;
+    pool->cacheNext = (pool->cacheNext + 1) % TITLE_CACHE;
+}
+
+/***
+    Queue a batch after the pages queued before it, pages go ahead of
+    prefetches. The pool's lock is held
+***/
+static void queueBatch (TitlePool *pool, TitleBatch *batch) {
+    TitleBatch **at = &pool->queue;
+    while (*at != NULL && (batch->titles == NULL || (*at)->titles != NULL))
+        at = &(*at)->next;
+    batch->next = *at;
+    *at = batch;
+    pthread_cond_broadcast(&pool->work);
+}
+
+/***
+    Claim the next title of the first batch, the pool's lock is held
+    @return : the title's index, -1 when nothing is queued
+***/
+static int claimTitle (TitlePool *pool, TitleBatch **batch) {
+    *batch = pool->queue;
+    if (*batch == NULL)
+        return -1;
+    int i = (*batch)->claimed++;
+    if ((*batch)->claimed == (*batch)->count)
+        pool->queue = (*batch)->next;
+    return i;
+}
+
+static void freeBatch (TitleBatch *batch) {
+    free(batch->docnos);
+    free(batch->profiles);
+    free(batch);
+}
+
+/***
+    Read a claimed title, taking the pool's lock back when it's done
+    @return : the prefetch batch to free once the lock is dropped, NULL if
+              none is done
+***/
+static TitleBatch *readTitle (TitlePool *pool, TitleBatch *batch, int i) {
+    Index *index = &batch->snapshot->index;
+    long docno = batch->docnos[i];
+    char *title = getTitle(docno, index, (batch->profiles != NULL) ? &batch->profiles[i] : NULL);
+
+    pthread_mutex_lock(&pool->lock);
+    if (batch->titles != NULL)
+        batch->titles[i] = title;
+    else if (title != NULL)
+        cacheTitle(pool, docFile(index, docno), getDoc(index, docno)->line, title);
+    if (--batch->pending > 0)
+        return NULL;
+    if (batch->titles != NULL) {
+        pthread_cond_broadcast(&pool->done);
+        return NULL;
+    }
+    return batch;
+}
+
+/***
+    Title thread, reads titles until the pool stops
+***/
+static void *titleWorker (void *arg) {
+    TitlePool *pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stop) {
+        TitleBatch *batch;
+        int i = claimTitle(pool, &batch);
+        if (i < 0) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        TitleBatch *finished = readTitle(pool, batch, i);
+        pthread_mutex_unlock(&pool->lock);
+        if (finished != NULL) {
+            releaseIndex(pool->reloader, finished->snapshot);
+            freeBatch(finished);
+        }
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int startTitlePool (TitlePool *pool, Reloader *reloader, int numThreads) {
+    memset(pool, 0, sizeof(TitlePool));
+    pool->reloader = reloader;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    if (numThreads <= 0)
+        return 0;
+    pool->threads = malloc(sizeof(pthread_t)*numThreads);
+    if (pool->threads == NULL)
+        return -1;
+    for (int t = 0; t < numThreads; t++) {
+        if (pthread_create(&pool->threads[t], NULL, titleWorker, pool) != 0)
+            return -1;
+        pool->numThreads++;
+    }
+    return 0;
+}
+
+void stopTitlePool (TitlePool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int t = 0; t < pool->numThreads; t++)
+        pthread_join(pool->threads[t], NULL);
+    free(pool->threads);
+
+    // Only prefetches can be left, no page is read while the pool stops
+    while (pool->queue != NULL) {
+        TitleBatch *batch = pool->queue;
+        pool->queue = batch->next;
+        releaseIndex(pool->reloader, batch->snapshot);
+        freeBatch(batch);
+    }
+    for (int i = 0; i < TITLE_CACHE; i++) {
+        free(pool->cache[i].file);
+        free(pool->cache[i].title);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    memset(pool, 0, sizeof(TitlePool));
+}
+
+void fetchTitles (TitlePool *pool, Snapshot *snapshot, long docnos[], int count, char *titles[],
+                  QueryProfile *profile) {
+    Index *index = &snapshot->index;
+    double start = (profile != NULL) ? metricsClock() / 1e9 : 0;
+    TitleBatch batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.snapshot = snapshot;
+    batch.docnos = malloc(sizeof(long)*(count + 1));
+    batch.titles = malloc(sizeof(char*)*(count + 1));
+    batch.profiles = (profile != NULL) ? calloc(count + 1, sizeof(QueryProfile)) : NULL;
+    int *slot = malloc(sizeof(int)*(count + 1));
+    if (batch.docnos == NULL || batch.titles == NULL || slot == NULL
+            || (profile != NULL && batch.profiles == NULL)) {
+        for (int i = 0; i < count; i++)
+            titles[i] = getTitle(docnos[i], index, profile);
+        free(batch.docnos);
+        free(batch.titles);
+        free(batch.profiles);
+        free(slot);
+        return;
+    }
+
+    // Prefetched titles are taken from the cache, the rest are read
+    long cached = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < count; i++) {
+        titles[i] = cachedTitle(pool, docFile(index, docnos[i]), getDoc(index, docnos[i])->line);
+        if (titles[i] != NULL) {
+            cached++;
+        } else {
+            slot[batch.count] = i;
+            batch.docnos[batch.count++] = docnos[i];
+        }
+    }
+    batch.pending = batch.count;
+    if (batch.count > 0)
+        queueBatch(pool, &batch);
+
+    // Read titles of the page alongside the pool until they're all claimed
+    while (batch.claimed < batch.count) {
+        TitleBatch *claimed;
+        int i = claimTitle(pool, &claimed);
+        pthread_mutex_unlock(&pool->lock);
+        // Pages go first, this is a title of this page or one queued before it
+        readTitle(pool, claimed, i);
+    }
+    while (batch.pending > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int k = 0; k < batch.count; k++)
+        titles[slot[k]] = batch.titles[k];
+    countMetric(METRIC_TITLE_CACHE_HITS, cached);
+    if (profile != NULL) {
+        for (int k = 0; k < batch.count; k++) {
+            profile->titlesFetched += batch.profiles[k].titlesFetched;
+            profile->titleBytes += batch.profiles[k].titleBytes;
+        }
+        profile->titlesCached += cached;
+        profile->phase[PHASE_TITLES] += metricsClock() / 1e9 - start;
+    }
+    free(batch.docnos);
+    free(batch.titles);
+    free(batch.profiles);
+    free(slot);
+}
+
+void prefetchTitles (TitlePool *pool, Snapshot *snapshot, long docnos[], int count) {
+    // Without threads nothing would read them before the page is asked for
+    if (pool->numThreads == 0 || count <= 0)
+        return;
+    TitleBatch *batch = calloc(1, sizeof(TitleBatch));
+    if (batch == NULL)
+        return;
+    batch->docnos = malloc(sizeof(long)*count);
+    if (batch->docnos == NULL) {
+        free(batch);
+        return;
+    }
+    Index *index = &snapshot->index;
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < count; i++) {
+        char *title = cachedTitle(pool, docFile(index, docnos[i]), getDoc(index, docnos[i])->line);
+        if (title == NULL)
+            batch->docnos[batch->count++] = docnos[i];
+        free(title);
+    }
+    if (batch->count == 0 || pool->stop) {
+        pthread_mutex_unlock(&pool->lock);
+        freeBatch(batch);
+        return;
+    }
+    batch->snapshot = snapshot;
+    batch->pending = batch->count;
+    holdIndex(pool->reloader, snapshot);
+    queueBatch(pool, batch);
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,76 @@
+/***
+    Filename: titles.h
+    Author: Benjamin Baird
+    Description: Header file for titles.c, the pool of threads that read a
+                 page of result titles from the corpus at once and prefetch
+                 the next page into a small cache
+***/
+
+#ifndef RELOAD_H_INCLUDED
+#define RELOAD_H_INCLUDED
+#include "reload.h"
+#endif
+
+// Default threads reading titles
+#define TITLE_THREADS 4
+// Titles kept from prefetched pages
+#define TITLE_CACHE 64
+
+/***
+    A prefetched title, keyed by the corpus file and line of its document
+***/
+typedef struct TitleEntry {
+    char *file;         // NULL while the entry is empty
+    long line;
+    char *title;
+}TitleEntry;
+
+/***
+    The title threads, the batches of titles queued for them and the titles
+    read ahead
+***/
+typedef struct TitlePool {
+    Reloader *reloader;         // snapshots of prefetched pages are released to it
+    pthread_t *threads;
+    int numThreads;
+    pthread_mutex_t lock;       // guards everything below
+    pthread_cond_t work;        // a batch was queued or the pool is stopping
+    pthread_cond_t done;        // a page's batch was read
+    struct TitleBatch *queue;   // batches with titles left to claim, pages first
+    int stop;
+    TitleEntry cache[TITLE_CACHE];
+    int cacheNext;              // entry replaced next
+}TitlePool;
+
+/***
+    Start numThreads threads reading titles, 0 to read them on the threads
+    asking for them
+    @return 0 : started
+    @return -1 : the threads couldn't be started, titles are read by the
+                 threads asking for them
+***/
+int startTitlePool (TitlePool *pool, Reloader *reloader, int numThreads);
+
+/***
+    Stop the threads, dropping the prefetches they haven't read, and free
+    the cache
+***/
+void stopTitlePool (TitlePool *pool);
+
+/***
+    Read the titles of count documents of a snapshot at once, from the
+    cache when they were prefetched. The calling thread reads titles too
+    until none are left to claim. Title time, reads and cache hits are
+    added to profile unless it's NULL
+    @call titles : count malloc'd titles, NULL for documents whose file
+                   couldn't be read
+***/
+void fetchTitles (TitlePool *pool, Snapshot *snapshot, long docnos[], int count, char *titles[],
+                  QueryProfile *profile);
+
+/***
+    Queue the titles of count documents to be read into the cache in the
+    background, behind any page being read. The pool holds a reference to
+    the snapshot until they're read
+***/
+void prefetchTitles (TitlePool *pool, Snapshot *snapshot, long docnos[], int count);
@@ -75,13 +75,15 @@ TreeNode *insert(TreeNode *node, char *term, char *docId) {
     return node;
 }
 
-TreeNode * addTerm (TreeNode *tree, char *term, char *docId) {
+TreeNode * addTerm (TreeNode *tree, char *term, char *docId, long *numPostings) {
     TreeNode *treeNode = searchTree(tree, term);
 
     // Check if term exists already
     if (treeNode == NULL) {
         // Term doesn't exist, create and add it to the tree
         tree = insert(tree, term, docId);
+        if (numPostings != NULL)
+            (*numPostings)++;
     } else {
         // Check if term exists in document, increment term frequency in relevant document
         treeNode->freq++;
@@ -90,6 +92,8 @@ TreeNode * addTerm (TreeNode *tree, char *term, char *docId) {
             // Create a node for the document
             node = initNode(docId);
             appendNode(treeNode->dictionary, node);
+            if (numPostings != NULL)
+                (*numPostings)++;
             // return 1;
         } else {
             node->freq++;
@@ -229,6 +233,29 @@ TreeNode *selfBalance(TreeNode *node,  char *term){
     }
     return node;
 }
+/**
+    Pushes a node and its chain of left children onto the iterator's stack
+**/
+void pushLeft(TreeIter *iter, TreeNode *node) {
+    while (node != NULL) {
+        iter->stack[iter->depth++] = node;
+        node = node->left;
+    }
+}
+
+void initTreeIter(TreeIter *iter, TreeNode *tree) {
+    iter->depth = 0;
+    pushLeft(iter, tree);
+}
+
+TreeNode *nextTreeNode(TreeIter *iter) {
+    if (iter->depth == 0)
+        return NULL;
+    TreeNode *node = iter->stack[--iter->depth];
+    pushLeft(iter, node->right);
+    return node;
+}
+
 // Test
 // int main () {
 //     printf("Testing Begins\n");
@@ -34,6 +34,17 @@ typedef struct TreeNode {
     struct TreeNode *left;
 }TreeNode;
 
+// Deeper than any AVL tree that fits in memory (height < 1.45 log2(n))
+#define TREE_ITER_DEPTH 96
+
+/***
+    In-order (alphabetical) iterator over a tree, using an explicit stack
+***/
+typedef struct TreeIter {
+    TreeNode *stack[TREE_ITER_DEPTH];
+    int depth;
+}TreeIter;
+
 /***
     Initializes a node with a given id
     @return : pointer to the created node
@@ -52,10 +63,11 @@ void freeTreeNode (TreeNode *node);
 
 /***
     Adds node using binary search method
-    @return 1 : successful
-    @return 0 : failure
+    @call numPostings : if not NULL, incremented when the term gets a new
+                        document in its posting list
+    @return : the tree's new root
 ***/
-TreeNode * addTerm (TreeNode *tree, char *term, char *docId);
+TreeNode * addTerm (TreeNode *tree, char *term, char *docId, long *numPostings);
 
 /***
     Prints a tree node including left and right terms
@@ -113,3 +125,14 @@ TreeNode *rotateRight(TreeNode *node);
     Balances out a subtree
 **/
 TreeNode *selfBalance(TreeNode *node, char *term);
+
+/**
+    Starts an in-order iteration of a tree
+**/
+void initTreeIter(TreeIter *iter, TreeNode *tree);
+
+/**
+    Returns the next node in alphabetical order
+    @return : NULL once every node has been visited
+**/
+TreeNode *nextTreeNode(TreeIter *iter);
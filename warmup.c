@@ -0,0 +1,290 @@
+/***
+    Filename: warmup.c
+    Author: Benjamin Baird
+    Date Created: October 19, 2026
+    Date Updated: October 19, 2026
+    Description: Hot term sidecar and page cache warmup. The postings are
+                 loaded into memory, so a cold start is paid in the corpus
+                 files that getTitle reads every result's title from. The
+                 warmup touches the hot terms' postings, then reads the corpus
+                 files their documents are in a window at a time, with
+                 madvise(MADV_WILLNEED) on the next window so the kernel's
+                 readahead overlaps the reads. Progress is measured with
+                 mincore, all while the retriever already answers queries.
+***/
+
+#ifndef WARMUP_H_INCLUDED
+#define WARMUP_H_INCLUDED
+#include "warmup.h"
+#endif
+
+#ifndef MMAN_H_INCLUDED
+#define MMAN_H_INCLUDED
+#include <sys/mman.h>
+#endif
+
+#ifndef STAT_H_INCLUDED
+#define STAT_H_INCLUDED
+#include <sys/stat.h>
+#endif
+
+#ifndef FCNTL_H_INCLUDED
+#define FCNTL_H_INCLUDED
+#include <fcntl.h>
+#endif
+
+#ifndef UNISTD_H_INCLUDED
+#define UNISTD_H_INCLUDED
+#include <unistd.h>
+#endif
+
+#define MB (1024.0*1024.0)
+
+long loadHotTerms (Index *index, char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    char term[200];
+    long hits = 0;
+    long count = 0;
+    while (fscanf(fp, "%199s %ld", term, &hits) == 2) {
+        long entry = searchIndex(index->dictIndex, index->dictSize - 1, term);
+        if (entry >= 0 && hits > 0)
+            index->termHits[entry] += (hits + 1) / 2;
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+/***
+    Compare function for qsort_r, most hits first
+***/
+static int cmpHits (const void *pa, const void *pb, void *hits) {
+    long a = ((long *)hits)[*(const long *)pa];
+    long b = ((long *)hits)[*(const long *)pb];
+    return (a < b) - (a > b);
+}
+
+/***
+    The most queried dictionary entries, sorted on a copy of the hit counts
+    since queries may add to them meanwhile
+    @return : array of up to HOT_TERMS entries with hits, most hits first,
+              their counts in *hits by dictionary entry
+***/
+static long *hotEntries (Index *index, long *count, long **hits) {
+    *count = 0;
+    *hits = NULL;
+    long size = (index->dictSize > 0) ? index->dictSize : 1;
+    long *entries = malloc(sizeof(long)*size);
+    long *copy = malloc(sizeof(long)*size);
+    if (entries == NULL || copy == NULL || index->termHits == NULL) {
+        free(entries);
+        free(copy);
+        return NULL;
+    }
+    for (long i = 0; i < index->dictSize; i++) {
+        copy[i] = __atomic_load_n(&index->termHits[i], __ATOMIC_RELAXED);
+        if (copy[i] > 0)
+            entries[(*count)++] = i;
+    }
+    qsort_r(entries, *count, sizeof(long), cmpHits, copy);
+    if (*count > HOT_TERMS)
+        *count = HOT_TERMS;
+    *hits = copy;
+    return entries;
+}
+
+int saveHotTerms (Index *index, char *path) {
+    long count = 0;
+    long *hits;
+    long *entries = hotEntries(index, &count, &hits);
+    if (entries == NULL)
+        return -1;
+
+    char *tmpPath = malloc(strlen(path) + 5);
+    sprintf(tmpPath, "%s.tmp", path);
+    FILE *fp = fopen(tmpPath, "w");
+    int ret = (fp == NULL) ? -1 : 0;
+    for (long i = 0; ret == 0 && i < count; i++)
+        fprintf(fp, "%s %ld\n", index->dictIndex[entries[i]].term, hits[entries[i]]);
+    if (fp != NULL && (fclose(fp) != 0 || ret != 0 || rename(tmpPath, path) != 0)) {
+        remove(tmpPath);
+        ret = -1;
+    }
+    free(tmpPath);
+    free(entries);
+    free(hits);
+    return ret;
+}
+
+long carryHotTerms (Index *from, Index *to) {
+    long count = 0;
+    long *hits;
+    long *entries = hotEntries(from, &count, &hits);
+    if (entries == NULL)
+        return 0;
+    long carried = 0;
+    for (long i = 0; to->termHits != NULL && i < count; i++) {
+        long entry = searchIndex(to->dictIndex, to->dictSize - 1, from->dictIndex[entries[i]].term);
+        if (entry >= 0) {
+            to->termHits[entry] += hits[entries[i]];
+            carried++;
+        }
+    }
+    free(entries);
+    free(hits);
+    return carried;
+}
+
+/***
+    A corpus file mapped to be read ahead
+***/
+typedef struct WarmFile {
+    char *data;
+    long size;
+    unsigned char *pages;   // mincore's residency of each page
+}WarmFile;
+
+/***
+    Bytes of the files in the page cache
+***/
+static long residentBytes (WarmFile files[], int numFiles, long pageSize) {
+    long resident = 0;
+    for (int f = 0; f < numFiles; f++) {
+        if (files[f].data == NULL)
+            continue;
+        long numPages = (files[f].size + pageSize - 1) / pageSize;
+        if (mincore(files[f].data, files[f].size, files[f].pages) != 0)
+            continue;
+        for (long p = 0; p < numPages; p++) {
+            if (files[f].pages[p] & 1)
+                resident += (p == numPages - 1) ? files[f].size - p * pageSize : pageSize;
+        }
+    }
+    return resident;
+}
+
+/***
+    Warmup thread
+***/
+static void *warmupWorker (void *arg) {
+    Warmup *warmup = arg;
+    Index *index = warmup->index;
+    double start = metricsClock() / 1e9;
+
+    // Touch the hot postings and note the files their documents are in
+    char *wanted = calloc(index->numFiles > 0 ? index->numFiles : 1, 1);
+    volatile unsigned long touched = 0;
+    long postings = 0;
+    for (long i = 0; i < warmup->numEntries && !__atomic_load_n(&warmup->stop, __ATOMIC_RELAXED); i++) {
+        DictIndex *entry = &index->dictIndex[warmup->entries[i]];
+        for (long k = entry->postIndex; k < entry->postIndex + entry->df; k++) {
+            uint32_t docno = index->postIndex.docno[k];
+            touched += docno + index->postIndex.tf[k];
+            if (wanted != NULL && index->files != NULL)
+                wanted[index->docIndex[docno].fileid] = 1;
+        }
+        postings += entry->df;
+    }
+    fprintf(stderr, "Warmup: touched %ld postings of %ld hot terms\n", postings, warmup->numEntries);
+
+    // Map the corpus files
+    long pageSize = sysconf(_SC_PAGESIZE);
+    WarmFile *files = calloc(index->numFiles > 0 ? index->numFiles : 1, sizeof(WarmFile));
+    long total = 0;
+    for (int f = 0; files != NULL && wanted != NULL && f < index->numFiles; f++) {
+        if (!wanted[f])
+            continue;
+        int fd = open(index->files[f], O_RDONLY);
+        struct stat info;
+        if (fd < 0)
+            continue;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            unsigned char *pages = malloc((info.st_size + pageSize - 1) / pageSize);
+            if (data != MAP_FAILED && pages != NULL) {
+                files[f].data = data;
+                files[f].size = info.st_size;
+                files[f].pages = pages;
+                total += info.st_size;
+            } else {
+                if (data != MAP_FAILED)
+                    munmap(data, info.st_size);
+                free(pages);
+            }
+        }
+        close(fd);
+    }
+
+    // Read them a window at a time, asking for the next window while this one is read
+    double lastReport = metricsClock() / 1e9;
+    for (int f = 0; files != NULL && f < index->numFiles; f++) {
+        char *data = files[f].data;
+        long size = files[f].size;
+        if (data != NULL)
+            madvise(data, (size < WARMUP_WINDOW) ? size : WARMUP_WINDOW, MADV_WILLNEED);
+        for (long off = 0; data != NULL && off < size; off += WARMUP_WINDOW) {
+            if (__atomic_load_n(&warmup->stop, __ATOMIC_RELAXED))
+                break;
+            long length = (size - off < WARMUP_WINDOW) ? size - off : WARMUP_WINDOW;
+            long next = off + length;
+            if (next < size)
+                madvise(data + next, (size - next < WARMUP_WINDOW) ? size - next : WARMUP_WINDOW,
+                        MADV_WILLNEED);
+            for (long p = off; p < off + length; p += pageSize)
+                touched += (unsigned char)data[p];
+
+            double now = metricsClock() / 1e9;
+            if (now - lastReport >= 1.0) {
+                long resident = residentBytes(files, index->numFiles, pageSize);
+                fprintf(stderr, "Warmup: %.1f of %.1f MB of corpus resident (%.0f%%)\n",
+                        resident / MB, total / MB, 100.0 * resident / total);
+                lastReport = now;
+            }
+        }
+    }
+    long resident = (files != NULL) ? residentBytes(files, index->numFiles, pageSize) : 0;
+    fprintf(stderr, "Warmup: %.1f of %.1f MB of corpus resident after %.2f s\n",
+            resident / MB, total / MB, metricsClock() / 1e9 - start);
+
+    for (int f = 0; files != NULL && f < index->numFiles; f++) {
+        if (files[f].data != NULL)
+            munmap(files[f].data, files[f].size);
+        free(files[f].pages);
+    }
+    free(files);
+    free(wanted);
+    return NULL;
+}
+
+int startWarmup (Warmup *warmup, Index *index) {
+    warmup->running = 0;
+    warmup->stop = 0;
+    warmup->index = index;
+    long *hits;
+    warmup->entries = hotEntries(index, &warmup->numEntries, &hits);
+    free(hits);
+    if (warmup->entries == NULL || warmup->numEntries == 0) {
+        free(warmup->entries);
+        warmup->entries = NULL;
+        return -1;
+    }
+    if (pthread_create(&warmup->thread, NULL, warmupWorker, warmup) != 0) {
+        free(warmup->entries);
+        warmup->entries = NULL;
+        return -1;
+    }
+    warmup->running = 1;
+    return 0;
+}
+
+void stopWarmup (Warmup *warmup) {
+    if (!warmup->running)
+        return;
+    __atomic_store_n(&warmup->stop, 1, __ATOMIC_RELAXED);
+    pthread_join(warmup->thread, NULL);
+    warmup->running = 0;
+    free(warmup->entries);
+    warmup->entries = NULL;
+}
@@ -0,0 +1,75 @@
+/***
+    Filename: warmup.h
+    Author: Benjamin Baird
+    Description: Header file for warmup.c, the record of the most queried
+                 terms and the background warmup that brings the pages their
+                 queries read into memory after the retriever starts
+***/
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+#include "engine.h"
+#endif
+
+#ifndef PTHREAD_H_INCLUDED
+#define PTHREAD_H_INCLUDED
+#include <pthread.h>
+#endif
+
+// Sidecar of the most queried terms, kept next to the index
+#define HOT_TERMS_FILE "hotterms.txt"
+// Terms kept in the sidecar
+#define HOT_TERMS 1000
+// Queries between saves of the sidecar
+#define HOT_TERMS_SAVE 1000
+// Bytes of a corpus file read ahead at a time
+#define WARMUP_WINDOW 4194304
+
+/***
+    A warmup running on its own thread
+***/
+typedef struct Warmup {
+    pthread_t thread;
+    int running;
+    int stop;               // set to end the warmup early
+    Index *index;
+    long *entries;          // hot dictionary entries, most queried first
+    long numEntries;
+}Warmup;
+
+/***
+    Add the hit counts saved in a sidecar to the index's, halved so terms
+    that stop being queried fade out
+    @return >=0 : number of terms read
+    @return -1 : no sidecar
+***/
+long loadHotTerms (Index *index, char *path);
+
+/***
+    Write the HOT_TERMS most queried terms with their hit counts, through a
+    temporary file
+    @return 0 : success
+    @return -1 : the file couldn't be written
+***/
+int saveHotTerms (Index *index, char *path);
+
+/***
+    Add the hit counts of from's most queried terms to the same terms in
+    to, before a reloaded index replaces from
+    @return : number of terms carried over
+***/
+long carryHotTerms (Index *from, Index *to);
+
+/***
+    Start warming the postings of the index's most queried terms and the
+    corpus files their documents are in on another thread, reporting
+    progress to stderr
+    @return 0 : started
+    @return -1 : nothing to warm or the thread couldn't be started
+***/
+int startWarmup (Warmup *warmup, Index *index);
+
+/***
+    Stop a warmup and wait for its thread
+***/
+void stopWarmup (Warmup *warmup);